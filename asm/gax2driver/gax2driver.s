@@ -172,6 +172,29 @@ InitIntrHandlers:
 
 	.align 2, 0
 	arm_func_start IntrMain
+	.ifdef LEAN_DRIVER
+@ Lean handler: VBlank is the only interrupt that the driver enables, so the
+@ source lookup, the nesting and the IE/IME bookkeeping are left out.
+@ The size and the table position are the same as the full handler.
+IntrMain:
+	mov r3, #REG_BASE
+	add r3, r3, #OFFSET_REG_IE
+	ldrh r0, [r3, #OFFSET_REG_IF - OFFSET_REG_IE]
+	strh r0, [r3, #OFFSET_REG_IF - OFFSET_REG_IE]
+	tst r0, #INTR_FLAG_VBLANK
+	bxeq lr
+	msr cpsr_c, #PSR_I_BIT | PSR_F_BIT | PSR_SYS_MODE
+	stmfd sp!, {lr}
+	ldr r0, IntrTable
+	mov lr, pc
+	bx r0
+	ldmfd sp!, {lr}
+	msr cpsr_c, #PSR_I_BIT | PSR_F_BIT | PSR_IRQ_MODE
+	bx lr
+	.space INTR_MAIN_BUFFER_SIZE - (. - IntrMain)
+IntrTable:
+	.space INTR_TABLE_LENGTH * 4
+	.else
 IntrMain:
 	mov r3, #REG_BASE
 	add r3, r3, #OFFSET_REG_IE
@@ -252,6 +275,7 @@ IntrMain_RetAddr:
 	.pool
 IntrTable:
 	.space INTR_TABLE_LENGTH * 4
+	.endif
 	arm_func_end IntrMain
 
 	thumb_func_start IntrDummy
@@ -0,0 +1,499 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "agb_bus.hpp"
+
+#include <algorithm>
+#include "bytes.hpp"
+
+namespace gaxtapper {
+
+static constexpr int kTimerPrescalerShifts[4] = {0, 6, 8, 10};
+
+AgbBus::AgbBus(std::string_view rom)
+    : rom_(rom),
+      bios_(kBiosSize),
+      ewram_(kEwramSize),
+      iwram_(kIwramSize),
+      io_(kIoSize),
+      palette_(kPaletteSize),
+      vram_(kVramSize),
+      oam_(kOamSize),
+      sram_(kSramSize, 0xff) {
+  WriteInt16L(&io_[kRegKeyinput], 0x3ff);
+  WriteInt16L(&io_[0x088], 0x200);  // SOUNDBIAS
+  UpdateNextEvent();
+}
+
+void AgbBus::RequestInterrupt(std::uint16_t flags) {
+  if_ |= flags;
+  if (interrupt_requested()) halted_ = false;
+}
+
+void AgbBus::ProcessEvents() {
+  while (cycles_ >= next_event_cycle_) {
+    const std::uint64_t video_event =
+        line_start_cycle_ + (hblank_ ? kCyclesPerLine : kHBlankStartCycle);
+
+    std::uint64_t event = video_event;
+    int timer = -1;
+    for (int i = 0; i < 4; i++) {
+      if (timers_[i].next_overflow < event) {
+        event = timers_[i].next_overflow;
+        timer = i;
+      }
+    }
+
+    if (timer >= 0)
+      TimerOverflow(timer, event);
+    else
+      ProcessVideoEvent();
+    UpdateNextEvent();
+  }
+}
+
+void AgbBus::ProcessVideoEvent() {
+  std::uint16_t dispstat = ReadInt16L(&io_[kRegDispstat]);
+  if (!hblank_) {
+    hblank_ = true;
+    dispstat |= 2;
+    WriteInt16L(&io_[kRegDispstat], dispstat);
+    if ((dispstat & 0x10) != 0) RequestInterrupt(kIntrHBlank);
+    if (vcount_ < kVisibleLines) TriggerDma(2);
+    return;
+  }
+
+  hblank_ = false;
+  line_start_cycle_ += kCyclesPerLine;
+  vcount_ = (vcount_ + 1) % kLinesPerFrame;
+  dispstat &= ~2;
+
+  if (vcount_ == kVisibleLines) {
+    dispstat |= 1;
+    if ((dispstat & 0x08) != 0) RequestInterrupt(kIntrVBlank);
+    TriggerDma(1);
+  } else if (vcount_ == kLinesPerFrame - 1) {
+    dispstat &= ~1;
+  }
+
+  if (vcount_ == (dispstat >> 8)) {
+    dispstat |= 4;
+    if ((dispstat & 0x20) != 0) RequestInterrupt(kIntrVCount);
+  } else {
+    dispstat &= ~4;
+  }
+
+  WriteInt16L(&io_[kRegDispstat], dispstat);
+  WriteInt16L(&io_[kRegVcount], static_cast<std::uint16_t>(vcount_));
+}
+
+void AgbBus::UpdateNextEvent() noexcept {
+  std::uint64_t event =
+      line_start_cycle_ + (hblank_ ? kCyclesPerLine : kHBlankStartCycle);
+  for (const Timer& timer : timers_)
+    event = std::min(event, timer.next_overflow);
+  next_event_cycle_ = event;
+}
+
+std::uint8_t AgbBus::ReadSlow8(agbptr_t address) {
+  const std::uint16_t value = ReadSlow16(address & ~1);
+  return static_cast<std::uint8_t>((address & 1) != 0 ? value >> 8 : value);
+}
+
+std::uint16_t AgbBus::ReadSlow16(agbptr_t address) {
+  cycles_ += 1;
+  switch (address >> 24) {
+    case 0x0:
+      return address < kBiosSize ? ReadInt16L(&bios_[address]) : 0;
+    case 0x4:
+      return (address & 0xffffff) < kIoSize ? ReadIo16(address & 0x3fe) : 0;
+    case 0x5:
+      return ReadInt16L(&palette_[address & (kPaletteSize - 1)]);
+    case 0x6: {
+      agbsize_t offset = address & 0x1ffff;
+      if (offset >= kVramSize) offset -= 0x8000;
+      return ReadInt16L(&vram_[offset]);
+    }
+    case 0x7:
+      return ReadInt16L(&oam_[address & (kOamSize - 1)]);
+    case 0xe:
+    case 0xf: {
+      const std::uint8_t value = sram_[address & (kSramSize - 1)];
+      return value | (value << 8);
+    }
+    default:
+      return 0;
+  }
+}
+
+std::uint32_t AgbBus::ReadSlow32(agbptr_t address) {
+  const std::uint32_t lo = ReadSlow16(address);
+  const std::uint32_t hi = ReadSlow16(address + 2);
+  return lo | (hi << 16);
+}
+
+void AgbBus::WriteSlow8(agbptr_t address, std::uint8_t value) {
+  cycles_ += 1;
+  switch (address >> 24) {
+    case 0x4:
+      if ((address & 0xffffff) < kIoSize) WriteIo8(address & 0x3ff, value);
+      break;
+    case 0x5:
+    case 0x6:
+      // 8-bit writes to palette/VRAM are duplicated to the halfword.
+      WriteSlow16(address & ~1, value | (value << 8));
+      break;
+    case 0xe:
+    case 0xf:
+      sram_[address & (kSramSize - 1)] = value;
+      break;
+    default:
+      break;
+  }
+}
+
+void AgbBus::WriteSlow16(agbptr_t address, std::uint16_t value) {
+  cycles_ += 1;
+  switch (address >> 24) {
+    case 0x4:
+      if ((address & 0xffffff) < kIoSize) WriteIo16(address & 0x3fe, value);
+      break;
+    case 0x5:
+      WriteInt16L(&palette_[address & (kPaletteSize - 1)], value);
+      break;
+    case 0x6: {
+      agbsize_t offset = address & 0x1ffff;
+      if (offset >= kVramSize) offset -= 0x8000;
+      WriteInt16L(&vram_[offset], value);
+      break;
+    }
+    case 0x7:
+      WriteInt16L(&oam_[address & (kOamSize - 1)], value);
+      break;
+    case 0xe:
+    case 0xf:
+      sram_[address & (kSramSize - 1)] =
+          static_cast<std::uint8_t>(value >> ((address & 1) * 8));
+      break;
+    default:
+      break;
+  }
+}
+
+void AgbBus::WriteSlow32(agbptr_t address, std::uint32_t value) {
+  WriteSlow16(address, static_cast<std::uint16_t>(value));
+  WriteSlow16(address + 2, static_cast<std::uint16_t>(value >> 16));
+}
+
+std::uint16_t AgbBus::ReadIo16(agbsize_t offset) {
+  if (offset >= kRegTm0 && offset < kRegTm0 + 0x10 && (offset & 2) == 0)
+    return TimerCounter(static_cast<int>((offset - kRegTm0) / 4));
+  if (offset == kRegIf) return if_;
+  return ReadInt16L(&io_[offset]);
+}
+
+void AgbBus::WriteIo8(agbsize_t offset, std::uint8_t value) {
+  if (offset >= kRegFifoA && offset < kRegFifoB + 4) {
+    PushFifo(offset < kRegFifoB ? 0 : 1, value);
+    return;
+  }
+  if (offset == kRegHaltcnt) {
+    halted_ = true;
+    return;
+  }
+  if ((offset & ~1) == kRegIf) {
+    WriteIo16(kRegIf, static_cast<std::uint16_t>(value << ((offset & 1) * 8)));
+    return;
+  }
+
+  const agbsize_t aligned = offset & ~1;
+  std::uint16_t current = ReadInt16L(&io_[aligned]);
+  if ((offset & 1) != 0)
+    current = static_cast<std::uint16_t>((current & 0x00ff) | (value << 8));
+  else
+    current = static_cast<std::uint16_t>((current & 0xff00) | value);
+  WriteIo16(aligned, current);
+}
+
+void AgbBus::WriteIo16(agbsize_t offset, std::uint16_t value) {
+  switch (offset) {
+    case kRegDispstat:
+      WriteInt16L(&io_[offset],
+                  (value & 0xff38) | (ReadInt16L(&io_[offset]) & 7));
+      return;
+    case kRegVcount:
+      return;
+    case kRegSoundcntH:
+      if ((value & 0x0800) != 0) fifo_[0] = Fifo{};
+      if ((value & 0x8000) != 0) fifo_[1] = Fifo{};
+      WriteInt16L(&io_[offset], value & 0x770f);
+      RescheduleTimers();
+      return;
+    case kRegFifoA:
+    case kRegFifoA + 2:
+    case kRegFifoB:
+    case kRegFifoB + 2: {
+      const int fifo = offset < kRegFifoB ? 0 : 1;
+      PushFifo(fifo, static_cast<std::uint8_t>(value));
+      PushFifo(fifo, static_cast<std::uint8_t>(value >> 8));
+      return;
+    }
+    case kRegIf:
+      if_ &= ~value;
+      return;
+    case kRegKeyinput:
+      return;
+    case kRegHaltcnt & ~1:
+      WriteInt16L(&io_[offset], value & 0xff);
+      halted_ = true;
+      return;
+    default:
+      break;
+  }
+
+  if (offset >= kRegDma0 && offset < kRegDma0 + 0x30) {
+    const int channel = static_cast<int>((offset - kRegDma0) / 12);
+    if ((offset - kRegDma0) % 12 == 10) {
+      WriteDmaControl(channel, value);
+      return;
+    }
+  } else if (offset >= kRegTm0 && offset < kRegTm0 + 0x10) {
+    const int index = static_cast<int>((offset - kRegTm0) / 4);
+    if ((offset & 2) == 0) {
+      timers_[index].reload = value;
+      WriteInt16L(&io_[offset], value);
+    } else {
+      WriteTimerControl(index, value);
+    }
+    return;
+  }
+
+  WriteInt16L(&io_[offset], value);
+  if (offset == kRegIe || offset == kRegIme) {
+    if (interrupt_requested()) halted_ = false;
+  }
+}
+
+std::uint16_t AgbBus::TimerCounter(int index) {
+  Timer& timer = timers_[index];
+  if ((timer.control & 0x80) == 0 || (index > 0 && (timer.control & 4) != 0))
+    return timer.counter;
+
+  const int shift = kTimerPrescalerShifts[timer.control & 3];
+  const std::uint64_t period =
+      static_cast<std::uint64_t>(0x10000 - timer.reload) << shift;
+  if (timer.next_overflow != kNever && cycles_ >= timer.next_overflow) {
+    // Catch up with the overflows that are not scheduled as events.
+    const std::uint64_t elapsed = (cycles_ - timer.next_overflow) / period;
+    timer.base_cycle = timer.next_overflow + elapsed * period;
+    timer.counter = timer.reload;
+    timer.next_overflow = timer.base_cycle + period;
+  } else if (timer.next_overflow == kNever) {
+    const std::uint64_t ticks = (cycles_ - timer.base_cycle) >> shift;
+    const std::uint64_t range = 0x10000 - timer.reload;
+    const std::uint64_t first = 0x10000 - timer.counter;
+    if (ticks < first)
+      return static_cast<std::uint16_t>(timer.counter + ticks);
+    return static_cast<std::uint16_t>(timer.reload + (ticks - first) % range);
+  }
+  return static_cast<std::uint16_t>(
+      timer.counter + ((cycles_ - timer.base_cycle) >> shift));
+}
+
+bool AgbBus::TimerIsObserved(int index) const noexcept {
+  if ((timers_[index].control & 0x40) != 0) return true;
+  if (index < 2) {
+    const std::uint16_t soundcnt_h = ReadInt16L(&io_[kRegSoundcntH]);
+    if (((soundcnt_h >> 10) & 1) == index || ((soundcnt_h >> 14) & 1) == index)
+      return true;
+  }
+  return false;
+}
+
+bool AgbBus::TimerIsScheduled(int index) const noexcept {
+  const Timer& timer = timers_[index];
+  if ((timer.control & 0x80) == 0) return false;
+  if (index > 0 && (timer.control & 4) != 0) return false;
+  if (TimerIsObserved(index)) return true;
+
+  // Overflows also have to be delivered to the observed count-up timers.
+  for (int next = index + 1; next < 4; next++) {
+    if ((timers_[next].control & 0x84) != 0x84) break;
+    if (TimerIsObserved(next)) return true;
+  }
+  return false;
+}
+
+void AgbBus::RescheduleTimers() {
+  for (int i = 0; i < 4; i++) {
+    Timer& timer = timers_[i];
+    if ((timer.control & 0x80) == 0 || (i > 0 && (timer.control & 4) != 0)) {
+      timer.next_overflow = kNever;
+      continue;
+    }
+
+    // Re-base the counter at the current cycle.
+    timer.counter = TimerCounter(i);
+    timer.base_cycle = cycles_;
+    const int shift = kTimerPrescalerShifts[timer.control & 3];
+    timer.next_overflow =
+        TimerIsScheduled(i)
+            ? cycles_ + (static_cast<std::uint64_t>(0x10000 - timer.counter)
+                         << shift)
+            : kNever;
+  }
+  UpdateNextEvent();
+}
+
+void AgbBus::WriteTimerControl(int index, std::uint16_t control) {
+  Timer& timer = timers_[index];
+  const bool was_running = (timer.control & 0x80) != 0;
+  if (was_running) {
+    timer.counter = TimerCounter(index);
+  }
+  if (!was_running && (control & 0x80) != 0) {
+    timer.counter = timer.reload;
+  }
+  timer.base_cycle = cycles_;
+  timer.control = control & 0xc7;
+  WriteInt16L(&io_[kRegTm0 + index * 4 + 2], timer.control);
+  timer.next_overflow = kNever;
+  RescheduleTimers();
+}
+
+void AgbBus::TimerOverflow(int index, std::uint64_t cycle) {
+  Timer& timer = timers_[index];
+  const int shift = kTimerPrescalerShifts[timer.control & 3];
+  timer.counter = timer.reload;
+  timer.base_cycle = cycle;
+  timer.next_overflow =
+      cycle + (static_cast<std::uint64_t>(0x10000 - timer.reload) << shift);
+  TimerTick(index, cycle);
+}
+
+void AgbBus::TimerTick(int index, std::uint64_t cycle) {
+  Timer& timer = timers_[index];
+  if ((timer.control & 0x40) != 0)
+    RequestInterrupt(static_cast<std::uint16_t>(kIntrTimer0 << index));
+
+  if (index < 2) {
+    const std::uint16_t soundcnt_h = ReadInt16L(&io_[kRegSoundcntH]);
+    if (((soundcnt_h >> 10) & 1) == index) ConsumeFifo(0);
+    if (((soundcnt_h >> 14) & 1) == index) ConsumeFifo(1);
+  }
+
+  if (index < 3) {
+    Timer& next = timers_[index + 1];
+    if ((next.control & 0x84) == 0x84) {
+      if (next.counter == 0xffff) {
+        next.counter = next.reload;
+        TimerTick(index + 1, cycle);
+      } else {
+        next.counter++;
+      }
+    }
+  }
+}
+
+void AgbBus::WriteDmaControl(int channel, std::uint16_t control) {
+  const agbsize_t base = kRegDma0 + channel * 12;
+  const std::uint16_t previous = ReadInt16L(&io_[base + 10]);
+  WriteInt16L(&io_[base + 10], control);
+  if ((previous & 0x8000) != 0 || (control & 0x8000) == 0) return;
+
+  Dma& dma = dma_[channel];
+  dma.source = ReadInt32L(&io_[base]) & (channel == 0 ? 0x7ffffff : 0xfffffff);
+  dma.dest = ReadInt32L(&io_[base + 4]) & (channel == 3 ? 0xfffffff : 0x7ffffff);
+  dma.count = ReadInt16L(&io_[base + 8]);
+  if (channel != 3) dma.count &= 0x3fff;
+  if (dma.count == 0) dma.count = channel == 3 ? 0x10000 : 0x4000;
+
+  if (((control >> 12) & 3) == 0) TransferDma(channel);
+}
+
+void AgbBus::TriggerDma(int timing) {
+  for (int channel = 0; channel < 4; channel++) {
+    const std::uint16_t control =
+        ReadInt16L(&io_[kRegDma0 + channel * 12 + 10]);
+    if ((control & 0x8000) != 0 && ((control >> 12) & 3) == timing)
+      TransferDma(channel);
+  }
+}
+
+void AgbBus::TransferDma(int channel) {
+  const agbsize_t base = kRegDma0 + channel * 12;
+  std::uint16_t control = ReadInt16L(&io_[base + 10]);
+  Dma& dma = dma_[channel];
+
+  const int timing = (control >> 12) & 3;
+  const bool fifo = timing == 3 && (channel == 1 || channel == 2);
+  const bool word = fifo || (control & 0x400) != 0;
+  const agbsize_t unit = word ? 4 : 2;
+  const std::uint32_t count = fifo ? 4 : dma.count;
+  const int dest_control = fifo ? 2 : (control >> 5) & 3;
+  const int source_control = (control >> 7) & 3;
+
+  for (std::uint32_t i = 0; i < count; i++) {
+    if (word)
+      Write32(dma.dest, Read32(dma.source));
+    else
+      Write16(dma.dest, Read16(dma.source));
+
+    if (source_control == 0)
+      dma.source += unit;
+    else if (source_control == 1)
+      dma.source -= unit;
+
+    if (dest_control == 0 || dest_control == 3)
+      dma.dest += unit;
+    else if (dest_control == 1)
+      dma.dest -= unit;
+  }
+  cycles_ += 2;
+
+  if ((control & 0x4000) != 0)
+    RequestInterrupt(static_cast<std::uint16_t>(kIntrDma0 << channel));
+
+  if ((control & 0x200) != 0 && timing != 0) {
+    if (!fifo) {
+      dma.count = ReadInt16L(&io_[base + 8]);
+      if (channel != 3) dma.count &= 0x3fff;
+      if (dma.count == 0) dma.count = channel == 3 ? 0x10000 : 0x4000;
+    }
+    if (dest_control == 3) dma.dest = ReadInt32L(&io_[base + 4]);
+  } else {
+    control &= 0x7fff;
+    WriteInt16L(&io_[base + 10], control);
+  }
+}
+
+void AgbBus::PushFifo(int fifo, std::uint8_t value) {
+  Fifo& f = fifo_[fifo];
+  if (f.size >= static_cast<int>(f.data.size())) return;
+  f.data[(f.read + f.size) % f.data.size()] = static_cast<std::int8_t>(value);
+  f.size++;
+}
+
+void AgbBus::ConsumeFifo(int fifo) {
+  Fifo& f = fifo_[fifo];
+  std::int8_t sample = 0;
+  if (f.size > 0) {
+    sample = f.data[f.read];
+    f.read = (f.read + 1) % static_cast<int>(f.data.size());
+    f.size--;
+  }
+  if (sound_sink_ != nullptr) sound_sink_->OnSample(fifo, sample);
+
+  if (f.size <= 16) {
+    const agbptr_t fifo_address = 0x4000000 | (fifo == 0 ? kRegFifoA : kRegFifoB);
+    for (int channel = 1; channel <= 2; channel++) {
+      const std::uint16_t control =
+          ReadInt16L(&io_[kRegDma0 + channel * 12 + 10]);
+      if ((control & 0xb000) == 0xb000 && dma_[channel].dest == fifo_address) {
+        TransferDma(channel);
+        break;
+      }
+    }
+  }
+}
+
+}  // namespace gaxtapper
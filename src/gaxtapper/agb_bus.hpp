@@ -0,0 +1,363 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_AGB_BUS_HPP_
+#define GAXTAPPER_AGB_BUS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "bytes.hpp"
+#include "rom_coverage.hpp"
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// Receives notifications of writes to a watched RAM range.
+class AgbWriteObserver {
+ public:
+  virtual ~AgbWriteObserver() = default;
+  virtual void OnWrite(agbptr_t address, agbsize_t size) = 0;
+};
+
+// Receives the samples consumed by the direct sound FIFOs.
+class AgbSoundSink {
+ public:
+  virtual ~AgbSoundSink() = default;
+  virtual void OnSample(int fifo, std::int8_t sample) = 0;
+};
+
+// Memory map and the minimum set of I/O devices (video timing, timers, DMA,
+// direct sound FIFOs and interrupts) that a sound driver relies on.
+class AgbBus {
+ public:
+  static constexpr agbsize_t kBiosSize = 0x4000;
+  static constexpr agbsize_t kEwramSize = 0x40000;
+  static constexpr agbsize_t kIwramSize = 0x8000;
+  static constexpr agbsize_t kIoSize = 0x400;
+  static constexpr agbsize_t kPaletteSize = 0x400;
+  static constexpr agbsize_t kVramSize = 0x18000;
+  static constexpr agbsize_t kOamSize = 0x400;
+  static constexpr agbsize_t kSramSize = 0x10000;
+
+  static constexpr std::uint32_t kCyclesPerLine = 1232;
+  static constexpr std::uint32_t kHBlankStartCycle = 1006;
+  static constexpr std::uint32_t kLinesPerFrame = 228;
+  static constexpr std::uint32_t kVisibleLines = 160;
+  static constexpr std::uint32_t kCyclesPerFrame =
+      kCyclesPerLine * kLinesPerFrame;
+
+  static constexpr std::uint16_t kIntrVBlank = 1 << 0;
+  static constexpr std::uint16_t kIntrHBlank = 1 << 1;
+  static constexpr std::uint16_t kIntrVCount = 1 << 2;
+  static constexpr std::uint16_t kIntrTimer0 = 1 << 3;
+  static constexpr std::uint16_t kIntrDma0 = 1 << 8;
+
+  explicit AgbBus(std::string_view rom);
+
+  [[nodiscard]] std::uint64_t cycles() const noexcept { return cycles_; }
+  void AddCycles(std::uint32_t cycles) noexcept { cycles_ += cycles; }
+
+  [[nodiscard]] std::uint64_t next_event_cycle() const noexcept {
+    return next_event_cycle_;
+  }
+
+  [[nodiscard]] bool halted() const noexcept { return halted_; }
+  void Halt() noexcept { halted_ = true; }
+
+  // Returns true when an enabled interrupt is being requested, regardless of
+  // IME. This is the condition that wakes the CPU from the halt state.
+  [[nodiscard]] bool interrupt_requested() const noexcept {
+    return (ie() & if_) != 0;
+  }
+
+  // Returns true when the CPU should take an IRQ exception (CPSR permitting).
+  [[nodiscard]] bool irq_line() const noexcept {
+    return (ReadInt16L(&io_[kRegIme]) & 1) != 0 && interrupt_requested();
+  }
+
+  void RequestInterrupt(std::uint16_t flags);
+
+  // Advances the devices to the current cycle, dispatching all events that
+  // are due. Clears the halt state when an interrupt is requested.
+  void ProcessEvents();
+
+  // Skips the idle time until the next device event.
+  void SkipToNextEvent() noexcept {
+    if (cycles_ < next_event_cycle_) cycles_ = next_event_cycle_;
+  }
+
+  [[nodiscard]] std::uint8_t* bios() noexcept { return bios_.data(); }
+  [[nodiscard]] std::uint8_t* ewram() noexcept { return ewram_.data(); }
+  [[nodiscard]] std::uint8_t* iwram() noexcept { return iwram_.data(); }
+  [[nodiscard]] std::string_view rom() const noexcept { return rom_; }
+
+  // Replaces a small range of the ROM image with the given bytes, without
+  // copying the whole ROM (used for the minigsf program block).
+  void set_rom_overlay(agbptr_t address, std::string_view data) noexcept {
+    overlay_offset_ = to_offset(address);
+    overlay_ = data;
+  }
+
+  void set_rom_coverage(RomCoverage* coverage) noexcept {
+    coverage_ = coverage;
+  }
+
+  void set_write_observer(AgbWriteObserver* observer, agbptr_t begin,
+                          agbptr_t end) noexcept {
+    write_observer_ = observer;
+    watch_begin_ = begin;
+    watch_size_ = end - begin;
+  }
+
+  void set_sound_sink(AgbSoundSink* sink) noexcept { sound_sink_ = sink; }
+
+  std::uint8_t Read8(agbptr_t address) {
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 3;
+        return ewram_[address & (kEwramSize - 1)];
+      case 0x3:
+        cycles_ += 1;
+        return iwram_[address & (kIwramSize - 1)];
+      case 0x8: case 0x9: case 0xa: case 0xb: case 0xc: case 0xd: {
+        cycles_ += 3;
+        const agbsize_t offset = address & 0x1ffffff;
+        if (offset >= rom_.size()) return static_cast<std::uint8_t>(address >> ((address & 1) * 8 + 1));
+        if (coverage_ != nullptr) coverage_->Mark(offset, 1);
+        return ReadRom8(offset);
+      }
+      default:
+        return ReadSlow8(address);
+    }
+  }
+
+  std::uint16_t Read16(agbptr_t address) {
+    address &= ~1;
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 3;
+        return ReadInt16L(&ewram_[address & (kEwramSize - 1)]);
+      case 0x3:
+        cycles_ += 1;
+        return ReadInt16L(&iwram_[address & (kIwramSize - 1)]);
+      case 0x8: case 0x9: case 0xa: case 0xb: case 0xc: case 0xd: {
+        cycles_ += 3;
+        const agbsize_t offset = address & 0x1ffffff;
+        if (offset >= rom_.size()) return static_cast<std::uint16_t>(address >> 1);
+        if (coverage_ != nullptr) coverage_->Mark(offset, 2);
+        return ReadRom16(offset);
+      }
+      default:
+        return ReadSlow16(address);
+    }
+  }
+
+  std::uint32_t Read32(agbptr_t address) {
+    address &= ~3;
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 6;
+        return ReadInt32L(&ewram_[address & (kEwramSize - 1)]);
+      case 0x3:
+        cycles_ += 1;
+        return ReadInt32L(&iwram_[address & (kIwramSize - 1)]);
+      case 0x8: case 0x9: case 0xa: case 0xb: case 0xc: case 0xd: {
+        cycles_ += 6;
+        const agbsize_t offset = address & 0x1ffffff;
+        if (offset >= rom_.size())
+          return ((address >> 1) & 0xffff) | (((address >> 1) + 1) << 16);
+        if (coverage_ != nullptr) coverage_->Mark(offset, 4);
+        return ReadRom32(offset);
+      }
+      default:
+        return ReadSlow32(address);
+    }
+  }
+
+  void Write8(agbptr_t address, std::uint8_t value) {
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 3;
+        Notify(0x2000000 | (address & (kEwramSize - 1)), 1);
+        ewram_[address & (kEwramSize - 1)] = value;
+        break;
+      case 0x3:
+        cycles_ += 1;
+        Notify(0x3000000 | (address & (kIwramSize - 1)), 1);
+        iwram_[address & (kIwramSize - 1)] = value;
+        break;
+      default:
+        WriteSlow8(address, value);
+        break;
+    }
+  }
+
+  void Write16(agbptr_t address, std::uint16_t value) {
+    address &= ~1;
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 3;
+        Notify(0x2000000 | (address & (kEwramSize - 1)), 2);
+        WriteInt16L(&ewram_[address & (kEwramSize - 1)], value);
+        break;
+      case 0x3:
+        cycles_ += 1;
+        Notify(0x3000000 | (address & (kIwramSize - 1)), 2);
+        WriteInt16L(&iwram_[address & (kIwramSize - 1)], value);
+        break;
+      default:
+        WriteSlow16(address, value);
+        break;
+    }
+  }
+
+  void Write32(agbptr_t address, std::uint32_t value) {
+    address &= ~3;
+    switch (address >> 24) {
+      case 0x2:
+        cycles_ += 6;
+        Notify(0x2000000 | (address & (kEwramSize - 1)), 4);
+        WriteInt32L(&ewram_[address & (kEwramSize - 1)], value);
+        break;
+      case 0x3:
+        cycles_ += 1;
+        Notify(0x3000000 | (address & (kIwramSize - 1)), 4);
+        WriteInt32L(&iwram_[address & (kIwramSize - 1)], value);
+        break;
+      default:
+        WriteSlow32(address, value);
+        break;
+    }
+  }
+
+ private:
+  static constexpr agbsize_t kRegDispstat = 0x004;
+  static constexpr agbsize_t kRegVcount = 0x006;
+  static constexpr agbsize_t kRegSoundcntH = 0x082;
+  static constexpr agbsize_t kRegFifoA = 0x0a0;
+  static constexpr agbsize_t kRegFifoB = 0x0a4;
+  static constexpr agbsize_t kRegDma0 = 0x0b0;
+  static constexpr agbsize_t kRegTm0 = 0x100;
+  static constexpr agbsize_t kRegKeyinput = 0x130;
+  static constexpr agbsize_t kRegIe = 0x200;
+  static constexpr agbsize_t kRegIf = 0x202;
+  static constexpr agbsize_t kRegIme = 0x208;
+  static constexpr agbsize_t kRegHaltcnt = 0x301;
+
+  static constexpr std::uint64_t kNever =
+      std::numeric_limits<std::uint64_t>::max();
+
+  struct Timer {
+    std::uint16_t reload = 0;
+    std::uint16_t control = 0;
+    std::uint16_t counter = 0;  // value at base_cycle
+    std::uint64_t base_cycle = 0;
+    std::uint64_t next_overflow = kNever;
+  };
+
+  struct Dma {
+    agbptr_t source = 0;
+    agbptr_t dest = 0;
+    std::uint32_t count = 0;
+  };
+
+  struct Fifo {
+    std::array<std::int8_t, 32> data{};
+    int read = 0;
+    int size = 0;
+  };
+
+  std::string_view rom_;
+  std::string_view overlay_;
+  agbsize_t overlay_offset_ = 0;
+  std::vector<std::uint8_t> bios_;
+  std::vector<std::uint8_t> ewram_;
+  std::vector<std::uint8_t> iwram_;
+  std::vector<std::uint8_t> io_;
+  std::vector<std::uint8_t> palette_;
+  std::vector<std::uint8_t> vram_;
+  std::vector<std::uint8_t> oam_;
+  std::vector<std::uint8_t> sram_;
+
+  std::uint64_t cycles_ = 0;
+  std::uint64_t next_event_cycle_ = 0;
+  std::uint64_t line_start_cycle_ = 0;
+  std::uint32_t vcount_ = 0;
+  bool hblank_ = false;
+  bool halted_ = false;
+  std::uint16_t if_ = 0;
+  std::array<Timer, 4> timers_{};
+  std::array<Dma, 4> dma_{};
+  std::array<Fifo, 2> fifo_{};
+
+  RomCoverage* coverage_ = nullptr;
+  AgbWriteObserver* write_observer_ = nullptr;
+  agbptr_t watch_begin_ = 0;
+  agbsize_t watch_size_ = 0;
+  AgbSoundSink* sound_sink_ = nullptr;
+
+  [[nodiscard]] std::uint16_t ie() const noexcept {
+    return ReadInt16L(&io_[kRegIe]);
+  }
+
+  void Notify(agbptr_t address, agbsize_t size) {
+    if (write_observer_ != nullptr && address - watch_begin_ < watch_size_)
+      write_observer_->OnWrite(address, size);
+  }
+
+  [[nodiscard]] std::uint8_t ReadRom8(agbsize_t offset) const noexcept {
+    if (offset - overlay_offset_ < overlay_.size())
+      return static_cast<std::uint8_t>(overlay_[offset - overlay_offset_]);
+    return static_cast<std::uint8_t>(rom_[offset]);
+  }
+
+  [[nodiscard]] std::uint16_t ReadRom16(agbsize_t offset) const noexcept {
+    if (offset + 2 - overlay_offset_ < overlay_.size() + 2 ||
+        offset + 1 >= rom_.size())
+      return ReadRom8(offset) | (ReadRom8(offset + 1) << 8);
+    return ReadInt16L(&rom_[offset]);
+  }
+
+  [[nodiscard]] std::uint32_t ReadRom32(agbsize_t offset) const noexcept {
+    if (offset + 4 - overlay_offset_ < overlay_.size() + 4 ||
+        offset + 3 >= rom_.size())
+      return ReadRom16(offset) | (ReadRom16(offset + 2) << 16);
+    return ReadInt32L(&rom_[offset]);
+  }
+
+  std::uint8_t ReadSlow8(agbptr_t address);
+  std::uint16_t ReadSlow16(agbptr_t address);
+  std::uint32_t ReadSlow32(agbptr_t address);
+  void WriteSlow8(agbptr_t address, std::uint8_t value);
+  void WriteSlow16(agbptr_t address, std::uint16_t value);
+  void WriteSlow32(agbptr_t address, std::uint32_t value);
+
+  std::uint16_t ReadIo16(agbsize_t offset);
+  void WriteIo8(agbsize_t offset, std::uint8_t value);
+  void WriteIo16(agbsize_t offset, std::uint16_t value);
+
+  [[nodiscard]] std::uint16_t TimerCounter(int index);
+  void WriteTimerControl(int index, std::uint16_t control);
+  [[nodiscard]] bool TimerIsObserved(int index) const noexcept;
+  [[nodiscard]] bool TimerIsScheduled(int index) const noexcept;
+  void RescheduleTimers();
+  void TimerOverflow(int index, std::uint64_t cycle);
+  void TimerTick(int index, std::uint64_t cycle);
+
+  void WriteDmaControl(int channel, std::uint16_t control);
+  void TriggerDma(int timing);
+  void TransferDma(int channel);
+
+  void PushFifo(int fifo, std::uint8_t value);
+  void ConsumeFifo(int fifo);
+
+  void UpdateNextEvent() noexcept;
+  void ProcessVideoEvent();
+};
+
+}  // namespace gaxtapper
+
+#endif
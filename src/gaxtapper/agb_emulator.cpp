@@ -0,0 +1,314 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "agb_emulator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include "bytes.hpp"
+
+namespace gaxtapper {
+
+static constexpr agbptr_t kBiosIntrFlags = 0x3007ff8;
+static constexpr agbptr_t kRegIme = 0x4000208;
+
+// M_PI is not defined by every compiler.
+static constexpr double kPi = 3.14159265358979323846;
+
+// IRQ vector and the interrupt dispatcher of the BIOS, which saves the
+// registers and calls the handler stored at 0x3007FFC.
+static constexpr std::uint32_t kBiosIrqVector = 0xea000042;  // b 0x128
+static constexpr agbsize_t kBiosIrqHandlerOffset = 0x128;
+static constexpr std::uint32_t kBiosIrqHandler[] = {
+    0xe92d500f,  // stmfd sp!, {r0-r3, r12, lr}
+    0xe3a00301,  // mov r0, #0x4000000
+    0xe28fe000,  // add lr, pc, #0
+    0xe510f004,  // ldr pc, [r0, #-4]
+    0xe8bd500f,  // ldmfd sp!, {r0-r3, r12, lr}
+    0xe25ef004,  // subs pc, lr, #4
+};
+
+AgbEmulator::AgbEmulator(std::string_view rom) : bus_(rom), cpu_(bus_) {
+  WriteInt32L(bus_.bios() + 0x18, kBiosIrqVector);
+  for (std::size_t i = 0; i < std::size(kBiosIrqHandler); i++)
+    WriteInt32L(bus_.bios() + kBiosIrqHandlerOffset + i * 4,
+                kBiosIrqHandler[i]);
+  cpu_.set_swi_handler(this);
+  Reset();
+}
+
+void AgbEmulator::Reset(agbptr_t entrypoint) {
+  cpu_.Reset(entrypoint);
+  intr_wait_flags_ = 0;
+}
+
+bool AgbEmulator::Run(std::uint64_t cycles) {
+  const std::uint64_t end = bus_.cycles() + cycles;
+  while (bus_.cycles() < end) {
+    if (cpu_.faulted()) return false;
+
+    if (bus_.halted()) {
+      if (bus_.next_event_cycle() <= end)
+        bus_.SkipToNextEvent();
+      else
+        bus_.AddCycles(static_cast<std::uint32_t>(end - bus_.cycles()));
+    } else {
+      const std::uint64_t limit = std::min(end, bus_.next_event_cycle());
+      const std::uint64_t start = bus_.cycles();
+      while (bus_.cycles() < limit && !bus_.halted() && !cpu_.faulted())
+        cpu_.Step();
+      active_cycles_ += bus_.cycles() - start;
+    }
+    bus_.ProcessEvents();
+  }
+  return !cpu_.faulted();
+}
+
+void AgbEmulator::HandleSwi(Arm7Tdmi& cpu, std::uint8_t number) {
+  switch (number) {
+    case 0x00:  // SoftReset
+      Reset();
+      break;
+
+    case 0x01:
+      RegisterRamReset(cpu.reg(0));
+      break;
+
+    case 0x02:  // Halt
+    case 0x03:  // Stop
+      bus_.Halt();
+      break;
+
+    case 0x04:
+      IntrWait(cpu.reg(0) != 0, static_cast<std::uint16_t>(cpu.reg(1)));
+      break;
+
+    case 0x05:  // VBlankIntrWait
+      IntrWait(true, AgbBus::kIntrVBlank);
+      break;
+
+    case 0x06:
+      Div(static_cast<std::int32_t>(cpu.reg(0)),
+          static_cast<std::int32_t>(cpu.reg(1)));
+      break;
+
+    case 0x07:  // DivArm
+      Div(static_cast<std::int32_t>(cpu.reg(1)),
+          static_cast<std::int32_t>(cpu.reg(0)));
+      break;
+
+    case 0x08:  // Sqrt
+      cpu.set_reg(0, static_cast<std::uint32_t>(
+                         std::sqrt(static_cast<double>(cpu.reg(0)))));
+      bus_.AddCycles(100);
+      break;
+
+    case 0x09: {  // ArcTan
+      const double tan =
+          static_cast<std::int16_t>(cpu.reg(0)) / static_cast<double>(0x4000);
+      const double angle = std::atan(tan) / (kPi / 2) * 0x4000;
+      cpu.set_reg(0, static_cast<std::uint32_t>(std::lround(angle)));
+      bus_.AddCycles(100);
+      break;
+    }
+
+    case 0x0a: {  // ArcTan2
+      const double x = static_cast<std::int16_t>(cpu.reg(0));
+      const double y = static_cast<std::int16_t>(cpu.reg(1));
+      double angle = std::atan2(y, x);
+      if (angle < 0) angle += 2 * kPi;
+      cpu.set_reg(0, static_cast<std::uint32_t>(
+                         std::lround(angle / (2 * kPi) * 0x10000)) &
+                         0xffff);
+      bus_.AddCycles(100);
+      break;
+    }
+
+    case 0x0b:
+      CpuSet(cpu.reg(0), cpu.reg(1), cpu.reg(2));
+      break;
+
+    case 0x0c:
+      CpuFastSet(cpu.reg(0), cpu.reg(1), cpu.reg(2));
+      break;
+
+    case 0x0d:  // GetBiosChecksum
+      cpu.set_reg(0, 0xbaae187f);
+      break;
+
+    case 0x11:
+    case 0x12:
+      LZ77UnComp(cpu.reg(0), cpu.reg(1));
+      break;
+
+    case 0x14:
+    case 0x15:
+      RLUnComp(cpu.reg(0), cpu.reg(1));
+      break;
+
+    default:
+      // The remaining calls (sound, affine, etc.) are not used by the driver.
+      break;
+  }
+}
+
+void AgbEmulator::RegisterRamReset(std::uint32_t flags) {
+  if ((flags & 0x01) != 0)
+    std::fill_n(bus_.ewram(), AgbBus::kEwramSize, std::uint8_t{0});
+  if ((flags & 0x02) != 0)
+    std::fill_n(bus_.iwram(), AgbBus::kIwramSize - 0x200, std::uint8_t{0});
+
+  struct Region {
+    std::uint32_t flag;
+    agbptr_t address;
+    agbsize_t size;
+  };
+  static constexpr Region kRegions[] = {
+      {0x04, 0x5000000, AgbBus::kPaletteSize},
+      {0x08, 0x6000000, AgbBus::kVramSize},
+      {0x10, 0x7000000, AgbBus::kOamSize},
+  };
+  for (const Region& region : kRegions) {
+    if ((flags & region.flag) == 0) continue;
+    for (agbsize_t i = 0; i < region.size; i += 4)
+      bus_.Write32(region.address + i, 0);
+  }
+}
+
+void AgbEmulator::IntrWait(bool discard, std::uint16_t flags) {
+  bus_.Write16(kRegIme, 1);
+
+  // The wait is emulated by halting and re-executing the SWI instruction
+  // after each interrupt, until the requested flag is set by the handler.
+  if (intr_wait_flags_ == 0 && discard) {
+    bus_.Write16(kBiosIntrFlags,
+                 static_cast<std::uint16_t>(bus_.Read16(kBiosIntrFlags) & ~flags));
+  }
+
+  const std::uint16_t current = bus_.Read16(kBiosIntrFlags);
+  if ((current & flags) != 0) {
+    bus_.Write16(kBiosIntrFlags, static_cast<std::uint16_t>(current & ~flags));
+    intr_wait_flags_ = 0;
+    return;
+  }
+
+  intr_wait_flags_ = flags;
+  cpu_.RewindInstruction();
+  bus_.Halt();
+}
+
+void AgbEmulator::Div(std::int32_t numerator, std::int32_t denominator) {
+  std::int32_t quotient;
+  std::int32_t remainder;
+  if (denominator == 0) {
+    quotient = numerator < 0 ? -1 : 1;
+    remainder = numerator;
+  } else if (numerator == std::numeric_limits<std::int32_t>::min() &&
+             denominator == -1) {
+    quotient = numerator;
+    remainder = 0;
+  } else {
+    quotient = numerator / denominator;
+    remainder = numerator % denominator;
+  }
+  cpu_.set_reg(0, static_cast<std::uint32_t>(quotient));
+  cpu_.set_reg(1, static_cast<std::uint32_t>(remainder));
+  cpu_.set_reg(3, quotient < 0 ? 0u - static_cast<std::uint32_t>(quotient)
+                               : static_cast<std::uint32_t>(quotient));
+  bus_.AddCycles(50);
+}
+
+void AgbEmulator::CpuSet(agbptr_t source, agbptr_t dest,
+                         std::uint32_t control) {
+  const std::uint32_t count = control & 0x1fffff;
+  const bool fill = (control & 0x1000000) != 0;
+  if ((control & 0x4000000) != 0) {
+    source &= ~3u;
+    dest &= ~3u;
+    const std::uint32_t value = bus_.Read32(source);
+    for (std::uint32_t i = 0; i < count; i++) {
+      bus_.Write32(dest + i * 4, fill ? value : bus_.Read32(source + i * 4));
+    }
+  } else {
+    source &= ~1u;
+    dest &= ~1u;
+    const std::uint16_t value = bus_.Read16(source);
+    for (std::uint32_t i = 0; i < count; i++) {
+      bus_.Write16(dest + i * 2, fill ? value : bus_.Read16(source + i * 2));
+    }
+  }
+}
+
+void AgbEmulator::CpuFastSet(agbptr_t source, agbptr_t dest,
+                             std::uint32_t control) {
+  const std::uint32_t count = ((control & 0x1fffff) + 7) & ~7u;
+  CpuSet(source, dest, (control & 0x1000000) | 0x4000000 | count);
+}
+
+void AgbEmulator::LZ77UnComp(agbptr_t source, agbptr_t dest) {
+  const std::uint32_t header = bus_.Read32(source);
+  const std::uint32_t size = header >> 8;
+  source += 4;
+
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    std::uint8_t flags = bus_.Read8(source++);
+    for (int block = 0; block < 8 && data.size() < size; block++) {
+      if ((flags & 0x80) != 0) {
+        const std::uint8_t b0 = bus_.Read8(source++);
+        const std::uint8_t b1 = bus_.Read8(source++);
+        const std::size_t length = (b0 >> 4) + 3;
+        const std::size_t distance = (((b0 & 0xf) << 8) | b1) + 1;
+        for (std::size_t i = 0; i < length && data.size() < size; i++) {
+          data.push_back(distance <= data.size() ? data[data.size() - distance]
+                                                 : '\0');
+        }
+      } else {
+        data.push_back(static_cast<char>(bus_.Read8(source++)));
+      }
+      flags <<= 1;
+    }
+  }
+  WriteBytes(dest, data);
+}
+
+void AgbEmulator::RLUnComp(agbptr_t source, agbptr_t dest) {
+  const std::uint32_t header = bus_.Read32(source);
+  const std::uint32_t size = header >> 8;
+  source += 4;
+
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    const std::uint8_t flag = bus_.Read8(source++);
+    if ((flag & 0x80) != 0) {
+      const std::size_t length = (flag & 0x7f) + 3;
+      const char value = static_cast<char>(bus_.Read8(source++));
+      data.append(std::min<std::size_t>(length, size - data.size()), value);
+    } else {
+      const std::size_t length = (flag & 0x7f) + 1;
+      for (std::size_t i = 0; i < length && data.size() < size; i++)
+        data.push_back(static_cast<char>(bus_.Read8(source++)));
+    }
+  }
+  WriteBytes(dest, data);
+}
+
+void AgbEmulator::WriteBytes(agbptr_t dest, const std::string& data) {
+  // Write in halfwords so that the result is also valid for VRAM.
+  std::size_t i = 0;
+  for (; i + 1 < data.size(); i += 2) {
+    bus_.Write16(dest + static_cast<agbptr_t>(i),
+                 static_cast<std::uint16_t>(
+                     static_cast<std::uint8_t>(data[i]) |
+                     (static_cast<std::uint8_t>(data[i + 1]) << 8)));
+  }
+  if (i < data.size())
+    bus_.Write8(dest + static_cast<agbptr_t>(i),
+                static_cast<std::uint8_t>(data[i]));
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,66 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_AGB_EMULATOR_HPP_
+#define GAXTAPPER_AGB_EMULATOR_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "agb_bus.hpp"
+#include "arm7tdmi.hpp"
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// Minimal GBA machine for running a GSF program: the CPU, the bus and a
+// high-level emulation of the BIOS calls.
+class AgbEmulator : private Arm7SwiHandler {
+ public:
+  static constexpr std::uint32_t kCpuClock = 16777216;
+  static constexpr std::uint32_t kCyclesPerFrame = AgbBus::kCyclesPerFrame;
+
+  explicit AgbEmulator(std::string_view rom);
+
+  AgbEmulator(const AgbEmulator&) = delete;
+  AgbEmulator& operator=(const AgbEmulator&) = delete;
+
+  [[nodiscard]] AgbBus& bus() noexcept { return bus_; }
+  [[nodiscard]] Arm7Tdmi& cpu() noexcept { return cpu_; }
+
+  // Puts the machine in the post-boot state and starts at the entrypoint.
+  void Reset(agbptr_t entrypoint = 0x8000000);
+
+  // Runs the machine for the given number of cycles. Returns false when the
+  // CPU has stopped on an instruction that cannot be executed.
+  bool Run(std::uint64_t cycles);
+
+  bool RunFrames(std::uint32_t frames) {
+    return Run(static_cast<std::uint64_t>(frames) * kCyclesPerFrame);
+  }
+
+  // The number of cycles in which the CPU was not halted.
+  [[nodiscard]] std::uint64_t active_cycles() const noexcept {
+    return active_cycles_;
+  }
+
+ private:
+  AgbBus bus_;
+  Arm7Tdmi cpu_;
+  std::uint64_t active_cycles_ = 0;
+  std::uint16_t intr_wait_flags_ = 0;
+
+  void HandleSwi(Arm7Tdmi& cpu, std::uint8_t number) override;
+
+  void RegisterRamReset(std::uint32_t flags);
+  void IntrWait(bool discard, std::uint16_t flags);
+  void Div(std::int32_t numerator, std::int32_t denominator);
+  void CpuSet(agbptr_t source, agbptr_t dest, std::uint32_t control);
+  void CpuFastSet(agbptr_t source, agbptr_t dest, std::uint32_t control);
+  void LZ77UnComp(agbptr_t source, agbptr_t dest);
+  void RLUnComp(agbptr_t source, agbptr_t dest);
+  void WriteBytes(agbptr_t dest, const std::string& data);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,137 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "agb_emulator.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bytes.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbptr_t kRomStart = 0x8000000;
+constexpr agbsize_t kHandlerOffset = 0x100;
+constexpr agbsize_t kLz77Offset = 0x200;
+constexpr agbsize_t kRlOffset = 0x220;
+constexpr agbptr_t kDest = 0x2000000;
+constexpr agbptr_t kBiosIntrFlags = 0x3007ff8;
+
+void WriteCode(std::string& rom, agbsize_t offset,
+               const std::vector<std::uint32_t>& code) {
+  for (std::size_t i = 0; i < code.size(); i++)
+    WriteInt32L(&rom[offset + i * 4], code[i]);
+}
+
+std::string MakeRom() {
+  std::string rom(0x300, '\0');
+  WriteCode(rom, 0,
+            {
+                0xe3a00001,  // mov r0, #1
+                0xe3a01001,  // mov r1, #1
+                0xef040000,  // swi 0x04 (IntrWait)
+                0xe3a02007,  // mov r2, #7
+                0xeafffffe,  // b .
+                0xef110000,  // swi 0x11 (LZ77UnCompWram)
+                0xef140000,  // swi 0x14 (RLUnCompWram)
+                0xef060000,  // swi 0x06 (Div)
+                0xef070000,  // swi 0x07 (DivArm)
+            });
+
+  // The interrupt handler, called by the BIOS with r0 = 0x4000000, which
+  // acknowledges the interrupts and sets the flags for IntrWait.
+  WriteCode(rom, kHandlerOffset,
+            {
+                0xe2802c02,  // add r2, r0, #0x200
+                0xe1d230b2,  // ldrh r3, [r2, #2]
+                0xe1c230b2,  // strh r3, [r2, #2]
+                0xe3a02403,  // mov r2, #0x3000000
+                0xe2822c7f,  // add r2, r2, #0x7f00
+                0xe28220f8,  // add r2, r2, #0xf8
+                0xe1c230b0,  // strh r3, [r2]
+                0xe12fff1e,  // bx lr
+            });
+
+  // "ABCABCABCX": 3 literals, a copy of 6 bytes from 3 bytes back, and a
+  // literal.
+  const std::string lz77{"\x10\x0a\x00\x00\x10" "ABC\x30\x02X", 11};
+  rom.replace(kLz77Offset, lz77.size(), lz77);
+  // "xyzzzzzz": 2 bytes as they are, and a run of 6 bytes.
+  const std::string rl{"\x30\x08\x00\x00\x01xy\x83z", 9};
+  rom.replace(kRlOffset, rl.size(), rl);
+  return rom;
+}
+
+std::string ReadBytes(AgbBus& bus, agbptr_t address, agbsize_t size) {
+  std::string data;
+  for (agbsize_t i = 0; i < size; i++)
+    data.push_back(static_cast<char>(bus.Read8(address + i)));
+  return data;
+}
+
+// Runs the SWI instruction at the address with the given r0 and r1.
+void RunSwi(AgbEmulator& emulator, agbptr_t address, std::uint32_t r0,
+            std::uint32_t r1) {
+  emulator.Reset(address);
+  emulator.cpu().set_reg(0, r0);
+  emulator.cpu().set_reg(1, r1);
+  emulator.cpu().Step();
+}
+
+void TestDecompression(AgbEmulator& emulator) {
+  RunSwi(emulator, kRomStart + 0x14, kRomStart + kLz77Offset, kDest);
+  EXPECT(ReadBytes(emulator.bus(), kDest, 10) == "ABCABCABCX");
+
+  RunSwi(emulator, kRomStart + 0x18, kRomStart + kRlOffset, kDest + 0x100);
+  EXPECT(ReadBytes(emulator.bus(), kDest + 0x100, 8) == "xyzzzzzz");
+}
+
+void TestDivision(AgbEmulator& emulator) {
+  // The quotient rounds toward zero, and r3 gets its absolute value.
+  RunSwi(emulator, kRomStart + 0x1c, static_cast<std::uint32_t>(-7), 2);
+  EXPECT(emulator.cpu().reg(0) == static_cast<std::uint32_t>(-3));
+  EXPECT(emulator.cpu().reg(1) == static_cast<std::uint32_t>(-1));
+  EXPECT(emulator.cpu().reg(3) == 3);
+
+  // DivArm takes the operands the other way round.
+  RunSwi(emulator, kRomStart + 0x20, 3, 100);
+  EXPECT(emulator.cpu().reg(0) == 33);
+  EXPECT(emulator.cpu().reg(1) == 1);
+  EXPECT(emulator.cpu().reg(3) == 33);
+}
+
+// IntrWait halts until the handler sets the VBlank flag, and then clears
+// the flag and returns.
+void TestIntrWait(AgbEmulator& emulator) {
+  emulator.Reset(kRomStart);
+  AgbBus& bus = emulator.bus();
+  bus.Write16(0x4000004, 0x0008);  // DISPSTAT: VBlank interrupt
+  bus.Write16(0x4000200, AgbBus::kIntrVBlank);  // IE
+  bus.Write32(0x3007ffc, kRomStart + kHandlerOffset);
+  bus.Write16(kBiosIntrFlags, AgbBus::kIntrVBlank);
+
+  // The flag set before the call is discarded.
+  EXPECT(emulator.Run(1000));
+  EXPECT(bus.halted());
+  EXPECT(emulator.cpu().pc() == kRomStart + 0x08);
+  EXPECT(bus.Read16(kBiosIntrFlags) == 0);
+
+  EXPECT(emulator.RunFrames(1));
+  EXPECT(emulator.cpu().reg(2) == 7);
+  EXPECT(emulator.cpu().pc() == kRomStart + 0x10);
+  EXPECT(bus.Read16(kBiosIntrFlags) == 0);
+  EXPECT(emulator.active_cycles() < AgbEmulator::kCyclesPerFrame);
+}
+
+}  // namespace
+
+int main() {
+  const std::string rom = MakeRom();
+  AgbEmulator emulator{rom};
+  TestDecompression(emulator);
+  TestDivision(emulator);
+  TestIntrWait(emulator);
+  return testing::num_failures != 0;
+}
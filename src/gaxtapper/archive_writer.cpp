@@ -0,0 +1,210 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "archive_writer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+#include "bytes.hpp"
+
+namespace gaxtapper {
+
+// The zip fields are 32-bit (no zip64), which is plenty for a GSF set.
+static constexpr std::uint64_t kMaxZipOffset = 0xffffffff;
+
+static constexpr std::size_t kTarBlockSize = 512;
+static constexpr std::size_t kTarNameSize = 100;
+
+namespace {
+
+// Returns the MS-DOS date and time of the zip headers.
+void ToDosTime(std::time_t time, std::uint16_t& dos_date,
+               std::uint16_t& dos_time) {
+  std::tm tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &time);
+#else
+  localtime_r(&time, &tm);
+#endif
+  const int year = std::max(tm.tm_year + 1900, 1980);
+  dos_date = static_cast<std::uint16_t>(((year - 1980) << 9) |
+                                        ((tm.tm_mon + 1) << 5) | tm.tm_mday);
+  dos_time = static_cast<std::uint16_t>((tm.tm_hour << 11) |
+                                        (tm.tm_min << 5) | (tm.tm_sec / 2));
+}
+
+// Writes an octal number field of a tar header, terminated by NUL.
+void WriteOctal(char* field, std::size_t field_size, std::uint64_t value) {
+  std::snprintf(field, field_size, "%0*llo", static_cast<int>(field_size - 1),
+                static_cast<unsigned long long>(value));
+}
+
+}  // namespace
+
+ArchiveWriter::Format ArchiveWriter::FormatOf(
+    const std::filesystem::path& path) {
+  if (path == "-" || path.extension() == ".tar") return Format::kTar;
+  if (path.extension() == ".zip") return Format::kZip;
+  throw std::invalid_argument(path.string() +
+                              ": The archive must be a .zip or .tar file "
+                              "(or - for a tar to the standard output).");
+}
+
+ArchiveWriter::ArchiveWriter(std::ostream& out, Format format,
+                             std::time_t time)
+    : out_(out), format_(format), time_(time) {}
+
+void ArchiveWriter::Add(std::string_view name, std::string_view data) {
+  if (format_ == Format::kZip)
+    AddZipEntry(name, data);
+  else
+    AddTarEntry(name, data);
+}
+
+void ArchiveWriter::Finish() {
+  if (format_ == Format::kTar) {
+    // Two zero blocks end a tar archive.
+    Write(std::string(kTarBlockSize * 2, '\0'));
+    out_.flush();
+    return;
+  }
+
+  std::uint16_t dos_date;
+  std::uint16_t dos_time;
+  ToDosTime(time_, dos_date, dos_time);
+
+  const std::uint64_t directory_offset = offset_;
+  for (const ZipEntry& entry : zip_entries_) {
+    char header[46]{};
+    WriteInt32L(&header[0], 0x02014b50);
+    WriteInt16L(&header[4], 20);  // version made by
+    WriteInt16L(&header[6], 20);  // version needed to extract
+    WriteInt16L(&header[8], 0x0800);  // UTF-8 names
+    WriteInt16L(&header[10], 0);  // stored
+    WriteInt16L(&header[12], dos_time);
+    WriteInt16L(&header[14], dos_date);
+    WriteInt32L(&header[16], entry.crc32);
+    WriteInt32L(&header[20], entry.size);
+    WriteInt32L(&header[24], entry.size);
+    WriteInt16L(&header[28], static_cast<std::uint16_t>(entry.name.size()));
+    WriteInt32L(&header[42], entry.offset);
+    Write({header, sizeof(header)});
+    Write(entry.name);
+  }
+  const std::uint64_t directory_size = offset_ - directory_offset;
+  if (offset_ > kMaxZipOffset || zip_entries_.size() > 0xffff)
+    throw std::runtime_error("The zip archive is too large.");
+
+  char end[22]{};
+  WriteInt32L(&end[0], 0x06054b50);
+  WriteInt16L(&end[8], static_cast<std::uint16_t>(zip_entries_.size()));
+  WriteInt16L(&end[10], static_cast<std::uint16_t>(zip_entries_.size()));
+  WriteInt32L(&end[12], static_cast<std::uint32_t>(directory_size));
+  WriteInt32L(&end[16], static_cast<std::uint32_t>(directory_offset));
+  Write({end, sizeof(end)});
+  out_.flush();
+}
+
+void ArchiveWriter::Write(std::string_view data) {
+  out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!out_) throw std::runtime_error("Unable to write the archive.");
+  offset_ += data.size();
+}
+
+void ArchiveWriter::AddZipEntry(std::string_view name, std::string_view data) {
+  if (offset_ + data.size() + name.size() + 30 > kMaxZipOffset ||
+      name.size() > 0xffff)
+    throw std::runtime_error("The zip archive is too large.");
+
+  const ZipEntry entry{
+      std::string{name},
+      static_cast<std::uint32_t>(
+          crc32(crc32(0L, Z_NULL, 0),
+                reinterpret_cast<const Bytef*>(data.data()),
+                static_cast<uInt>(data.size()))),
+      static_cast<std::uint32_t>(data.size()),
+      static_cast<std::uint32_t>(offset_)};
+
+  std::uint16_t dos_date;
+  std::uint16_t dos_time;
+  ToDosTime(time_, dos_date, dos_time);
+
+  char header[30]{};
+  WriteInt32L(&header[0], 0x04034b50);
+  WriteInt16L(&header[4], 20);  // version needed to extract
+  WriteInt16L(&header[6], 0x0800);  // UTF-8 names
+  WriteInt16L(&header[8], 0);  // stored
+  WriteInt16L(&header[10], dos_time);
+  WriteInt16L(&header[12], dos_date);
+  WriteInt32L(&header[14], entry.crc32);
+  WriteInt32L(&header[18], entry.size);
+  WriteInt32L(&header[22], entry.size);
+  WriteInt16L(&header[26], static_cast<std::uint16_t>(name.size()));
+  Write({header, sizeof(header)});
+  Write(name);
+  Write(data);
+  zip_entries_.push_back(entry);
+}
+
+void ArchiveWriter::AddTarEntry(std::string_view name, std::string_view data) {
+  // A long or non-ASCII name is given by a pax extended header, which is in
+  // UTF-8. The ustar header keeps an ASCII form of the name for the readers
+  // without pax.
+  const bool ascii = std::all_of(name.begin(), name.end(), [](char c) {
+    return static_cast<unsigned char>(c) < 0x80;
+  });
+  std::string ustar_name;
+  if (name.size() >= kTarNameSize || !ascii) {
+    std::string record = " path=" + std::string{name} + "\n";
+    // The length of the record includes its own digits.
+    std::size_t digits = 1;
+    while (std::to_string(record.size() + digits).size() > digits) digits++;
+    record.insert(0, std::to_string(record.size() + digits));
+
+    WriteTarHeader("PaxHeader", record.size(), 'x');
+    Write(record);
+    PadTarEntry(record.size());
+
+    ustar_name = name.substr(0, kTarNameSize - 1);
+    for (char& c : ustar_name) {
+      if (static_cast<unsigned char>(c) >= 0x80) c = '_';
+    }
+    name = ustar_name;
+  }
+
+  WriteTarHeader(name, data.size(), '0');
+  Write(data);
+  PadTarEntry(data.size());
+}
+
+void ArchiveWriter::WriteTarHeader(std::string_view name, std::uint64_t size,
+                                   char type) {
+  char header[kTarBlockSize]{};
+  std::memcpy(&header[0], name.data(), std::min(name.size(), kTarNameSize));
+  WriteOctal(&header[100], 8, 0644);  // mode
+  WriteOctal(&header[108], 8, 0);  // uid
+  WriteOctal(&header[116], 8, 0);  // gid
+  WriteOctal(&header[124], 12, size);
+  WriteOctal(&header[136], 12, static_cast<std::uint64_t>(time_));
+  std::memset(&header[148], ' ', 8);  // checksum, counted as spaces
+  header[156] = type;
+  std::memcpy(&header[257], "ustar", 6);
+  std::memcpy(&header[263], "00", 2);
+
+  unsigned checksum = 0;
+  for (const char c : header) checksum += static_cast<unsigned char>(c);
+  std::snprintf(&header[148], 8, "%06o", checksum);
+  header[155] = ' ';
+  Write({header, sizeof(header)});
+}
+
+void ArchiveWriter::PadTarEntry(std::uint64_t size) {
+  const std::size_t padding =
+      (kTarBlockSize - size % kTarBlockSize) % kTarBlockSize;
+  Write(std::string(padding, '\0'));
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,58 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ARCHIVE_WRITER_HPP_
+#define GAXTAPPER_ARCHIVE_WRITER_HPP_
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gaxtapper {
+
+// Writes files as the members of a zip or tar archive to a stream, in a
+// single sequential pass (the stream does not have to be seekable). PSF
+// files are compressed already, so the zip members are stored as they are.
+class ArchiveWriter {
+ public:
+  enum class Format { kZip, kTar };
+
+  // The format for the archive path: zip for ".zip", tar for ".tar" and
+  // for "-" (the standard output). Throws std::invalid_argument otherwise.
+  [[nodiscard]] static Format FormatOf(const std::filesystem::path& path);
+
+  ArchiveWriter(std::ostream& out, Format format,
+                std::time_t time = std::time(nullptr));
+
+  void Add(std::string_view name, std::string_view data);
+
+  // Writes the end of the archive (the zip central directory).
+  void Finish();
+
+ private:
+  struct ZipEntry {
+    std::string name;
+    std::uint32_t crc32;
+    std::uint32_t size;
+    std::uint32_t offset;
+  };
+
+  std::ostream& out_;
+  Format format_;
+  std::time_t time_;
+  std::uint64_t offset_ = 0;
+  std::vector<ZipEntry> zip_entries_;
+
+  void Write(std::string_view data);
+  void AddZipEntry(std::string_view name, std::string_view data);
+  void AddTarEntry(std::string_view name, std::string_view data);
+  void WriteTarHeader(std::string_view name, std::uint64_t size, char type);
+  void PadTarEntry(std::uint64_t size);
+};
+
+}  // namespace gaxtapper
+
+#endif
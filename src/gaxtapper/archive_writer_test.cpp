@@ -0,0 +1,121 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "archive_writer.hpp"
+
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <zlib.h>
+#include "bytes.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+using Members = std::map<std::string, std::string>;
+
+// Reads the members of a tar archive, with the names of the pax headers.
+Members ReadTar(std::string_view archive) {
+  Members members;
+  std::string pax_path;
+  while (archive.size() >= 512 && archive[0] != '\0') {
+    const std::string_view header = archive.substr(0, 512);
+    const std::string name{header.substr(0, header.find('\0'))};
+    const std::uint64_t size =
+        std::stoull(std::string{header.substr(124, 11)}, nullptr, 8);
+    const char type = header[156];
+    const std::string_view data = archive.substr(512, size);
+    archive.remove_prefix(512 + (size + 511) / 512 * 512);
+
+    if (type == 'x') {
+      // "<length> path=<name>\n"
+      const std::size_t key = data.find(" path=");
+      if (key != std::string_view::npos) {
+        pax_path = std::string{data.substr(key + 6)};
+        pax_path.pop_back();
+      }
+      continue;
+    }
+    members[pax_path.empty() ? name : pax_path] = std::string{data};
+    pax_path.clear();
+  }
+  return members;
+}
+
+// Reads the members of a zip archive through the central directory, and
+// checks their crc32.
+Members ReadZip(std::string_view archive) {
+  Members members;
+  if (archive.size() < 22) return members;
+  const char* end = &archive[archive.size() - 22];
+  if (ReadInt32L(end) != 0x06054b50) return members;
+  const std::uint16_t count = ReadInt16L(end + 10);
+  std::size_t entry = ReadInt32L(end + 16);
+  for (std::uint16_t i = 0; i < count; i++) {
+    const char* header = &archive[entry];
+    if (ReadInt32L(header) != 0x02014b50) break;
+    const std::uint32_t crc = ReadInt32L(header + 16);
+    const std::uint32_t size = ReadInt32L(header + 20);
+    const std::uint16_t name_size = ReadInt16L(header + 28);
+    const std::uint32_t offset = ReadInt32L(header + 42);
+    const std::string name{header + 46, name_size};
+    entry += 46 + name_size;
+
+    const char* local = &archive[offset];
+    EXPECT(ReadInt32L(local) == 0x04034b50);
+    EXPECT(ReadInt16L(local + 8) == 0);  // stored
+    const std::size_t data_offset =
+        offset + 30 + ReadInt16L(local + 26) + ReadInt16L(local + 28);
+    const std::string data{archive.substr(data_offset, size)};
+    EXPECT(crc == crc32(0, reinterpret_cast<const Bytef*>(data.data()),
+                        static_cast<uInt>(data.size())));
+    members[name] = data;
+  }
+  return members;
+}
+
+Members MakeMembers() {
+  return {
+      {"Game.gsflib", std::string(1000, '\x5a')},
+      {"Game-01.minigsf", "PSF\x22"},
+      {"Empty.minigsf", ""},
+      // A name with an umlaut, which takes a pax header in a tar.
+      {"Spiel \xc3\x9c" "berall.minigsf", std::string(513, '\0')},
+      // A name longer than the name field of a tar header.
+      {std::string(150, 'n') + ".minigsf", "long"},
+  };
+}
+
+std::string WriteArchive(ArchiveWriter::Format format,
+                         const Members& members) {
+  std::ostringstream stream;
+  ArchiveWriter writer{stream, format, 0};
+  for (const auto& [name, data] : members) writer.Add(name, data);
+  writer.Finish();
+  return stream.str();
+}
+
+}  // namespace
+
+int main() {
+  EXPECT(ArchiveWriter::FormatOf("set.zip") == ArchiveWriter::Format::kZip);
+  EXPECT(ArchiveWriter::FormatOf("set.tar") == ArchiveWriter::Format::kTar);
+  EXPECT(ArchiveWriter::FormatOf("-") == ArchiveWriter::Format::kTar);
+  EXPECT_THROW((void)ArchiveWriter::FormatOf("set.7z"),
+               std::invalid_argument);
+
+  const Members members = MakeMembers();
+  const std::string tar = WriteArchive(ArchiveWriter::Format::kTar, members);
+  EXPECT(tar.size() % 512 == 0);
+  EXPECT(ReadTar(tar) == members);
+  // The ustar header of a non-ASCII name has an ASCII form of it.
+  EXPECT(tar.find("Spiel _") != std::string::npos);
+
+  const std::string zip = WriteArchive(ArchiveWriter::Format::kZip, members);
+  EXPECT(ReadZip(zip) == members);
+  return testing::num_failures != 0;
+}
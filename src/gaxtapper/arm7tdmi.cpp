@@ -0,0 +1,893 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "arm7tdmi.hpp"
+
+#include <cstdint>
+#include "agb_bus.hpp"
+
+namespace gaxtapper {
+
+static constexpr std::uint32_t RotateRight(std::uint32_t value,
+                                           std::uint32_t amount) {
+  amount &= 31;
+  return amount == 0 ? value : (value >> amount) | (value << (32 - amount));
+}
+
+static int CountBits(std::uint32_t value) {
+  int count = 0;
+  while (value != 0) {
+    value &= value - 1;
+    count++;
+  }
+  return count;
+}
+
+void Arm7Tdmi::Reset(agbptr_t entrypoint) {
+  regs_.fill(0);
+  bank_r13_.fill(0);
+  bank_r14_.fill(0);
+  bank_spsr_.fill(0);
+  bank_usr_r8_.fill(0);
+  bank_fiq_r8_.fill(0);
+  bank_r13_[BankIndex(kModeSvc)] = 0x3007fe0;
+  bank_r13_[BankIndex(kModeIrq)] = 0x3007fa0;
+  cpsr_ = kModeSys;
+  spsr_ = 0;
+  regs_[13] = 0x3007f00;
+  pc_ = entrypoint & ~3u;
+  current_ = pc_;
+  faulted_ = false;
+}
+
+void Arm7Tdmi::Step() {
+  if (faulted_) return;
+  if ((cpsr_ & kFlagI) == 0 && bus_.irq_line()) RaiseIrq();
+
+  current_ = pc_;
+  instructions_++;
+  if (thumb()) {
+    const std::uint16_t ins = bus_.Read16(current_);
+    pc_ = current_ + 2;
+    regs_[15] = current_ + 4;
+    ExecuteThumb(ins);
+  } else {
+    const std::uint32_t ins = bus_.Read32(current_);
+    pc_ = current_ + 4;
+    regs_[15] = current_ + 8;
+    if (CheckCondition(ins >> 28)) ExecuteArm(ins);
+  }
+}
+
+int Arm7Tdmi::BankIndex(std::uint32_t mode) noexcept {
+  switch (mode) {
+    case kModeFiq:
+      return 1;
+    case kModeIrq:
+      return 2;
+    case kModeSvc:
+      return 3;
+    case kModeAbt:
+      return 4;
+    case kModeUnd:
+      return 5;
+    default:
+      return 0;
+  }
+}
+
+void Arm7Tdmi::SwitchMode(std::uint32_t mode) {
+  const std::uint32_t old_mode = cpsr_ & 0x1f;
+  cpsr_ = (cpsr_ & ~0x1fu) | mode;
+  const int old_bank = BankIndex(old_mode);
+  const int new_bank = BankIndex(mode);
+  if (old_bank == new_bank) return;
+
+  bank_r13_[old_bank] = regs_[13];
+  bank_r14_[old_bank] = regs_[14];
+  bank_spsr_[old_bank] = spsr_;
+  if (old_mode == kModeFiq) {
+    for (int i = 0; i < 5; i++) {
+      bank_fiq_r8_[i] = regs_[8 + i];
+      regs_[8 + i] = bank_usr_r8_[i];
+    }
+  } else if (mode == kModeFiq) {
+    for (int i = 0; i < 5; i++) {
+      bank_usr_r8_[i] = regs_[8 + i];
+      regs_[8 + i] = bank_fiq_r8_[i];
+    }
+  }
+  regs_[13] = bank_r13_[new_bank];
+  regs_[14] = bank_r14_[new_bank];
+  spsr_ = bank_spsr_[new_bank];
+}
+
+void Arm7Tdmi::WriteCpsr(std::uint32_t value) {
+  SwitchMode(value & 0x1f);
+  cpsr_ = value;
+}
+
+void Arm7Tdmi::RaiseIrq() {
+  const std::uint32_t old_cpsr = cpsr_;
+  SwitchMode(kModeIrq);
+  spsr_ = old_cpsr;
+  regs_[14] = pc_ + 4;
+  cpsr_ = (cpsr_ & ~kFlagT) | kFlagI;
+  pc_ = 0x18;
+  bus_.AddCycles(6);
+}
+
+void Arm7Tdmi::Fault() { faulted_ = true; }
+
+bool Arm7Tdmi::CheckCondition(std::uint32_t cond) const noexcept {
+  const bool n = (cpsr_ & kFlagN) != 0;
+  const bool z = (cpsr_ & kFlagZ) != 0;
+  const bool c = (cpsr_ & kFlagC) != 0;
+  const bool v = (cpsr_ & kFlagV) != 0;
+  switch (cond) {
+    case 0x0: return z;
+    case 0x1: return !z;
+    case 0x2: return c;
+    case 0x3: return !c;
+    case 0x4: return n;
+    case 0x5: return !n;
+    case 0x6: return v;
+    case 0x7: return !v;
+    case 0x8: return c && !z;
+    case 0x9: return !c || z;
+    case 0xa: return n == v;
+    case 0xb: return n != v;
+    case 0xc: return !z && n == v;
+    case 0xd: return z || n != v;
+    case 0xe: return true;
+    default: return false;
+  }
+}
+
+std::uint32_t Arm7Tdmi::Add(std::uint32_t a, std::uint32_t b, bool carry_in,
+                            bool set_flags) {
+  const std::uint64_t sum = static_cast<std::uint64_t>(a) + b + (carry_in ? 1 : 0);
+  const auto result = static_cast<std::uint32_t>(sum);
+  if (set_flags) {
+    SetNZ(result);
+    SetC((sum >> 32) != 0);
+    SetV(((~(a ^ b) & (a ^ result)) >> 31) != 0);
+  }
+  return result;
+}
+
+std::uint32_t Arm7Tdmi::Sub(std::uint32_t a, std::uint32_t b, bool carry_in,
+                            bool set_flags) {
+  return Add(a, ~b, carry_in, set_flags);
+}
+
+std::uint32_t Arm7Tdmi::Shift(int type, std::uint32_t value,
+                              std::uint32_t amount, bool& carry_out,
+                              bool immediate) const noexcept {
+  switch (type) {
+    case 0:  // LSL
+      if (amount == 0) return value;
+      if (amount < 32) {
+        carry_out = ((value >> (32 - amount)) & 1) != 0;
+        return value << amount;
+      }
+      carry_out = amount == 32 && (value & 1) != 0;
+      return 0;
+
+    case 1:  // LSR
+      if (amount == 0) {
+        if (!immediate) return value;
+        amount = 32;
+      }
+      if (amount < 32) {
+        carry_out = ((value >> (amount - 1)) & 1) != 0;
+        return value >> amount;
+      }
+      carry_out = amount == 32 && (value >> 31) != 0;
+      return 0;
+
+    case 2:  // ASR
+      if (amount == 0) {
+        if (!immediate) return value;
+        amount = 32;
+      }
+      if (amount < 32) {
+        carry_out = ((static_cast<std::int32_t>(value) >> (amount - 1)) & 1) != 0;
+        return static_cast<std::uint32_t>(static_cast<std::int32_t>(value) >> amount);
+      }
+      carry_out = (value >> 31) != 0;
+      return (value >> 31) != 0 ? 0xffffffff : 0;
+
+    default:  // ROR
+      if (amount == 0) {
+        if (!immediate) return value;
+        // RRX
+        const std::uint32_t result = (carry() ? 0x80000000 : 0) | (value >> 1);
+        carry_out = (value & 1) != 0;
+        return result;
+      }
+      amount &= 31;
+      if (amount == 0) {
+        carry_out = (value >> 31) != 0;
+        return value;
+      }
+      carry_out = ((value >> (amount - 1)) & 1) != 0;
+      return RotateRight(value, amount);
+  }
+}
+
+std::uint32_t Arm7Tdmi::LoadWord(agbptr_t address) {
+  return RotateRight(bus_.Read32(address & ~3u), (address & 3) * 8);
+}
+
+std::uint32_t Arm7Tdmi::LoadHalf(agbptr_t address) {
+  return RotateRight(bus_.Read16(address & ~1u), (address & 1) * 8);
+}
+
+std::uint32_t Arm7Tdmi::LoadSignedHalf(agbptr_t address) {
+  if ((address & 1) != 0)
+    return static_cast<std::uint32_t>(
+        static_cast<std::int8_t>(bus_.Read8(address)));
+  return static_cast<std::uint32_t>(
+      static_cast<std::int16_t>(bus_.Read16(address)));
+}
+
+void Arm7Tdmi::ExecuteArm(std::uint32_t ins) {
+  if ((ins & 0x0ffffff0) == 0x012fff10) {
+    // BX
+    const std::uint32_t target = regs_[ins & 0xf];
+    cpsr_ = (target & 1) != 0 ? (cpsr_ | kFlagT) : (cpsr_ & ~kFlagT);
+    Branch(target);
+  } else if ((ins & 0x0fc000f0) == 0x00000090) {
+    ArmMultiply(ins);
+  } else if ((ins & 0x0f8000f0) == 0x00800090) {
+    ArmMultiplyLong(ins);
+  } else if ((ins & 0x0fb00ff0) == 0x01000090) {
+    ArmSwap(ins);
+  } else if ((ins & 0x0e000090) == 0x00000090 && (ins & 0x60) != 0) {
+    ArmHalfwordTransfer(ins);
+  } else if ((ins & 0x0fbf0fff) == 0x010f0000 ||
+             (ins & 0x0db0f000) == 0x0120f000) {
+    ArmPsrTransfer(ins);
+  } else if ((ins & 0x0c000000) == 0) {
+    ArmDataProcessing(ins);
+  } else if ((ins & 0x0c000000) == 0x04000000) {
+    if ((ins & 0x02000010) == 0x02000010)
+      Fault();
+    else
+      ArmSingleTransfer(ins);
+  } else if ((ins & 0x0e000000) == 0x08000000) {
+    ArmBlockTransfer(ins);
+  } else if ((ins & 0x0e000000) == 0x0a000000) {
+    // B, BL
+    const auto offset =
+        static_cast<std::uint32_t>(static_cast<std::int32_t>(ins << 8) >> 6);
+    if ((ins & 0x01000000) != 0) regs_[14] = pc_;
+    Branch(regs_[15] + offset);
+  } else if ((ins & 0x0f000000) == 0x0f000000) {
+    SoftwareInterrupt(static_cast<std::uint8_t>(ins >> 16));
+  } else {
+    Fault();
+  }
+}
+
+void Arm7Tdmi::ArmDataProcessing(std::uint32_t ins) {
+  const bool set_flags = (ins & 0x00100000) != 0;
+  const int opcode = (ins >> 21) & 0xf;
+  const int rn = (ins >> 16) & 0xf;
+  const int rd = (ins >> 12) & 0xf;
+
+  std::uint32_t a = regs_[rn];
+  std::uint32_t b;
+  bool shifter_carry = carry();
+  if ((ins & 0x02000000) != 0) {
+    const std::uint32_t rotate = ((ins >> 8) & 0xf) * 2;
+    b = RotateRight(ins & 0xff, rotate);
+    if (rotate != 0) shifter_carry = (b >> 31) != 0;
+  } else {
+    const int rm = ins & 0xf;
+    const int type = (ins >> 5) & 3;
+    std::uint32_t value = regs_[rm];
+    if ((ins & 0x10) != 0) {
+      // The register specified shift reads PC as instruction + 12.
+      if (rm == 15) value += 4;
+      if (rn == 15) a += 4;
+      bus_.AddCycles(1);
+      b = Shift(type, value, regs_[(ins >> 8) & 0xf] & 0xff, shifter_carry,
+                false);
+    } else {
+      b = Shift(type, value, (ins >> 7) & 0x1f, shifter_carry, true);
+    }
+  }
+
+  std::uint32_t result = 0;
+  bool logical = false;
+  switch (opcode) {
+    case 0x0: result = a & b; logical = true; break;
+    case 0x1: result = a ^ b; logical = true; break;
+    case 0x2: result = Sub(a, b, true, set_flags); break;
+    case 0x3: result = Sub(b, a, true, set_flags); break;
+    case 0x4: result = Add(a, b, false, set_flags); break;
+    case 0x5: result = Add(a, b, carry(), set_flags); break;
+    case 0x6: result = Sub(a, b, carry(), set_flags); break;
+    case 0x7: result = Sub(b, a, carry(), set_flags); break;
+    case 0x8: result = a & b; logical = true; break;
+    case 0x9: result = a ^ b; logical = true; break;
+    case 0xa: result = Sub(a, b, true, true); break;
+    case 0xb: result = Add(a, b, false, true); break;
+    case 0xc: result = a | b; logical = true; break;
+    case 0xd: result = b; logical = true; break;
+    case 0xe: result = a & ~b; logical = true; break;
+    default: result = ~b; logical = true; break;
+  }
+
+  if (logical && set_flags) {
+    SetNZ(result);
+    SetC(shifter_carry);
+  }
+
+  if (opcode >= 0x8 && opcode <= 0xb) return;
+
+  if (rd == 15) {
+    if (set_flags) WriteCpsr(spsr_);
+    Branch(result);
+  } else {
+    regs_[rd] = result;
+  }
+}
+
+void Arm7Tdmi::ArmPsrTransfer(std::uint32_t ins) {
+  const bool use_spsr = (ins & 0x00400000) != 0;
+  if ((ins & 0x00200000) == 0) {
+    // MRS
+    regs_[(ins >> 12) & 0xf] = use_spsr ? spsr_ : cpsr_;
+    return;
+  }
+
+  // MSR
+  const std::uint32_t operand = (ins & 0x02000000) != 0
+                                    ? RotateRight(ins & 0xff, ((ins >> 8) & 0xf) * 2)
+                                    : regs_[ins & 0xf];
+  std::uint32_t mask = 0;
+  if ((ins & 0x00010000) != 0) mask |= 0x000000ff;
+  if ((ins & 0x00020000) != 0) mask |= 0x0000ff00;
+  if ((ins & 0x00040000) != 0) mask |= 0x00ff0000;
+  if ((ins & 0x00080000) != 0) mask |= 0xff000000;
+
+  const std::uint32_t mode = cpsr_ & 0x1f;
+  if (use_spsr) {
+    if (mode != kModeUsr && mode != kModeSys)
+      spsr_ = (spsr_ & ~mask) | (operand & mask);
+  } else {
+    if (mode == kModeUsr) mask &= 0xff000000;
+    std::uint32_t value = (cpsr_ & ~mask) | (operand & mask);
+    value = (value & ~kFlagT) | (cpsr_ & kFlagT);
+    WriteCpsr(value);
+  }
+}
+
+void Arm7Tdmi::ArmMultiply(std::uint32_t ins) {
+  const int rd = (ins >> 16) & 0xf;
+  const int rn = (ins >> 12) & 0xf;
+  const int rs = (ins >> 8) & 0xf;
+  const int rm = ins & 0xf;
+  std::uint32_t result = regs_[rm] * regs_[rs];
+  if ((ins & 0x00200000) != 0) result += regs_[rn];
+  regs_[rd] = result;
+  if ((ins & 0x00100000) != 0) SetNZ(result);
+  bus_.AddCycles(3);
+}
+
+void Arm7Tdmi::ArmMultiplyLong(std::uint32_t ins) {
+  const int rd_hi = (ins >> 16) & 0xf;
+  const int rd_lo = (ins >> 12) & 0xf;
+  const int rs = (ins >> 8) & 0xf;
+  const int rm = ins & 0xf;
+
+  std::uint64_t result;
+  if ((ins & 0x00400000) != 0) {
+    result = static_cast<std::uint64_t>(
+        static_cast<std::int64_t>(static_cast<std::int32_t>(regs_[rm])) *
+        static_cast<std::int32_t>(regs_[rs]));
+  } else {
+    result = static_cast<std::uint64_t>(regs_[rm]) * regs_[rs];
+  }
+  if ((ins & 0x00200000) != 0)
+    result += (static_cast<std::uint64_t>(regs_[rd_hi]) << 32) | regs_[rd_lo];
+
+  regs_[rd_lo] = static_cast<std::uint32_t>(result);
+  regs_[rd_hi] = static_cast<std::uint32_t>(result >> 32);
+  if ((ins & 0x00100000) != 0) {
+    cpsr_ = (cpsr_ & ~(kFlagN | kFlagZ)) |
+            ((result >> 63) != 0 ? kFlagN : 0) | (result == 0 ? kFlagZ : 0);
+  }
+  bus_.AddCycles(4);
+}
+
+void Arm7Tdmi::ArmSwap(std::uint32_t ins) {
+  const agbptr_t address = regs_[(ins >> 16) & 0xf];
+  const int rd = (ins >> 12) & 0xf;
+  const std::uint32_t value = regs_[ins & 0xf];
+  if ((ins & 0x00400000) != 0) {
+    const std::uint32_t old = bus_.Read8(address);
+    bus_.Write8(address, static_cast<std::uint8_t>(value));
+    regs_[rd] = old;
+  } else {
+    const std::uint32_t old = LoadWord(address);
+    bus_.Write32(address, value);
+    regs_[rd] = old;
+  }
+  bus_.AddCycles(1);
+}
+
+void Arm7Tdmi::ArmHalfwordTransfer(std::uint32_t ins) {
+  const bool pre = (ins & 0x01000000) != 0;
+  const bool up = (ins & 0x00800000) != 0;
+  const bool writeback = !pre || (ins & 0x00200000) != 0;
+  const bool load = (ins & 0x00100000) != 0;
+  const int rn = (ins >> 16) & 0xf;
+  const int rd = (ins >> 12) & 0xf;
+  const int sh = (ins >> 5) & 3;
+
+  const std::uint32_t offset = (ins & 0x00400000) != 0
+                                   ? ((ins >> 4) & 0xf0) | (ins & 0xf)
+                                   : regs_[ins & 0xf];
+  const std::uint32_t base = regs_[rn];
+  const std::uint32_t updated = up ? base + offset : base - offset;
+  const agbptr_t address = pre ? updated : base;
+
+  if (load) {
+    std::uint32_t value;
+    switch (sh) {
+      case 1:
+        value = LoadHalf(address);
+        break;
+      case 2:
+        value = static_cast<std::uint32_t>(
+            static_cast<std::int8_t>(bus_.Read8(address)));
+        break;
+      default:
+        value = LoadSignedHalf(address);
+        break;
+    }
+    if (writeback && rn != 15) regs_[rn] = updated;
+    set_reg(rd, value);
+    bus_.AddCycles(1);
+  } else {
+    if (sh == 1) {
+      const std::uint32_t value = rd == 15 ? regs_[15] + 4 : regs_[rd];
+      bus_.Write16(address, static_cast<std::uint16_t>(value));
+    }
+    if (writeback && rn != 15) regs_[rn] = updated;
+  }
+}
+
+void Arm7Tdmi::ArmSingleTransfer(std::uint32_t ins) {
+  const bool pre = (ins & 0x01000000) != 0;
+  const bool up = (ins & 0x00800000) != 0;
+  const bool byte = (ins & 0x00400000) != 0;
+  const bool writeback = !pre || (ins & 0x00200000) != 0;
+  const bool load = (ins & 0x00100000) != 0;
+  const int rn = (ins >> 16) & 0xf;
+  const int rd = (ins >> 12) & 0xf;
+
+  std::uint32_t offset;
+  if ((ins & 0x02000000) != 0) {
+    bool unused_carry = carry();
+    offset = Shift((ins >> 5) & 3, regs_[ins & 0xf], (ins >> 7) & 0x1f,
+                   unused_carry, true);
+  } else {
+    offset = ins & 0xfff;
+  }
+
+  const std::uint32_t base = regs_[rn];
+  const std::uint32_t updated = up ? base + offset : base - offset;
+  const agbptr_t address = pre ? updated : base;
+
+  if (load) {
+    const std::uint32_t value = byte ? bus_.Read8(address) : LoadWord(address);
+    if (writeback && rn != 15) regs_[rn] = updated;
+    set_reg(rd, value);
+    bus_.AddCycles(1);
+  } else {
+    const std::uint32_t value = rd == 15 ? regs_[15] + 4 : regs_[rd];
+    if (byte)
+      bus_.Write8(address, static_cast<std::uint8_t>(value));
+    else
+      bus_.Write32(address, value);
+    if (writeback && rn != 15) regs_[rn] = updated;
+  }
+}
+
+void Arm7Tdmi::ArmBlockTransfer(std::uint32_t ins) {
+  const bool pre = (ins & 0x01000000) != 0;
+  const bool up = (ins & 0x00800000) != 0;
+  const bool psr = (ins & 0x00400000) != 0;
+  const bool writeback = (ins & 0x00200000) != 0;
+  const bool load = (ins & 0x00100000) != 0;
+  const int rn = (ins >> 16) & 0xf;
+  std::uint32_t list = ins & 0xffff;
+
+  // An empty list transfers PC and moves the base by 0x40 (ARMv4).
+  int count = CountBits(list);
+  if (list == 0) {
+    list = 0x8000;
+    count = 16;
+  }
+
+  const std::uint32_t base = regs_[rn];
+  const std::uint32_t updated = up ? base + count * 4 : base - count * 4;
+  agbptr_t address = up ? base + (pre ? 4 : 0) : updated + (pre ? 0 : 4);
+
+  const bool user_bank = psr && !(load && (list & 0x8000) != 0);
+  const std::uint32_t old_mode = cpsr_ & 0x1f;
+  if (user_bank) SwitchMode(kModeSys);
+
+  if (load) {
+    std::uint32_t new_pc = 0;
+    for (int i = 0; i < 16; i++) {
+      if ((list & (1u << i)) == 0) continue;
+      const std::uint32_t value = bus_.Read32(address);
+      if (i == 15)
+        new_pc = value;
+      else
+        regs_[i] = value;
+      address += 4;
+    }
+    if (writeback && (list & (1u << rn)) == 0) regs_[rn] = updated;
+    if (user_bank) SwitchMode(old_mode);
+    if ((list & 0x8000) != 0) {
+      if (psr) WriteCpsr(spsr_);
+      Branch(new_pc);
+    }
+    bus_.AddCycles(1);
+  } else {
+    bool first = true;
+    for (int i = 0; i < 16; i++) {
+      if ((list & (1u << i)) == 0) continue;
+      std::uint32_t value = i == 15 ? regs_[15] + 4 : regs_[i];
+      if (i == rn && writeback && !first) value = updated;
+      bus_.Write32(address, value);
+      address += 4;
+      first = false;
+    }
+    if (writeback) regs_[rn] = updated;
+    if (user_bank) SwitchMode(old_mode);
+  }
+}
+
+void Arm7Tdmi::SoftwareInterrupt(std::uint8_t number) {
+  if (swi_handler_ != nullptr) {
+    bus_.AddCycles(8);
+    swi_handler_->HandleSwi(*this, number);
+    return;
+  }
+
+  const std::uint32_t old_cpsr = cpsr_;
+  SwitchMode(kModeSvc);
+  spsr_ = old_cpsr;
+  regs_[14] = pc_;
+  cpsr_ = (cpsr_ & ~kFlagT) | kFlagI;
+  pc_ = 0x08;
+}
+
+void Arm7Tdmi::ExecuteThumb(std::uint16_t ins) {
+  switch (ins >> 13) {
+    case 0: {
+      const int rs = (ins >> 3) & 7;
+      const int rd = ins & 7;
+      if (((ins >> 11) & 3) == 3) {
+        // ADD/SUB register or 3-bit immediate
+        const std::uint32_t operand =
+            (ins & 0x0400) != 0 ? (ins >> 6) & 7 : regs_[(ins >> 6) & 7];
+        regs_[rd] = (ins & 0x0200) != 0 ? Sub(regs_[rs], operand, true, true)
+                                        : Add(regs_[rs], operand, false, true);
+      } else {
+        // LSL/LSR/ASR immediate
+        bool shifter_carry = carry();
+        const std::uint32_t result = Shift((ins >> 11) & 3, regs_[rs],
+                                           (ins >> 6) & 0x1f, shifter_carry,
+                                           true);
+        regs_[rd] = result;
+        SetNZ(result);
+        SetC(shifter_carry);
+      }
+      break;
+    }
+
+    case 1: {
+      // MOV/CMP/ADD/SUB 8-bit immediate
+      const int rd = (ins >> 8) & 7;
+      const std::uint32_t imm = ins & 0xff;
+      switch ((ins >> 11) & 3) {
+        case 0:
+          regs_[rd] = imm;
+          SetNZ(imm);
+          break;
+        case 1:
+          (void)Sub(regs_[rd], imm, true, true);
+          break;
+        case 2:
+          regs_[rd] = Add(regs_[rd], imm, false, true);
+          break;
+        default:
+          regs_[rd] = Sub(regs_[rd], imm, true, true);
+          break;
+      }
+      break;
+    }
+
+    case 2:
+      if ((ins >> 10) == 0x10) {
+        ThumbAlu(ins);
+      } else if ((ins >> 10) == 0x11) {
+        ThumbHiRegister(ins);
+      } else if ((ins >> 11) == 0x09) {
+        // LDR PC-relative
+        const agbptr_t address = (regs_[15] & ~2u) + (ins & 0xff) * 4;
+        regs_[(ins >> 8) & 7] = bus_.Read32(address);
+        bus_.AddCycles(1);
+      } else {
+        ThumbLoadStore(ins);
+      }
+      break;
+
+    case 3:
+    case 4:
+      ThumbLoadStore(ins);
+      break;
+
+    case 5:
+      if ((ins & 0x1000) == 0) {
+        // ADD Rd, PC/SP, #imm
+        const std::uint32_t base =
+            (ins & 0x0800) != 0 ? regs_[13] : (regs_[15] & ~2u);
+        regs_[(ins >> 8) & 7] = base + (ins & 0xff) * 4;
+      } else if ((ins & 0x0f00) == 0x0000) {
+        // ADD SP, #imm
+        const std::uint32_t imm = (ins & 0x7f) * 4;
+        regs_[13] = (ins & 0x80) != 0 ? regs_[13] - imm : regs_[13] + imm;
+      } else if ((ins & 0x0600) == 0x0400) {
+        ThumbBlockTransfer(ins);
+      } else {
+        Fault();
+      }
+      break;
+
+    case 6:
+      if ((ins & 0x1000) == 0) {
+        ThumbBlockTransfer(ins);
+      } else {
+        const std::uint32_t cond = (ins >> 8) & 0xf;
+        if (cond == 0xf) {
+          SoftwareInterrupt(static_cast<std::uint8_t>(ins));
+        } else if (cond == 0xe) {
+          Fault();
+        } else if (CheckCondition(cond)) {
+          const auto offset = static_cast<std::uint32_t>(
+              static_cast<std::int32_t>(static_cast<std::int8_t>(ins)) * 2);
+          Branch(regs_[15] + offset);
+        }
+      }
+      break;
+
+    default:
+      switch ((ins >> 11) & 3) {
+        case 0: {
+          // B (unconditional)
+          const auto offset = static_cast<std::uint32_t>(
+              static_cast<std::int32_t>(static_cast<std::uint32_t>(ins) << 21) >> 20);
+          Branch(regs_[15] + offset);
+          break;
+        }
+        case 2:
+          // BL (first half)
+          regs_[14] = regs_[15] + static_cast<std::uint32_t>(
+              static_cast<std::int32_t>((static_cast<std::uint32_t>(ins) & 0x7ff) << 21) >> 9);
+          break;
+        case 3: {
+          // BL (second half)
+          const std::uint32_t target = regs_[14] + ((ins & 0x7ff) << 1);
+          regs_[14] = pc_ | 1;
+          Branch(target);
+          break;
+        }
+        default:
+          Fault();
+          break;
+      }
+      break;
+  }
+}
+
+void Arm7Tdmi::ThumbAlu(std::uint16_t ins) {
+  const int rs = (ins >> 3) & 7;
+  const int rd = ins & 7;
+  const std::uint32_t a = regs_[rd];
+  const std::uint32_t b = regs_[rs];
+  std::uint32_t result;
+  bool shifter_carry = carry();
+
+  switch ((ins >> 6) & 0xf) {
+    case 0x0: result = a & b; SetNZ(result); break;
+    case 0x1: result = a ^ b; SetNZ(result); break;
+    case 0x2:
+    case 0x3:
+    case 0x4:
+    case 0x7: {
+      static constexpr int kTypes[8] = {0, 0, 0, 1, 2, 0, 0, 3};
+      result = Shift(kTypes[(ins >> 6) & 7], a, b & 0xff, shifter_carry, false);
+      SetNZ(result);
+      SetC(shifter_carry);
+      bus_.AddCycles(1);
+      break;
+    }
+    case 0x5: result = Add(a, b, carry(), true); break;
+    case 0x6: result = Sub(a, b, carry(), true); break;
+    case 0x8: SetNZ(a & b); return;
+    case 0x9: result = Sub(0, b, true, true); break;
+    case 0xa: (void)Sub(a, b, true, true); return;
+    case 0xb: (void)Add(a, b, false, true); return;
+    case 0xc: result = a | b; SetNZ(result); break;
+    case 0xd: result = a * b; SetNZ(result); bus_.AddCycles(3); break;
+    case 0xe: result = a & ~b; SetNZ(result); break;
+    default: result = ~b; SetNZ(result); break;
+  }
+  regs_[rd] = result;
+}
+
+void Arm7Tdmi::ThumbHiRegister(std::uint16_t ins) {
+  const int rs = ((ins >> 3) & 7) | ((ins >> 3) & 8);
+  const int rd = (ins & 7) | ((ins >> 4) & 8);
+  switch ((ins >> 8) & 3) {
+    case 0:
+      set_reg(rd, regs_[rd] + regs_[rs]);
+      break;
+    case 1:
+      (void)Sub(regs_[rd], regs_[rs], true, true);
+      break;
+    case 2:
+      set_reg(rd, regs_[rs]);
+      break;
+    default: {
+      const std::uint32_t target = regs_[rs];
+      cpsr_ = (target & 1) != 0 ? (cpsr_ | kFlagT) : (cpsr_ & ~kFlagT);
+      Branch(target);
+      break;
+    }
+  }
+}
+
+void Arm7Tdmi::ThumbLoadStore(std::uint16_t ins) {
+  const int rd = ins & 7;
+  const std::uint32_t rb = regs_[(ins >> 3) & 7];
+
+  switch (ins >> 12) {
+    case 0x5: {
+      const agbptr_t address = rb + regs_[(ins >> 6) & 7];
+      switch ((ins >> 9) & 7) {
+        case 0: bus_.Write32(address, regs_[rd]); break;
+        case 1: bus_.Write16(address, static_cast<std::uint16_t>(regs_[rd])); break;
+        case 2: bus_.Write8(address, static_cast<std::uint8_t>(regs_[rd])); break;
+        case 3:
+          regs_[rd] = static_cast<std::uint32_t>(
+              static_cast<std::int8_t>(bus_.Read8(address)));
+          break;
+        case 4: regs_[rd] = LoadWord(address); break;
+        case 5: regs_[rd] = LoadHalf(address); break;
+        case 6: regs_[rd] = bus_.Read8(address); break;
+        default: regs_[rd] = LoadSignedHalf(address); break;
+      }
+      break;
+    }
+
+    case 0x6: {
+      const agbptr_t address = rb + ((ins >> 6) & 0x1f) * 4;
+      if ((ins & 0x0800) != 0)
+        regs_[rd] = LoadWord(address);
+      else
+        bus_.Write32(address, regs_[rd]);
+      break;
+    }
+
+    case 0x7: {
+      const agbptr_t address = rb + ((ins >> 6) & 0x1f);
+      if ((ins & 0x0800) != 0)
+        regs_[rd] = bus_.Read8(address);
+      else
+        bus_.Write8(address, static_cast<std::uint8_t>(regs_[rd]));
+      break;
+    }
+
+    case 0x8: {
+      const agbptr_t address = rb + ((ins >> 6) & 0x1f) * 2;
+      if ((ins & 0x0800) != 0)
+        regs_[rd] = LoadHalf(address);
+      else
+        bus_.Write16(address, static_cast<std::uint16_t>(regs_[rd]));
+      break;
+    }
+
+    default: {
+      // SP-relative
+      const int r = (ins >> 8) & 7;
+      const agbptr_t address = regs_[13] + (ins & 0xff) * 4;
+      if ((ins & 0x0800) != 0)
+        regs_[r] = LoadWord(address);
+      else
+        bus_.Write32(address, regs_[r]);
+      break;
+    }
+  }
+  if ((ins & 0x0800) != 0) bus_.AddCycles(1);
+}
+
+void Arm7Tdmi::ThumbBlockTransfer(std::uint16_t ins) {
+  const bool load = (ins & 0x0800) != 0;
+  const std::uint32_t list = ins & 0xff;
+
+  if ((ins & 0xf000) == 0xb000) {
+    // PUSH/POP
+    const bool extra = (ins & 0x0100) != 0;
+    if (load) {
+      agbptr_t address = regs_[13];
+      for (int i = 0; i < 8; i++) {
+        if ((list & (1u << i)) == 0) continue;
+        regs_[i] = bus_.Read32(address);
+        address += 4;
+      }
+      std::uint32_t new_pc = 0;
+      if (extra) {
+        new_pc = bus_.Read32(address);
+        address += 4;
+      }
+      regs_[13] = address;
+      if (extra) Branch(new_pc);
+      bus_.AddCycles(1);
+    } else {
+      const int count = CountBits(list) + (extra ? 1 : 0);
+      agbptr_t address = regs_[13] - count * 4;
+      regs_[13] = address;
+      for (int i = 0; i < 8; i++) {
+        if ((list & (1u << i)) == 0) continue;
+        bus_.Write32(address, regs_[i]);
+        address += 4;
+      }
+      if (extra) bus_.Write32(address, regs_[14]);
+    }
+    return;
+  }
+
+  // LDMIA/STMIA
+  const int rb = (ins >> 8) & 7;
+  agbptr_t address = regs_[rb];
+  if (list == 0) {
+    if (load)
+      Branch(bus_.Read32(address));
+    else
+      bus_.Write32(address, regs_[15] + 2);
+    regs_[rb] = address + 0x40;
+    return;
+  }
+
+  if (load) {
+    for (int i = 0; i < 8; i++) {
+      if ((list & (1u << i)) == 0) continue;
+      regs_[i] = bus_.Read32(address);
+      address += 4;
+    }
+    if ((list & (1u << rb)) == 0) regs_[rb] = address;
+    bus_.AddCycles(1);
+  } else {
+    const std::uint32_t updated = address + CountBits(list) * 4;
+    bool first = true;
+    for (int i = 0; i < 8; i++) {
+      if ((list & (1u << i)) == 0) continue;
+      bus_.Write32(address, (i == rb && !first) ? updated : regs_[i]);
+      address += 4;
+      first = false;
+    }
+    regs_[rb] = updated;
+  }
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,155 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ARM7TDMI_HPP_
+#define GAXTAPPER_ARM7TDMI_HPP_
+
+#include <array>
+#include <cstdint>
+#include "agb_bus.hpp"
+#include "types.hpp"
+
+namespace gaxtapper {
+
+class Arm7Tdmi;
+
+// Implements the software interrupts (BIOS calls) in high-level code.
+class Arm7SwiHandler {
+ public:
+  virtual ~Arm7SwiHandler() = default;
+  virtual void HandleSwi(Arm7Tdmi& cpu, std::uint8_t number) = 0;
+};
+
+// ARM7TDMI interpreter (ARMv4T, ARM and Thumb states).
+class Arm7Tdmi {
+ public:
+  static constexpr std::uint32_t kModeUsr = 0x10;
+  static constexpr std::uint32_t kModeFiq = 0x11;
+  static constexpr std::uint32_t kModeIrq = 0x12;
+  static constexpr std::uint32_t kModeSvc = 0x13;
+  static constexpr std::uint32_t kModeAbt = 0x17;
+  static constexpr std::uint32_t kModeUnd = 0x1b;
+  static constexpr std::uint32_t kModeSys = 0x1f;
+
+  static constexpr std::uint32_t kFlagN = 1u << 31;
+  static constexpr std::uint32_t kFlagZ = 1u << 30;
+  static constexpr std::uint32_t kFlagC = 1u << 29;
+  static constexpr std::uint32_t kFlagV = 1u << 28;
+  static constexpr std::uint32_t kFlagI = 1u << 7;
+  static constexpr std::uint32_t kFlagF = 1u << 6;
+  static constexpr std::uint32_t kFlagT = 1u << 5;
+
+  explicit Arm7Tdmi(AgbBus& bus) : bus_(bus) {}
+
+  // Sets up the state the BIOS leaves when it jumps to the cartridge.
+  void Reset(agbptr_t entrypoint);
+
+  // Executes a single instruction, or takes a pending IRQ exception.
+  void Step();
+
+  [[nodiscard]] std::uint32_t reg(int index) const noexcept {
+    return index == 15 ? pc_ : regs_[index];
+  }
+  void set_reg(int index, std::uint32_t value) noexcept {
+    if (index == 15)
+      Branch(value);
+    else
+      regs_[index] = value;
+  }
+
+  [[nodiscard]] std::uint32_t cpsr() const noexcept { return cpsr_; }
+  [[nodiscard]] bool thumb() const noexcept { return (cpsr_ & kFlagT) != 0; }
+
+  // The address of the instruction that is executed next.
+  [[nodiscard]] agbptr_t pc() const noexcept { return pc_; }
+
+  // Re-executes the current instruction (used for waiting BIOS calls).
+  void RewindInstruction() noexcept { pc_ = current_; }
+
+  [[nodiscard]] bool faulted() const noexcept { return faulted_; }
+  [[nodiscard]] agbptr_t fault_address() const noexcept { return current_; }
+
+  [[nodiscard]] std::uint64_t instructions() const noexcept {
+    return instructions_;
+  }
+
+  void set_swi_handler(Arm7SwiHandler* handler) noexcept {
+    swi_handler_ = handler;
+  }
+
+ private:
+  AgbBus& bus_;
+  Arm7SwiHandler* swi_handler_ = nullptr;
+
+  // regs_[15] holds the pipelined value of PC (instruction + 8 or + 4).
+  std::array<std::uint32_t, 16> regs_{};
+  std::uint32_t cpsr_ = kModeSys;
+  std::uint32_t spsr_ = 0;
+  agbptr_t pc_ = 0;
+  agbptr_t current_ = 0;
+  bool faulted_ = false;
+  std::uint64_t instructions_ = 0;
+
+  // Banked registers: index by BankIndex().
+  std::array<std::uint32_t, 6> bank_r13_{};
+  std::array<std::uint32_t, 6> bank_r14_{};
+  std::array<std::uint32_t, 6> bank_spsr_{};
+  std::array<std::uint32_t, 5> bank_usr_r8_{};
+  std::array<std::uint32_t, 5> bank_fiq_r8_{};
+
+  static int BankIndex(std::uint32_t mode) noexcept;
+  void SwitchMode(std::uint32_t mode);
+  void WriteCpsr(std::uint32_t value);
+  void RaiseIrq();
+  void Fault();
+
+  void Branch(std::uint32_t address) noexcept {
+    pc_ = address & (thumb() ? ~1u : ~3u);
+    bus_.AddCycles(4);
+  }
+
+  [[nodiscard]] bool CheckCondition(std::uint32_t cond) const noexcept;
+
+  void SetNZ(std::uint32_t result) noexcept {
+    cpsr_ = (cpsr_ & ~(kFlagN | kFlagZ)) | (result & kFlagN) |
+            (result == 0 ? kFlagZ : 0);
+  }
+  void SetC(bool carry) noexcept {
+    cpsr_ = carry ? (cpsr_ | kFlagC) : (cpsr_ & ~kFlagC);
+  }
+  void SetV(bool overflow) noexcept {
+    cpsr_ = overflow ? (cpsr_ | kFlagV) : (cpsr_ & ~kFlagV);
+  }
+  [[nodiscard]] bool carry() const noexcept { return (cpsr_ & kFlagC) != 0; }
+
+  std::uint32_t Add(std::uint32_t a, std::uint32_t b, bool carry_in,
+                    bool set_flags);
+  std::uint32_t Sub(std::uint32_t a, std::uint32_t b, bool carry_in,
+                    bool set_flags);
+  std::uint32_t Shift(int type, std::uint32_t value, std::uint32_t amount,
+                      bool& carry_out, bool immediate) const noexcept;
+
+  std::uint32_t LoadWord(agbptr_t address);
+  std::uint32_t LoadHalf(agbptr_t address);
+  std::uint32_t LoadSignedHalf(agbptr_t address);
+
+  void ExecuteArm(std::uint32_t ins);
+  void ArmDataProcessing(std::uint32_t ins);
+  void ArmPsrTransfer(std::uint32_t ins);
+  void ArmMultiply(std::uint32_t ins);
+  void ArmMultiplyLong(std::uint32_t ins);
+  void ArmSwap(std::uint32_t ins);
+  void ArmHalfwordTransfer(std::uint32_t ins);
+  void ArmSingleTransfer(std::uint32_t ins);
+  void ArmBlockTransfer(std::uint32_t ins);
+  void SoftwareInterrupt(std::uint8_t number);
+
+  void ExecuteThumb(std::uint16_t ins);
+  void ThumbAlu(std::uint16_t ins);
+  void ThumbHiRegister(std::uint16_t ins);
+  void ThumbLoadStore(std::uint16_t ins);
+  void ThumbBlockTransfer(std::uint16_t ins);
+};
+
+}  // namespace gaxtapper
+
+#endif
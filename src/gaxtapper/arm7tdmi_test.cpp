@@ -0,0 +1,277 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "arm7tdmi.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "agb_bus.hpp"
+#include "bytes.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr std::uint32_t kFlagsMask = Arm7Tdmi::kFlagN | Arm7Tdmi::kFlagZ |
+                                     Arm7Tdmi::kFlagC | Arm7Tdmi::kFlagV;
+
+// A bare CPU and bus that run hand-assembled code from the start of the ROM,
+// without the high-level BIOS calls of AgbEmulator.
+class Machine {
+ public:
+  explicit Machine(const std::vector<std::uint32_t>& code)
+      : rom_(MakeRom(code)), bus_(rom_), cpu_(bus_) {
+    cpu_.Reset(0x8000000);
+  }
+
+  [[nodiscard]] AgbBus& bus() noexcept { return bus_; }
+  [[nodiscard]] Arm7Tdmi& cpu() noexcept { return cpu_; }
+
+  void Run(int steps) {
+    for (int i = 0; i < steps; i++) cpu_.Step();
+  }
+
+  [[nodiscard]] std::uint32_t flags() const noexcept {
+    return cpu_.cpsr() & kFlagsMask;
+  }
+
+ private:
+  std::string rom_;
+  AgbBus bus_;
+  Arm7Tdmi cpu_;
+
+  static std::string MakeRom(const std::vector<std::uint32_t>& code) {
+    std::string rom(code.size() * 4, '\0');
+    for (std::size_t i = 0; i < code.size(); i++)
+      WriteInt32L(&rom[i * 4], code[i]);
+    return rom;
+  }
+};
+
+// Two Thumb instructions in a word, the first one in the low half.
+constexpr std::uint32_t Thumb(std::uint16_t first, std::uint16_t second) {
+  return first | static_cast<std::uint32_t>(second) << 16;
+}
+
+void TestFlags() {
+  Machine machine{{
+      0xe3b00102,  // movs r0, #0x80000000
+      0xe0901000,  // adds r1, r0, r0
+      0xe2512001,  // subs r2, r1, #1
+      0xe3a03005,  // mov r3, #5
+      0xe3530005,  // cmp r3, #5
+      0xe2a34000,  // adc r4, r3, #0
+      0x03a05001,  // moveq r5, #1
+      0x13a05002,  // movne r5, #2
+      0xe3730005,  // cmn r3, #5
+      0xc3a06001,  // movgt r6, #1
+  }};
+  using C = Arm7Tdmi;
+
+  // An immediate with a rotation puts its bit 31 into the carry.
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(0) == 0x80000000);
+  EXPECT(machine.flags() == (C::kFlagN | C::kFlagC));
+
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(1) == 0);
+  EXPECT(machine.flags() == (C::kFlagZ | C::kFlagC | C::kFlagV));
+
+  // A borrow clears the carry.
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(2) == 0xffffffff);
+  EXPECT(machine.flags() == C::kFlagN);
+
+  machine.Run(2);
+  EXPECT(machine.flags() == (C::kFlagZ | C::kFlagC));
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(4) == 6);
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(5) == 1);
+
+  // 5 + 5 is positive and does not carry, so GT holds.
+  machine.Run(2);
+  EXPECT(machine.flags() == 0);
+  EXPECT(machine.cpu().reg(6) == 1);
+}
+
+void TestShifterCarry() {
+  Machine machine{{
+      0xe3a00003,  // mov r0, #3
+      0xe1b010a0,  // movs r1, r0, lsr #1
+      0xe1b02f00,  // movs r2, r0, lsl #30
+      0xe1b03020,  // movs r3, r0, lsr #32
+      0xe1b04060,  // movs r4, r0, rrx
+      0xe3a05000,  // mov r5, #0
+      0xe1b06510,  // movs r6, r0, lsl r5
+      0xe3e07000,  // mvn r7, #0
+      0xe1b08047,  // movs r8, r7, asr #32
+      0xe3a05021,  // mov r5, #33
+      0xe1b09537,  // movs r9, r7, lsr r5
+  }};
+  using C = Arm7Tdmi;
+
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(1) == 1);
+  EXPECT(machine.flags() == C::kFlagC);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(2) == 0xc0000000);
+  EXPECT(machine.flags() == C::kFlagN);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(3) == 0);
+  EXPECT(machine.flags() == C::kFlagZ);
+
+  // RRX shifts the carry in, and bit 0 out.
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(4) == 1);
+  EXPECT(machine.flags() == C::kFlagC);
+
+  // A shift by a register of 0 leaves the carry as it is.
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(6) == 3);
+  EXPECT(machine.flags() == C::kFlagC);
+
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(8) == 0xffffffff);
+  EXPECT(machine.flags() == (C::kFlagN | C::kFlagC));
+
+  // A shift by a register of more than 32 clears the result and the carry.
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(9) == 0);
+  EXPECT(machine.flags() == C::kFlagZ);
+}
+
+void TestBlockTransfer() {
+  Machine machine{{
+      0xe3a00403,  // mov r0, #0x3000000
+      0xe3a01001,  // mov r1, #1
+      0xe3a02002,  // mov r2, #2
+      0xe3a03003,  // mov r3, #3
+      0xe8a0000e,  // stmia r0!, {r1-r3}
+      0xe9300070,  // ldmdb r0!, {r4-r6}
+      0xe3a0e0aa,  // mov lr, #0xaa
+      0xe92d4002,  // stmfd sp!, {r1, lr}
+      0xe8bd0300,  // ldmfd sp!, {r8, r9}
+      0xe8800003,  // stmia r0, {r0, r1}
+  }};
+
+  machine.Run(5);
+  EXPECT(machine.cpu().reg(0) == 0x300000c);
+  EXPECT(machine.bus().Read32(0x3000000) == 1);
+  EXPECT(machine.bus().Read32(0x3000004) == 2);
+  EXPECT(machine.bus().Read32(0x3000008) == 3);
+
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(0) == 0x3000000);
+  EXPECT(machine.cpu().reg(4) == 1);
+  EXPECT(machine.cpu().reg(5) == 2);
+  EXPECT(machine.cpu().reg(6) == 3);
+
+  const std::uint32_t sp = machine.cpu().reg(13);
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(13) == sp - 8);
+  EXPECT(machine.bus().Read32(sp - 8) == 1);
+  EXPECT(machine.bus().Read32(sp - 4) == 0xaa);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(13) == sp);
+  EXPECT(machine.cpu().reg(8) == 1);
+  EXPECT(machine.cpu().reg(9) == 0xaa);
+
+  // A base in the list stores its value before the writeback.
+  machine.Run(1);
+  EXPECT(machine.bus().Read32(0x3000000) == 0x3000000);
+  EXPECT(machine.bus().Read32(0x3000004) == 1);
+}
+
+void TestModes() {
+  Machine machine{{
+      0xe3a08001,  // mov r8, #1
+      0xe321f0d1,  // msr cpsr_c, #0xd1 (FIQ)
+      0xe3a08002,  // mov r8, #2
+      0xe321f0d2,  // msr cpsr_c, #0xd2 (IRQ)
+      0xe10f0000,  // mrs r0, cpsr
+      0xe321f01f,  // msr cpsr_c, #0x1f (System)
+      0xef060000,  // swi 0x06
+  }};
+
+  // The FIQ mode has its own r8-r12, and every mode but System its own
+  // r13 and r14.
+  machine.Run(3);
+  EXPECT((machine.cpu().cpsr() & 0x1f) == Arm7Tdmi::kModeFiq);
+  EXPECT(machine.cpu().reg(8) == 2);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(8) == 1);
+  EXPECT(machine.cpu().reg(13) == 0x3007fa0);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(0) == 0xd2);
+  machine.Run(1);
+  EXPECT(machine.cpu().cpsr() == Arm7Tdmi::kModeSys);
+  EXPECT(machine.cpu().reg(13) == 0x3007f00);
+
+  // Without a SWI handler, SWI enters the Supervisor mode at the vector.
+  machine.Run(1);
+  EXPECT((machine.cpu().cpsr() & 0x1f) == Arm7Tdmi::kModeSvc);
+  EXPECT((machine.cpu().cpsr() & Arm7Tdmi::kFlagI) != 0);
+  EXPECT(machine.cpu().pc() == 0x08);
+  EXPECT(machine.cpu().reg(14) == 0x800001c);
+  EXPECT(machine.cpu().reg(13) == 0x3007fe0);
+}
+
+void TestThumb() {
+  Machine machine{{
+      0xe28f0001,  // add r0, pc, #1
+      0xe12fff10,  // bx r0
+      Thumb(0x2105,    // movs r1, #5
+            0x008a),   // lsls r2, r1, #2
+      Thumb(0x1a53,    // subs r3, r2, r1
+            0x4249),   // negs r1, r1
+      Thumb(0xb406,    // push {r1, r2}
+            0xbc30),   // pop {r4, r5}
+      Thumb(0xf000,    // bl 0x800001c
+            0xf802),
+      Thumb(0x0000,    // (returned to)
+            0x0000),
+      Thumb(0x4770,    // bx lr
+            0x0000),
+  }};
+
+  machine.Run(2);
+  EXPECT(machine.cpu().thumb());
+  EXPECT(machine.cpu().pc() == 0x8000008);
+
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(1) == 5);
+  EXPECT(machine.cpu().reg(2) == 20);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(3) == 15);
+  EXPECT(machine.flags() == Arm7Tdmi::kFlagC);
+  machine.Run(1);
+  EXPECT(machine.cpu().reg(1) == 0xfffffffb);
+  EXPECT((machine.flags() & Arm7Tdmi::kFlagN) != 0);
+
+  const std::uint32_t sp = machine.cpu().reg(13);
+  machine.Run(2);
+  EXPECT(machine.cpu().reg(4) == 0xfffffffb);
+  EXPECT(machine.cpu().reg(5) == 20);
+  EXPECT(machine.cpu().reg(13) == sp);
+
+  // BL sets lr to the next instruction, with bit 0 for the Thumb state.
+  machine.Run(2);
+  EXPECT(machine.cpu().pc() == 0x800001c);
+  EXPECT(machine.cpu().reg(14) == 0x8000019);
+  machine.Run(1);
+  EXPECT(machine.cpu().pc() == 0x8000018);
+  EXPECT(machine.cpu().thumb());
+}
+
+}  // namespace
+
+int main() {
+  TestFlags();
+  TestShifterCarry();
+  TestBlockTransfer();
+  TestModes();
+  TestThumb();
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,179 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "async_file_writer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gaxtapper {
+
+namespace {
+
+struct FileCloser {
+  void operator()(std::FILE* file) const noexcept { std::fclose(file); }
+};
+
+[[noreturn]] void ThrowFileError(const std::filesystem::path& path,
+                                 const char* message) {
+  throw std::runtime_error(path.string() + ": " + message);
+}
+
+void SyncDescriptor(std::FILE* file, const std::filesystem::path& path) {
+  if (std::fflush(file) != 0) ThrowFileError(path, "Unable to write the file");
+#ifdef _WIN32
+  if (_commit(_fileno(file)) != 0)
+#else
+  if (fsync(fileno(file)) != 0)
+#endif
+    ThrowFileError(path, "Unable to sync the file");
+}
+
+// A new file is durable only when the directory entry is, too.
+void SyncDirectory(const std::filesystem::path& path) {
+#ifndef _WIN32
+  const int fd = open(path.empty() ? "." : path.c_str(), O_RDONLY);
+  if (fd < 0) ThrowFileError(path, "Unable to open the directory");
+  const int result = fsync(fd);
+  close(fd);
+  if (result != 0) ThrowFileError(path, "Unable to sync the directory");
+#else
+  (void)path;
+#endif
+}
+
+}  // namespace
+
+AsyncFileWriter::AsyncFileWriter(SyncPolicy sync, unsigned num_threads,
+                                 std::size_t queue_size)
+    : sync_(sync), queue_size_(queue_size) {
+  if (num_threads == 0) num_threads = 1;
+  threads_.reserve(num_threads);
+  for (unsigned i = 0; i < num_threads; i++)
+    threads_.emplace_back([this] { Run(); });
+}
+
+AsyncFileWriter::~AsyncFileWriter() { Close(); }
+
+void AsyncFileWriter::Write(std::filesystem::path path, std::string data) {
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock{mutex_};
+  not_full_.wait(lock, [&] {
+    return error_ || queue_.empty() ||
+           queued_bytes_ + data.size() <= queue_size_;
+  });
+  wait_seconds_ += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  if (error_) std::rethrow_exception(error_);
+  queued_bytes_ += data.size();
+  queue_.push_back(Job{std::move(path), std::move(data)});
+  not_empty_.notify_one();
+}
+
+void AsyncFileWriter::Finish() {
+  Close();
+  if (error_) std::rethrow_exception(error_);
+  if (sync_ == SyncPolicy::kBatch) {
+    std::set<std::filesystem::path> directories;
+    for (const std::filesystem::path& path : written_) {
+      SyncFile(path);
+      directories.insert(path.parent_path());
+    }
+    for (const std::filesystem::path& directory : directories)
+      SyncDirectory(directory);
+  }
+}
+
+double AsyncFileWriter::busy_seconds() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return busy_seconds_;
+}
+
+double AsyncFileWriter::wait_seconds() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return wait_seconds_;
+}
+
+void AsyncFileWriter::Run() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      not_empty_.wait(lock, [&] { return closed_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    try {
+      WriteFile(job.path, job.data, sync_ == SyncPolicy::kFile);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      if (!error_) error_ = std::current_exception();
+    }
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    busy_seconds_ += seconds;
+    queued_bytes_ -= job.data.size();
+    written_.push_back(std::move(job.path));
+    not_full_.notify_all();
+  }
+}
+
+void AsyncFileWriter::Close() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (closed_) return;
+    closed_ = true;
+  }
+  not_empty_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+SyncPolicy AsyncFileWriter::ParseSyncPolicy(std::string_view name) {
+  if (name == "none") return SyncPolicy::kNone;
+  if (name == "file") return SyncPolicy::kFile;
+  if (name == "batch") return SyncPolicy::kBatch;
+  throw std::invalid_argument("Unknown sync policy \"" + std::string{name} +
+                              "\" (expected none, file or batch).");
+}
+
+void AsyncFileWriter::WriteFile(const std::filesystem::path& path,
+                                std::string_view data, bool sync) {
+#ifdef _WIN32
+  std::unique_ptr<std::FILE, FileCloser> file{_wfopen(path.c_str(), L"wb")};
+#else
+  std::unique_ptr<std::FILE, FileCloser> file{std::fopen(path.c_str(), "wb")};
+#endif
+  if (!file) ThrowFileError(path, "Unable to create the file");
+  if (std::fwrite(data.data(), 1, data.size(), file.get()) != data.size())
+    ThrowFileError(path, "Unable to write the file");
+  if (sync) SyncDescriptor(file.get(), path);
+  if (std::fclose(file.release()) != 0)
+    ThrowFileError(path, "Unable to write the file");
+}
+
+void AsyncFileWriter::SyncFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+  std::unique_ptr<std::FILE, FileCloser> file{_wfopen(path.c_str(), L"r+b")};
+#else
+  std::unique_ptr<std::FILE, FileCloser> file{std::fopen(path.c_str(), "rb")};
+#endif
+  if (!file) ThrowFileError(path, "Unable to open the file");
+  SyncDescriptor(file.get(), path);
+}
+
+}  // namespace gaxtapper
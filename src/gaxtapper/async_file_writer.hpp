@@ -0,0 +1,91 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ASYNC_FILE_WRITER_HPP_
+#define GAXTAPPER_ASYNC_FILE_WRITER_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gaxtapper {
+
+// When the written files are flushed to the storage device.
+//   none:  left to the operating system.
+//   file:  each file is synced when it is closed.
+//   batch: all the files are synced at once by Finish.
+enum class SyncPolicy { kNone, kFile, kBatch };
+
+// Writes files on dedicated I/O threads, so that the threads that compress
+// the data do not wait for the file system. The files waiting to be written
+// are kept in a queue of a limited size in bytes: Write blocks while the
+// queue is full, which keeps the memory bounded when the disk is slower
+// than the compression.
+class AsyncFileWriter {
+ public:
+  static constexpr std::size_t kDefaultQueueSize = 0x4000000;
+
+  explicit AsyncFileWriter(SyncPolicy sync = SyncPolicy::kNone,
+                           unsigned num_threads = 1,
+                           std::size_t queue_size = kDefaultQueueSize);
+  ~AsyncFileWriter();
+
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  // Queues the file. A file larger than the queue is accepted when the
+  // queue is empty. Rethrows the error of a previous write, if any.
+  void Write(std::filesystem::path path, std::string data);
+
+  // Waits for all the files, syncs them for the batch policy, and rethrows
+  // the first error of the writes.
+  void Finish();
+
+  // The time that the I/O threads spent writing, summed over the threads,
+  // and the time that Write waited for room in the queue.
+  [[nodiscard]] double busy_seconds() const;
+  [[nodiscard]] double wait_seconds() const;
+
+  [[nodiscard]] static SyncPolicy ParseSyncPolicy(std::string_view name);
+
+  // Writes a file at once, and syncs it if sync is true.
+  static void WriteFile(const std::filesystem::path& path,
+                        std::string_view data, bool sync);
+
+  // Flushes an existing file to the storage device.
+  static void SyncFile(const std::filesystem::path& path);
+
+ private:
+  struct Job {
+    std::filesystem::path path;
+    std::string data;
+  };
+
+  SyncPolicy sync_;
+  std::size_t queue_size_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<Job> queue_;
+  std::size_t queued_bytes_ = 0;
+  double busy_seconds_ = 0.0;
+  double wait_seconds_ = 0.0;
+  bool closed_ = false;
+  std::exception_ptr error_;
+  std::vector<std::filesystem::path> written_;
+  std::vector<std::thread> threads_;
+
+  void Run();
+  void Close();
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,120 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "async_file_writer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  return {std::istreambuf_iterator<char>(stream),
+          std::istreambuf_iterator<char>()};
+}
+
+std::string MakeData(int index) {
+  return std::string(static_cast<std::size_t>(index) * 0x1000 + 7,
+                     static_cast<char>('a' + index));
+}
+
+// The files are the same whatever the number of threads and the policy.
+void TestOutput(const std::filesystem::path& directory) {
+  constexpr int kNumFiles = 16;
+  for (const unsigned num_threads : {1u, 2u, 4u}) {
+    for (const SyncPolicy sync :
+         {SyncPolicy::kNone, SyncPolicy::kFile, SyncPolicy::kBatch}) {
+      const std::filesystem::path outdir =
+          directory / ("out" + std::to_string(num_threads) + "-" +
+                       std::to_string(static_cast<int>(sync)));
+      std::filesystem::create_directories(outdir);
+      AsyncFileWriter writer{sync, num_threads, 0x8000};
+      for (int i = 0; i < kNumFiles; i++) {
+        writer.Write(outdir / (std::to_string(i) + ".bin"), MakeData(i));
+      }
+      writer.Finish();
+      EXPECT(writer.busy_seconds() >= 0.0);
+
+      for (int i = 0; i < kNumFiles; i++) {
+        EXPECT(ReadFile(outdir / (std::to_string(i) + ".bin")) == MakeData(i));
+      }
+      EXPECT(std::distance(std::filesystem::directory_iterator(outdir),
+                           std::filesystem::directory_iterator()) ==
+             kNumFiles);
+    }
+  }
+}
+
+// The error of a write is rethrown by Finish.
+void TestError(const std::filesystem::path& directory) {
+  AsyncFileWriter writer;
+  writer.Write(directory / "missing" / "a.bin", "data");
+  EXPECT_THROW(writer.Finish(), std::runtime_error);
+
+  // A file larger than the queue is accepted into an empty queue.
+  AsyncFileWriter small{SyncPolicy::kNone, 1, 4};
+  small.Write(directory / "large.bin", MakeData(3));
+  small.Finish();
+  EXPECT(ReadFile(directory / "large.bin") == MakeData(3));
+}
+
+#ifndef _WIN32
+// Write blocks while the queue is full. The first file is a FIFO, whose
+// writer waits until the test opens it for reading, so the queue stays full
+// until then.
+void TestQueueFull(const std::filesystem::path& directory) {
+  const std::filesystem::path fifo = directory / "fifo";
+  EXPECT(mkfifo(fifo.c_str(), 0600) == 0);
+
+  const std::string data(16, 'x');
+  AsyncFileWriter writer{SyncPolicy::kNone, 1, data.size()};
+  writer.Write(fifo, data);
+  std::atomic<bool> done{false};
+  std::thread thread{[&] {
+    writer.Write(directory / "a.bin", data);
+    writer.Write(directory / "b.bin", data);
+    done = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds{200});
+  EXPECT(!done);
+
+  {
+    std::ifstream reader(fifo, std::ios::in | std::ios::binary);
+    EXPECT(std::string(std::istreambuf_iterator<char>(reader),
+                       std::istreambuf_iterator<char>()) == data);
+  }
+  thread.join();
+  EXPECT(done);
+  writer.Finish();
+  EXPECT(writer.wait_seconds() > 0.0);
+  EXPECT(ReadFile(directory / "a.bin") == data);
+  EXPECT(ReadFile(directory / "b.bin") == data);
+}
+#endif
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  EXPECT(AsyncFileWriter::ParseSyncPolicy("batch") == SyncPolicy::kBatch);
+  EXPECT_THROW((void)AsyncFileWriter::ParseSyncPolicy("always"),
+               std::invalid_argument);
+  TestOutput(directory.path());
+  TestError(directory.path());
+#ifndef _WIN32
+  TestQueueFull(directory.path());
+#endif
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,92 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_BOUNDED_QUEUE_HPP_
+#define GAXTAPPER_BOUNDED_QUEUE_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace gaxtapper {
+
+/// A queue of a limited number of items between the stages of a pipeline.
+/// Push blocks while the queue is full and Pop blocks while it is empty, so
+/// a fast stage waits for a slow one instead of piling up items. The time
+/// spent blocking on each side is kept, which shows the stage that holds
+/// back the pipeline.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity)
+      : capacity_(capacity != 0 ? capacity : 1) {}
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /// Adds an item, waiting for room in the queue.
+  void Push(T item) {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock{mutex_};
+    not_full_.wait(lock, [&] { return items_.size() < capacity_; });
+    push_wait_seconds_ += SecondsSince(start);
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  /// Takes the oldest item, waiting for one. Returns nothing once the queue
+  /// is closed and empty.
+  std::optional<T> Pop() {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock{mutex_};
+    not_empty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+    pop_wait_seconds_ += SecondsSince(start);
+    if (items_.empty()) return std::nullopt;
+    std::optional<T> item{std::move(items_.front())};
+    items_.pop_front();
+    not_full_.notify_one();
+    return item;
+  }
+
+  /// Ends the input. The items in the queue can still be taken.
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+  }
+
+  /// The time that Push waited for room, and Pop waited for an item.
+  [[nodiscard]] double push_wait_seconds() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return push_wait_seconds_;
+  }
+  [[nodiscard]] double pop_wait_seconds() const {
+    std::lock_guard<std::mutex> lock{mutex_};
+    return pop_wait_seconds_;
+  }
+
+ private:
+  const std::size_t capacity_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<T> items_;
+  bool closed_ = false;
+  double push_wait_seconds_ = 0.0;
+  double pop_wait_seconds_ = 0.0;
+
+  static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  }
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -27,6 +27,17 @@ Cartridge Cartridge::LoadFromFile(const std::filesystem::path& path) {
   return cartridge;
 }
 
+Cartridge Cartridge::LoadFromMemory(std::string_view rom) {
+  Cartridge cartridge;
+  ValidateSize(rom.size());
+
+  const auto aligned_size = (rom.size() + 3) & ~std::size_t{3};
+  cartridge.rom_.reserve(aligned_size);
+  cartridge.rom_.assign(rom.data(), rom.size());
+  cartridge.rom_.resize(aligned_size, 0);
+  return cartridge;
+}
+
 void Cartridge::ValidateSize(std::uintmax_t size) {
   if (size < kHeaderSize) {
     throw std::range_error("The input data too small.");
@@ -7,6 +7,7 @@
 #include <cstring>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include "arm.hpp"
 #include "bytes.hpp"
 #include "types.hpp"
@@ -80,6 +81,7 @@ class Cartridge {
   }
 
   static Cartridge LoadFromFile(const std::filesystem::path& path);
+  static Cartridge LoadFromMemory(std::string_view rom);
 
  private:
   std::string rom_;
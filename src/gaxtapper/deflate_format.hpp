@@ -0,0 +1,77 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_DEFLATE_FORMAT_HPP_
+#define GAXTAPPER_DEFLATE_FORMAT_HPP_
+
+#include <cstdint>
+
+namespace gaxtapper {
+
+// The constants of the deflate format (RFC 1951) that the built-in encoders
+// need.
+struct DeflateFormat {
+  static constexpr unsigned kMinMatch = 3;
+  static constexpr unsigned kMaxMatch = 258;
+  static constexpr unsigned kWindowSize = 0x8000;
+  static constexpr unsigned kEndOfBlock = 256;
+  static constexpr unsigned kNumLitLenSymbols = 286;
+  static constexpr unsigned kNumDistanceSymbols = 30;
+  // The fixed code also assigns codes to the two unused symbols 286 and 287.
+  static constexpr unsigned kNumFixedLitLenSymbols = 288;
+  static constexpr unsigned kMaxStoredSize = 0xffff;
+
+  static constexpr std::uint16_t kLengthBase[29]{
+      3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static constexpr std::uint8_t kLengthExtraBits[29]{
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static constexpr std::uint16_t kDistanceBase[30]{
+      1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+      33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+      1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+  static constexpr std::uint8_t kDistanceExtraBits[30]{
+      0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+      6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+  // The order of the code length code lengths in a dynamic block header.
+  static constexpr std::uint8_t kCodeLengthOrder[19]{
+      16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+  /// Returns the index of the length code (the symbol minus 257).
+  /// @param length the match length (3-258).
+  [[nodiscard]] static constexpr unsigned LengthCode(unsigned length) noexcept {
+    if (length == kMaxMatch) return 28;
+    const unsigned value = length - kMinMatch;
+    if (value < 8) return value;
+    const unsigned bits = Log2(value);
+    return 4 * (bits - 1) + ((value >> (bits - 2)) & 3);
+  }
+
+  /// Returns the distance code.
+  /// @param distance the match distance (1-32768).
+  [[nodiscard]] static constexpr unsigned DistanceCode(
+      unsigned distance) noexcept {
+    const unsigned value = distance - 1;
+    if (value < 4) return value;
+    const unsigned bits = Log2(value);
+    return 2 * bits + ((value >> (bits - 1)) & 1);
+  }
+
+  /// Returns the length of a symbol of the fixed literal/length code.
+  [[nodiscard]] static constexpr unsigned FixedLitLenLength(
+      unsigned symbol) noexcept {
+    return symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+  }
+
+ private:
+  [[nodiscard]] static constexpr unsigned Log2(unsigned value) noexcept {
+    unsigned bits = 0;
+    while (value >>= 1) bits++;
+    return bits;
+  }
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,35 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_benchmark.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "agb_emulator.hpp"
+#include "parallel.hpp"
+
+namespace gaxtapper {
+
+std::vector<GaxDriverLoad> GaxBenchmark::MeasureDriverLoad(
+    std::string_view rom, agbptr_t minigsf_address,
+    const std::vector<std::string>& minigsfs, double seconds,
+    unsigned num_threads) {
+  std::vector<GaxDriverLoad> loads(minigsfs.size());
+  const auto cycles =
+      static_cast<std::uint64_t>(seconds * AgbEmulator::kCpuClock);
+
+  ParallelFor(
+      minigsfs.size(),
+      [&](std::size_t index, unsigned) {
+        AgbEmulator emulator{rom};
+        emulator.bus().set_rom_overlay(minigsf_address, minigsfs[index]);
+        GaxDriverLoad& load = loads[index];
+        load.ok = emulator.Run(cycles);
+        load.active_cycles = emulator.active_cycles();
+        load.seconds = seconds;
+      },
+      num_threads);
+  return loads;
+}
+
+}  // namespace gaxtapper
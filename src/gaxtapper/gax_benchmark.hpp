@@ -0,0 +1,39 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GAX_BENCHMARK_HPP_
+#define GAXTAPPER_GAX_BENCHMARK_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// The CPU load of playing a minigsf, measured by emulation.
+struct GaxDriverLoad {
+  std::uint64_t active_cycles = 0;  // cycles spent outside of the halt
+  double seconds = 0.0;             // seconds of audio that have been played
+  bool ok = false;                  // false if the playback has stopped
+
+  [[nodiscard]] double cycles_per_second() const noexcept {
+    return seconds > 0 ? active_cycles / seconds : 0.0;
+  }
+};
+
+// Measures the cost of the playback, which is what a GSF player pays for
+// every second of audio.
+class GaxBenchmark {
+ public:
+  static constexpr double kDefaultSeconds = 30.0;
+
+  [[nodiscard]] static std::vector<GaxDriverLoad> MeasureDriverLoad(
+      std::string_view rom, agbptr_t minigsf_address,
+      const std::vector<std::string>& minigsfs,
+      double seconds = kDefaultSeconds, unsigned num_threads = 0);
+};
+
+}  // namespace gaxtapper
+
+#endif
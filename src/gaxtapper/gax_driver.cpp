@@ -36,7 +36,7 @@ GaxDriverParam GaxDriver::Inspect(std::string_view rom) {
 
 void GaxDriver::InstallGsfDriver(std::string& rom, agbptr_t address,
                                  agbptr_t work_address, agbsize_t work_size,
-                                 const GaxDriverParam& param) {
+                                 const GaxDriverParam& param, bool lean) {
   if (!is_romptr(address))
     throw std::invalid_argument("The gsf driver address is not valid.");
   if (!param.ok()) {
@@ -91,6 +91,14 @@ void GaxDriver::InstallGsfDriver(std::string& rom, agbptr_t address,
     WriteInt32L(&rom[offset + kMyWorkRamSizeOffsetV2], work_size);
   }
 
+  if (lean) {
+    const agbsize_t intr_main_offset = param.version().major_version() == 3
+                                           ? kIntrMainOffsetV3
+                                           : kIntrMainOffsetV2;
+    std::memcpy(&rom[offset + intr_main_offset], lean_intr_main.data(),
+                lean_intr_main.size());
+  }
+
   WriteInt32L(rom.data(), make_arm_b(0x8000000, address));
 }
 
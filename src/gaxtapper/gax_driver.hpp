@@ -32,6 +32,18 @@ class GaxDriver {
   static constexpr agbsize_t kGaxPlayOffsetV3 = 0x204;
   static constexpr agbsize_t kGax2ParamFxImmOffsetV3 = 0x7c;
 
+  // AgbMain of the driver keeps the Gax2Params structure that it passes to
+  // gax2_init on the system stack (sp_sys - push {r4-r7,lr} - Gax2Params).
+  static constexpr agbptr_t kGax2ParamsAddress = 0x3007f00 - 0x14 - 0x40;
+  // The stacks of the driver are assumed to fit above this address.
+  static constexpr agbptr_t kDriverStackLimit = 0x3007c00;
+  // The driver copies IntrMain and its table to the beginning of the work
+  // area, and passes the rest of the area to GAX.
+  static constexpr agbsize_t kDriverWorkRamHeaderSize = 0x94 + 2 * 4;
+  // IntrMain in the driver blocks, which the lean driver replaces.
+  static constexpr agbsize_t kIntrMainOffsetV2 = 0x12c;
+  static constexpr agbsize_t kIntrMainOffsetV3 = 0x130;
+
   static constexpr agbsize_t kMinigsfParamMyMusicOffset = 0;
   static constexpr agbsize_t kMinigsfParamMyFxOffset = 4;
   static constexpr agbsize_t kMinigsfParamMyFxIdOffset = 8;
@@ -131,6 +143,23 @@ class GaxDriver {
       0x00, 0x48, 0x00, 0x47, 0x00, 0x00, 0x00, 0x08, 0x00, 0x48, 0x00, 0x47,
       0x00, 0x00, 0x00, 0x08};
 
+  // IntrMain of the lean driver (LEAN_DRIVER in asm/gax*driver). It serves
+  // VBlank only, without nesting and the IE/IME bookkeeping.
+  static constexpr std::array<unsigned char, 0x94> lean_intr_main = {
+      0x01, 0x33, 0xA0, 0xE3, 0x02, 0x3C, 0x83, 0xE2, 0xB2, 0x00, 0xD3, 0xE1,
+      0xB2, 0x00, 0xC3, 0xE1, 0x01, 0x00, 0x10, 0xE3, 0x1E, 0xFF, 0x2F, 0x01,
+      0xDF, 0xF0, 0x21, 0xE3, 0x00, 0x40, 0x2D, 0xE9, 0x6C, 0x00, 0x9F, 0xE5,
+      0x0F, 0xE0, 0xA0, 0xE1, 0x10, 0xFF, 0x2F, 0xE1, 0x00, 0x40, 0xBD, 0xE8,
+      0xD2, 0xF0, 0x21, 0xE3, 0x1E, 0xFF, 0x2F, 0xE1, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00};
+
   GaxDriver() = default;
 
   [[nodiscard]] static agbsize_t gsf_driver_size(
@@ -154,7 +183,7 @@ class GaxDriver {
 
   static void InstallGsfDriver(std::string& rom, agbptr_t address,
                                agbptr_t work_address, agbsize_t work_size,
-                               const GaxDriverParam& param);
+                               const GaxDriverParam& param, bool lean = false);
 
   static std::string NewMinigsfData(const GaxMinigsfDriverParam& param);
 
@@ -0,0 +1,108 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_driver.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "arm.hpp"
+#include "bytes.hpp"
+#include "gax_song_info_text.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbptr_t kDriverAddress = 0x8000400;
+constexpr agbptr_t kWorkAddress = 0x3001000;
+constexpr agbsize_t kWorkSize = 0x1000;
+
+GaxDriverParam MakeParam(int major_version) {
+  GaxDriverParam param;
+  param.set_version(GaxVersion{major_version, 0});
+  param.set_gax2_estimate(0x8010000);
+  param.set_gax2_new(0x8010100);
+  param.set_gax2_init(0x8010200);
+  param.set_gax_irq(0x8010300);
+  param.set_gax_play(0x8010400);
+  param.set_songs({GaxMusicEntry{0x8100000, GaxSongInfoText{"\"Song\""}, 4,
+                                 15769}});
+  return param;
+}
+
+template <typename Block>
+bool BytesEqual(const std::string& rom, agbsize_t offset,
+                const Block& expected) {
+  return rom.size() >= offset + expected.size() &&
+         std::memcmp(&rom[offset], expected.data(), expected.size()) == 0;
+}
+
+std::string Install(const GaxDriverParam& param, bool lean) {
+  std::string rom(0x1000, '\0');
+  GaxDriver::InstallGsfDriver(rom, kDriverAddress, kWorkAddress, kWorkSize,
+                              param, lean);
+  return rom;
+}
+
+// The lean IntrMain replaces the whole IntrMain of the driver block, and
+// none of the pointers that InstallGsfDriver writes.
+template <typename Block>
+void TestLeanDriver(int major_version, const Block& block,
+                    agbsize_t intr_main_offset, agbsize_t first_pointer) {
+  const GaxDriverParam param = MakeParam(major_version);
+  const agbsize_t offset = to_offset(kDriverAddress);
+
+  // The offset is where the IntrMain of the block begins, with the same
+  // "mov r3, #0x4000000; add r3, r3, #0x200" as the lean one.
+  EXPECT(std::equal(GaxDriver::lean_intr_main.begin(),
+                    GaxDriver::lean_intr_main.begin() + 8,
+                    block.begin() + intr_main_offset));
+
+  const std::string rom = Install(param, false);
+  EXPECT(ReadInt32L(&rom[0]) == make_arm_b(0x8000000, kDriverAddress));
+
+  const std::string lean_rom = Install(param, true);
+  EXPECT(BytesEqual(lean_rom, offset + intr_main_offset,
+                    GaxDriver::lean_intr_main));
+  EXPECT(intr_main_offset + GaxDriver::lean_intr_main.size() <= first_pointer);
+
+  // Everything else is the same as the full driver.
+  const agbsize_t lean_end = offset + intr_main_offset +
+                             static_cast<agbsize_t>(
+                                 GaxDriver::lean_intr_main.size());
+  EXPECT(rom.compare(0, offset + intr_main_offset, lean_rom, 0,
+                     offset + intr_main_offset) == 0);
+  EXPECT(rom.compare(lean_end, std::string::npos, lean_rom, lean_end,
+                     std::string::npos) == 0);
+}
+
+void TestErrors() {
+  std::string rom(0x1000, '\0');
+  const GaxDriverParam param = MakeParam(3);
+  EXPECT_THROW(GaxDriver::InstallGsfDriver(rom, 0x3000000, kWorkAddress,
+                                           kWorkSize, param),
+               std::invalid_argument);
+  EXPECT_THROW(GaxDriver::InstallGsfDriver(rom, 0x8000f00, kWorkAddress,
+                                           kWorkSize, param),
+               std::out_of_range);
+  EXPECT_THROW(GaxDriver::InstallGsfDriver(rom, kDriverAddress, kWorkAddress,
+                                           kWorkSize, GaxDriverParam{}),
+               std::invalid_argument);
+}
+
+}  // namespace
+
+int main() {
+  // The work area header is the lean IntrMain and its table.
+  EXPECT(GaxDriver::kDriverWorkRamHeaderSize ==
+         GaxDriver::lean_intr_main.size() + 2 * 4);
+
+  TestLeanDriver(2, GaxDriver::gax2_driver_block, GaxDriver::kIntrMainOffsetV2,
+                 GaxDriver::kGax2NewOffsetV2);
+  TestLeanDriver(3, GaxDriver::gax3_driver_block, GaxDriver::kIntrMainOffsetV3,
+                 GaxDriver::kGax2EstimateOffsetV3);
+  TestErrors();
+  return testing::num_failures != 0;
+}
@@ -11,12 +11,14 @@ namespace gaxtapper {
 GaxMusicEntry::GaxMusicEntry(const GaxMusicEntryV2& song)
     : address_(song.address()),
       info_(song.info()),
-      num_channels_(song.header().num_channels()) {}
+      num_channels_(song.header().num_channels()),
+      mixing_rate_(song.header().mixing_rate()) {}
 
 GaxMusicEntry::GaxMusicEntry(const GaxSongHeaderV3& header)
     : address_(header.address()),
       info_(header.info()),
-      num_channels_(header.num_channels()) {}
+      num_channels_(header.num_channels()),
+      mixing_rate_(header.mixing_rate()) {}
 
 std::vector<GaxMusicEntry> GaxMusicEntry::Scan(
     std::string_view rom, const GaxVersion& version,
@@ -3,6 +3,7 @@
 #ifndef GAXTAPPER_GAX_MUSIC_ENTRY_HPP_
 #define GAXTAPPER_GAX_MUSIC_ENTRY_HPP_
 
+#include <utility>
 #include <vector>
 
 #include "gax_song_info_text.hpp"
@@ -18,6 +19,12 @@ class GaxMusicEntry {
   GaxMusicEntry() = default;
   GaxMusicEntry(const GaxMusicEntryV2& song);
   GaxMusicEntry(const GaxSongHeaderV3& header);
+  GaxMusicEntry(agbptr_t address, GaxSongInfoText info,
+                std::uint16_t num_channels, std::uint16_t mixing_rate)
+      : address_(address),
+        info_(std::move(info)),
+        num_channels_(num_channels),
+        mixing_rate_(mixing_rate) {}
 
   constexpr operator bool() const {
     return address_ != agbnullptr;
@@ -31,6 +38,10 @@ class GaxMusicEntry {
     return num_channels_;
   }
 
+  [[nodiscard]] std::uint16_t mixing_rate() const noexcept {
+    return mixing_rate_;
+  }
+
   static std::vector<GaxMusicEntry> Scan(
       std::string_view rom, const GaxVersion& version,
       std::string_view::size_type offset = 0);
@@ -39,6 +50,7 @@ class GaxMusicEntry {
   agbptr_t address_ = agbnullptr;
   GaxSongInfoText info_;
   std::uint16_t num_channels_ = 0;
+  std::uint16_t mixing_rate_ = 0xffff;
 };
 
 }  // namespace gaxtapper
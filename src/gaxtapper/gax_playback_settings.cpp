@@ -0,0 +1,178 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_playback_settings.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "gax_music_entry.hpp"
+
+namespace gaxtapper {
+
+// GAX uses this rate when the song header does not specify one.
+static constexpr std::uint16_t kGaxDefaultMixingRate = 15769;
+
+namespace {
+
+std::string_view Trim(std::string_view s) {
+  const auto begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string_view::npos) return {};
+  const auto end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+std::uint16_t ParseUInt16(std::string_view s, std::size_t line) {
+  std::size_t used = 0;
+  unsigned long value = 0;
+  try {
+    value = std::stoul(std::string{s}, &used, 0);
+  } catch (const std::exception&) {
+    used = 0;
+  }
+  if (used != s.size() || used == 0 || value > 0xfffe) {
+    std::ostringstream message;
+    message << "Line " << line << ": \"" << s << "\" is not a valid value.";
+    throw std::invalid_argument(message.str());
+  }
+  return static_cast<std::uint16_t>(value);
+}
+
+}  // namespace
+
+GaxPlaybackSettings GaxPlaybackSettings::LoadFromFile(
+    const std::filesystem::path& path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    std::ostringstream message;
+    message << path.string() << ": Unable to open the manifest";
+    throw std::runtime_error(message.str());
+  }
+  return Parse(stream);
+}
+
+GaxPlaybackSettings GaxPlaybackSettings::Parse(std::istream& stream) {
+  GaxPlaybackSettings settings;
+  std::string text;
+  for (std::size_t line = 1; std::getline(stream, text); line++) {
+    const std::string_view s = Trim(text);
+    if (s.empty() || s[0] == '#' || s[0] == ';') continue;
+
+    if (s.front() == '[') {
+      if (s.back() != ']') {
+        std::ostringstream message;
+        message << "Line " << line << ": The section is not closed.";
+        throw std::invalid_argument(message.str());
+      }
+      settings.entries_.push_back(
+          Entry{std::string{Trim(s.substr(1, s.size() - 2))}, {}, {}});
+      continue;
+    }
+
+    const auto separator = s.find('=');
+    if (separator == std::string_view::npos || settings.entries_.empty()) {
+      std::ostringstream message;
+      message << "Line " << line
+              << ": Expected \"[song]\" or \"key = value\" in a section.";
+      throw std::invalid_argument(message.str());
+    }
+
+    const std::string_view key = Trim(s.substr(0, separator));
+    const std::uint16_t value = ParseUInt16(Trim(s.substr(separator + 1)), line);
+    Entry& entry = settings.entries_.back();
+    if (key == "mixing_rate") {
+      if (!IsValidMixingRate(value)) {
+        std::ostringstream message;
+        message << "Line " << line << ": " << value
+                << " Hz is not a mixing rate supported by GAX.";
+        throw std::invalid_argument(message.str());
+      }
+      entry.mixing_rate = value;
+    } else if (key == "volume") {
+      entry.volume = value;
+    } else {
+      std::ostringstream message;
+      message << "Line " << line << ": Unknown key \"" << key << "\".";
+      throw std::invalid_argument(message.str());
+    }
+  }
+  return settings;
+}
+
+void GaxPlaybackSettings::set_mixing_rate(std::uint16_t mixing_rate) {
+  if (!IsValidMixingRate(mixing_rate)) {
+    std::ostringstream message;
+    message << mixing_rate << " Hz is not a mixing rate supported by GAX.";
+    throw std::invalid_argument(message.str());
+  }
+  mixing_rate_ = mixing_rate;
+}
+
+void GaxPlaybackSettings::set_volume(std::uint16_t volume) {
+  if (volume == GaxPlaybackParams::kSongDefault)
+    throw std::invalid_argument("The volume must be less than 0xffff.");
+  volume_ = volume;
+}
+
+GaxPlaybackParams GaxPlaybackSettings::Resolve(
+    const GaxMusicEntry& song, std::string_view minigsf_name) const {
+  std::optional<std::uint16_t> mixing_rate = mixing_rate_;
+  std::optional<std::uint16_t> volume = volume_;
+  bool song_mixing_rate = false;
+  for (const Entry& entry : entries_) {
+    if (!Matches(entry, song, minigsf_name)) continue;
+    if (entry.mixing_rate.has_value()) {
+      mixing_rate = entry.mixing_rate;
+      song_mixing_rate = entry.selector != "*";
+    }
+    if (entry.volume.has_value()) volume = entry.volume;
+  }
+
+  if (low_cpu_ && !song_mixing_rate) {
+    const std::uint16_t song_rate =
+        IsValidMixingRate(song.mixing_rate()) ? song.mixing_rate()
+                                              : kGaxDefaultMixingRate;
+    const std::uint16_t rate = mixing_rate.value_or(song_rate);
+    const std::uint16_t limit = LowCpuMixingRate(song.num_channels());
+    if (rate > limit) mixing_rate = limit;
+  }
+
+  GaxPlaybackParams params;
+  if (mixing_rate.has_value()) params.mixing_rate = *mixing_rate;
+  if (volume.has_value()) params.volume = *volume;
+  return params;
+}
+
+bool GaxPlaybackSettings::IsValidMixingRate(std::uint16_t rate) noexcept {
+  return std::find(kMixingRates.begin(), kMixingRates.end(), rate) !=
+         kMixingRates.end();
+}
+
+std::uint16_t GaxPlaybackSettings::LowCpuMixingRate(
+    std::uint16_t num_channels) noexcept {
+  const std::uint32_t budget =
+      kLowCpuChannelRate / std::max<std::uint16_t>(num_channels, 1);
+  std::uint16_t rate = kMixingRates.front();
+  for (const std::uint16_t candidate : kMixingRates) {
+    if (candidate <= budget) rate = candidate;
+  }
+  return rate;
+}
+
+bool GaxPlaybackSettings::Matches(const Entry& entry, const GaxMusicEntry& song,
+                                  std::string_view minigsf_name) {
+  if (entry.selector == "*" || entry.selector == minigsf_name ||
+      entry.selector == song.info().parsed_name())
+    return true;
+
+  std::size_t used = 0;
+  try {
+    return std::stoul(entry.selector, &used, 16) == song.address() &&
+           used == entry.selector.size();
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,95 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GAX_PLAYBACK_SETTINGS_HPP_
+#define GAXTAPPER_GAX_PLAYBACK_SETTINGS_HPP_
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+class GaxMusicEntry;
+
+// The playback parameters written to a minigsf. 0xffff keeps the value that
+// the song header has.
+struct GaxPlaybackParams {
+  static constexpr std::uint16_t kSongDefault = 0xffff;
+
+  std::uint16_t mixing_rate = kSongDefault;
+  std::uint16_t volume = kSongDefault;
+};
+
+// Decides the mixing rate and the volume of each song, from the global
+// options, the per-song entries of a manifest and the low-CPU profile.
+//
+// The manifest is an INI-like text file. A section selects the songs by the
+// song name, the minigsf name or the address of the song header ("*" selects
+// every song), and the keys mixing_rate and volume set the parameters:
+//
+//   [*]
+//   volume = 0x100
+//   [Title Theme]
+//   mixing_rate = 13380
+class GaxPlaybackSettings {
+ public:
+  static constexpr std::array<std::uint16_t, 13> kMixingRates{
+      5735,  9079,  10513, 11469, 13380, 15769, 18158,
+      21025, 26760, 31537, 36316, 40138, 42049};
+
+  // The low-CPU profile keeps the mixing work of a song (mixing rate times
+  // the number of channels) within the cost of 4 channels at 13380 Hz.
+  static constexpr std::uint32_t kLowCpuChannelRate = 4 * 13380;
+
+  GaxPlaybackSettings() = default;
+
+  [[nodiscard]] static GaxPlaybackSettings LoadFromFile(
+      const std::filesystem::path& path);
+  [[nodiscard]] static GaxPlaybackSettings Parse(std::istream& stream);
+
+  [[nodiscard]] bool low_cpu() const noexcept { return low_cpu_; }
+
+  void set_mixing_rate(std::uint16_t mixing_rate);
+  void set_volume(std::uint16_t volume);
+  void set_low_cpu(bool low_cpu) noexcept { low_cpu_ = low_cpu; }
+
+  // Returns the parameters for the song. Per-song entries have priority over
+  // the global ones, and the low-CPU profile only lowers a rate that has not
+  // been set for the song explicitly.
+  [[nodiscard]] GaxPlaybackParams Resolve(const GaxMusicEntry& song,
+                                          std::string_view minigsf_name) const;
+
+  [[nodiscard]] static bool IsValidMixingRate(std::uint16_t rate) noexcept;
+
+  // Returns the highest mixing rate that the low-CPU profile allows for a
+  // song that has the given number of channels.
+  [[nodiscard]] static std::uint16_t LowCpuMixingRate(
+      std::uint16_t num_channels) noexcept;
+
+ private:
+  struct Entry {
+    std::string selector;
+    std::optional<std::uint16_t> mixing_rate;
+    std::optional<std::uint16_t> volume;
+  };
+
+  [[nodiscard]] static bool Matches(const Entry& entry,
+                                    const GaxMusicEntry& song,
+                                    std::string_view minigsf_name);
+
+  std::optional<std::uint16_t> mixing_rate_;
+  std::optional<std::uint16_t> volume_;
+  bool low_cpu_ = false;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace gaxtapper
+
+#endif
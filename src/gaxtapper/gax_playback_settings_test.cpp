@@ -0,0 +1,120 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_playback_settings.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include "gax_music_entry.hpp"
+#include "gax_song_info_text.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr std::uint16_t kDefault = GaxPlaybackParams::kSongDefault;
+
+GaxPlaybackSettings Parse(const std::string& text) {
+  std::istringstream stream{text};
+  return GaxPlaybackSettings::Parse(stream);
+}
+
+bool ResolvesTo(const GaxPlaybackSettings& settings, const GaxMusicEntry& song,
+                std::string_view minigsf_name, std::uint16_t mixing_rate,
+                std::uint16_t volume) {
+  const GaxPlaybackParams params = settings.Resolve(song, minigsf_name);
+  return params.mixing_rate == mixing_rate && params.volume == volume;
+}
+
+void TestParseErrors() {
+  EXPECT_THROW((void)Parse("[Title\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("volume = 1\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("[*]\nvolume\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("[*]\ncolor = 1\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("[*]\nvolume = loud\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("[*]\nvolume = 0xffff\n"), std::invalid_argument);
+  EXPECT_THROW((void)Parse("[*]\nmixing_rate = 12345\n"),
+               std::invalid_argument);
+
+  // The line number is in the message.
+  try {
+    (void)Parse("# comment\n\n[*]\nvolume = 1x\n");
+    EXPECT(false);
+  } catch (const std::invalid_argument& e) {
+    EXPECT(std::string{e.what()}.rfind("Line 4:", 0) == 0);
+  }
+
+  GaxPlaybackSettings settings;
+  EXPECT_THROW(settings.set_mixing_rate(12345), std::invalid_argument);
+  EXPECT_THROW(settings.set_volume(kDefault), std::invalid_argument);
+}
+
+void TestResolve() {
+  const GaxMusicEntry title{0x8100000,
+                            GaxSongInfoText{"\"Title Theme\" \xa9 Artist"}, 8,
+                            15769};
+  const GaxMusicEntry boss{0x8200000, GaxSongInfoText{"\"Boss\""}, 4, 21025};
+  const GaxMusicEntry ending{0x8300000, GaxSongInfoText{"\"Ending\""}, 2,
+                             15769};
+
+  // Nothing set keeps the song header values, and the globals apply to
+  // every song.
+  GaxPlaybackSettings settings;
+  EXPECT(ResolvesTo(settings, title, "title.minigsf", kDefault, kDefault));
+  settings.set_mixing_rate(13380);
+  settings.set_volume(0x80);
+  EXPECT(ResolvesTo(settings, boss, "boss.minigsf", 13380, 0x80));
+
+  // A song is selected by its name, its minigsf name or the address of its
+  // header, and a per-song entry overrides "*" and the globals.
+  settings = Parse(
+      "; A manifest.\n"
+      "[*]\n"
+      "volume = 0x100\n"
+      "mixing_rate = 18158\n"
+      "\n"
+      "[Title Theme]\n"
+      "mixing_rate = 21025\n"
+      "[boss.minigsf]\n"
+      "volume = 200\n"
+      "[0x8300000]\n"
+      "mixing_rate = 9079\n");
+  settings.set_mixing_rate(13380);
+  settings.set_volume(0x80);
+  EXPECT(ResolvesTo(settings, title, "title.minigsf", 21025, 0x100));
+  EXPECT(ResolvesTo(settings, boss, "boss.minigsf", 18158, 200));
+  EXPECT(ResolvesTo(settings, boss, "other.minigsf", 18158, 0x100));
+  EXPECT(ResolvesTo(settings, ending, "ending.minigsf", 9079, 0x100));
+
+  // The low-CPU profile lowers the rates of "*" and the globals, but not a
+  // rate that is set for the song.
+  settings.set_low_cpu(true);
+  EXPECT(ResolvesTo(settings, title, "title.minigsf", 21025, 0x100));
+  EXPECT(ResolvesTo(settings, boss, "boss.minigsf",
+                    GaxPlaybackSettings::LowCpuMixingRate(4), 200));
+  EXPECT(ResolvesTo(settings, ending, "ending.minigsf", 9079, 0x100));
+
+  // The address may be given without "0x", and the low-CPU profile lowers
+  // the rate of the song header too.
+  GaxPlaybackSettings low_cpu = Parse("[8100000]\nvolume = 1\n");
+  low_cpu.set_low_cpu(true);
+  EXPECT(ResolvesTo(low_cpu, title, "title.minigsf",
+                    GaxPlaybackSettings::LowCpuMixingRate(8), 1));
+  EXPECT(ResolvesTo(low_cpu, ending, "ending.minigsf", kDefault, kDefault));
+}
+
+}  // namespace
+
+int main() {
+  EXPECT(GaxPlaybackSettings::IsValidMixingRate(15769));
+  EXPECT(!GaxPlaybackSettings::IsValidMixingRate(15770));
+  EXPECT(GaxPlaybackSettings::LowCpuMixingRate(4) == 13380);
+  EXPECT(GaxPlaybackSettings::LowCpuMixingRate(8) == 5735);
+  EXPECT(GaxPlaybackSettings::LowCpuMixingRate(0) ==
+         GaxPlaybackSettings::kMixingRates.back());
+
+  TestParseErrors();
+  TestResolve();
+  return testing::num_failures != 0;
+}
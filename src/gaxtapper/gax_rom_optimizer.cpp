@@ -0,0 +1,91 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_rom_optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "agb_emulator.hpp"
+#include "parallel.hpp"
+
+namespace gaxtapper {
+
+// The cartridge header is checked by players and has to be kept.
+static constexpr agbsize_t kCartridgeHeaderSize = 0xc0;
+
+RomCoverage GaxRomOptimizer::Analyze(std::string_view rom,
+                                     agbptr_t minigsf_address,
+                                     const std::vector<std::string>& minigsfs,
+                                     double seconds, unsigned num_threads,
+                                     std::vector<agbptr_t>* faults) {
+  if (num_threads == 0) num_threads = DefaultThreadCount();
+  num_threads = static_cast<unsigned>(
+      std::clamp<std::size_t>(minigsfs.size(), 1, num_threads));
+
+  const auto size = static_cast<agbsize_t>(rom.size());
+  std::vector<RomCoverage> workers(num_threads, RomCoverage{size});
+  std::vector<agbptr_t> fault_addresses(minigsfs.size(), agbnullptr);
+  const auto cycles =
+      static_cast<std::uint64_t>(seconds * AgbEmulator::kCpuClock);
+
+  ParallelFor(
+      minigsfs.size(),
+      [&](std::size_t index, unsigned worker) {
+        AgbEmulator emulator{rom};
+        emulator.bus().set_rom_overlay(minigsf_address, minigsfs[index]);
+        emulator.bus().set_rom_coverage(&workers[worker]);
+        if (!emulator.Run(cycles))
+          fault_addresses[index] = emulator.cpu().fault_address();
+      },
+      num_threads);
+
+  if (faults != nullptr) *faults = std::move(fault_addresses);
+
+  RomCoverage coverage{size};
+  MergeCoverage(coverage, workers, num_threads);
+  return coverage;
+}
+
+void GaxRomOptimizer::MergeCoverage(RomCoverage& coverage,
+                                    const std::vector<RomCoverage>& workers,
+                                    unsigned num_threads) {
+  // Each thread merges its own slice of words, so no locking is needed.
+  std::vector<std::uint64_t>& words = coverage.words();
+  const std::size_t slice = (words.size() + num_threads - 1) / num_threads;
+  ParallelFor(
+      num_threads,
+      [&](std::size_t index, unsigned) {
+        const std::size_t begin = std::min(words.size(), index * slice);
+        const std::size_t end = std::min(words.size(), begin + slice);
+        for (const RomCoverage& worker : workers) {
+          const std::vector<std::uint64_t>& source = worker.words();
+          for (std::size_t i = begin; i < end; i++) words[i] |= source[i];
+        }
+      },
+      num_threads);
+}
+
+agbsize_t GaxRomOptimizer::Optimize(std::string& rom,
+                                    const RomCoverage& coverage,
+                                    agbptr_t driver_address,
+                                    agbsize_t driver_size) {
+  const agbsize_t driver_offset = to_offset(driver_address);
+  const auto is_kept = [&](agbsize_t offset) {
+    return offset < kCartridgeHeaderSize ||
+           (offset >= driver_offset && offset < driver_offset + driver_size) ||
+           coverage.test(offset);
+  };
+
+  for (agbsize_t offset = 0; offset < rom.size(); offset++) {
+    if (!is_kept(offset)) rom[offset] = '\0';
+  }
+
+  agbsize_t size = std::max({coverage.end(), kCartridgeHeaderSize,
+                             driver_offset + driver_size});
+  size = std::min<agbsize_t>((size + 3) & ~3u, static_cast<agbsize_t>(rom.size()));
+  return size;
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,44 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GAX_ROM_OPTIMIZER_HPP_
+#define GAXTAPPER_GAX_ROM_OPTIMIZER_HPP_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "rom_coverage.hpp"
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// Removes the ROM data that is not used for the playback, in the same way as
+// gsfopt does, by playing every song and recording which bytes are read.
+class GaxRomOptimizer {
+ public:
+  static constexpr double kDefaultSeconds = 180.0;
+
+  // Plays each minigsf program (placed at minigsf_address) on top of the
+  // patched ROM for the given time, and returns the merged coverage. If
+  // faults is given, it receives for each minigsf the address of the
+  // unsupported instruction that stopped it (agbnullptr if none), in which
+  // case the coverage of the song may be incomplete.
+  [[nodiscard]] static RomCoverage Analyze(
+      std::string_view rom, agbptr_t minigsf_address,
+      const std::vector<std::string>& minigsfs,
+      double seconds = kDefaultSeconds, unsigned num_threads = 0,
+      std::vector<agbptr_t>* faults = nullptr);
+
+  // Clears the uncovered bytes except for the ranges that must be kept, and
+  // returns the size that the gsflib needs to contain.
+  static agbsize_t Optimize(std::string& rom, const RomCoverage& coverage,
+                            agbptr_t driver_address, agbsize_t driver_size);
+
+ private:
+  static void MergeCoverage(RomCoverage& coverage,
+                            const std::vector<RomCoverage>& workers,
+                            unsigned num_threads);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,101 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_rom_optimizer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bytes.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbptr_t kMinigsfAddress = 0x8001000;
+constexpr agbsize_t kIdleOffset = 0x200;
+constexpr agbsize_t kUndefinedOffset = 0x204;
+constexpr double kSeconds = 0.01;
+
+// A stand-in for the driver, which reads a byte at the pointer given by the
+// minigsf, and then jumps to the address given by the minigsf.
+std::string MakeRom() {
+  std::string rom(0x1100, '\x55');
+  const std::vector<std::uint32_t> code{
+      0xe3a00408,  // mov r0, #0x8000000
+      0xe2800a01,  // add r0, r0, #0x1000 (the minigsf)
+      0xe5901000,  // ldr r1, [r0]
+      0xe5d12000,  // ldrb r2, [r1]
+      0xe5903004,  // ldr r3, [r0, #4]
+      0xe12fff13,  // bx r3
+  };
+  for (std::size_t i = 0; i < code.size(); i++)
+    WriteInt32L(&rom[i * 4], code[i]);
+  WriteInt32L(&rom[kIdleOffset], 0xeafffffe);       // b .
+  WriteInt32L(&rom[kUndefinedOffset], 0xe7f000f0);  // (undefined)
+  return rom;
+}
+
+std::string MakeMinigsf(agbptr_t data, agbptr_t next) {
+  std::string minigsf(8, '\0');
+  WriteInt32L(&minigsf[0], data);
+  WriteInt32L(&minigsf[4], next);
+  return minigsf;
+}
+
+void TestAnalyze() {
+  const std::string rom = MakeRom();
+  const std::vector<std::string> minigsfs{
+      MakeMinigsf(0x8000400, 0x8000000 + kIdleOffset),
+      MakeMinigsf(0x8000800, 0x8000000 + kUndefinedOffset)};
+
+  // The coverage of every song is merged, and the song that hits an
+  // unsupported instruction reports its address.
+  for (const unsigned num_threads : {1u, 2u}) {
+    std::vector<agbptr_t> faults;
+    const RomCoverage coverage = GaxRomOptimizer::Analyze(
+        rom, kMinigsfAddress, minigsfs, kSeconds, num_threads, &faults);
+    EXPECT(coverage.size() == rom.size());
+    EXPECT(coverage.test(0x400) && !coverage.test(0x401));
+    EXPECT(coverage.test(0x800) && !coverage.test(0x801));
+    EXPECT(coverage.test(0x14) && !coverage.test(0x18));
+    EXPECT(coverage.test(kIdleOffset) && coverage.test(kIdleOffset + 3));
+    EXPECT(!coverage.test(0x600));
+    EXPECT(coverage.end() == to_offset(kMinigsfAddress) + 8);
+    EXPECT(faults == (std::vector<agbptr_t>{
+                         agbnullptr, 0x8000000 + kUndefinedOffset}));
+  }
+
+  const RomCoverage first = GaxRomOptimizer::Analyze(
+      rom, kMinigsfAddress, {minigsfs[0]}, kSeconds);
+  EXPECT(first.test(0x400));
+  EXPECT(!first.test(0x800));
+}
+
+void TestOptimize() {
+  RomCoverage coverage{0x400};
+  coverage.MarkRange(0x200, 3);
+
+  // The cartridge header and the driver are kept, whether they have been
+  // read or not, and the size covers them.
+  std::string rom(0x400, '\xff');
+  EXPECT(GaxRomOptimizer::Optimize(rom, coverage, 0x8000300, 0x10) == 0x310);
+  EXPECT(rom[0xbf] == '\xff' && rom[0xc0] == '\0');
+  EXPECT(rom[0x1ff] == '\0' && rom[0x200] == '\xff' && rom[0x202] == '\xff');
+  EXPECT(rom[0x203] == '\0');
+  EXPECT(rom[0x300] == '\xff' && rom[0x30f] == '\xff' && rom[0x310] == '\0');
+
+  // The size is rounded up to a word, within the ROM.
+  rom.assign(0x400, '\xff');
+  EXPECT(GaxRomOptimizer::Optimize(rom, coverage, 0x8000100, 0x10) == 0x204);
+  rom.assign(0x202, '\xff');
+  EXPECT(GaxRomOptimizer::Optimize(rom, coverage, 0x8000100, 0x10) == 0x202);
+}
+
+}  // namespace
+
+int main() {
+  TestAnalyze();
+  TestOptimize();
+  return testing::num_failures != 0;
+}
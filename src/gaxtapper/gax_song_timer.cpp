@@ -0,0 +1,266 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_song_timer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "agb_emulator.hpp"
+#include "bytes.hpp"
+#include "gax_driver.hpp"
+#include "hash.hpp"
+
+namespace gaxtapper {
+
+// The words that change in most of the frames (mixing buffers, sample
+// positions, tick counters) are excluded from the song state.
+static constexpr std::uint32_t kVolatilityFrames = 300;
+static constexpr std::uint32_t kVolatilityPercent = 90;
+
+// A song that does not loop ends when it keeps silent for this long.
+static constexpr std::uint32_t kSilenceFrames = 600;
+
+namespace {
+
+// Keeps a shadow copy of the GAX work area, and finds the words that have
+// been changed since the last update, by watching the writes.
+class StateTracker : public AgbWriteObserver {
+ public:
+  StateTracker(AgbBus& bus, agbptr_t begin, agbptr_t end)
+      : begin_(begin),
+        memory_(is_iwramptr(begin)
+                    ? bus.iwram() + (begin & (AgbBus::kIwramSize - 1))
+                    : bus.ewram() + (begin & (AgbBus::kEwramSize - 1))),
+        shadow_((end - begin) / 4),
+        dirty_(shadow_.size()) {
+    for (std::size_t i = 0; i < shadow_.size(); i++) shadow_[i] = word(i);
+    bus.set_write_observer(this, begin, end);
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept { return shadow_.size(); }
+
+  [[nodiscard]] std::uint32_t word(std::size_t index) const noexcept {
+    return ReadInt32L(memory_ + index * 4);
+  }
+
+  void OnWrite(agbptr_t address, agbsize_t) override {
+    const std::size_t index = (address - begin_) / 4;
+    if (!dirty_[index]) {
+      dirty_[index] = true;
+      dirty_list_.push_back(index);
+    }
+  }
+
+  // Calls changed(index, old_value, new_value) for each modified word.
+  template <typename Function>
+  void Update(Function&& changed) {
+    for (const std::size_t index : dirty_list_) {
+      dirty_[index] = false;
+      if (const std::uint32_t value = word(index); value != shadow_[index]) {
+        changed(index, shadow_[index], value);
+        shadow_[index] = value;
+      }
+    }
+    dirty_list_.clear();
+  }
+
+ private:
+  agbptr_t begin_;
+  const std::uint8_t* memory_;
+  std::vector<std::uint32_t> shadow_;
+  std::vector<bool> dirty_;
+  std::vector<std::size_t> dirty_list_;
+};
+
+class SilenceDetector : public AgbSoundSink {
+ public:
+  void set_frame(std::uint32_t frame) noexcept { frame_ = frame; }
+  [[nodiscard]] bool heard() const noexcept { return heard_; }
+  [[nodiscard]] std::uint32_t last_sound_frame() const noexcept {
+    return last_sound_frame_;
+  }
+
+  void OnSample(int fifo, std::int8_t sample) override {
+    // A constant level is silent, whatever its DC offset is.
+    if (sample != previous_[fifo]) {
+      heard_ = true;
+      last_sound_frame_ = frame_;
+      previous_[fifo] = sample;
+    }
+  }
+
+ private:
+  std::uint32_t frame_ = 0;
+  std::uint32_t last_sound_frame_ = 0;
+  bool heard_ = false;
+  std::int8_t previous_[2]{};
+};
+
+struct StateRange {
+  agbptr_t begin = agbnullptr;
+  agbptr_t end = agbnullptr;
+};
+
+// Finds the GAX work area from the parameters that the driver has passed to
+// gax2_init, and from the pointer that GAX keeps to its work area.
+StateRange FindStateRange(AgbBus& bus, agbptr_t gax_wram_pointer) {
+  const agbptr_t wram = bus.Read32(GaxDriver::kGax2ParamsAddress);
+  const agbsize_t wram_size = bus.Read32(GaxDriver::kGax2ParamsAddress + 4);
+
+  agbptr_t region_end;
+  if (is_iwramptr(wram))
+    region_end = GaxDriver::kDriverStackLimit;
+  else if (is_ewramptr(wram))
+    region_end = 0x2000000 + AgbBus::kEwramSize;
+  else
+    return {};
+
+  StateRange range{wram, region_end};
+  if (wram_size != 0 && wram_size < region_end - wram)
+    range.end = wram + wram_size;
+
+  if (gax_wram_pointer != agbnullptr) {
+    if (const agbptr_t state = bus.Read32(gax_wram_pointer);
+        state >= range.begin && state < range.end)
+      range.begin = state;
+  }
+
+  range.begin &= ~3u;
+  range.end &= ~3u;
+  if (range.begin >= range.end) return {};
+  return range;
+}
+
+struct State {
+  std::uint64_t hash;
+  std::uint32_t frame;  // the first frame of the state
+};
+
+// Makes the timing from the repeated state (states[loop] equals to
+// states[repeat]). The first state of the song has begun before it has been
+// observed, so the loop is measured by the frames where the next states begin.
+GaxSongTiming LoopTiming(const std::vector<State>& states, std::size_t repeat,
+                         std::size_t loop) {
+  const std::uint32_t length =
+      loop + 1 < states.size()
+          ? states[loop + 1].frame - states[repeat + 1].frame
+          : states[loop].frame - states[repeat].frame;
+  return GaxSongTiming::Loop(states[loop].frame - length, length);
+}
+
+[[nodiscard]] std::uint64_t WordHash(std::size_t index, std::uint32_t value) {
+  return Mix64((static_cast<std::uint64_t>(index) << 32) | value);
+}
+
+}  // namespace
+
+GaxSongTiming GaxSongTimer::Measure(std::string_view rom,
+                                    agbptr_t minigsf_address,
+                                    std::string_view minigsf,
+                                    agbptr_t gax_wram_pointer,
+                                    double max_seconds) {
+  // Pass 1: find the volatile words.
+  std::vector<bool> volatile_words;
+  StateRange range;
+  {
+    AgbEmulator emulator{rom};
+    emulator.bus().set_rom_overlay(minigsf_address, minigsf);
+    if (!emulator.RunFrames(1)) return {};
+    range = FindStateRange(emulator.bus(), gax_wram_pointer);
+    if (range.begin == agbnullptr) return {};
+
+    StateTracker tracker{emulator.bus(), range.begin, range.end};
+    std::vector<std::uint32_t> changes(tracker.size());
+    for (std::uint32_t frame = 0; frame < kVolatilityFrames; frame++) {
+      if (!emulator.RunFrames(1)) return {};
+      tracker.Update([&](std::size_t index, std::uint32_t, std::uint32_t) {
+        changes[index]++;
+      });
+    }
+
+    volatile_words.resize(tracker.size());
+    for (std::size_t i = 0; i < changes.size(); i++) {
+      volatile_words[i] =
+          changes[i] * 100 >= kVolatilityFrames * kVolatilityPercent;
+    }
+  }
+
+  // Pass 2: hash the song state of every frame from the start, and find the
+  // first state that repeats the same sequence of states.
+  AgbEmulator emulator{rom};
+  emulator.bus().set_rom_overlay(minigsf_address, minigsf);
+  SilenceDetector silence;
+  emulator.bus().set_sound_sink(&silence);
+  if (!emulator.RunFrames(1)) return {};
+
+  StateTracker tracker{emulator.bus(), range.begin, range.end};
+  std::uint64_t hash = 0;
+  for (std::size_t i = 0; i < tracker.size(); i++) {
+    if (!volatile_words[i]) hash ^= WordHash(i, tracker.word(i));
+  }
+
+  std::vector<State> states{State{hash, 1}};
+  std::unordered_map<std::uint64_t, std::size_t> first_states{{hash, 0}};
+
+  // A repeat candidate: states[repeat] is the state that states[loop] has
+  // returned to. It is confirmed after the whole loop has repeated once.
+  constexpr std::size_t kNone = static_cast<std::size_t>(-1);
+  std::size_t loop = kNone;
+  std::size_t repeat = kNone;
+
+  const auto max_frames = static_cast<std::uint32_t>(
+      std::min(max_seconds * GaxSongTiming::kFramesPerSecond, 4.0e9));
+  for (std::uint32_t frame = 2; frame <= max_frames; frame++) {
+    silence.set_frame(frame);
+    if (!emulator.RunFrames(1)) break;
+
+    tracker.Update([&](std::size_t index, std::uint32_t old_value,
+                       std::uint32_t new_value) {
+      if (!volatile_words[index])
+        hash ^= WordHash(index, old_value) ^ WordHash(index, new_value);
+    });
+
+    if (hash != states.back().hash) {
+      const std::size_t current = states.size();
+      states.push_back(State{hash, frame});
+
+      if (loop != kNone) {
+        const std::size_t offset = current - loop;
+        if (hash != states[repeat + offset].hash) {
+          loop = kNone;
+        } else if (offset == loop - repeat) {
+          return LoopTiming(states, repeat, loop);
+        }
+      }
+
+      if (loop == kNone) {
+        if (const auto it = first_states.find(hash); it != first_states.end()) {
+          repeat = it->second;
+          loop = current;
+        }
+      }
+      first_states.emplace(hash, current);
+    }
+
+    if (silence.heard() && frame - silence.last_sound_frame() >= kSilenceFrames)
+      return GaxSongTiming::End(silence.last_sound_frame() + 1);
+  }
+
+  // Use the unconfirmed loop if the time is up in the middle of the check.
+  if (loop != kNone) return LoopTiming(states, repeat, loop);
+  return {};
+}
+
+std::string GaxSongTimer::ToTagTime(double seconds) {
+  const long long milliseconds = std::llround(seconds * 1000);
+  char s[32];
+  std::snprintf(s, sizeof(s), "%lld:%02lld.%03lld", milliseconds / 60000,
+                milliseconds / 1000 % 60, milliseconds % 1000);
+  return s;
+}
+
+}  // namespace gaxtapper
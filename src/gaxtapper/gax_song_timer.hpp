@@ -0,0 +1,76 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GAX_SONG_TIMER_HPP_
+#define GAXTAPPER_GAX_SONG_TIMER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// The result of timing a song. Times are measured in frames (VBlanks).
+class GaxSongTiming {
+ public:
+  static constexpr double kFramesPerSecond = 16777216.0 / (1232 * 228);
+
+  GaxSongTiming() = default;
+
+  [[nodiscard]] static GaxSongTiming Loop(std::uint32_t loop_start,
+                                          std::uint32_t loop_length) noexcept {
+    GaxSongTiming timing;
+    timing.loop_start_ = loop_start;
+    timing.loop_length_ = loop_length;
+    return timing;
+  }
+
+  [[nodiscard]] static GaxSongTiming End(std::uint32_t end) noexcept {
+    GaxSongTiming timing;
+    timing.end_ = end;
+    return timing;
+  }
+
+  [[nodiscard]] bool ok() const noexcept { return loops() || end_ != 0; }
+  [[nodiscard]] bool loops() const noexcept { return loop_length_ != 0; }
+
+  [[nodiscard]] std::uint32_t loop_start() const noexcept { return loop_start_; }
+  [[nodiscard]] std::uint32_t loop_length() const noexcept { return loop_length_; }
+  [[nodiscard]] std::uint32_t end() const noexcept { return end_; }
+
+  // Returns the playback length in seconds, without the fade.
+  [[nodiscard]] double length(int loop_count) const noexcept {
+    const std::uint64_t frames =
+        loops() ? loop_start_ + static_cast<std::uint64_t>(loop_length_) * loop_count
+                : end_;
+    return frames / kFramesPerSecond;
+  }
+
+ private:
+  std::uint32_t loop_start_ = 0;
+  std::uint32_t loop_length_ = 0;
+  std::uint32_t end_ = 0;
+};
+
+// Times a song by emulation. The song state in GAX work RAM is hashed every
+// frame; the first repeated state gives the loop, and a long silence gives
+// the end of a song that does not loop.
+class GaxSongTimer {
+ public:
+  static constexpr double kDefaultSeconds = 900.0;
+  static constexpr int kDefaultLoopCount = 2;
+  static constexpr double kDefaultFadeSeconds = 10.0;
+
+  [[nodiscard]] static GaxSongTiming Measure(std::string_view rom,
+                                             agbptr_t minigsf_address,
+                                             std::string_view minigsf,
+                                             agbptr_t gax_wram_pointer,
+                                             double max_seconds = kDefaultSeconds);
+
+  // Formats the time for the length/fade tags of PSF ("m:ss.sss").
+  [[nodiscard]] static std::string ToTagTime(double seconds);
+};
+
+}  // namespace gaxtapper
+
+#endif
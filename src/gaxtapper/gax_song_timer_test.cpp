@@ -0,0 +1,129 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_song_timer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bytes.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbsize_t kHandlerOffset = 0x100;
+
+// A stand-in for a GAX song, which keeps its state in a work area of 0x100
+// bytes at 0x3001000, registered at the parameter address of gax2_init:
+//
+//   [0x3001000] a tick counter, which changes every frame
+//   [0x3001004] a position, which advances every other frame, and goes back
+//               from limit to loop_position
+//
+// While the position is below sound_end, each frame pushes a sample to the
+// FIFO A, which timer 0 plays. The values are ARM immediate operands, such as
+// 0x801 for 0x10000.
+std::string MakeRom(std::uint32_t limit, std::uint32_t loop_position,
+                    std::uint32_t sound_end) {
+  std::vector<std::uint32_t> code{
+      0xe3a00301,  // mov r0, #0x4000000
+      0xe3a01008,  // mov r1, #8
+      0xe1c010b4,  // strh r1, [r0, #4] (DISPSTAT: VBlank interrupt)
+      0xe3a01001,  // mov r1, #1
+      0xe2802c02,  // add r2, r0, #0x200
+      0xe1c210b0,  // strh r1, [r2] (IE: VBlank)
+      0xe3a02403,  // mov r2, #0x3000000
+      0xe2822c7f,  // add r2, r2, #0x7f00
+      0xe28220fc,  // add r2, r2, #0xfc
+      0xe3a01408,  // mov r1, #0x8000000
+      0xe2811c01,  // add r1, r1, #0x100
+      0xe5821000,  // str r1, [r2] (the interrupt handler)
+      0xe3a02403,  // mov r2, #0x3000000
+      0xe2822c7e,  // add r2, r2, #0x7e00
+      0xe28220ac,  // add r2, r2, #0xac (the parameters of gax2_init)
+      0xe3a04403,  // mov r4, #0x3000000
+      0xe2844a01,  // add r4, r4, #0x1000
+      0xe5824000,  // str r4, [r2]
+      0xe3a01c01,  // mov r1, #0x100
+      0xe5821004,  // str r1, [r2, #4]
+      0xe2802c01,  // add r2, r0, #0x100
+      0xe3a01cfc,  // mov r1, #0xfc00
+      0xe1c210b0,  // strh r1, [r2] (TM0CNT_L)
+      0xe3a01080,  // mov r1, #0x80
+      0xe1c210b2,  // strh r1, [r2, #2] (TM0CNT_H: start)
+      0xe3a05000,  // mov r5, #0
+      0xe3a06000,  // mov r6, #0
+  };
+  const auto loop = static_cast<std::uint32_t>(code.size());
+  code.insert(code.end(), {
+      0xef050000,                 // swi 0x05 (VBlankIntrWait)
+      0xe2855001,                 // add r5, r5, #1
+      0xe5845000,                 // str r5, [r4]
+      0xe3150001,                 // tst r5, #1
+      0x1a000003,                 // bne (skip)
+      0xe2866001,                 // add r6, r6, #1
+      0xe3560000 | limit,         // cmp r6, #limit
+      0x03a06000 | loop_position, // moveq r6, #loop_position
+      0xe5846004,                 // str r6, [r4, #4]
+      0xe3560000 | sound_end,     // (skip) cmp r6, #sound_end
+      0xb3a01040,                 // movlt r1, #0x40
+      0xb58010a0,                 // strlt r1, [r0, #0xa0] (FIFO A)
+  });
+  // b (loop)
+  const auto here = static_cast<std::uint32_t>(code.size());
+  code.push_back(0xea000000 | ((loop - here - 2) & 0xffffff));
+
+  // The interrupt handler acknowledges the interrupts, and sets the flags
+  // for IntrWait.
+  const std::vector<std::uint32_t> handler{
+      0xe2802c02,  // add r2, r0, #0x200
+      0xe1d230b2,  // ldrh r3, [r2, #2]
+      0xe1c230b2,  // strh r3, [r2, #2]
+      0xe3a02403,  // mov r2, #0x3000000
+      0xe2822c7f,  // add r2, r2, #0x7f00
+      0xe28220f8,  // add r2, r2, #0xf8
+      0xe1c230b0,  // strh r3, [r2]
+      0xe12fff1e,  // bx lr
+  };
+
+  std::string rom(0x200, '\0');
+  for (std::size_t i = 0; i < code.size(); i++)
+    WriteInt32L(&rom[i * 4], code[i]);
+  for (std::size_t i = 0; i < handler.size(); i++)
+    WriteInt32L(&rom[kHandlerOffset + i * 4], handler[i]);
+  return rom;
+}
+
+GaxSongTiming Measure(const std::string& rom) {
+  // Without a minigsf, and without the pointer that GAX keeps to its work
+  // area.
+  return GaxSongTimer::Measure(
+      rom, 0x8000000 + static_cast<agbptr_t>(rom.size()), {}, agbnullptr);
+}
+
+}  // namespace
+
+int main() {
+  // The position advances at the even frames, so it reaches 30 at frame 60,
+  // and comes back to it at frame 160. The tick counter is left out of the
+  // state as a volatile word.
+  const GaxSongTiming loop = Measure(MakeRom(80, 30, 0));
+  EXPECT(loop.ok());
+  EXPECT(loop.loops());
+  EXPECT(loop.loop_length() == 100);
+  EXPECT(loop.loop_start() == 60);
+
+  // The last sample is pushed at frame 199, before the position reaches 100,
+  // and the position never repeats.
+  const GaxSongTiming end = Measure(MakeRom(0x801, 0, 100));
+  EXPECT(end.ok());
+  EXPECT(!end.loops());
+  EXPECT(end.end() == 200);
+
+  EXPECT(GaxSongTimer::ToTagTime(61.5) == "1:01.500");
+  EXPECT(GaxSongTimer::ToTagTime(0.0004) == "0:00.000");
+  EXPECT(GaxSongTiming::Loop(60, 120).length(2) ==
+         300 / GaxSongTiming::kFramesPerSecond);
+  return testing::num_failures != 0;
+}
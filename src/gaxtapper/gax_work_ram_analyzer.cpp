@@ -0,0 +1,154 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_work_ram_analyzer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "agb_emulator.hpp"
+#include "gax_driver.hpp"
+#include "parallel.hpp"
+#include "tabulate.hpp"
+
+namespace gaxtapper {
+
+static constexpr agbptr_t kEwramStart = 0x2000000;
+static constexpr agbptr_t kIwramStart = 0x3000000;
+static constexpr agbptr_t kIwramEnd = kIwramStart + AgbBus::kIwramSize;
+
+namespace {
+
+// Records every byte of EWRAM and IWRAM that has been written.
+class WriteTracer : public AgbWriteObserver {
+ public:
+  WriteTracer() : written_(AgbBus::kEwramSize + AgbBus::kIwramSize) {}
+
+  [[nodiscard]] static std::size_t index(agbptr_t address) noexcept {
+    return is_iwramptr(address) ? AgbBus::kEwramSize + (address - kIwramStart)
+                                : address - kEwramStart;
+  }
+
+  [[nodiscard]] static agbptr_t address(std::size_t index) noexcept {
+    return index >= AgbBus::kEwramSize
+               ? static_cast<agbptr_t>(kIwramStart + index - AgbBus::kEwramSize)
+               : static_cast<agbptr_t>(kEwramStart + index);
+  }
+
+  [[nodiscard]] const std::vector<std::uint8_t>& written() const noexcept {
+    return written_;
+  }
+
+  void OnWrite(agbptr_t address, agbsize_t size) override {
+    std::fill_n(written_.begin() + index(address), size, std::uint8_t{1});
+  }
+
+ private:
+  std::vector<std::uint8_t> written_;
+};
+
+}  // namespace
+
+agbptr_t GaxWorkRamUsage::FindIwramHole() const noexcept {
+  agbptr_t start = kIwramStart;
+  for (const range_t& range : ranges_) {
+    if (range.second <= start || !is_iwramptr(range.first)) continue;
+    if (range.first >= start + work_size_) return start;
+    start = (range.second + 3) & ~3u;
+  }
+  return start + work_size_ <= GaxDriver::kDriverStackLimit ? start
+                                                            : agbnullptr;
+}
+
+std::ostream& GaxWorkRamUsage::WriteAsTable(std::ostream& stream) const {
+  using row_t = std::vector<std::string>;
+  const row_t header{"Start", "End", "Size", "Use"};
+  std::vector<row_t> items;
+  items.reserve(ranges_.size() + 1);
+  for (const range_t& range : ranges_) {
+    items.push_back(row_t{to_string(range.first), to_string(range.second),
+                          to_string(range.second - range.first), ""});
+  }
+  if (temporary_work_.first != temporary_work_.second) {
+    items.push_back(row_t{to_string(temporary_work_.first),
+                          to_string(temporary_work_.second),
+                          to_string(temporary_work_.second -
+                                    temporary_work_.first),
+                          "temporary work area"});
+  }
+  tabulate(stream, header, items);
+  return stream;
+}
+
+GaxWorkRamUsage GaxWorkRamAnalyzer::Analyze(
+    std::string_view rom, agbptr_t minigsf_address,
+    const std::vector<std::string>& minigsfs, unsigned num_threads) {
+  if (num_threads == 0) num_threads = DefaultThreadCount();
+  num_threads = static_cast<unsigned>(
+      std::clamp<std::size_t>(minigsfs.size(), 1, num_threads));
+
+  std::vector<WriteTracer> tracers(num_threads);
+  std::vector<agbsize_t> work_sizes(minigsfs.size());
+  ParallelFor(
+      minigsfs.size(),
+      [&](std::size_t index, unsigned worker) {
+        AgbEmulator emulator{rom};
+        emulator.bus().set_rom_overlay(minigsf_address, minigsfs[index]);
+        emulator.bus().set_write_observer(&tracers[worker], kEwramStart,
+                                          kIwramEnd);
+        (void)emulator.RunFrames(kFrames);
+
+        const agbsize_t wram_size =
+            emulator.bus().Read32(GaxDriver::kGax2ParamsAddress + 4);
+        work_sizes[index] = GaxDriver::kDriverWorkRamHeaderSize + wram_size;
+      },
+      num_threads);
+
+  std::vector<std::uint8_t> written(AgbBus::kEwramSize + AgbBus::kIwramSize);
+  for (const WriteTracer& tracer : tracers) {
+    const std::vector<std::uint8_t>& source = tracer.written();
+    for (std::size_t i = 0; i < written.size(); i++) written[i] |= source[i];
+  }
+
+  // The work area must cover at least what has been written in it.
+  const std::size_t work_index = WriteTracer::index(kTemporaryWorkAddress);
+  agbsize_t work_size = GaxDriver::kDriverWorkRamHeaderSize;
+  for (agbsize_t offset = kTemporaryWorkSize; offset > 0; offset--) {
+    if (written[work_index + offset - 1] != 0) {
+      work_size = std::max(work_size, offset);
+      break;
+    }
+  }
+  for (const agbsize_t size : work_sizes) {
+    // A broken size means that GAX has not been initialized as expected.
+    if (size <= kTemporaryWorkSize) work_size = std::max(work_size, size);
+  }
+
+  // The temporary work area moves with the driver, and the stacks are fixed.
+  std::fill_n(written.begin() + work_index, kTemporaryWorkSize,
+              std::uint8_t{0});
+  std::fill(written.begin() + WriteTracer::index(GaxDriver::kDriverStackLimit),
+            written.end(), std::uint8_t{1});
+
+  std::vector<GaxWorkRamUsage::range_t> ranges;
+  for (std::size_t i = 0; i < written.size();) {
+    if (written[i] == 0) {
+      i++;
+      continue;
+    }
+    const std::size_t first = i;
+    // Ranges never span across EWRAM and IWRAM.
+    while (i < written.size() && written[i] != 0 &&
+           (i != AgbBus::kEwramSize || i == first))
+      i++;
+    ranges.emplace_back(WriteTracer::address(first),
+                        WriteTracer::address(i - 1) + 1);
+  }
+
+  return GaxWorkRamUsage{
+      std::move(ranges),
+      {kTemporaryWorkAddress, kTemporaryWorkAddress + work_size},
+      (work_size + 3) & ~3u};
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,71 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GAX_WORK_RAM_ANALYZER_HPP_
+#define GAXTAPPER_GAX_WORK_RAM_ANALYZER_HPP_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// The RAM that GAX uses outside of the work area given by the driver.
+class GaxWorkRamUsage {
+ public:
+  using range_t = std::pair<agbptr_t, agbptr_t>;  // [first, second)
+
+  GaxWorkRamUsage() = default;
+
+  GaxWorkRamUsage(std::vector<range_t> ranges, range_t temporary_work,
+                  agbsize_t work_size)
+      : ranges_(std::move(ranges)),
+        temporary_work_(temporary_work),
+        work_size_(work_size) {}
+
+  // The ranges written by GAX (and the driver stacks), in address order.
+  [[nodiscard]] const std::vector<range_t>& ranges() const noexcept {
+    return ranges_;
+  }
+
+  // The part of the temporary work area of the analysis that has been
+  // written. It is not in ranges(), since the work area moves with the driver.
+  [[nodiscard]] range_t temporary_work() const noexcept {
+    return temporary_work_;
+  }
+
+  // The size of the work area that the driver needs for all songs.
+  [[nodiscard]] agbsize_t work_size() const noexcept { return work_size_; }
+
+  // Returns the lowest IWRAM address where the work area fits without
+  // overlapping any of the used ranges, or agbnullptr.
+  [[nodiscard]] agbptr_t FindIwramHole() const noexcept;
+
+  std::ostream& WriteAsTable(std::ostream& stream) const;
+
+ private:
+  std::vector<range_t> ranges_;
+  range_t temporary_work_{agbnullptr, agbnullptr};
+  agbsize_t work_size_ = 0;
+};
+
+// Finds the RAM that GAX writes to, by running the initialization and a few
+// frames of every song with the driver work area placed temporarily in EWRAM.
+class GaxWorkRamAnalyzer {
+ public:
+  static constexpr agbptr_t kTemporaryWorkAddress = 0x2030000;
+  static constexpr agbsize_t kTemporaryWorkSize = 0x10000;
+  static constexpr std::uint32_t kFrames = 30;
+
+  // The ROM must have the driver installed at kTemporaryWorkAddress.
+  [[nodiscard]] static GaxWorkRamUsage Analyze(
+      std::string_view rom, agbptr_t minigsf_address,
+      const std::vector<std::string>& minigsfs, unsigned num_threads = 0);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,91 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gax_work_ram_analyzer.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bytes.hpp"
+#include "gax_driver.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+using Range = GaxWorkRamUsage::range_t;
+
+void TestFindIwramHole() {
+  const std::vector<Range> ranges{{0x2000000, 0x2001000},
+                                  {0x3000000, 0x3000100},
+                                  {0x3000180, 0x3000202},
+                                  {GaxDriver::kDriverStackLimit, 0x3008000}};
+  const Range none{agbnullptr, agbnullptr};
+
+  // The ranges in EWRAM do not matter, and the work area begins at a word.
+  EXPECT(GaxWorkRamUsage(ranges, none, 0x80).FindIwramHole() == 0x3000100);
+  EXPECT(GaxWorkRamUsage(ranges, none, 0x84).FindIwramHole() == 0x3000204);
+
+  // The hole in front of the driver stacks is the last one.
+  const agbsize_t last_hole = GaxDriver::kDriverStackLimit - 0x3000204;
+  EXPECT(GaxWorkRamUsage(ranges, none, last_hole).FindIwramHole() ==
+         0x3000204);
+  EXPECT(GaxWorkRamUsage(ranges, none, last_hole + 4).FindIwramHole() ==
+         agbnullptr);
+}
+
+// A stand-in for the driver, which writes two words of IWRAM, the first
+// 0x200 bytes of the temporary work area, and the work size of 0x180 bytes
+// into the parameters of gax2_init.
+std::string MakeRom() {
+  const std::vector<std::uint32_t> code{
+      0xe3a00403,  // mov r0, #0x3000000
+      0xe3a010aa,  // mov r1, #0xaa
+      0xe5801100,  // str r1, [r0, #0x100]
+      0xe5801400,  // str r1, [r0, #0x400]
+      0xe3a02402,  // mov r2, #0x2000000
+      0xe2822803,  // add r2, r2, #0x30000
+      0xe58211fc,  // str r1, [r2, #0x1fc]
+      0xe3a03403,  // mov r3, #0x3000000
+      0xe2833c7e,  // add r3, r3, #0x7e00
+      0xe28330ac,  // add r3, r3, #0xac (the parameters of gax2_init)
+      0xe5832000,  // str r2, [r3]
+      0xe3a01e18,  // mov r1, #0x180
+      0xe5831004,  // str r1, [r3, #4]
+      0xeafffffe,  // b .
+  };
+  std::string rom(code.size() * 4, '\0');
+  for (std::size_t i = 0; i < code.size(); i++)
+    WriteInt32L(&rom[i * 4], code[i]);
+  return rom;
+}
+
+void TestAnalyze() {
+  const std::string rom = MakeRom();
+  const GaxWorkRamUsage usage = GaxWorkRamAnalyzer::Analyze(
+      rom, 0x8000000 + static_cast<agbptr_t>(rom.size()), {"", ""});
+
+  const agbsize_t work_size = GaxDriver::kDriverWorkRamHeaderSize + 0x180;
+  EXPECT(usage.work_size() == work_size);
+  EXPECT(usage.ranges() ==
+         (std::vector<Range>{{0x3000100, 0x3000104},
+                             {0x3000400, 0x3000404},
+                             {GaxDriver::kDriverStackLimit, 0x3008000}}));
+  EXPECT(usage.temporary_work() ==
+         Range(GaxWorkRamAnalyzer::kTemporaryWorkAddress,
+               GaxWorkRamAnalyzer::kTemporaryWorkAddress + work_size));
+  EXPECT(usage.FindIwramHole() == 0x3000104);
+
+  std::ostringstream table;
+  (void)usage.WriteAsTable(table);
+  EXPECT(table.str().find("temporary work area") != std::string::npos);
+}
+
+}  // namespace
+
+int main() {
+  TestFindIwramHole();
+  TestAnalyze();
+  return testing::num_failures != 0;
+}
@@ -2,27 +2,195 @@
 
 #include "gaxtapper.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+#include "agb_emulator.hpp"
+#include "archive_writer.hpp"
+#include "async_file_writer.hpp"
+#include "bounded_queue.hpp"
+#include "bytes.hpp"
 #include "cartridge.hpp"
 #include "gsf_header.hpp"
+#include "gsf_verifier.hpp"
+#include "gsflib_store.hpp"
+#include "hash.hpp"
+#include "inspection_cache.hpp"
+#include "memory_budget.hpp"
 #include "gsf_writer.hpp"
+#include "gax_benchmark.hpp"
 #include "gax_driver.hpp"
 #include "gax_driver_param.hpp"
 #include "gax_minigsf_driver_param.hpp"
+#include "gax_rom_optimizer.hpp"
+#include "gax_song_timer.hpp"
+#include "gax_work_ram_analyzer.hpp"
+#include "output_hashes.hpp"
+#include "psf_reader.hpp"
+#include "psf_writer.hpp"
+#include "parallel.hpp"
 #include "path.hpp"
+#include "tabulate.hpp"
+#include "task_pool.hpp"
+#include "zlib_block_cache.hpp"
+#include "zlib_compressor.hpp"
 
 namespace gaxtapper {
 
-void Gaxtapper::ConvertToGsfSet(Cartridge& cartridge,
-                                const std::filesystem::path& basename,
-                                agbptr_t driver_address, agbptr_t work_address,
-                                agbsize_t work_size,
-                                const std::filesystem::path& outdir,
-                                const std::string_view& gsfby) {
+namespace {
+
+struct Minigsf {
+  std::filesystem::path path;
+  std::string rom;
+  std::map<std::string, std::string> tags;
+};
+
+// The original entrypoint of the ROM is used as is, if the block fits there.
+agbptr_t DefaultDriverAddress(const Cartridge& cartridge,
+                              const GaxDriverParam& param) {
+  agbptr_t driver_address = cartridge.entrypoint();
+  const agbsize_t driver_size = GaxDriver::gsf_driver_size(param.version());
+  if (driver_address + driver_size >= cartridge.size()) {
+    driver_address = to_romptr(cartridge.size() - driver_size);
+  }
+  return driver_address;
+}
+
+// The song without channels is the sound effects data.
+std::optional<GaxSongParam> FindFx(const GaxDriverParam& param) {
+  for (const GaxMusicEntry& song : param.songs()) {
+    if (song.num_channels() == 0)
+      return std::make_optional(GaxSongParam::Of(song));
+  }
+  return std::nullopt;
+}
+
+std::vector<std::string> ToMinigsfPrograms(const std::vector<Minigsf>& minigsfs) {
+  std::vector<std::string> programs;
+  programs.reserve(minigsfs.size());
+  for (const Minigsf& minigsf : minigsfs) programs.push_back(minigsf.rom);
+  return programs;
+}
+
+std::ostream& WriteRegionsAsTable(
+    std::ostream& stream, const std::vector<ZlibRegionStats>& regions) {
+  using row_t = std::vector<std::string>;
+  const row_t header{"Offset", "Size", "Entropy", "Level", "Compressed",
+                     "Ratio"};
+  std::vector<row_t> items;
+  items.reserve(regions.size());
+  for (const ZlibRegionStats& region : regions) {
+    std::ostringstream offset;
+    offset << "0x" << std::hex << std::setfill('0') << std::setw(8)
+           << region.offset;
+    std::ostringstream entropy;
+    entropy << std::fixed << std::setprecision(2) << region.entropy;
+    std::ostringstream ratio;
+    ratio << std::fixed << std::setprecision(1)
+          << region.compressed_size * 100.0 / region.size << "%";
+    items.push_back(row_t{offset.str(), std::to_string(region.size),
+                          entropy.str(), std::to_string(region.level),
+                          std::to_string(region.compressed_size),
+                          ratio.str()});
+  }
+
+  tabulate(stream, header, items);
+  return stream;
+}
+
+// Inspects the ROM through the InspectionCache in cache_directory, if it is
+// not empty. Sets *hit to whether the parameters were in the cache.
+GaxDriverParam InspectRom(std::string_view rom,
+                          const std::filesystem::path& cache_directory,
+                          bool* hit = nullptr) {
+  if (hit != nullptr) *hit = false;
+  if (cache_directory.empty()) return GaxDriver::Inspect(rom);
+  return InspectionCache{cache_directory}.Inspect(rom, hit);
+}
+
+void BenchmarkCompression(std::string_view rom,
+                          const std::vector<ZlibProfile>& profiles) {
+  using row_t = std::vector<std::string>;
+  const row_t header{"Profile", "Size", "Ratio", "Time", "Throughput"};
+  std::vector<row_t> items;
+  std::unique_ptr<char[]> out{new char[ZlibCompressor::Bound(rom.size())]};
+  for (const ZlibProfile profile : profiles) {
+    ZlibOptions options;
+    options.profile = profile;
+    std::uint32_t crc32;
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t size =
+        ZlibCompressor::Compress({rom}, out.get(), crc32, options);
+    const double seconds = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    std::ostringstream ratio;
+    ratio << std::fixed << std::setprecision(2)
+          << size * 100.0 / std::max<std::size_t>(rom.size(), 1) << "%";
+    std::ostringstream time;
+    time << std::fixed << std::setprecision(3) << seconds << " s";
+    std::ostringstream throughput;
+    throughput << std::fixed << std::setprecision(2)
+               << rom.size() / 1048576.0 / std::max(seconds, 1e-9) << " MiB/s";
+    items.push_back(row_t{ZlibCompressor::ProfileName(profile),
+                          std::to_string(size), ratio.str(), time.str(),
+                          throughput.str()});
+  }
+
+  std::cout << "Compression of the ROM (" << rom.size()
+            << " bytes):" << std::endl
+            << std::endl;
+  tabulate(std::cout, header, items);
+}
+
+// The GSF set of a ROM before the compression.
+struct GsfSetPlan {
+  GaxDriverParam param;
+  agbptr_t driver_address = agbnullptr;
+  agbptr_t work_address = agbnullptr;
+  agbptr_t minigsf_address = agbnullptr;
+  agbsize_t gsflib_size = 0;
+  std::vector<Minigsf> minigsfs;
+};
+
+// Installs the driver into the cartridge (and optimizes it), and makes the
+// minigsfs of the songs in outdir, whose _lib tag is lib_name. The messages
+// go to log, and the warnings to warnings.
+GsfSetPlan PlanGsfSet(Cartridge& cartridge,
+                      const std::filesystem::path& basename,
+                      const std::filesystem::path& outdir,
+                      const std::string& lib_name,
+                      const GsfSetOptions& options, std::ostream& log,
+                      std::ostream& warnings) {
+  agbptr_t driver_address = options.driver_address;
+  agbptr_t work_address = options.auto_work_address
+                              ? GaxWorkRamAnalyzer::kTemporaryWorkAddress
+                              : options.work_address;
+
   if (driver_address != agbnullptr) {
     if (!is_romptr(driver_address)) {
       throw std::invalid_argument(
@@ -48,7 +216,11 @@ void Gaxtapper::ConvertToGsfSet(Cartridge& cartridge,
     }
   }
 
-  const GaxDriverParam param = GaxDriver::Inspect(cartridge.rom());
+  bool cache_hit = false;
+  const GaxDriverParam param =
+      InspectRom(cartridge.rom(), options.inspect_cache, &cache_hit);
+  if (cache_hit && options.verbose)
+    log << "Driver parameters: found in the inspection cache" << std::endl;
   if (!param.ok()) {
     std::ostringstream message;
     message << "Identification of GAX Sound Engine is incomplete."
@@ -58,54 +230,35 @@ void Gaxtapper::ConvertToGsfSet(Cartridge& cartridge,
     throw std::runtime_error(message.str());
   }
 
-  // If the entry point address is not specified, the original entrypoint of the ROM is used as is.
-  if (driver_address == agbnullptr) {
-    driver_address = cartridge.entrypoint();
-    const agbsize_t driver_size = GaxDriver::gsf_driver_size(param.version());
-    if (driver_address + driver_size >= cartridge.size()) {
-      driver_address = to_romptr(cartridge.size() - driver_size);
-    }
-  }
+  if (driver_address == agbnullptr)
+    driver_address = DefaultDriverAddress(cartridge, param);
 
+  GsfSetPlan plan;
   GaxDriver::InstallGsfDriver(cartridge.rom(), driver_address, work_address,
-                              work_size, param);
+                              options.work_size, param, options.lean_driver);
 
-  if (!outdir.empty())
-    create_directories(outdir);
-
-  std::filesystem::path gsflib_path{outdir};
-  gsflib_path /= basename;
-  gsflib_path += ".gsflib";
-
-  constexpr agbptr_t kEntrypoint = to_romptr(0);
-  const GsfHeader gsf_header{kEntrypoint, kEntrypoint, cartridge.size()};
-  GsfWriter::SaveToFile(gsflib_path, gsf_header, cartridge.rom());
-
-  std::optional<GaxSongParam> fx;
-  for (const GaxMusicEntry& song : param.songs()) {
-    if (song.num_channels() == 0) {
-      fx = std::make_optional(GaxSongParam::Of(song));
-      break;
-    }
-  }
+  const std::optional<GaxSongParam> fx = FindFx(param);
 
   std::set<std::filesystem::path> minigsf_name_set;
   std::set<std::filesystem::path> duplicated_name_set;
   for (const GaxMusicEntry& song : param.songs()) {
     if (song.num_channels() == 0) continue;
-    std::filesystem::path minigsf_filename{GetMinigsfFilename(song, basename)};
+    std::filesystem::path minigsf_filename{
+        Gaxtapper::GetMinigsfFilename(song, basename)};
     const auto [_, new_name] = minigsf_name_set.insert(minigsf_filename);
     if (!new_name) {
       duplicated_name_set.insert(minigsf_filename);
     }
   }
 
-  std::set<std::filesystem::path> saved_minigsf_names;
-  const agbptr_t minigsf_address = GaxDriver::minigsf_address(driver_address, param.version());
+  std::vector<Minigsf>& minigsfs = plan.minigsfs;
+  const agbptr_t minigsf_address =
+      GaxDriver::minigsf_address(driver_address, param.version());
   for (const GaxMusicEntry& song : param.songs()) {
     if (song.num_channels() == 0) continue;
 
-    std::filesystem::path minigsf_filename{GetMinigsfFilename(song, basename)};
+    std::filesystem::path minigsf_filename{
+        Gaxtapper::GetMinigsfFilename(song, basename)};
 
     // If a file with the same name has already been saved,
     // add module address to the filename and make it unique.
@@ -124,24 +277,830 @@ void Gaxtapper::ConvertToGsfSet(Cartridge& cartridge,
     std::filesystem::path minigsf_path{outdir};
     minigsf_path /= minigsf_filename;
 
-    std::map<std::string, std::string> minigsf_tags{
-        {"_lib", gsflib_path.filename().string()}};
-    if (!gsfby.empty()) minigsf_tags["gsfby"] = gsfby;
+    std::map<std::string, std::string> minigsf_tags{{"_lib", lib_name}};
+    if (!options.gsfby.empty()) minigsf_tags["gsfby"] = options.gsfby;
 
     GaxMinigsfDriverParam minigsf{minigsf_address, GaxSongParam::Of(song)};
     minigsf.set_fx(fx);
-    std::string minigsf_rom{GaxDriver::NewMinigsfData(minigsf)};
-    GsfHeader minigsf_header{kEntrypoint, minigsf_address,
-                             static_cast<agbsize_t>(minigsf_rom.size())};
+    const GaxPlaybackParams playback = options.playback.Resolve(
+        song, minigsf_filename.stem().string());
+    minigsf.set_mixing_rate(playback.mixing_rate);
+    minigsf.set_volume(playback.volume);
     if (!minigsf.song().info().parsed_artist().empty())
       minigsf_tags["artist"] = minigsf.song().info().parsed_artist();
-    GsfWriter::SaveToFile(minigsf_path, minigsf_header, minigsf_rom,
-                          std::move(minigsf_tags));
+    minigsfs.push_back(Minigsf{std::move(minigsf_path),
+                               GaxDriver::NewMinigsfData(minigsf),
+                               std::move(minigsf_tags)});
+  }
+
+  if (options.auto_work_address) {
+    const GaxWorkRamUsage usage = GaxWorkRamAnalyzer::Analyze(
+        cartridge.rom(), minigsf_address, ToMinigsfPrograms(minigsfs));
+    log << "RAM used by GAX:" << std::endl << std::endl;
+    (void)usage.WriteAsTable(log);
+    log << std::endl;
+
+    work_address = usage.FindIwramHole();
+    if (work_address != agbnullptr) {
+      log << "Work RAM: " << to_string(work_address) << " (size "
+          << to_string(usage.work_size()) << ")" << std::endl;
+    } else {
+      warnings << "Warning: No IWRAM hole fits the work area of size "
+               << to_string(usage.work_size())
+               << ". The default address is used." << std::endl;
+    }
+    GaxDriver::InstallGsfDriver(cartridge.rom(), driver_address, work_address,
+                                options.work_size, param, options.lean_driver);
   }
+
+  if (options.timing_seconds > 0) {
+    std::vector<GaxSongTiming> timings(minigsfs.size());
+    ParallelFor(minigsfs.size(), [&](std::size_t index, unsigned) {
+      timings[index] = GaxSongTimer::Measure(
+          cartridge.rom(), minigsf_address, minigsfs[index].rom,
+          param.gax_wram_pointer(), options.timing_seconds);
+    });
+
+    for (std::size_t i = 0; i < minigsfs.size(); i++) {
+      const GaxSongTiming& timing = timings[i];
+      if (!timing.ok()) {
+        warnings << "Warning: " << minigsfs[i].path.filename().string()
+                 << ": Unable to detect the song length." << std::endl;
+        continue;
+      }
+      minigsfs[i].tags["length"] =
+          GaxSongTimer::ToTagTime(timing.length(options.loop_count));
+      minigsfs[i].tags["fade"] = GaxSongTimer::ToTagTime(
+          timing.loops() ? options.fade_seconds : 0.0);
+    }
+  }
+
+  agbsize_t gsflib_size = cartridge.size();
+  if (options.optimize_seconds > 0) {
+    std::vector<agbptr_t> faults;
+    const RomCoverage coverage = GaxRomOptimizer::Analyze(
+        cartridge.rom(), minigsf_address, ToMinigsfPrograms(minigsfs),
+        options.optimize_seconds, 0, &faults);
+    for (std::size_t i = 0; i < faults.size(); i++) {
+      if (faults[i] == agbnullptr) continue;
+      warnings << "Warning: " << minigsfs[i].path.filename().string()
+               << ": Stopped at an unsupported instruction ("
+               << to_string(faults[i])
+               << "). The optimized ROM may be incomplete." << std::endl;
+    }
+    gsflib_size = GaxRomOptimizer::Optimize(
+        cartridge.rom(), coverage, driver_address,
+        GaxDriver::gsf_driver_size(param.version()));
+
+    log << "Optimized ROM: " << coverage.count() << " of "
+        << cartridge.size() << " bytes used, gsflib size 0x" << std::hex
+        << gsflib_size << std::dec << std::endl;
+  }
+
+  plan.param = param;
+  plan.driver_address = driver_address;
+  plan.work_address = work_address;
+  plan.minigsf_address = minigsf_address;
+  plan.gsflib_size = gsflib_size;
+  return plan;
 }
 
-void Gaxtapper::Inspect(const Cartridge& cartridge) {
-  const GaxDriverParam param = GaxDriver::Inspect(cartridge.rom());
+// Returns the minigsfs to be written. If two minigsfs still have the same
+// path, the later one would replace the earlier one in serial order, so only
+// the later one is written.
+std::vector<const Minigsf*> UniqueMinigsfs(
+    const std::vector<Minigsf>& minigsfs) {
+  std::vector<const Minigsf*> unique_minigsfs;
+  std::set<std::filesystem::path> path_set;
+  for (auto it = minigsfs.rbegin(); it != minigsfs.rend(); ++it) {
+    if (path_set.insert(it->path).second) unique_minigsfs.push_back(&*it);
+  }
+  std::reverse(unique_minigsfs.begin(), unique_minigsfs.end());
+  return unique_minigsfs;
+}
+
+// Lists the files given and the files found in the directories given, in
+// order. The files in a directory are sorted by path.
+template <typename Predicate>
+std::vector<std::filesystem::path> CollectFiles(
+    const std::vector<std::filesystem::path>& paths, Predicate&& wanted) {
+  std::vector<std::filesystem::path> files;
+  for (const std::filesystem::path& path : paths) {
+    if (!std::filesystem::is_directory(path)) {
+      files.push_back(path);
+      continue;
+    }
+    std::vector<std::filesystem::path> found;
+    for (const auto& entry :
+         std::filesystem::recursive_directory_iterator(path)) {
+      if (entry.is_regular_file() && wanted(entry.path()))
+        found.push_back(entry.path());
+    }
+    std::sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+  }
+  return files;
+}
+
+bool IsRomPath(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension == ".gba" || extension == ".agb" || extension == ".bin";
+}
+
+// A ROM read by the read stage of Gaxtapper::Batch (no cartridge if it
+// could not be read).
+struct LoadedRom {
+  std::size_t index;
+  std::shared_ptr<Cartridge> cartridge;
+};
+
+// A ROM of Gaxtapper::Batch.
+struct BatchJob {
+  std::filesystem::path path;
+  std::uintmax_t size = 0;
+  std::filesystem::path outdir;
+  std::string game_code;
+  std::ostringstream log;
+  std::ostringstream warnings;
+  GsfSetResult result;
+  std::string error;
+  double load_seconds = 0.0;
+  // The estimated memory (see EstimateFootprint).
+  std::size_t footprint = 0;
+};
+
+// Reads the cartridge header of a ROM file, for the output layout. A short
+// file is padded with zeros, as Cartridge::LoadFromFile does.
+std::optional<Cartridge> ReadHeader(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  if (!stream) return std::nullopt;
+  Cartridge cartridge;
+  cartridge.rom().assign(Cartridge::kHeaderSize, '\0');
+  stream.read(cartridge.rom().data(), Cartridge::kHeaderSize);
+  return cartridge;
+}
+
+// Removes the directory and its parents up to root while they are empty.
+void RemoveEmptyDirectories(std::filesystem::path directory,
+                            const std::filesystem::path& root) {
+  std::error_code error;
+  while (directory != root && directory.has_relative_path() &&
+         std::filesystem::remove(directory, error)) {
+    directory = directory.parent_path();
+  }
+}
+
+// Estimates the memory that extracting a ROM of the file size takes at
+// most: the cartridge, the output buffer of the compressor, the compressed
+// gsflib (which is trimmed out of that buffer and moved to the writer), and
+// a fixed part for the emulator, the minigsfs and the compressor states. A
+// file larger than a cartridge is rejected before it is read.
+std::size_t EstimateFootprint(std::uintmax_t file_size) {
+  constexpr std::size_t kFixedSize = 0x800000;
+  if (file_size > Cartridge::kMaximumSize) return kFixedSize;
+  const auto rom_size = static_cast<std::size_t>((file_size + 3) & ~3);
+  return rom_size * 2 + ZlibCompressor::Bound(rom_size) + kFixedSize;
+}
+
+// Keeps the C runtime from translating the line feeds of the standard
+// output, which is binary when an archive is written to it.
+void SetBinaryMode(std::ostream& stream) {
+  stream.flush();
+#ifdef _WIN32
+  if (&stream == &std::cout) (void)_setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Runs the jobs of a GSF set as ParallelFor does, but on a TaskPool, so that
+// the nested loop of the gsflib compression shares the threads of the jobs
+// instead of starting as many again. Inside a task, the current pool is used.
+template <typename Function>
+void ParallelJobs(std::size_t count, Function&& function,
+                  unsigned num_threads) {
+  if (num_threads == 0) num_threads = DefaultThreadCount();
+  if (TaskPool::Current() != nullptr || num_threads == 1) {
+    ParallelFor(count, function, num_threads);
+    return;
+  }
+
+  // The calling thread takes the place of one of the workers.
+  TaskPool pool{num_threads - 1};
+  std::atomic<bool> done{false};
+  std::exception_ptr error;
+  pool.Submit([&] {
+    try {
+      ParallelFor(count, function, num_threads);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done = true;
+  });
+  pool.RunUntil([&] { return done.load(); });
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace
+
+GsfSetResult Gaxtapper::ConvertToGsfSet(
+    Cartridge& cartridge, const std::filesystem::path& basename,
+    const GsfSetOptions& options) {
+  const std::filesystem::path outdir =
+      options.layout.empty()
+          ? options.outdir
+          : options.outdir / options.layout.Directory(cartridge);
+  // The messages go to stderr while the archive is written to stdout.
+  const bool to_archive = !options.archive.empty();
+  std::ostream& log = options.log != nullptr    ? *options.log
+                      : options.archive == "-" ? std::cerr
+                                               : std::cout;
+  std::ostream& warnings =
+      options.warnings != nullptr ? *options.warnings : std::cerr;
+  if (to_archive) (void)ArchiveWriter::FormatOf(options.archive);
+
+  // The cache of the ROM is found by the content before the driver is
+  // installed, which does not depend on the options.
+  std::optional<ZlibBlockCache> block_cache;
+  if (!options.block_cache.empty()) {
+    std::ostringstream filename;
+    filename << std::hex << std::setfill('0') << std::setw(16)
+             << HashBytes(cartridge.rom()) << ZlibBlockCache::kExtension;
+    block_cache.emplace(options.block_cache / filename.str());
+  }
+
+  std::filesystem::path gsflib_path{outdir};
+  gsflib_path /= basename;
+  gsflib_path += ".gsflib";
+
+  const auto analyze_start = std::chrono::steady_clock::now();
+  GsfSetPlan plan =
+      PlanGsfSet(cartridge, basename, outdir, gsflib_path.filename().string(),
+                 options, log, warnings);
+  const double analyze_seconds = SecondsSince(analyze_start);
+  const agbptr_t minigsf_address = plan.minigsf_address;
+  const agbsize_t gsflib_size = plan.gsflib_size;
+  std::vector<Minigsf>& minigsfs = plan.minigsfs;
+
+  if (!outdir.empty() && !to_archive && !options.directories_created)
+    create_directories(outdir);
+
+  const std::vector<const Minigsf*> minigsf_jobs = UniqueMinigsfs(minigsfs);
+
+  // The gsflib and the minigsfs are written by independent jobs. The gsflib
+  // is the first job, since it takes the longest.
+  constexpr agbptr_t kEntrypoint = to_romptr(0);
+  const GsfHeader gsf_header{kEntrypoint, kEntrypoint, gsflib_size};
+  const std::string_view gsflib_rom =
+      std::string_view{cartridge.rom()}.substr(0, gsflib_size);
+  std::vector<ZlibRegionStats> regions;
+  ZlibOptions gsflib_compression;
+  gsflib_compression.profile = options.compression;
+  gsflib_compression.num_threads = options.num_threads;
+  if (options.verbose) gsflib_compression.regions = &regions;
+  if (block_cache) gsflib_compression.block_cache = &*block_cache;
+  ZlibOptions minigsf_compression;
+  minigsf_compression.profile = options.compression;
+
+  // A file is skipped if the sidecar says that the same content has been
+  // written to it. The other files are compressed in memory and handed to
+  // the writer threads, so that the compression does not wait for the disk.
+  // For an archive, the files are kept in memory and added in order, after
+  // all of them have been compressed.
+  const std::size_t num_files = minigsf_jobs.size() + 1;
+  std::vector<std::string> images(to_archive ? num_files : 0);
+  std::filesystem::path hashes_path{gsflib_path};
+  hashes_path.replace_extension(OutputHashes::kExtension);
+  OutputHashes hashes{hashes_path};
+
+  // With a store, the minigsfs refer to the gsflib in the store, which is
+  // only compressed if no other ROM has produced the same gsflib.
+  GsfSetResult result;
+  result.num_files = num_files;
+  result.analyze_seconds = analyze_seconds;
+  std::optional<GsflibStore> store;
+  std::uint64_t gsflib_hash = 0;
+  std::filesystem::path gsflib_temporary_path;
+  if (!options.lib_store.empty() && !to_archive) {
+    store.emplace(options.lib_store);
+    gsflib_hash = GsflibStore::HashGsflib(gsf_header, gsflib_rom);
+    gsflib_path = store->PathOf(gsflib_hash);
+    result.gsflib_shared = true;
+    result.gsflib_reused = store->Contains(gsflib_hash);
+    if (result.gsflib_reused &&
+        !store->Matches(gsflib_hash, gsf_header, gsflib_rom)) {
+      throw std::runtime_error("The gsflib \"" + gsflib_path.string() +
+                               "\" in the store differs from the gsflib of "
+                               "the ROM. Remove it and extract again.");
+    }
+    if (!result.gsflib_reused) {
+      if (!options.directories_created)
+        create_directories(store->directory());
+      gsflib_temporary_path = store->TemporaryPathOf(gsflib_hash);
+    }
+    const std::string lib = GsflibStore::LibTag(gsflib_path, outdir);
+    for (Minigsf& minigsf : minigsfs) minigsf.tags["_lib"] = lib;
+  }
+  result.gsflib_path = gsflib_path;
+  std::optional<AsyncFileWriter> writer;
+  if (!to_archive) {
+    writer.emplace(options.sync, options.num_io_threads,
+                   options.io_queue_size);
+  }
+  std::atomic<std::size_t> num_skipped{0};
+  bool gsflib_written = false;
+  const auto save = [&](std::size_t index, const std::filesystem::path& path,
+                        const GsfHeader& header, std::string_view rom,
+                        const std::map<std::string, std::string>& tags,
+                        const ZlibOptions& compression) {
+    if (to_archive) {
+      images[index] = GsfWriter::SaveToString(header, rom, tags, compression);
+      return true;
+    }
+
+    const std::uint64_t hash =
+        OutputHashes::HashGsf(header, rom, tags, options.compression);
+    if (!options.force && hashes.IsUnchanged(path, hash)) {
+      num_skipped++;
+      return false;
+    }
+    std::string data = GsfWriter::SaveToString(header, rom, tags, compression);
+    hashes.Update(path, hash, data);
+    writer->Write(path, std::move(data));
+    return true;
+  };
+
+  const auto compress_start = std::chrono::steady_clock::now();
+  ParallelJobs(
+      minigsf_jobs.size() + 1,
+      [&](std::size_t index, unsigned) {
+        if (index == 0) {
+          if (result.gsflib_reused) return;
+          if (store) {
+            writer->Write(gsflib_temporary_path,
+                          GsfWriter::SaveToString(gsf_header, gsflib_rom, {},
+                                                  gsflib_compression));
+            gsflib_written = true;
+            return;
+          }
+          gsflib_written = save(index, gsflib_path, gsf_header, gsflib_rom,
+                                {}, gsflib_compression);
+          return;
+        }
+
+        const Minigsf& minigsf = *minigsf_jobs[index - 1];
+        const GsfHeader minigsf_header{
+            kEntrypoint, minigsf_address,
+            static_cast<agbsize_t>(minigsf.rom.size())};
+        save(index, minigsf.path, minigsf_header, minigsf.rom, minigsf.tags,
+             minigsf_compression);
+      },
+      options.num_threads);
+  result.compress_seconds = SecondsSince(compress_start);
+
+  if (to_archive) {
+    std::ofstream file;
+    if (options.archive != "-") {
+      file.open(options.archive, std::ios::out | std::ios::binary);
+      file.exceptions(std::ios::badbit | std::ios::failbit);
+    } else {
+      SetBinaryMode(std::cout);
+    }
+    ArchiveWriter archive{options.archive != "-" ? file : std::cout,
+                          ArchiveWriter::FormatOf(options.archive)};
+    for (std::size_t i = 0; i < num_files; i++) {
+      const std::filesystem::path& path =
+          i == 0 ? gsflib_path : minigsf_jobs[i - 1]->path;
+      archive.Add(path.filename().u8string(), images[i]);
+      std::string{}.swap(images[i]);
+    }
+    archive.Finish();
+    if (options.archive != "-") {
+      file.close();
+      if (options.sync != SyncPolicy::kNone)
+        AsyncFileWriter::SyncFile(options.archive);
+    }
+    result.num_written = num_files;
+    log << "Written " << num_files << " files to "
+        << (options.archive != "-" ? options.archive.string()
+                                   : "the standard output")
+        << "." << std::endl;
+  } else {
+    // The sidecar is saved only after every file has been written.
+    writer->Finish();
+    result.write_busy_seconds = writer->busy_seconds();
+    result.write_wait_seconds = writer->wait_seconds();
+    if (store && gsflib_written)
+      store->Publish(gsflib_temporary_path, gsflib_hash);
+    hashes.Save();
+    result.num_skipped = num_skipped;
+    result.num_written =
+        num_files - num_skipped - (result.gsflib_reused ? 1 : 0);
+    log << "Written " << result.num_written << " files, skipped "
+        << num_skipped << " unchanged files." << std::endl;
+    if (store) {
+      log << "Shared gsflib: " << gsflib_path.string()
+          << (result.gsflib_reused ? " (reused)" : " (added)") << std::endl;
+    }
+
+    if (!options.layout.empty()) {
+      OutputLayout::RecordInManifest(
+          options.outdir,
+          {{store ? std::filesystem::path{GsflibStore::LibTag(
+                        gsflib_path, options.outdir)}
+                  : options.layout.Directory(cartridge) /
+                        gsflib_path.filename(),
+            cartridge.full_game_code(), options.rom_name}});
+      log << "Output directory: " << outdir.string() << std::endl;
+    }
+  }
+
+  if (block_cache && gsflib_written) {
+    if (!options.directories_created)
+      create_directories(options.block_cache);
+    block_cache->Save();
+    log << "Block cache: reused " << block_cache->hits() << " of "
+        << block_cache->hits() + block_cache->misses() << " blocks."
+        << std::endl;
+  }
+
+  if (options.verbose && gsflib_written) {
+    log << "Compression of " << gsflib_path.filename().string() << ":"
+              << std::endl
+              << std::endl;
+    (void)WriteRegionsAsTable(log, regions);
+    log << std::endl;
+  }
+  if (options.verbose) {
+    log << "Time: analyze " << std::fixed << std::setprecision(3)
+        << result.analyze_seconds << " s, compress "
+        << result.compress_seconds << " s, write " << result.write_busy_seconds
+        << " s (the compression waited " << result.write_wait_seconds
+        << " s for the writer)." << std::defaultfloat << std::endl;
+  }
+  return result;
+}
+
+GsfSet Gaxtapper::BuildGsfSet(std::string_view rom,
+                              const std::string& basename,
+                              const GsfSetOptions& options) {
+  Cartridge cartridge = Cartridge::LoadFromMemory(rom);
+  GsfSet set;
+  set.game_title = cartridge.game_title();
+  set.game_code = cartridge.full_game_code();
+
+  set.gsflib.filename = basename + ".gsflib";
+  std::ostringstream log;
+  std::ostringstream warnings;
+  GsfSetPlan plan = PlanGsfSet(cartridge, std::filesystem::u8path(basename),
+                               {}, set.gsflib.filename, options, log,
+                               warnings);
+  set.gax_version = plan.param.version_text();
+  set.driver_address = plan.driver_address;
+  set.work_address = plan.work_address;
+  set.minigsf_address = plan.minigsf_address;
+  set.gsflib_size = plan.gsflib_size;
+
+  const std::vector<const Minigsf*> minigsfs = UniqueMinigsfs(plan.minigsfs);
+  set.minigsfs.resize(minigsfs.size());
+  for (std::size_t i = 0; i < minigsfs.size(); i++) {
+    GsfSetFile& file = set.minigsfs[i];
+    file.filename = minigsfs[i]->path.filename().u8string();
+    file.tags = minigsfs[i]->tags;
+    file.song_address = ReadInt32L(
+        &minigsfs[i]->rom[GaxDriver::kMinigsfParamMyMusicOffset]);
+  }
+
+  constexpr agbptr_t kEntrypoint = to_romptr(0);
+  ZlibOptions gsflib_compression;
+  gsflib_compression.profile = options.compression;
+  gsflib_compression.num_threads = options.num_threads;
+  ZlibOptions minigsf_compression;
+  minigsf_compression.profile = options.compression;
+  ParallelJobs(
+      minigsfs.size() + 1,
+      [&](std::size_t index, unsigned) {
+        if (index == 0) {
+          set.gsflib.data = GsfWriter::SaveToString(
+              GsfHeader{kEntrypoint, kEntrypoint, plan.gsflib_size},
+              std::string_view{cartridge.rom()}.substr(0, plan.gsflib_size),
+              {}, gsflib_compression);
+          return;
+        }
+
+        const Minigsf& minigsf = *minigsfs[index - 1];
+        set.minigsfs[index - 1].data = GsfWriter::SaveToString(
+            GsfHeader{kEntrypoint, plan.minigsf_address,
+                      static_cast<agbsize_t>(minigsf.rom.size())},
+            minigsf.rom, minigsf.tags, minigsf_compression);
+      },
+      options.num_threads);
+
+  set.log = log.str();
+  std::istringstream warning_lines{warnings.str()};
+  for (std::string line; std::getline(warning_lines, line);)
+    set.warnings.push_back(line);
+  return set;
+}
+
+void Gaxtapper::Batch(const std::vector<std::filesystem::path>& paths,
+                      const BatchOptions& options) {
+  if (!options.extract.archive.empty())
+    throw std::invalid_argument("An archive cannot be used with a batch.");
+
+  // Each ROM has its own output directory. The ROMs of the same name get a
+  // number in the order of the input, so that they do not overwrite each
+  // other.
+  const std::vector<std::filesystem::path> files =
+      CollectFiles(paths, IsRomPath);
+  std::vector<BatchJob> jobs(files.size());
+  std::map<std::filesystem::path, int> name_counts;
+  for (std::size_t i = 0; i < files.size(); i++) {
+    BatchJob& job = jobs[i];
+    job.path = files[i];
+    std::error_code error;
+    job.size = std::filesystem::file_size(job.path, error);
+    if (error) job.size = 0;
+
+    std::filesystem::path name = job.path.stem();
+    if (const int count = ++name_counts[name]; count > 1)
+      name += "-" + std::to_string(count);
+    job.outdir = options.extract.outdir / name;
+    job.footprint = EstimateFootprint(job.size);
+
+    // The layout needs the game code, which is read from the header before
+    // the ROM, so that the ROMs of the same game code still have their own
+    // directories.
+    if (!options.extract.layout.empty()) {
+      if (const std::optional<Cartridge> header = ReadHeader(job.path)) {
+        job.outdir = options.extract.outdir /
+                     options.extract.layout.Directory(*header) / name;
+      }
+    }
+  }
+
+  // The directories are created at once before the extraction, instead of
+  // by the tasks of each ROM at the same time. The directories of the ROMs
+  // that fail are removed at the end, if they are still empty.
+  {
+    std::set<std::filesystem::path> directories;
+    for (const BatchJob& job : jobs) directories.insert(job.outdir);
+    if (!options.extract.lib_store.empty())
+      directories.insert(options.extract.lib_store);
+    if (!options.extract.block_cache.empty())
+      directories.insert(options.extract.block_cache);
+    for (const std::filesystem::path& directory : directories)
+      std::filesystem::create_directories(directory);
+  }
+
+  // The ROMs go through the stages of a pipeline: the read threads read the
+  // next ROMs, while the pool analyzes and compresses the current ones. The
+  // stages are connected by a bounded queue, so that a stage that is ahead
+  // waits instead of taking up memory. Each extraction writes its files
+  // through its own AsyncFileWriter, whose I/O threads write the files of
+  // the ROM while its next files are compressed. The largest ROMs are
+  // started first, and the small ones fill the gaps; the compression of a
+  // ROM spreads to the idle workers of the pool through ParallelFor.
+  std::vector<std::size_t> order(jobs.size());
+  for (std::size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) {
+                     return jobs[a].size > jobs[b].size;
+                   });
+
+  TaskPool pool{options.num_threads};
+  MemoryBudget budget{options.max_memory};
+  const unsigned num_read_threads = std::max(options.num_read_threads, 1u);
+  BoundedQueue<LoadedRom> loaded{options.read_ahead != 0 ? options.read_ahead
+                                                         : pool.size()};
+  const auto extract = [&](BatchJob& job, Cartridge& cartridge) {
+    try {
+      // The layout has been applied to the directory, and the manifest is
+      // written by the batch.
+      GsfSetOptions extract_options{options.extract};
+      extract_options.outdir = job.outdir;
+      extract_options.layout = OutputLayout{};
+      extract_options.directories_created = true;
+      extract_options.rom_name = job.path.filename().u8string();
+      extract_options.num_threads = 0;
+      extract_options.log = &job.log;
+      extract_options.warnings = &job.warnings;
+      job.result = ConvertToGsfSet(cartridge, job.game_code, extract_options);
+    } catch (const std::exception& e) {
+      job.error = job.path.string() + ": " + e.what();
+    }
+  };
+  const auto start = std::chrono::steady_clock::now();
+
+  // The read stage reads the ROMs in order, while their estimated memory
+  // fits in the budget.
+  std::atomic<std::size_t> num_read{0};
+  std::atomic<unsigned> num_readers{num_read_threads};
+  std::atomic<std::int64_t> budget_wait_nanoseconds{0};
+  const auto read = [&] {
+    for (std::size_t position; (position = num_read++) < order.size();) {
+      BatchJob& job = jobs[order[position]];
+      const auto wait_start = std::chrono::steady_clock::now();
+      budget.Acquire(job.footprint);
+      budget_wait_nanoseconds +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - wait_start)
+              .count();
+
+      const auto load_start = std::chrono::steady_clock::now();
+      LoadedRom rom{order[position], nullptr};
+      try {
+        rom.cartridge =
+            std::make_shared<Cartridge>(Cartridge::LoadFromFile(job.path));
+        job.game_code = rom.cartridge->full_game_code();
+      } catch (const std::exception& e) {
+        job.error = job.path.string() + ": " + e.what();
+      }
+      job.load_seconds = SecondsSince(load_start);
+      loaded.Push(std::move(rom));
+    }
+    if (--num_readers == 0) loaded.Close();
+  };
+  std::vector<std::thread> readers;
+  readers.reserve(num_read_threads);
+  for (unsigned i = 0; i < num_read_threads; i++) readers.emplace_back(read);
+
+  // The extract stage runs a task for each ROM, up to one for each worker
+  // of the pool.
+  std::mutex extract_mutex;
+  std::condition_variable extract_finished;
+  unsigned num_extracting = 0;
+  while (std::optional<LoadedRom> rom = loaded.Pop()) {
+    BatchJob& job = jobs[rom->index];
+    if (!rom->cartridge) {
+      budget.Release(job.footprint);
+      continue;
+    }
+    {
+      std::unique_lock<std::mutex> lock{extract_mutex};
+      extract_finished.wait(lock,
+                            [&] { return num_extracting < pool.size(); });
+      num_extracting++;
+    }
+    pool.Submit([&, cartridge = std::move(rom->cartridge)]() mutable {
+      extract(job, *cartridge);
+      cartridge.reset();
+      budget.Release(job.footprint);
+      {
+        std::lock_guard<std::mutex> lock{extract_mutex};
+        num_extracting--;
+      }
+      extract_finished.notify_all();
+    });
+  }
+  {
+    std::unique_lock<std::mutex> lock{extract_mutex};
+    extract_finished.wait(lock, [&] { return num_extracting == 0; });
+  }
+  for (std::thread& reader : readers) reader.join();
+  const double seconds = SecondsSince(start);
+
+  std::ostringstream report;
+  report << "rom\tgame_code\tstatus\tfiles\twritten\tskipped\tgsflib"
+         << std::endl;
+  std::uintmax_t total_size = 0;
+  double load_seconds = 0.0;
+  double analyze_seconds = 0.0;
+  double write_busy_seconds = 0.0;
+  double write_wait_seconds = 0.0;
+  std::size_t num_errors = 0;
+  std::size_t num_shared = 0;
+  std::size_t num_reused = 0;
+  for (const BatchJob& job : jobs) {
+    total_size += job.size;
+    load_seconds += job.load_seconds;
+    analyze_seconds += job.result.analyze_seconds;
+    write_busy_seconds += job.result.write_busy_seconds;
+    write_wait_seconds += job.result.write_wait_seconds;
+    if (const std::string log = job.log.str(); !log.empty()) {
+      std::cout << "# " << job.path.string() << std::endl
+                << std::endl
+                << log << std::endl;
+    }
+    std::cerr << job.warnings.str();
+
+    // The header of a broken ROM may have any bytes in the game code.
+    std::string game_code = job.game_code;
+    std::replace_if(
+        game_code.begin(), game_code.end(),
+        [](unsigned char c) { return c < 0x20 || c >= 0x7f; }, '?');
+    report << job.path.generic_u8string() << "\t" << game_code << "\t";
+    if (!job.error.empty()) {
+      std::cerr << job.error << std::endl;
+      RemoveEmptyDirectories(job.outdir, options.extract.outdir);
+      num_errors++;
+      report << "failed\t0\t0\t0\t-" << std::endl;
+      continue;
+    }
+    const GsfSetResult& result = job.result;
+    if (result.gsflib_shared) num_shared++;
+    if (result.gsflib_reused) num_reused++;
+    report << "ok\t" << result.num_files << "\t" << result.num_written
+           << "\t" << result.num_skipped << "\t"
+           << (result.gsflib_reused   ? "reused"
+               : result.gsflib_shared ? "shared"
+                                      : "local")
+           << std::endl;
+  }
+  if (!options.extract.layout.empty()) {
+    std::vector<OutputLayout::ManifestEntry> entries;
+    for (const BatchJob& job : jobs) {
+      if (!job.error.empty()) continue;
+      const std::filesystem::path& gsflib_path = job.result.gsflib_path;
+      entries.push_back(
+          {job.result.gsflib_shared
+               ? std::filesystem::path{GsflibStore::LibTag(
+                     gsflib_path, options.extract.outdir)}
+               : gsflib_path.lexically_relative(options.extract.outdir),
+           job.game_code, job.path.filename().u8string()});
+    }
+    OutputLayout::RecordInManifest(options.extract.outdir, entries);
+  }
+  if (!options.report.empty()) {
+    std::ofstream file(options.report, std::ios::out | std::ios::binary);
+    file.exceptions(std::ios::badbit | std::ios::failbit);
+    file << report.str();
+  }
+
+  const double elapsed = std::max(seconds, 1e-9);
+  std::cout << "Processed " << jobs.size() << " ROMs ("
+            << std::fixed << std::setprecision(1) << total_size / 1048576.0
+            << " MiB) in " << std::setprecision(3) << seconds << " s with "
+            << pool.size() << " threads: " << std::setprecision(2)
+            << jobs.size() / elapsed << " ROMs/s." << std::defaultfloat
+            << std::endl
+            << std::endl;
+
+  // The busy time of each stage, against the time of its threads. Waiting
+  // for the input means that the previous stage is too slow, and waiting
+  // for the output means that the next stage is. The writers are not a
+  // stage of their own, since each extraction has its own writer for the
+  // time of the ROM.
+  const auto format_seconds = [](double value) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3) << value << " s";
+    return s.str();
+  };
+  const auto format_utilization = [&](double busy, unsigned threads) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(1)
+      << busy * 100 / (elapsed * threads) << "%";
+    return s.str();
+  };
+  const std::vector<std::string> stage_header{
+      "Stage", "Threads", "Busy", "Utilization", "Waited for input",
+      "Waited for output"};
+  const std::vector<std::vector<std::string>> stages{
+      {"read", std::to_string(num_read_threads), format_seconds(load_seconds),
+       format_utilization(load_seconds, num_read_threads),
+       format_seconds(budget_wait_nanoseconds / 1e9) + " (memory)",
+       format_seconds(loaded.push_wait_seconds())},
+      {"extract", std::to_string(pool.size()),
+       format_seconds(pool.busy_seconds()),
+       format_utilization(pool.busy_seconds(), pool.size()),
+       format_seconds(loaded.pop_wait_seconds()),
+       format_seconds(write_wait_seconds) + " (writers)"}};
+  tabulate(std::cout, stage_header, stages);
+  std::cout << std::endl
+            << "The analysis of the ROMs took "
+            << format_seconds(analyze_seconds) << " of the extract stage."
+            << std::endl
+            << "The files of each ROM were written by a writer of its own "
+            << "with " << std::max(options.extract.num_io_threads, 1u)
+            << " I/O thread(s), busy for " << format_seconds(write_busy_seconds)
+            << " in total." << std::endl;
+  std::cout << "Peak memory estimate: " << std::fixed << std::setprecision(1)
+            << budget.peak() / 1048576.0 << " MiB";
+  if (budget.limit() != 0) {
+    std::cout << " (budget " << budget.limit() / 1048576.0 << " MiB)";
+  }
+  std::cout << "." << std::defaultfloat << std::endl;
+  if (num_shared != 0) {
+    std::cout << "Shared gsflibs: " << num_shared << " (" << num_reused
+              << " reused)." << std::endl;
+  }
+  if (num_errors != 0) {
+    std::ostringstream message;
+    message << num_errors << " of " << jobs.size()
+            << " ROMs could not be processed.";
+    throw std::runtime_error(message.str());
+  }
+}
+
+void Gaxtapper::Inspect(const Cartridge& cartridge,
+                        const std::filesystem::path& inspect_cache) {
+  const GaxDriverParam param = InspectRom(cartridge.rom(), inspect_cache);
   const std::vector<GaxMusicEntry> & songs = param.songs();
 
   std::cout << "Status: " << (param.ok() ? "OK" : "FAILED") << std::endl
@@ -156,9 +1115,228 @@ void Gaxtapper::Inspect(const Cartridge& cartridge) {
   }
 }
 
+void Gaxtapper::Benchmark(const Cartridge& cartridge, double seconds,
+                          const std::vector<ZlibProfile>& profiles) {
+  if (seconds <= 0) {
+    if (!profiles.empty()) BenchmarkCompression(cartridge.rom(), profiles);
+    return;
+  }
+
+  const GaxDriverParam param = GaxDriver::Inspect(cartridge.rom());
+  if (!param.ok()) {
+    std::ostringstream message;
+    message << "Identification of GAX Sound Engine is incomplete."
+            << std::endl
+            << std::endl;
+    (void)param.WriteAsTable(message);
+    throw std::runtime_error(message.str());
+  }
+
+  const agbptr_t driver_address = DefaultDriverAddress(cartridge, param);
+  const agbptr_t minigsf_address =
+      GaxDriver::minigsf_address(driver_address, param.version());
+  const std::optional<GaxSongParam> fx = FindFx(param);
+
+  std::vector<std::string> names;
+  std::vector<std::string> minigsfs;
+  for (const GaxMusicEntry& song : param.songs()) {
+    if (song.num_channels() == 0) continue;
+    GaxMinigsfDriverParam minigsf{minigsf_address, GaxSongParam::Of(song)};
+    minigsf.set_fx(fx);
+    names.push_back(
+        GetMinigsfFilename(song, cartridge.full_game_code()).stem().string());
+    minigsfs.push_back(GaxDriver::NewMinigsfData(minigsf));
+  }
+
+  std::vector<GaxDriverLoad> loads[2];
+  for (const bool lean : {false, true}) {
+    std::string rom{cartridge.rom()};
+    GaxDriver::InstallGsfDriver(rom, driver_address, agbnullptr, 0x2000, param,
+                                lean);
+    loads[lean] = GaxBenchmark::MeasureDriverLoad(rom, minigsf_address,
+                                                  minigsfs, seconds);
+  }
+
+  const auto format_load = [](const GaxDriverLoad& load) {
+    if (!load.ok) return std::string{"stopped"};
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(0) << load.cycles_per_second() << " ("
+      << std::setprecision(1)
+      << load.cycles_per_second() * 100 / AgbEmulator::kCpuClock << "%)";
+    return s.str();
+  };
+
+  using row_t = std::vector<std::string>;
+  const row_t header{"Song", "Standard", "Lean", "Saved"};
+  std::vector<row_t> items;
+  // The songs that have stopped with either driver are left out of the
+  // average, so that both drivers are compared on the same songs.
+  GaxDriverLoad totals[2];
+  std::size_t num_stopped = 0;
+  for (std::size_t i = 0; i < minigsfs.size(); i++) {
+    const bool ok = loads[0][i].ok && loads[1][i].ok;
+    std::ostringstream saved;
+    const double standard = loads[0][i].cycles_per_second();
+    if (ok && standard > 0) {
+      saved << std::fixed << std::setprecision(2)
+            << (standard - loads[1][i].cycles_per_second()) * 100 / standard
+            << "%";
+    }
+    items.push_back(row_t{names[i], format_load(loads[0][i]),
+                          format_load(loads[1][i]), saved.str()});
+
+    if (!ok) {
+      num_stopped++;
+      continue;
+    }
+    for (const bool lean : {false, true}) {
+      totals[lean].active_cycles += loads[lean][i].active_cycles;
+      totals[lean].seconds += loads[lean][i].seconds;
+      totals[lean].ok = true;
+    }
+  }
+
+  std::cout << "CPU cycles per second of audio (" << seconds
+            << " seconds per song):" << std::endl
+            << std::endl;
+  tabulate(std::cout, header, items);
+  if (totals[0].seconds > 0) {
+    std::cout << std::endl
+              << "Average: " << format_load(totals[0]) << " -> "
+              << format_load(totals[1]) << std::endl;
+  }
+  if (num_stopped != 0) {
+    std::cout << std::endl
+              << num_stopped << " of " << minigsfs.size()
+              << " songs have stopped and are not in the average."
+              << std::endl;
+  }
+
+  if (!profiles.empty()) {
+    std::cout << std::endl;
+    BenchmarkCompression(cartridge.rom(), profiles);
+  }
+}
+
+void Gaxtapper::Retag(const std::vector<std::filesystem::path>& paths,
+                      const TagOptions& options) {
+  // Tag names are case-insensitive in PSF.
+  const auto find_tag = [](std::map<std::string, std::string>& tags,
+                           std::string_view name) {
+    return std::find_if(tags.begin(), tags.end(), [&](const auto& tag) {
+      return std::equal(tag.first.begin(), tag.first.end(), name.begin(),
+                        name.end(), [](char a, char b) {
+                          return std::tolower(static_cast<unsigned char>(a)) ==
+                                 std::tolower(static_cast<unsigned char>(b));
+                        });
+    });
+  };
+
+  std::vector<std::string> outputs(paths.size());
+  std::vector<std::string> errors(paths.size());
+  std::atomic<std::size_t> num_changed{0};
+  ParallelFor(
+      paths.size(),
+      [&](std::size_t index, unsigned) {
+        const std::filesystem::path& path = paths[index];
+        try {
+          PsfReader psf = PsfReader::LoadFromFile(path);
+          if (options.set.empty()) {
+            std::ostringstream output;
+            output << "# " << path.string() << std::endl;
+            for (const auto& [name, value] : psf.tags()) {
+              std::istringstream value_reader{value};
+              std::string line;
+              while (std::getline(value_reader, line))
+                output << name << '=' << line << std::endl;
+            }
+            outputs[index] = output.str();
+            return;
+          }
+
+          std::map<std::string, std::string> tags = psf.tags();
+          for (const auto& [name, value] : options.set) {
+            const auto it = find_tag(tags, name);
+            if (it != tags.end()) tags.erase(it);
+            if (!value.empty()) tags[name] = value;
+          }
+          if (tags == psf.tags()) return;
+
+          PsfWriter::ReplaceTags(path, psf.tag_offset(), tags,
+                                 options.atomic);
+          num_changed++;
+        } catch (const std::exception& e) {
+          errors[index] = e.what();
+        }
+      },
+      options.num_threads);
+
+  std::size_t num_errors = 0;
+  for (std::size_t i = 0; i < paths.size(); i++) {
+    std::cout << outputs[i];
+    if (!errors[i].empty()) {
+      std::cerr << errors[i] << std::endl;
+      num_errors++;
+    }
+  }
+
+  if (!options.set.empty()) {
+    std::cout << "Retagged " << num_changed << " of " << paths.size()
+              << " files." << std::endl;
+  }
+  if (num_errors != 0) {
+    std::ostringstream message;
+    message << num_errors << " of " << paths.size()
+            << " files could not be processed.";
+    throw std::runtime_error(message.str());
+  }
+}
+
+void Gaxtapper::Verify(const std::vector<std::filesystem::path>& paths,
+                       const VerifyOptions& options) {
+  const std::vector<std::filesystem::path> files =
+      CollectFiles(paths, GsfVerifier::IsGsfPath);
+
+  GsfVerifier verifier{options.deep};
+  std::vector<GsfVerifyResult> results(files.size());
+  const auto start = std::chrono::steady_clock::now();
+  ParallelFor(
+      files.size(),
+      [&](std::size_t index, unsigned) {
+        results[index] = verifier.Verify(files[index]);
+      },
+      options.num_threads);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  std::uintmax_t total_size = 0;
+  std::size_t num_errors = 0;
+  for (const GsfVerifyResult& result : results) {
+    total_size += result.size;
+    for (const std::string& problem : result.problems)
+      std::cerr << problem << std::endl;
+    if (!result.ok()) num_errors++;
+  }
+
+  const double elapsed = std::max(seconds, 1e-9);
+  std::cout << "Verified " << files.size() << " files ("
+            << std::fixed << std::setprecision(1) << total_size / 1048576.0
+            << " MiB) in " << std::setprecision(3) << seconds << " s: "
+            << std::setprecision(1) << total_size / 1048576.0 / elapsed
+            << " MiB/s, " << std::setprecision(0) << files.size() / elapsed
+            << " files/s." << std::defaultfloat << std::endl;
+  if (num_errors != 0) {
+    std::ostringstream message;
+    message << num_errors << " of " << files.size() << " files have problems.";
+    throw std::runtime_error(message.str());
+  }
+}
+
 void Gaxtapper::InspectSimple(const Cartridge& cartridge,
-                              std::string_view name) {
-  if (const GaxDriverParam param = GaxDriver::Inspect(cartridge.rom());
+                              std::string_view name,
+                              const std::filesystem::path& inspect_cache) {
+  if (const GaxDriverParam param = InspectRom(cartridge.rom(), inspect_cache);
       !param.version_text().empty()) {
     std::cout << std::left << std::setw(39) << param.version_text() << " "
               << std::left << std::setw(12) << cartridge.game_title() << " "
@@ -3,24 +3,215 @@
 #ifndef GAXTAPPER_GAXTAPPER_HPP_
 #define GAXTAPPER_GAXTAPPER_HPP_
 
+#include <cstddef>
 #include <filesystem>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "async_file_writer.hpp"
 #include "cartridge.hpp"
+#include "gax_playback_settings.hpp"
+#include "gax_song_timer.hpp"
+#include "output_layout.hpp"
+#include "zlib_compressor.hpp"
 
 namespace gaxtapper {
 
 class GaxMusicEntry;
 
+// Options of Gaxtapper::ConvertToGsfSet.
+struct GsfSetOptions {
+  agbptr_t driver_address = agbnullptr;
+  agbptr_t work_address = agbnullptr;
+  agbsize_t work_size = 0x2000;
+  // Finds the RAM used by GAX and places the work area in a free IWRAM hole.
+  bool auto_work_address = false;
+  // Installs the driver with the lean interrupt handler.
+  bool lean_driver = false;
+  std::filesystem::path outdir;
+  // Places the set in a subdirectory of outdir (see OutputLayout), and
+  // records it in the manifest with the name of the ROM file.
+  OutputLayout layout;
+  std::string rom_name;
+  // The caller has created the output directories (outdir with the layout,
+  // lib_store and block_cache), as Batch does for all the ROMs at once, so
+  // that they are not created again for the set.
+  bool directories_created = false;
+  // Writes the files into a zip or tar archive instead of the output
+  // directory ("-" writes a tar to the standard output).
+  std::filesystem::path archive;
+  std::string gsfby;
+  // Mixing rate and volume of the minigsfs.
+  GaxPlaybackSettings playback;
+  // The compression of the gsflib. The minigsfs are small enough for the
+  // tiny encoder of ZlibCompressor, which does not depend on the profile.
+  ZlibProfile compression = ZlibProfile::kDefault;
+  // The number of threads that write the files (0 = all cores). The output
+  // does not depend on it.
+  unsigned num_threads = 0;
+  // The files are written by dedicated threads, while the next files are
+  // compressed. The compressed files waiting to be written take up to
+  // io_queue_size bytes.
+  unsigned num_io_threads = 1;
+  std::size_t io_queue_size = AsyncFileWriter::kDefaultQueueSize;
+  // When the files are flushed to the storage device (see SyncPolicy).
+  SyncPolicy sync = SyncPolicy::kNone;
+  // Shares the gsflib through a GsflibStore in this directory, instead of
+  // writing it beside the minigsfs. Not used for an archive.
+  std::filesystem::path lib_store;
+  // Keeps the compressed blocks of the gsflib in this directory, so that
+  // extracting the ROM again with other driver options only compresses the
+  // blocks that have changed (see ZlibBlockCache).
+  std::filesystem::path block_cache;
+  // Keeps the driver parameters found in the ROM in this directory, so that
+  // the ROM is searched for the driver only once (see InspectionCache).
+  std::filesystem::path inspect_cache;
+  // Writes every file, even if the sidecar hashes show that the file has
+  // not changed since the last run.
+  bool force = false;
+
+  // Prints the details of the processing, such as the compression ratio of
+  // each region of the gsflib.
+  bool verbose = false;
+  // Receive the messages and the warnings instead of the standard output and
+  // the standard error, when not null.
+  std::ostream* log = nullptr;
+  std::ostream* warnings = nullptr;
+
+  // Play time for the ROM optimization in seconds (0 = no optimization).
+  double optimize_seconds = 0.0;
+
+  // Maximum play time for the song timing in seconds (0 = no timing).
+  double timing_seconds = 0.0;
+  int loop_count = GaxSongTimer::kDefaultLoopCount;
+  double fade_seconds = GaxSongTimer::kDefaultFadeSeconds;
+};
+
+// The outcome of Gaxtapper::ConvertToGsfSet.
+struct GsfSetResult {
+  std::size_t num_files = 0;
+  std::size_t num_written = 0;
+  // The files left as they are, since they have not changed.
+  std::size_t num_skipped = 0;
+  std::filesystem::path gsflib_path;
+  // The gsflib is in the store, and was already there before.
+  bool gsflib_shared = false;
+  bool gsflib_reused = false;
+  // The time of the stages: the analysis of the ROM (with the timing and
+  // the optimization), the compression (until the last file is queued), the
+  // writing (summed over the I/O threads), and the time that the compression
+  // waited for room in the queue of the writer.
+  double analyze_seconds = 0.0;
+  double compress_seconds = 0.0;
+  double write_busy_seconds = 0.0;
+  double write_wait_seconds = 0.0;
+};
+
+// A file of a GSF set built in memory.
+struct GsfSetFile {
+  std::string filename;  // UTF-8
+  std::string data;      // the whole PSF file
+  std::map<std::string, std::string> tags;
+  // The song of a minigsf (agbnullptr for the gsflib).
+  agbptr_t song_address = agbnullptr;
+};
+
+// A GSF set built in memory by Gaxtapper::BuildGsfSet, with the parameters
+// that were found or chosen for the ROM.
+struct GsfSet {
+  std::string game_title;
+  std::string game_code;  // AGB-XXXX-XXX
+  std::string gax_version;
+  agbptr_t driver_address = agbnullptr;
+  agbptr_t work_address = agbnullptr;
+  agbptr_t minigsf_address = agbnullptr;
+  agbsize_t gsflib_size = 0;
+  GsfSetFile gsflib;
+  std::vector<GsfSetFile> minigsfs;
+  // The messages and the warnings that the extract command prints.
+  std::string log;
+  std::vector<std::string> warnings;
+};
+
+// Options of Gaxtapper::Batch.
+struct BatchOptions {
+  // The extraction of each ROM. The set of a ROM is written into a
+  // directory of extract.outdir named after the ROM file, which is placed
+  // in the subdirectory of extract.layout if it is given. The manifest of
+  // the layout is written once, after all the ROMs. The archive is not
+  // supported.
+  GsfSetOptions extract;
+  // The number of threads shared by all the ROMs (0 = all cores).
+  unsigned num_threads = 0;
+  // The estimated memory of the ROMs in flight, in bytes (0 = no limit).
+  // The ROMs wait to be started while the budget is used up.
+  std::size_t max_memory = 0;
+  // The threads that read the ROMs, and the number of ROMs that are read
+  // ahead of the extraction (0 = the number of threads).
+  unsigned num_read_threads = 1;
+  std::size_t read_ahead = 0;
+  // Writes the report (a line for each ROM in the order of the input, which
+  // does not depend on the scheduling) to the file.
+  std::filesystem::path report;
+};
+
+// Options of Gaxtapper::Retag.
+struct TagOptions {
+  // Tags to be set. An empty value removes the tag.
+  std::map<std::string, std::string> set;
+  // Writes a new file and renames it, instead of rewriting the tags in place.
+  bool atomic = false;
+  unsigned num_threads = 0;
+};
+
+// Options of Gaxtapper::Verify.
+struct VerifyOptions {
+  // Inflates the whole exe of each file (see GsfVerifier).
+  bool deep = false;
+  unsigned num_threads = 0;
+};
+
 class Gaxtapper {
  public:
-  static void ConvertToGsfSet(Cartridge& cartridge,
-                              const std::filesystem::path& basename,
-                              agbptr_t driver_address = agbnullptr,
-                              agbptr_t work_address = agbnullptr,
-                              agbsize_t work_size = 0x2000,
-                              const std::filesystem::path& outdir = "",
-                              const std::string_view& gsfby = "");
-  static void Inspect(const Cartridge& cartridge);
-  static void InspectSimple(const Cartridge& cartridge, std::string_view name);
+  static GsfSetResult ConvertToGsfSet(Cartridge& cartridge,
+                                      const std::filesystem::path& basename,
+                                      const GsfSetOptions& options = {});
+  // Builds the GSF set of a ROM image in memory, without reading or writing
+  // any file and without printing anything. The options of the output
+  // (outdir, layout, archive, lib_store, block_cache, force, sync and the
+  // I/O threads) are ignored. It can be called for several ROMs at the same
+  // time from different threads.
+  static GsfSet BuildGsfSet(std::string_view rom, const std::string& basename,
+                            const GsfSetOptions& options = {});
+  // Extracts the GSF sets of many ROMs at once. A directory is searched
+  // recursively for ROM files. The phases of the ROMs run as tasks of a
+  // TaskPool, the largest ROM first, and the messages of each ROM are
+  // printed in the order of the input. Throws std::runtime_error if a ROM
+  // fails, after all the others have been processed.
+  static void Batch(const std::vector<std::filesystem::path>& paths,
+                    const BatchOptions& options);
+  // Uses the InspectionCache in inspect_cache if it is not empty.
+  static void Inspect(const Cartridge& cartridge,
+                      const std::filesystem::path& inspect_cache = {});
+  // Compares the CPU cycles per second of audio of the standard driver and
+  // the lean driver, by playing each song for the given time (0 = skip).
+  // Also measures the size and the time of compressing the ROM with each of
+  // the profiles.
+  static void Benchmark(const Cartridge& cartridge, double seconds,
+                        const std::vector<ZlibProfile>& profiles = {});
+  // Changes the tags of PSF files without recompressing the exe. Prints the
+  // tags of each file instead if there is nothing to set.
+  static void Retag(const std::vector<std::filesystem::path>& paths,
+                    const TagOptions& options);
+  // Checks GSF files for truncation and corruption, and prints the problems
+  // and the throughput. A directory is searched recursively for GSF files.
+  // Throws std::runtime_error if a file has a problem.
+  static void Verify(const std::vector<std::filesystem::path>& paths,
+                     const VerifyOptions& options);
+  static void InspectSimple(const Cartridge& cartridge, std::string_view name,
+                            const std::filesystem::path& inspect_cache = {});
   static std::filesystem::path GetMinigsfFilename(
       const GaxMusicEntry& song, const std::filesystem::path& default_name);
 };
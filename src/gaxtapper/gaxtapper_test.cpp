@@ -0,0 +1,220 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gaxtapper.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "arm.hpp"
+#include "bytes.hpp"
+#include "cartridge.hpp"
+#include "gax_driver.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbptr_t kEntrypoint = 0x8001000;
+
+// Writes a GAX 3 song header at the offset, with one channel whose sequence
+// at seq_offset is preceded by the info text.
+void WriteSong(std::string& rom, agbsize_t offset, agbsize_t seq_offset,
+               std::string_view info) {
+  WriteInt16L(&rom[offset], 1);                 // channels
+  WriteInt16L(&rom[offset + 2], 0x40);          // rows per pattern
+  WriteInt16L(&rom[offset + 4], 1);             // patterns per channel
+  WriteInt16L(&rom[offset + 8], 0x100);         // volume
+  WriteInt32L(&rom[offset + 0xc], 0x8009000);   // notes
+  WriteInt32L(&rom[offset + 0x10], 0x8009100);  // instruments
+  WriteInt32L(&rom[offset + 0x14], 0x8009200);  // samples
+  WriteInt16L(&rom[offset + 0x18], 15769);      // mixing rate
+  WriteInt32L(&rom[offset + 0x20], to_romptr(seq_offset));
+  rom.replace(seq_offset - info.size(), info.size(), info);
+}
+
+// A ROM that GaxDriver::Inspect takes for GAX 3.05: the version text, the
+// function prologues that it searches for, two songs and the sound effects.
+// None of it is run, since the set is built without the optimization and
+// the timing.
+std::string MakeRom() {
+  std::string rom(0x10000, '\0');
+  WriteInt32L(&rom[0], make_arm_b(0x8000000, kEntrypoint));
+  rom.replace(0xa0, 9, "SYNTHETIC");
+  rom.replace(0xac, 4, "AGXE");
+
+  const std::string_view version{"GAX Sound Engine v3.05 \xa9 Shin'en"};
+  rom.replace(0x3000, version.size(), version);
+
+  using namespace std::string_view_literals;
+  const std::string_view prologues[] = {
+      "\xf0\xb5\x57\x46\x4e\x46\x45\x46\xe0\xb4\x82\xb0\x07\x1c\x00\x24\x00\x20\x00\x90"sv,
+      "\xf0\xb5\x47\x46\x80\xb4\x81\xb0\x06\x1c\x00\x2e"sv,
+      "\xf0\xb5\x57\x46\x4e\x46\x45\x46\xe0\xb4\x81\xb0\x07\x1c\x00\x26\x0e\x48\x39\x68"sv,
+      "\xf0\xb5\x3b\x48\x02\x68\x11\x68\x3a\x48\x81\x42\x6d\xd1\x50\x6d\x00\x28\x6a\xd0\x50\x6d\x01\x28\x1a\xd1\x02\x20\x50\x65\x36\x49"sv,
+      "\x70\xb5\x81\xb0\x47\x48\x01\x68\x48\x6d\x00\x28\x00\xd1"sv,
+  };
+  agbsize_t offset = 0x4000;
+  for (const std::string_view prologue : prologues) {
+    rom.replace(offset, prologue.size(), prologue);
+    offset += 0x100;
+  }
+
+  WriteSong(rom, 0x8000, 0x9400, "\"Title Theme\" \xa9 Artist");
+  WriteSong(rom, 0x8100, 0x9800, "\"Boss\"");
+  // The sound effects: no channels and no notes.
+  WriteInt32L(&rom[0x8200 + 0x10], 0x8009100);
+  WriteInt32L(&rom[0x8200 + 0x14], 0x8009200);
+  WriteInt32L(&rom[0x9100], 0x8009000);
+  WriteInt32L(&rom[0x9200], 0x8009000);
+  return rom;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  return {std::istreambuf_iterator<char>(stream),
+          std::istreambuf_iterator<char>()};
+}
+
+// The set built in memory is the same as the files that the extraction
+// writes with the same options.
+void TestSameAsExtraction(const std::string& rom, GsfSetOptions options) {
+  options.compression = ZlibProfile::kFast;
+  const GsfSet set = Gaxtapper::BuildGsfSet(rom, "synthetic", options);
+  EXPECT(set.game_title == "SYNTHETIC");
+  EXPECT(set.game_code == "AGB-AGXE-USA");
+  EXPECT(set.gax_version == "GAX Sound Engine v3.05");
+  // The driver goes at the end of the ROM, unless it is given.
+  EXPECT(set.driver_address ==
+         (options.driver_address != agbnullptr
+              ? options.driver_address
+              : to_romptr(static_cast<agbsize_t>(rom.size()) -
+                          GaxDriver::gsf_driver_size(GaxVersion{3, 5}))));
+  EXPECT(set.gsflib_size == rom.size());
+  EXPECT(set.warnings.empty());
+  EXPECT(set.gsflib.filename == "synthetic.gsflib");
+  EXPECT(set.minigsfs.size() == 2);
+  if (set.minigsfs.size() != 2) return;
+  EXPECT(set.minigsfs[0].filename == "Title Theme.minigsf");
+  EXPECT(set.minigsfs[0].song_address == 0x8008000);
+  EXPECT(set.minigsfs[0].tags.at("artist") == "Artist");
+  EXPECT(set.minigsfs[1].filename == "Boss.minigsf");
+  EXPECT(set.minigsfs[1].song_address == 0x8008100);
+
+  const testing::TemporaryDirectory outdir;
+  std::ostringstream log;
+  options.outdir = outdir.path();
+  options.log = &log;
+  Cartridge cartridge = Cartridge::LoadFromMemory(rom);
+  const GsfSetResult result =
+      Gaxtapper::ConvertToGsfSet(cartridge, "synthetic", options);
+  EXPECT(result.num_written == 3);
+  EXPECT(ReadFile(outdir.path() / set.gsflib.filename) == set.gsflib.data);
+  for (const GsfSetFile& minigsf : set.minigsfs)
+    EXPECT(ReadFile(outdir.path() / minigsf.filename) == minigsf.data);
+}
+
+void TestThreads(const std::string& rom) {
+  GsfSetOptions options;
+  options.compression = ZlibProfile::kFast;
+  GsfSet sets[2];
+  std::thread thread{
+      [&] { sets[0] = Gaxtapper::BuildGsfSet(rom, "synthetic", options); }};
+  sets[1] = Gaxtapper::BuildGsfSet(rom, "synthetic", options);
+  thread.join();
+  EXPECT(sets[0].gsflib.data == sets[1].gsflib.data);
+  EXPECT(sets[0].minigsfs.size() == sets[1].minigsfs.size());
+}
+
+void WriteFile(const std::filesystem::path& path, std::string_view data) {
+  std::ofstream stream(path, std::ios::out | std::ios::binary);
+  stream << data;
+}
+
+// Runs a batch, which fails for the broken ROM, and returns the report.
+std::string RunBatch(const std::vector<std::filesystem::path>& paths,
+                     const std::filesystem::path& outdir,
+                     BatchOptions options) {
+  options.extract.outdir = outdir;
+  options.extract.compression = ZlibProfile::kFast;
+  options.report = outdir / "report.tsv";
+  EXPECT_THROW(Gaxtapper::Batch(paths, options), std::runtime_error);
+  return ReadFile(options.report);
+}
+
+// The report has a line for each ROM in the order of the input, whatever
+// the number of threads and the memory budget.
+void TestBatchReport(const std::string& rom) {
+  const testing::TemporaryDirectory directory;
+  const std::filesystem::path roms = directory.path() / "roms";
+  std::filesystem::create_directories(roms / "sub");
+  std::string other = rom;
+  other.replace(0xac, 4, "AGXP");
+  WriteFile(roms / "b.gba", rom);
+  WriteFile(roms / "a.gba", other);
+  WriteFile(roms / "sub" / "a.gba", rom);
+  WriteFile(directory.path() / "broken.gba", std::string(0x1000, '\0'));
+  const std::vector<std::filesystem::path> paths{
+      directory.path() / "broken.gba", roms};
+
+  const auto line = [](const std::filesystem::path& path,
+                       std::string_view game_code, std::string_view status) {
+    return path.generic_u8string() + "\t" + std::string{game_code} + "\t" +
+           std::string{status} + "\n";
+  };
+  const auto expected = [&](std::string_view status) {
+    return "rom\tgame_code\tstatus\tfiles\twritten\tskipped\tgsflib\n" +
+           line(directory.path() / "broken.gba", "AGB-", "failed\t0\t0\t0\t-") +
+           line(roms / "a.gba", "AGB-AGXP-EUR", status) +
+           line(roms / "b.gba", "AGB-AGXE-USA", status) +
+           line(roms / "sub" / "a.gba", "AGB-AGXE-USA", status);
+  };
+
+  BatchOptions options;
+  options.num_threads = 1;
+  const std::filesystem::path outdir = directory.path() / "out";
+  EXPECT(RunBatch(paths, outdir, options) == expected("ok\t3\t3\t0\tlocal"));
+  // The ROMs of the same name get their own directories.
+  EXPECT(std::filesystem::exists(outdir / "a" / "AGB-AGXP-EUR.gsflib"));
+  EXPECT(std::filesystem::exists(outdir / "a-2" / "AGB-AGXE-USA.gsflib"));
+  EXPECT(!std::filesystem::exists(outdir / "broken"));
+
+  // The files have not changed, so they are skipped.
+  EXPECT(RunBatch(paths, outdir, options) == expected("ok\t3\t0\t3\tlocal"));
+
+  // A budget smaller than any ROM runs them one at a time.
+  options.num_threads = 2;
+  options.num_read_threads = 2;
+  options.max_memory = 1;
+  EXPECT(RunBatch(paths, directory.path() / "out2", options) ==
+         expected("ok\t3\t3\t0\tlocal"));
+}
+
+}  // namespace
+
+int main() {
+  const std::string rom = MakeRom();
+
+  TestSameAsExtraction(rom, {});
+  GsfSetOptions options;
+  options.driver_address = 0x8000800;
+  options.work_address = 0x2000000;
+  options.lean_driver = true;
+  options.gsfby = "Gaxtapper";
+  options.playback.set_mixing_rate(13380);
+  TestSameAsExtraction(rom, options);
+  TestThreads(rom);
+  TestBatchReport(rom);
+
+  // A ROM without GAX is refused.
+  EXPECT_THROW((void)Gaxtapper::BuildGsfSet(std::string(0x1000, '\0'), "x"),
+               std::runtime_error);
+  return testing::num_failures != 0;
+}
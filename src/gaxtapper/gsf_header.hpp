@@ -13,6 +13,8 @@ class GsfHeader {
  public:
   using size_type = agbsize_t;
 
+  static constexpr size_type kSize = 12;
+
   GsfHeader() : entrypoint_{0}, load_offset_{0}, load_size_{0} {};
 
   GsfHeader(agbptr_t entrypoint, agbptr_t load_offset, agbsize_t load_size)
@@ -27,9 +29,13 @@ class GsfHeader {
   [[nodiscard]] agbptr_t load_offset() const noexcept { return load_offset_; }
   [[nodiscard]] agbptr_t load_size() const noexcept { return load_size_; }
 
- private:
-  static constexpr size_type kSize = 12;
+  // Reads the header from the first kSize bytes of an exe.
+  [[nodiscard]] static GsfHeader Parse(const char* data) {
+    return GsfHeader{ReadInt32L(&data[0]), ReadInt32L(&data[4]),
+                     ReadInt32L(&data[8])};
+  }
 
+ private:
   std::string str_;
   agbptr_t entrypoint_;
   agbptr_t load_offset_;
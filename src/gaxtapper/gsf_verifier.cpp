@@ -0,0 +1,193 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gsf_verifier.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include "bytes.hpp"
+#include "gax_driver.hpp"
+#include "gsf_header.hpp"
+#include "psf_reader.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+// Reads the PSF header and the GSF header of the file, and checks them.
+// Returns false with the problem if the file cannot be loaded by a player.
+bool ReadGsf(PsfReader& psf, std::size_t exe_size, GsfHeader& header,
+             std::string& problem) {
+  if (psf.version() != GsfVerifier::kGsfVersion) {
+    std::ostringstream message;
+    message << "Not a GSF file (version 0x" << std::hex << std::setfill('0')
+            << std::setw(2) << +psf.version() << ")";
+    problem = message.str();
+    return false;
+  }
+  if (!psf.VerifyCrc32()) {
+    problem = "The crc32 of the compressed exe does not match";
+    return false;
+  }
+
+  try {
+    const std::string& exe = psf.Exe(exe_size);
+    if (exe.size() < GsfHeader::kSize) {
+      problem = "The exe is shorter than the GSF header";
+      return false;
+    }
+    header = GsfHeader::Parse(exe.data());
+  } catch (const std::runtime_error& e) {
+    problem = e.what();
+    return false;
+  }
+
+  const agbptr_t first = header.load_offset();
+  const agbptr_t last = first + std::max<agbsize_t>(header.load_size(), 1) - 1;
+  const bool in_rom = is_romptr(first) && is_romptr(last) && last >= first;
+  const bool in_ewram = is_ewramptr(first) && is_ewramptr(last);
+  if (!in_rom && !in_ewram) {
+    problem = "The load range " + to_string(first) + "-" +
+              to_string(last) + " is outside ROM and EWRAM";
+    return false;
+  }
+  return true;
+}
+
+bool Contains(agbptr_t offset, agbsize_t size, agbptr_t address) noexcept {
+  return address >= offset && address - offset < size;
+}
+
+}  // namespace
+
+GsfVerifyResult GsfVerifier::Verify(const std::filesystem::path& path) {
+  GsfVerifyResult result;
+  PsfReader psf;
+  try {
+    psf = PsfReader::MapFile(path);
+  } catch (const std::runtime_error& e) {
+    result.problems.push_back(e.what());
+    return result;
+  }
+  std::error_code error;
+  result.size = std::filesystem::file_size(path, error);
+
+  // A GAX minigsf has the parameters of the song after the GSF header.
+  GsfHeader header;
+  std::string problem;
+  if (!ReadGsf(psf,
+               deep_ ? PsfReader::kWholeExe
+                     : GsfHeader::kSize + GaxDriver::kMinigsfParamSize,
+               header, problem)) {
+    result.problems.push_back(path.string() + ": " + problem);
+    return result;
+  }
+  if (deep_ && psf.Exe().size() != GsfHeader::kSize + header.load_size()) {
+    std::ostringstream message;
+    message << path.string() << ": The exe has "
+            << psf.Exe().size() - GsfHeader::kSize
+            << " bytes, while the GSF header says " << header.load_size();
+    result.problems.push_back(message.str());
+  }
+
+  std::vector<const Library*> libraries;
+  for (const auto& [name, value] : psf.tags()) {
+    std::string lower{name};
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) {
+      return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+    if (lower.compare(0, 4, "_lib") != 0) continue;
+
+    const Library& library =
+        LoadLibrary(path.parent_path() / std::filesystem::u8path(value));
+    if (!library.problem.empty()) {
+      result.problems.push_back(path.string() + ": " + name + "=" + value +
+                                ": " + library.problem);
+      continue;
+    }
+    libraries.push_back(&library);
+  }
+
+  // The parameters have been inflated by ReadGsf, and a shallow check does
+  // not inflate the rest of the exe, which is large for a gsflib.
+  const std::string& exe =
+      psf.Exe(GsfHeader::kSize + GaxDriver::kMinigsfParamSize);
+  if (!libraries.empty() && header.load_size() == GaxDriver::kMinigsfParamSize &&
+      exe.size() >= GsfHeader::kSize + GaxDriver::kMinigsfParamSize) {
+    const char* const param = &exe[GsfHeader::kSize];
+    const agbptr_t song = ReadInt32L(
+        &param[GaxDriver::kMinigsfParamMyMusicOffset]);
+    const agbptr_t fx = ReadInt32L(&param[GaxDriver::kMinigsfParamMyFxOffset]);
+    for (const auto& [name, address] : {std::pair{"song", song},
+                                        std::pair{"fx", fx}}) {
+      if (address == 0) continue;
+      if (std::none_of(libraries.begin(), libraries.end(),
+                       [address = address](const Library* library) {
+                         return Contains(library->load_offset,
+                                         library->load_size, address);
+                       })) {
+        result.problems.push_back(path.string() + ": The " + name +
+                                  " address " + to_string(address) +
+                                  " is outside the libraries");
+      }
+    }
+  }
+  return result;
+}
+
+bool GsfVerifier::IsGsfPath(const std::filesystem::path& path) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](char c) {
+                   return static_cast<char>(
+                       std::tolower(static_cast<unsigned char>(c)));
+                 });
+  return extension == ".gsf" || extension == ".gsflib" ||
+         extension == ".minigsf";
+}
+
+const GsfVerifier::Library& GsfVerifier::LoadLibrary(
+    const std::filesystem::path& path) {
+  std::error_code error;
+  std::filesystem::path key = std::filesystem::weakly_canonical(path, error);
+  if (error) key = path.lexically_normal();
+
+  // The first thread that needs the library reads it, and the others wait
+  // for it.
+  std::promise<Library> promise;
+  std::shared_future<Library> future;
+  bool first = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::shared_future<Library>& entry = libraries_[key];
+    if (!entry.valid()) {
+      entry = promise.get_future().share();
+      first = true;
+    }
+    future = entry;
+  }
+
+  if (first) {
+    Library library;
+    try {
+      PsfReader psf = PsfReader::MapFile(path);
+      GsfHeader header;
+      if (ReadGsf(psf, GsfHeader::kSize, header, library.problem)) {
+        library.load_offset = header.load_offset();
+        library.load_size = header.load_size();
+      }
+    } catch (const std::runtime_error& e) {
+      library.problem = e.what();
+    }
+    promise.set_value(std::move(library));
+  }
+  // The futures in the map live as long as the verifier.
+  return future.get();
+}
+
+}  // namespace gaxtapper
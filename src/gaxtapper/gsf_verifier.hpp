@@ -0,0 +1,66 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GSF_VERIFIER_HPP_
+#define GAXTAPPER_GSF_VERIFIER_HPP_
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// The result of GsfVerifier::Verify.
+struct GsfVerifyResult {
+  std::uintmax_t size = 0;  // file size
+  std::vector<std::string> problems;
+
+  [[nodiscard]] bool ok() const noexcept { return problems.empty(); }
+};
+
+// Checks GSF files (gsf, gsflib and minigsf) for truncation and corruption:
+//
+// - the PSF header, the GSF version and the file size,
+// - the crc32 of the compressed exe,
+// - the GSF header of the exe, whose load range must be in ROM or EWRAM,
+// - the libraries in the _lib tags, which must be readable GSF files,
+// - for a GAX minigsf, the song address, which must be loaded by a library.
+//
+// Only the beginning of the exe is inflated, unless deep is true, which
+// inflates the whole exe and checks its adler32 and size. Verify can be
+// called from several threads; each library is read once.
+class GsfVerifier {
+ public:
+  static constexpr std::uint8_t kGsfVersion = 0x22;
+
+  explicit GsfVerifier(bool deep = false) : deep_(deep) {}
+
+  GsfVerifier(const GsfVerifier&) = delete;
+  GsfVerifier& operator=(const GsfVerifier&) = delete;
+
+  GsfVerifyResult Verify(const std::filesystem::path& path);
+
+  // Returns whether the path has the extension of a GSF file.
+  [[nodiscard]] static bool IsGsfPath(const std::filesystem::path& path);
+
+ private:
+  struct Library {
+    std::string problem;
+    agbptr_t load_offset = agbnullptr;
+    agbsize_t load_size = 0;
+  };
+
+  bool deep_;
+  std::mutex mutex_;
+  std::map<std::filesystem::path, std::shared_future<Library>> libraries_;
+
+  const Library& LoadLibrary(const std::filesystem::path& path);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,95 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gsf_verifier.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "bytes.hpp"
+#include "gax_driver.hpp"
+#include "gsf_header.hpp"
+#include "gsf_writer.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr agbptr_t kGsflibAddress = 0x8000000;
+constexpr agbsize_t kGsflibSize = 0x1000;
+constexpr agbptr_t kMinigsfAddress = 0x8100000;
+
+void SaveMinigsf(const std::filesystem::path& path, agbptr_t song,
+                 const std::string& lib) {
+  std::string param(GaxDriver::kMinigsfParamSize, '\0');
+  WriteInt32L(&param[GaxDriver::kMinigsfParamMyMusicOffset], song);
+  GsfWriter::SaveToFile(
+      path,
+      GsfHeader{kGsflibAddress, kMinigsfAddress,
+                static_cast<agbsize_t>(param.size())},
+      param, {{"_lib", lib}});
+}
+
+bool HasProblem(const GsfVerifyResult& result, const std::string& text) {
+  for (const std::string& problem : result.problems) {
+    if (problem.find(text) != std::string::npos) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  const std::filesystem::path gsflib = directory.path() / "set.gsflib";
+  GsfWriter::SaveToFile(
+      gsflib, GsfHeader{kGsflibAddress, kGsflibAddress, kGsflibSize},
+      std::string(kGsflibSize, '\x11'));
+
+  const std::filesystem::path good = directory.path() / "good.minigsf";
+  SaveMinigsf(good, kGsflibAddress + 0x10, "set.gsflib");
+  const std::filesystem::path outside = directory.path() / "outside.minigsf";
+  SaveMinigsf(outside, kGsflibAddress + kGsflibSize, "set.gsflib");
+  const std::filesystem::path no_lib = directory.path() / "no_lib.minigsf";
+  SaveMinigsf(no_lib, kGsflibAddress + 0x10, "missing.gsflib");
+
+  for (const bool deep : {false, true}) {
+    GsfVerifier verifier{deep};
+    const GsfVerifyResult lib_result = verifier.Verify(gsflib);
+    EXPECT(lib_result.ok());
+    EXPECT(lib_result.size == std::filesystem::file_size(gsflib));
+    EXPECT(verifier.Verify(good).ok());
+    EXPECT(HasProblem(verifier.Verify(outside), "outside the libraries"));
+    EXPECT(!verifier.Verify(no_lib).ok());
+  }
+
+  // A file cut short fails the crc32 of the compressed exe.
+  const std::filesystem::path truncated = directory.path() / "cut.gsflib";
+  std::filesystem::copy_file(gsflib, truncated);
+  std::filesystem::resize_file(truncated,
+                               std::filesystem::file_size(gsflib) - 8);
+  EXPECT(!GsfVerifier{}.Verify(truncated).ok());
+
+  // An exe shorter than its GSF header says is found only by a deep check,
+  // which inflates the whole exe.
+  const std::filesystem::path short_exe = directory.path() / "short.gsf";
+  GsfWriter::SaveToFile(short_exe,
+                        GsfHeader{kGsflibAddress, kGsflibAddress, 0x200},
+                        std::string(0x100, '\x22'));
+  EXPECT(GsfVerifier{false}.Verify(short_exe).ok());
+  EXPECT(HasProblem(GsfVerifier{true}.Verify(short_exe),
+                    "while the GSF header says"));
+
+  // A PSF of another console is not a GSF.
+  const std::filesystem::path other = directory.path() / "other.gsf";
+  {
+    std::ofstream stream(other, std::ios::out | std::ios::binary);
+    stream << std::string{"PSF\x01", 4} << std::string(12, '\0');
+  }
+  EXPECT(HasProblem(GsfVerifier{}.Verify(other), "Not a GSF file"));
+
+  EXPECT(GsfVerifier::IsGsfPath("a.GSFLIB"));
+  EXPECT(GsfVerifier::IsGsfPath("a.minigsf"));
+  EXPECT(!GsfVerifier::IsGsfPath("a.psf"));
+  return testing::num_failures != 0;
+}
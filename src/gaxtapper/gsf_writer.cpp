@@ -14,21 +14,30 @@ namespace gaxtapper {
 
 void GsfWriter::SaveToFile(const std::filesystem::path& path,
                            const GsfHeader& header, std::string_view rom,
-                           std::map<std::string, std::string> tags) {
+                           std::map<std::string, std::string> tags,
+                           const ZlibOptions& options) {
   std::ofstream file(path, std::ios::out | std::ios::binary);
   file.exceptions(std::ios::badbit | std::ios::failbit);
-  SaveToStream(file, header, rom, std::move(tags));
+  SaveToStream(file, header, rom, std::move(tags), options);
   file.close();
 }
 
 void GsfWriter::SaveToStream(std::ostream& out, const GsfHeader& header,
                              std::string_view rom,
-                             std::map<std::string, std::string> tags) {
+                             std::map<std::string, std::string> tags,
+                             const ZlibOptions& options) {
   PsfWriter psf{kVersion, std::move(tags)};
-  auto& exe = psf.exe();
-  exe.write(header.data(), header.size());
-  exe.write(rom.data(), rom.size());
+  psf.SetExe({std::string_view{header.data(), header.size()}, rom}, options);
   psf.SaveToStream(out);
 }
 
+std::string GsfWriter::SaveToString(const GsfHeader& header,
+                                    std::string_view rom,
+                                    std::map<std::string, std::string> tags,
+                                    const ZlibOptions& options) {
+  PsfWriter psf{kVersion, std::move(tags)};
+  psf.SetExe({std::string_view{header.data(), header.size()}, rom}, options);
+  return psf.SaveToString();
+}
+
 }  // namespace gaxtapper
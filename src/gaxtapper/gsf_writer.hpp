@@ -8,6 +8,7 @@
 #include <map>
 #include <string>
 #include "gsf_header.hpp"
+#include "zlib_compressor.hpp"
 
 namespace gaxtapper {
 
@@ -15,11 +16,20 @@ class GsfWriter {
  public:
   static void SaveToFile(const std::filesystem::path& path,
                          const GsfHeader& header, std::string_view rom,
-                         std::map<std::string, std::string> tags = {});
+                         std::map<std::string, std::string> tags = {},
+                         const ZlibOptions& options = {});
 
   static void SaveToStream(std::ostream& out, const GsfHeader& header,
                            std::string_view rom,
-                           std::map<std::string, std::string> tags = {});
+                           std::map<std::string, std::string> tags = {},
+                           const ZlibOptions& options = {});
+
+  // Returns the whole GSF file in a single buffer (see
+  // PsfWriter::SaveToString), which can be moved to the writer.
+  [[nodiscard]] static std::string SaveToString(
+      const GsfHeader& header, std::string_view rom,
+      std::map<std::string, std::string> tags = {},
+      const ZlibOptions& options = {});
 
  private:
   static constexpr std::uint8_t kVersion = 0x22;
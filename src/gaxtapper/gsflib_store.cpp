@@ -0,0 +1,93 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gsflib_store.hpp"
+
+#include <exception>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <system_error>
+#include <utility>
+#include "hash.hpp"
+#include "psf_reader.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+std::string ToHexString(std::uint64_t value, int width) {
+  std::ostringstream s;
+  s << std::hex << std::setfill('0') << std::setw(width) << value;
+  return s.str();
+}
+
+}  // namespace
+
+GsflibStore::GsflibStore(std::filesystem::path directory)
+    : directory_(std::move(directory)) {}
+
+std::uint64_t GsflibStore::HashGsflib(const GsfHeader& header,
+                                      std::string_view rom) {
+  return HashBytes(rom, HashBytes({header.data(), header.size()}));
+}
+
+std::filesystem::path GsflibStore::PathOf(std::uint64_t hash) const {
+  std::filesystem::path path{directory_};
+  path /= ToHexString(hash, 16) + ".gsflib";
+  return path;
+}
+
+bool GsflibStore::Contains(std::uint64_t hash) const {
+  std::error_code error;
+  return std::filesystem::is_regular_file(PathOf(hash), error);
+}
+
+bool GsflibStore::Matches(std::uint64_t hash, const GsfHeader& header,
+                          std::string_view rom) const {
+  try {
+    PsfReader psf = PsfReader::MapFile(PathOf(hash));
+    const std::string& exe = psf.Exe();
+    return exe.size() == header.size() + rom.size() &&
+           std::string_view{exe}.substr(0, header.size()) ==
+               std::string_view{header.data(), header.size()} &&
+           std::string_view{exe}.substr(header.size()) == rom;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+std::filesystem::path GsflibStore::TemporaryPathOf(std::uint64_t hash) const {
+  std::random_device random;
+  std::filesystem::path path{PathOf(hash)};
+  path += "." + ToHexString(random(), 8) + ".tmp";
+  return path;
+}
+
+void GsflibStore::Publish(const std::filesystem::path& temporary_path,
+                          std::uint64_t hash) const {
+  std::error_code error;
+  std::filesystem::rename(temporary_path, PathOf(hash), error);
+  if (!error) return;
+
+  // Windows does not replace an existing file.
+  if (Contains(hash)) {
+    std::filesystem::remove(temporary_path, error);
+    return;
+  }
+  throw std::filesystem::filesystem_error("Unable to add the gsflib",
+                                          temporary_path, PathOf(hash), error);
+}
+
+std::string GsflibStore::LibTag(
+    const std::filesystem::path& gsflib_path,
+    const std::filesystem::path& minigsf_directory) {
+  const std::filesystem::path absolute_path =
+      std::filesystem::absolute(gsflib_path);
+  const std::filesystem::path relative_path = std::filesystem::relative(
+      absolute_path, std::filesystem::absolute(minigsf_directory));
+  // On another drive, there is no relative path.
+  return (relative_path.empty() ? absolute_path : relative_path)
+      .generic_u8string();
+}
+
+}  // namespace gaxtapper
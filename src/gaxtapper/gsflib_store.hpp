@@ -0,0 +1,62 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_GSFLIB_STORE_HPP_
+#define GAXTAPPER_GSFLIB_STORE_HPP_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include "gsf_header.hpp"
+
+namespace gaxtapper {
+
+// A directory of gsflibs named after the hash of their content. The ROMs
+// that produce the same gsflib, such as the ROMs that differ only in the
+// code and data that the optimization removes (the cartridge header is
+// kept), refer to a single gsflib in the store, which is compressed only by
+// the first extraction.
+//
+// A gsflib is written to a temporary file and renamed, so that a file under
+// the final name is always complete, even with concurrent extractions.
+class GsflibStore {
+ public:
+  explicit GsflibStore(std::filesystem::path directory);
+
+  [[nodiscard]] const std::filesystem::path& directory() const noexcept {
+    return directory_;
+  }
+
+  // Returns the key of the gsflib with the header and the patched ROM.
+  [[nodiscard]] static std::uint64_t HashGsflib(const GsfHeader& header,
+                                                std::string_view rom);
+
+  [[nodiscard]] std::filesystem::path PathOf(std::uint64_t hash) const;
+  [[nodiscard]] bool Contains(std::uint64_t hash) const;
+  // Returns whether the gsflib in the store has the header and the ROM, so
+  // that a hit of the hash is not taken for the same gsflib by mistake.
+  [[nodiscard]] bool Matches(std::uint64_t hash, const GsfHeader& header,
+                             std::string_view rom) const;
+
+  // Returns a new temporary path, beside the final path of the gsflib.
+  [[nodiscard]] std::filesystem::path TemporaryPathOf(
+      std::uint64_t hash) const;
+
+  // Renames the gsflib written at the temporary path to its final path. If
+  // another extraction has added the same gsflib meanwhile, it is kept.
+  void Publish(const std::filesystem::path& temporary_path,
+               std::uint64_t hash) const;
+
+  // Returns the _lib tag of a minigsf in minigsf_directory that refers to
+  // the gsflib: a relative path with '/' separators if possible.
+  [[nodiscard]] static std::string LibTag(
+      const std::filesystem::path& gsflib_path,
+      const std::filesystem::path& minigsf_directory);
+
+ private:
+  std::filesystem::path directory_;
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,103 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "gsflib_store.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "gsf_writer.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+const GsfHeader kHeader{0x8000000, 0x8000000, 0x100};
+
+void WriteFile(const std::filesystem::path& path, const std::string& data) {
+  std::ofstream stream(path, std::ios::out | std::ios::binary);
+  stream << data;
+}
+
+void TestHash() {
+  const std::string rom(0x100, 'a');
+  const std::uint64_t hash = GsflibStore::HashGsflib(kHeader, rom);
+  EXPECT(GsflibStore::HashGsflib(kHeader, std::string(0x100, 'a')) == hash);
+  EXPECT(GsflibStore::HashGsflib(kHeader, std::string(0x100, 'b')) != hash);
+  EXPECT(GsflibStore::HashGsflib(GsfHeader{0x8000000, 0x8000000, 0x104},
+                                 rom) != hash);
+
+  const GsflibStore store{"store"};
+  EXPECT(store.PathOf(0x1234).generic_string() ==
+         "store/0000000000001234.gsflib");
+}
+
+// A gsflib found under the hash of another one is not taken for it.
+void TestMatches() {
+  const testing::TemporaryDirectory directory;
+  const GsflibStore store{directory.path()};
+  const std::string rom(0x100, 'a');
+  const std::string other_rom(0x100, 'b');
+  const std::uint64_t hash = GsflibStore::HashGsflib(kHeader, rom);
+
+  EXPECT(!store.Contains(hash));
+  EXPECT(!store.Matches(hash, kHeader, rom));
+
+  GsfWriter::SaveToFile(store.PathOf(hash), kHeader, other_rom);
+  EXPECT(store.Contains(hash));
+  EXPECT(!store.Matches(hash, kHeader, rom));
+  EXPECT(store.Matches(hash, kHeader, other_rom));
+  EXPECT(!store.Matches(hash, GsfHeader{0x8000000, 0x8000000, 0x104},
+                        other_rom));
+  EXPECT(!store.Matches(hash, kHeader, other_rom.substr(1)));
+
+  // A broken file does not match either.
+  WriteFile(store.PathOf(hash), "PSF\x22");
+  EXPECT(!store.Matches(hash, kHeader, other_rom));
+}
+
+void TestPublish() {
+  const testing::TemporaryDirectory directory;
+  const GsflibStore store{directory.path()};
+  const std::uint64_t hash = 0xfedcba9876543210;
+
+  const std::filesystem::path first = store.TemporaryPathOf(hash);
+  const std::filesystem::path second = store.TemporaryPathOf(hash);
+  EXPECT(first != second);
+  EXPECT(first.parent_path() == directory.path());
+  WriteFile(first, "gsflib");
+  WriteFile(second, "gsflib");
+
+  store.Publish(first, hash);
+  EXPECT(store.Contains(hash));
+  EXPECT(!std::filesystem::exists(first));
+
+  // The extraction that loses the race leaves no temporary file behind.
+  store.Publish(second, hash);
+  EXPECT(store.Contains(hash));
+  EXPECT(!std::filesystem::exists(second));
+  EXPECT(std::filesystem::file_size(store.PathOf(hash)) == 6);
+
+  EXPECT_THROW(store.Publish(store.TemporaryPathOf(hash + 1), hash + 1),
+               std::filesystem::filesystem_error);
+}
+
+void TestLibTag() {
+  const testing::TemporaryDirectory directory;
+  const std::filesystem::path gsflib_path =
+      directory.path() / "store" / "0000000000001234.gsflib";
+  EXPECT(GsflibStore::LibTag(gsflib_path, directory.path() / "gsf" / "A") ==
+         "../../store/0000000000001234.gsflib");
+  EXPECT(GsflibStore::LibTag(gsflib_path, directory.path() / "store") ==
+         "0000000000001234.gsflib");
+}
+
+}  // namespace
+
+int main() {
+  TestHash();
+  TestMatches();
+  TestPublish();
+  TestLibTag();
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,46 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_HASH_HPP_
+#define GAXTAPPER_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace gaxtapper {
+
+/// Scrambles a 64-bit value (the finalizer of SplitMix64).
+/// @param value the value to be scrambled.
+/// @return the well-distributed hash of the value.
+[[nodiscard]] constexpr std::uint64_t Mix64(std::uint64_t value) noexcept {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111eb;
+  value ^= value >> 31;
+  return value;
+}
+
+/// Hashes a byte sequence, 8 bytes (in little-endian order) at a time.
+/// @param data the bytes to be hashed.
+/// @param seed the hash of the preceding data, to hash a sequence in pieces.
+/// @return the 64-bit hash of the bytes.
+[[nodiscard]] inline std::uint64_t HashBytes(std::string_view data,
+                                             std::uint64_t seed = 0) noexcept {
+  std::uint64_t hash = Mix64(seed ^ data.size());
+  std::size_t offset = 0;
+  for (; offset + 8 <= data.size(); offset += 8) {
+    std::uint64_t word = 0;
+    for (int i = 7; i >= 0; i--)
+      word = (word << 8) | static_cast<unsigned char>(data[offset + i]);
+    hash = Mix64(hash ^ word);
+  }
+  std::uint64_t tail = 0;
+  for (std::size_t i = data.size(); i > offset; i--)
+    tail = (tail << 8) | static_cast<unsigned char>(data[i - 1]);
+  return Mix64(hash ^ tail ^ 0x8000000000000000);
+}
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,274 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "inspection_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+#include "bytes.hpp"
+#include "gax_driver.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+constexpr std::string_view kMagic{"GAXINFO\x01", 8};
+constexpr std::size_t kHeaderSize = 64;
+constexpr std::size_t kSongSize = 16;
+constexpr std::size_t kChecksummedOffset = 16;
+
+std::uint32_t Crc32Of(std::string_view data) {
+  return crc32(0L, reinterpret_cast<const Bytef*>(data.data()),
+               static_cast<uInt>(data.size()));
+}
+
+std::string ToHexString(std::uint64_t value, int width) {
+  std::ostringstream s;
+  s << std::hex << std::setfill('0') << std::setw(width) << value;
+  return s.str();
+}
+
+}  // namespace
+
+InspectionCache::InspectionCache(std::filesystem::path directory)
+    : directory_(std::move(directory)) {}
+
+GaxDriverParam InspectionCache::Inspect(std::string_view rom,
+                                        bool* hit) const {
+  const std::uint64_t hash = HashBytes(rom);
+  const auto rom_size = static_cast<std::uint32_t>(rom.size());
+  const std::filesystem::path path = PathOf(hash);
+
+  std::error_code error;
+  if (std::filesystem::is_regular_file(path, error)) {
+    try {
+      const MappedFile file{path};
+      if (std::optional<GaxDriverParam> param =
+              Deserialize(file.data(), hash, rom_size)) {
+        // The time of the last use decides what Prune removes first.
+        const auto now = std::filesystem::file_time_type::clock::now();
+        const auto time = std::filesystem::last_write_time(path, error);
+        if (!error && now - time > kUseTimeResolution)
+          std::filesystem::last_write_time(path, now, error);
+        if (hit != nullptr) *hit = true;
+        return std::move(*param);
+      }
+    } catch (const std::runtime_error&) {
+      // An unreadable entry is replaced.
+    }
+  }
+
+  if (hit != nullptr) *hit = false;
+  GaxDriverParam param = GaxDriver::Inspect(rom);
+  std::random_device random;
+  std::filesystem::path temporary_path{path};
+  temporary_path += "." + ToHexString(random(), 8) + ".tmp";
+  try {
+    create_directories(directory_);
+    {
+      std::ofstream file(temporary_path, std::ios::out | std::ios::binary);
+      file.exceptions(std::ios::badbit | std::ios::failbit);
+      file << Serialize(hash, rom_size, param);
+    }
+    std::filesystem::rename(temporary_path, path);
+  } catch (const std::exception&) {
+    // The cache only saves time, so a failure to add the entry is ignored.
+    std::filesystem::remove(temporary_path, error);
+  }
+  return param;
+}
+
+InspectionCache::Stats InspectionCache::Scan() const {
+  Stats stats;
+  std::error_code error;
+  if (!std::filesystem::is_directory(directory_, error)) return stats;
+  for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+    if (!entry.is_regular_file() || entry.path().extension() != kExtension)
+      continue;
+    stats.num_entries++;
+    stats.size += entry.file_size();
+    EntryState state = EntryState::kBroken;
+    try {
+      state = Check(MappedFile{entry.path()}.data());
+    } catch (const std::runtime_error&) {
+    }
+    if (state == EntryState::kStale) stats.num_stale++;
+    if (state == EntryState::kBroken) stats.num_broken++;
+  }
+  return stats;
+}
+
+std::size_t InspectionCache::Prune(std::uintmax_t max_size) const {
+  struct Entry {
+    std::filesystem::path path;
+    std::uintmax_t size;
+    std::filesystem::file_time_type time;
+  };
+
+  std::error_code error;
+  if (!std::filesystem::is_directory(directory_, error)) return 0;
+  std::vector<Entry> entries;
+  std::uintmax_t total_size = 0;
+  std::size_t num_removed = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+    if (!entry.is_regular_file() || entry.path().extension() != kExtension)
+      continue;
+
+    EntryState state = EntryState::kBroken;
+    try {
+      state = Check(MappedFile{entry.path()}.data());
+    } catch (const std::runtime_error&) {
+    }
+    if (state != EntryState::kValid) {
+      if (std::filesystem::remove(entry.path(), error)) num_removed++;
+      continue;
+    }
+    entries.push_back(
+        Entry{entry.path(), entry.file_size(), entry.last_write_time()});
+    total_size += entries.back().size;
+  }
+
+  if (max_size == 0) return num_removed;
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) { return a.time < b.time; });
+  for (const Entry& entry : entries) {
+    if (total_size <= max_size) break;
+    if (std::filesystem::remove(entry.path, error)) {
+      num_removed++;
+      total_size -= entry.size;
+    }
+  }
+  return num_removed;
+}
+
+std::size_t InspectionCache::Clear() const {
+  std::error_code error;
+  if (!std::filesystem::is_directory(directory_, error)) return 0;
+  std::vector<std::filesystem::path> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(directory_)) {
+    if (entry.is_regular_file() && entry.path().extension() == kExtension)
+      paths.push_back(entry.path());
+  }
+  std::size_t num_removed = 0;
+  for (const std::filesystem::path& path : paths) {
+    if (std::filesystem::remove(path, error)) num_removed++;
+  }
+  return num_removed;
+}
+
+std::string InspectionCache::Serialize(std::uint64_t hash,
+                                       std::uint32_t rom_size,
+                                       const GaxDriverParam& param) {
+  const std::vector<GaxMusicEntry>& songs = param.songs();
+  std::string data(kHeaderSize + songs.size() * kSongSize, '\0');
+  std::string text = param.version_text();
+
+  std::memcpy(&data[0], kMagic.data(), kMagic.size());
+  WriteInt32L(&data[8], kSignatureVersion);
+  WriteInt32L(&data[16], static_cast<std::uint32_t>(hash));
+  WriteInt32L(&data[20], static_cast<std::uint32_t>(hash >> 32));
+  WriteInt32L(&data[24], rom_size);
+  WriteInt16L(&data[28],
+              static_cast<std::uint16_t>(param.version().major_version()));
+  WriteInt16L(&data[30],
+              static_cast<std::uint16_t>(param.version().minor_version()));
+  WriteInt32L(&data[32], param.gax2_estimate());
+  WriteInt32L(&data[36], param.gax2_new());
+  WriteInt32L(&data[40], param.gax2_init());
+  WriteInt32L(&data[44], param.gax_irq());
+  WriteInt32L(&data[48], param.gax_play());
+  WriteInt32L(&data[52], param.gax_wram_pointer());
+  WriteInt32L(&data[56], static_cast<std::uint32_t>(songs.size()));
+  WriteInt32L(&data[60], static_cast<std::uint32_t>(text.size()));
+
+  for (std::size_t i = 0; i < songs.size(); i++) {
+    char* const record = &data[kHeaderSize + i * kSongSize];
+    const std::string name = songs[i].info().name();
+    WriteInt32L(&record[0], songs[i].address());
+    WriteInt16L(&record[4], songs[i].num_channels());
+    WriteInt16L(&record[6], songs[i].mixing_rate());
+    WriteInt32L(&record[8], static_cast<std::uint32_t>(text.size()));
+    WriteInt32L(&record[12], static_cast<std::uint32_t>(name.size()));
+    text += name;
+  }
+  data += text;
+
+  WriteInt32L(&data[12],
+              Crc32Of(std::string_view{data}.substr(kChecksummedOffset)));
+  return data;
+}
+
+std::optional<GaxDriverParam> InspectionCache::Deserialize(
+    std::string_view data, std::uint64_t hash, std::uint32_t rom_size) {
+  if (Check(data) != EntryState::kValid) return std::nullopt;
+  const std::uint64_t entry_hash =
+      ReadInt32L(&data[16]) |
+      (static_cast<std::uint64_t>(ReadInt32L(&data[20])) << 32);
+  if (entry_hash != hash || ReadInt32L(&data[24]) != rom_size)
+    return std::nullopt;
+
+  const std::size_t num_songs = ReadInt32L(&data[56]);
+  const std::string_view text = data.substr(kHeaderSize + num_songs * kSongSize);
+  GaxDriverParam param;
+  param.set_version(GaxVersion{ReadInt16L(&data[28]), ReadInt16L(&data[30])});
+  param.set_version_text(std::string{text.substr(0, ReadInt32L(&data[60]))});
+  param.set_gax2_estimate(ReadInt32L(&data[32]));
+  param.set_gax2_new(ReadInt32L(&data[36]));
+  param.set_gax2_init(ReadInt32L(&data[40]));
+  param.set_gax_irq(ReadInt32L(&data[44]));
+  param.set_gax_play(ReadInt32L(&data[48]));
+  param.set_gax_wram_pointer(ReadInt32L(&data[52]));
+
+  std::vector<GaxMusicEntry> songs;
+  songs.reserve(num_songs);
+  for (std::size_t i = 0; i < num_songs; i++) {
+    const char* const record = &data[kHeaderSize + i * kSongSize];
+    songs.emplace_back(
+        ReadInt32L(&record[0]),
+        GaxSongInfoText{std::string{
+            text.substr(ReadInt32L(&record[8]), ReadInt32L(&record[12]))}},
+        ReadInt16L(&record[4]), ReadInt16L(&record[6]));
+  }
+  param.set_songs(std::move(songs));
+  return param;
+}
+
+std::filesystem::path InspectionCache::PathOf(std::uint64_t hash) const {
+  std::filesystem::path path{directory_};
+  path /= ToHexString(hash, 16) + std::string{kExtension};
+  return path;
+}
+
+InspectionCache::EntryState InspectionCache::Check(std::string_view data) {
+  if (data.size() < kHeaderSize || data.substr(0, kMagic.size()) != kMagic)
+    return EntryState::kBroken;
+  if (ReadInt32L(&data[8]) != kSignatureVersion) return EntryState::kStale;
+  if (ReadInt32L(&data[12]) != Crc32Of(data.substr(kChecksummedOffset)))
+    return EntryState::kBroken;
+
+  // Every text must be in the text area.
+  const std::uint64_t num_songs = ReadInt32L(&data[56]);
+  const std::uint64_t text_offset = kHeaderSize + num_songs * kSongSize;
+  if (text_offset > data.size()) return EntryState::kBroken;
+  const std::uint64_t text_size = data.size() - text_offset;
+  if (ReadInt32L(&data[60]) > text_size) return EntryState::kBroken;
+  for (std::uint64_t i = 0; i < num_songs; i++) {
+    const char* const record = &data[kHeaderSize + i * kSongSize];
+    const std::uint64_t offset = ReadInt32L(&record[8]);
+    if (offset + ReadInt32L(&record[12]) > text_size)
+      return EntryState::kBroken;
+  }
+  return EntryState::kValid;
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,95 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_INSPECTION_CACHE_HPP_
+#define GAXTAPPER_INSPECTION_CACHE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "gax_driver_param.hpp"
+
+namespace gaxtapper {
+
+// Keeps the result of GaxDriver::Inspect for each ROM in a directory, so
+// that the signature search and the song scan are done only once for a
+// ROM. The entries are found by the content hash of the ROM, and entries
+// written by another kSignatureVersion are stale and ignored. The result of
+// a ROM without GAX is kept as well.
+//
+// An entry is a file "<hash>.gaxinfo", which is read through a memory
+// mapping:
+//   0   magic "GAXINFO\x01"
+//   8   kSignatureVersion
+//   12  crc32 of the rest of the file (from offset 16)
+//   16  content hash (64-bit) and size of the ROM
+//   28  GAX major and minor version (16-bit each)
+//   32  gax2_estimate, gax2_new, gax2_init, gax_irq, gax_play, wram_pointer
+//   56  number of songs, size of the version text
+//   64  songs: address, number of channels (16-bit), mixing rate (16-bit),
+//       offset and size of the info text in the text area
+//   ... text area: the version text, then the info texts
+// All numbers are 32-bit little-endian unless noted.
+//
+// The methods can be called from several threads and processes: an entry
+// is written to a temporary file and renamed.
+class InspectionCache {
+ public:
+  static constexpr std::string_view kExtension = ".gaxinfo";
+  // Changes when the signature search or the song scan finds other results.
+  static constexpr std::uint32_t kSignatureVersion = 1;
+  // The time of the last use of an entry is updated only when it is older
+  // than this, so that the hits do not write to the disk each time.
+  static constexpr std::chrono::hours kUseTimeResolution{24};
+
+  struct Stats {
+    std::size_t num_entries = 0;
+    // Entries of another signature version, and unreadable entries.
+    std::size_t num_stale = 0;
+    std::size_t num_broken = 0;
+    std::uintmax_t size = 0;
+  };
+
+  explicit InspectionCache(std::filesystem::path directory);
+
+  [[nodiscard]] const std::filesystem::path& directory() const noexcept {
+    return directory_;
+  }
+
+  // Returns the parameters of the ROM from the cache, or inspects the ROM
+  // and adds them. Sets *hit to whether they were in the cache.
+  [[nodiscard]] GaxDriverParam Inspect(std::string_view rom,
+                                       bool* hit = nullptr) const;
+
+  // Looks at every entry of the directory.
+  [[nodiscard]] Stats Scan() const;
+  // Removes the stale and the broken entries, and then the least recently
+  // used entries until the entries take max_size bytes at most (0 = no
+  // limit). Returns the number of removed entries.
+  std::size_t Prune(std::uintmax_t max_size = 0) const;
+  // Removes every entry. Returns the number of removed entries.
+  std::size_t Clear() const;
+
+  [[nodiscard]] static std::string Serialize(std::uint64_t hash,
+                                             std::uint32_t rom_size,
+                                             const GaxDriverParam& param);
+  // Returns nothing for an entry of another ROM, another version, or a
+  // broken entry.
+  [[nodiscard]] static std::optional<GaxDriverParam> Deserialize(
+      std::string_view data, std::uint64_t hash, std::uint32_t rom_size);
+
+ private:
+  enum class EntryState { kValid, kStale, kBroken };
+
+  std::filesystem::path directory_;
+
+  [[nodiscard]] std::filesystem::path PathOf(std::uint64_t hash) const;
+  [[nodiscard]] static EntryState Check(std::string_view data);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,133 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "inspection_cache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+#include "gax_music_entry.hpp"
+#include "gax_song_info_text.hpp"
+#include "gax_version.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+GaxDriverParam MakeParam() {
+  GaxDriverParam param;
+  param.set_version(GaxVersion{3, 5});
+  param.set_version_text("GAX Sound Engine v3.05");
+  param.set_gax2_estimate(0x8001000);
+  param.set_gax2_new(0x8001100);
+  param.set_gax2_init(0x8001200);
+  param.set_gax_irq(0x8001300);
+  param.set_gax_play(0x8001400);
+  param.set_gax_wram_pointer(0x3000010);
+  param.set_songs({
+      GaxMusicEntry{0x8100000, GaxSongInfoText{"\"Title\" \xa9 Artist"}, 6,
+                    15769},
+      GaxMusicEntry{0x8200000, GaxSongInfoText{""}, 0, 15769},
+  });
+  return param;
+}
+
+void TestRoundTrip() {
+  const GaxDriverParam param = MakeParam();
+  const std::string data = InspectionCache::Serialize(1234, 0x400000, param);
+
+  const std::optional<GaxDriverParam> read =
+      InspectionCache::Deserialize(data, 1234, 0x400000);
+  EXPECT(read.has_value());
+  if (!read) return;
+  EXPECT(read->version().major_version() == 3);
+  EXPECT(read->version().minor_version() == 5);
+  EXPECT(read->version_text() == param.version_text());
+  EXPECT(read->gax2_estimate() == param.gax2_estimate());
+  EXPECT(read->gax2_new() == param.gax2_new());
+  EXPECT(read->gax2_init() == param.gax2_init());
+  EXPECT(read->gax_irq() == param.gax_irq());
+  EXPECT(read->gax_play() == param.gax_play());
+  EXPECT(read->gax_wram_pointer() == param.gax_wram_pointer());
+  EXPECT(read->songs().size() == 2);
+  for (std::size_t i = 0; i < read->songs().size(); i++) {
+    const GaxMusicEntry& song = read->songs()[i];
+    EXPECT(song.address() == param.songs()[i].address());
+    EXPECT(song.info().name() == param.songs()[i].info().name());
+    EXPECT(song.num_channels() == param.songs()[i].num_channels());
+    EXPECT(song.mixing_rate() == param.songs()[i].mixing_rate());
+  }
+  EXPECT(read->fx().address() == 0x8200000);
+
+  // The entry of another ROM, a broken entry and an entry of another
+  // signature version are not used.
+  EXPECT(!InspectionCache::Deserialize(data, 1235, 0x400000));
+  EXPECT(!InspectionCache::Deserialize(data, 1234, 0x400004));
+  std::string broken = data;
+  broken.back() ^= 1;
+  EXPECT(!InspectionCache::Deserialize(broken, 1234, 0x400000));
+  EXPECT(!InspectionCache::Deserialize(data.substr(0, 40), 1234, 0x400000));
+  std::string stale = data;
+  stale[8] ^= 0x80;
+  EXPECT(!InspectionCache::Deserialize(stale, 1234, 0x400000));
+}
+
+void TestCache() {
+  const testing::TemporaryDirectory directory;
+  const InspectionCache cache{directory.path()};
+  // A ROM without GAX, whose result is cached as well.
+  const std::string rom(0x10000, '\x01');
+
+  bool hit = true;
+  const GaxDriverParam first = cache.Inspect(rom, &hit);
+  EXPECT(!hit);
+  const GaxDriverParam second = cache.Inspect(rom, &hit);
+  EXPECT(hit);
+  EXPECT(first.ok() == second.ok());
+  EXPECT(first.songs().size() == second.songs().size());
+
+  std::vector<std::filesystem::path> entries;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(directory.path())) {
+    entries.push_back(entry.path());
+  }
+  EXPECT(entries.size() == 1);
+  if (entries.size() != 1) return;
+  const std::filesystem::path& entry = entries.front();
+
+  // A hit updates the time of the last use only when it is older than
+  // kUseTimeResolution.
+  const auto now = std::filesystem::file_time_type::clock::now();
+  const auto recent = now - std::chrono::hours{1};
+  std::filesystem::last_write_time(entry, recent);
+  (void)cache.Inspect(rom, &hit);
+  EXPECT(std::filesystem::last_write_time(entry) == recent);
+  const auto old = now - InspectionCache::kUseTimeResolution * 2;
+  std::filesystem::last_write_time(entry, old);
+  (void)cache.Inspect(rom, &hit);
+  EXPECT(std::filesystem::last_write_time(entry) > old);
+
+  {
+    std::ofstream stream(directory.path() /
+                         ("broken" + std::string{InspectionCache::kExtension}));
+    stream << "GAXINFO";
+  }
+  const InspectionCache::Stats stats = cache.Scan();
+  EXPECT(stats.num_entries == 2);
+  EXPECT(stats.num_broken == 1);
+  EXPECT(cache.Prune() == 1);
+  EXPECT(cache.Scan().num_entries == 1);
+  EXPECT(cache.Clear() == 1);
+  EXPECT(cache.Scan().num_entries == 0);
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestCache();
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,37 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_MAPPED_FILE_HPP_
+#define GAXTAPPER_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace gaxtapper {
+
+// A read-only memory mapping of a whole file. The pages are read on demand,
+// so the parts of a large file that are not looked at are never read.
+class MappedFile {
+ public:
+  // Throws std::runtime_error if the file cannot be mapped.
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] std::string_view data() const noexcept {
+    return {data_, size_};
+  }
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _WIN32
+  void* mapping_ = nullptr;
+#endif
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,74 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "memory_budget.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace gaxtapper {
+
+std::size_t MemoryBudget::peak() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return peak_;
+}
+
+void MemoryBudget::Acquire(std::size_t size) {
+  std::unique_lock<std::mutex> lock{mutex_};
+  released_.wait(lock, [&] { return Fits(size); });
+  in_use_ += size;
+  peak_ = std::max(peak_, in_use_);
+}
+
+void MemoryBudget::Release(std::size_t size) {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    in_use_ -= std::min(size, in_use_);
+  }
+  released_.notify_all();
+}
+
+bool MemoryBudget::Fits(std::size_t size) const noexcept {
+  return limit_ == 0 || in_use_ == 0 ||
+         size <= limit_ - std::min(in_use_, limit_);
+}
+
+std::size_t MemoryBudget::ParseSize(std::string_view text) {
+  const std::string message =
+      "Invalid size \"" + std::string{text} + "\" (expected such as 512M).";
+  std::size_t value = 0;
+  const auto [ptr, ec] =
+      std::from_chars(text.data(), text.data() + text.size(), value);
+  if (ec != std::errc{} || ptr == text.data())
+    throw std::invalid_argument(message);
+
+  std::string unit{ptr, text.data() + text.size()};
+  std::transform(unit.begin(), unit.end(), unit.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  if (unit.size() >= 2 && unit.substr(unit.size() - 2) == "IB")
+    unit.resize(unit.size() - 2);
+  else if (!unit.empty() && unit.back() == 'B')
+    unit.pop_back();
+
+  int shift = 0;
+  if (unit == "K") {
+    shift = 10;
+  } else if (unit == "M") {
+    shift = 20;
+  } else if (unit == "G") {
+    shift = 30;
+  } else if (unit == "T") {
+    shift = 40;
+  } else if (!unit.empty()) {
+    throw std::invalid_argument(message);
+  }
+  if (shift >= std::numeric_limits<std::size_t>::digits ||
+      value > (std::numeric_limits<std::size_t>::max() >> shift))
+    throw std::invalid_argument(message);
+  return value << shift;
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,48 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_MEMORY_BUDGET_HPP_
+#define GAXTAPPER_MEMORY_BUDGET_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+
+namespace gaxtapper {
+
+// Counts the estimated memory of the jobs in flight against a limit. A job
+// is admitted if it fits in the rest of the budget, or if no other job is in
+// flight, so that a job larger than the whole budget still runs, alone.
+// The methods can be called from several threads.
+class MemoryBudget {
+ public:
+  // A limit of 0 admits every job, and only keeps the peak.
+  explicit MemoryBudget(std::size_t limit = 0) noexcept : limit_(limit) {}
+
+  MemoryBudget(const MemoryBudget&) = delete;
+  MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+  [[nodiscard]] std::size_t limit() const noexcept { return limit_; }
+  [[nodiscard]] std::size_t peak() const;
+
+  // Waits until the job is admitted, and takes size bytes from the budget.
+  void Acquire(std::size_t size);
+  void Release(std::size_t size);
+
+  // Parses a size such as "512M" or "2G" (binary units; K, M, G and T, with
+  // an optional "B" or "iB"). Throws std::invalid_argument for a bad size.
+  [[nodiscard]] static std::size_t ParseSize(std::string_view text);
+
+ private:
+  const std::size_t limit_;
+  mutable std::mutex mutex_;
+  std::condition_variable released_;
+  std::size_t in_use_ = 0;
+  std::size_t peak_ = 0;
+
+  [[nodiscard]] bool Fits(std::size_t size) const noexcept;
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,73 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "memory_budget.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+void TestParseSize() {
+  EXPECT(MemoryBudget::ParseSize("4096") == 4096);
+  EXPECT(MemoryBudget::ParseSize("512M") == std::size_t{512} << 20);
+  EXPECT(MemoryBudget::ParseSize("2g") == std::size_t{2} << 30);
+  EXPECT(MemoryBudget::ParseSize("64KB") == std::size_t{64} << 10);
+  EXPECT(MemoryBudget::ParseSize("1GiB") == std::size_t{1} << 30);
+
+  EXPECT_THROW((void)MemoryBudget::ParseSize(""), std::invalid_argument);
+  EXPECT_THROW((void)MemoryBudget::ParseSize("M"), std::invalid_argument);
+  EXPECT_THROW((void)MemoryBudget::ParseSize("-1M"), std::invalid_argument);
+  EXPECT_THROW((void)MemoryBudget::ParseSize("12X"), std::invalid_argument);
+  EXPECT_THROW((void)MemoryBudget::ParseSize("1.5G"), std::invalid_argument);
+  EXPECT_THROW((void)MemoryBudget::ParseSize("99999999999999T"),
+               std::invalid_argument);
+}
+
+void TestAdmission() {
+  // Without a limit, only the peak is kept.
+  MemoryBudget unlimited;
+  unlimited.Acquire(100);
+  unlimited.Acquire(200);
+  unlimited.Release(100);
+  unlimited.Release(200);
+  EXPECT(unlimited.peak() == 300);
+
+  // A job larger than the budget runs alone.
+  MemoryBudget budget{100};
+  budget.Acquire(150);
+  budget.Release(150);
+  budget.Acquire(60);
+  budget.Acquire(40);
+  EXPECT(budget.peak() == 150);
+
+  // A job that does not fit waits for a release.
+  std::atomic<bool> admitted{false};
+  std::thread job{[&] {
+    budget.Acquire(50);
+    admitted = true;
+  }};
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT(!admitted);
+  budget.Release(40);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT(!admitted);
+  budget.Release(60);
+  job.join();
+  EXPECT(admitted);
+  budget.Release(50);
+  EXPECT(budget.peak() == 150);
+}
+
+}  // namespace
+
+int main() {
+  TestParseSize();
+  TestAdmission();
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,626 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "optimal_deflater.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include "deflate_format.hpp"
+
+namespace gaxtapper {
+
+// The number of hash chain entries to visit for each position.
+static constexpr int kMaxChainLength = 512;
+
+// Blocks are split in halves while it pays off, down to this depth.
+static constexpr int kMaxSplitDepth = 3;
+
+namespace {
+
+using LitLenCounts =
+    std::array<std::uint32_t, DeflateFormat::kNumLitLenSymbols>;
+using DistanceCounts =
+    std::array<std::uint32_t, DeflateFormat::kNumDistanceSymbols>;
+
+// A literal (length == 0) or a match.
+struct Symbol {
+  std::uint16_t length;
+  std::uint16_t value;  // the literal byte or the match distance
+};
+
+struct Match {
+  std::uint16_t length;
+  std::uint16_t distance;
+};
+
+// For each position, keeps the matches of increasing length, each with the
+// smallest distance that reaches the length.
+class MatchTable {
+ public:
+  MatchTable(std::string_view data, std::size_t begin, std::size_t end) {
+    constexpr std::size_t kHashSize = 0x10000;
+    constexpr std::size_t kWindowMask = DeflateFormat::kWindowSize - 1;
+    constexpr std::uint32_t kNone = 0xffffffff;
+    std::vector<std::uint32_t> head(kHashSize, kNone);
+    std::vector<std::uint32_t> previous(DeflateFormat::kWindowSize, kNone);
+    const auto* const bytes =
+        reinterpret_cast<const std::uint8_t*>(data.data());
+    const auto hash = [&](std::size_t position) {
+      return ((bytes[position] << 8) ^ (bytes[position + 1] << 4) ^
+              bytes[position + 2] ^ (bytes[position + 2] << 11)) &
+             (kHashSize - 1);
+    };
+    const auto insert = [&](std::size_t position) {
+      if (position + DeflateFormat::kMinMatch > data.size()) return;
+      const std::size_t h = hash(position);
+      previous[position & kWindowMask] = head[h];
+      head[h] = static_cast<std::uint32_t>(position);
+    };
+
+    const std::size_t window_begin =
+        begin > DeflateFormat::kWindowSize ? begin - DeflateFormat::kWindowSize
+                                           : 0;
+    for (std::size_t position = window_begin; position < begin; position++)
+      insert(position);
+
+    offsets_.reserve(end - begin + 1);
+    for (std::size_t position = begin; position < end; position++) {
+      offsets_.push_back(static_cast<std::uint32_t>(matches_.size()));
+      const std::size_t max_length =
+          std::min<std::size_t>(DeflateFormat::kMaxMatch, end - position);
+      if (max_length >= DeflateFormat::kMinMatch) {
+        std::size_t best_length = DeflateFormat::kMinMatch - 1;
+        std::uint32_t candidate = head[hash(position)];
+        for (int chain = 0; chain < kMaxChainLength && candidate != kNone;
+             chain++) {
+          const std::size_t distance = position - candidate;
+          if (distance == 0 || distance > DeflateFormat::kWindowSize) break;
+
+          if (bytes[candidate + best_length] == bytes[position + best_length]) {
+            std::size_t length = 0;
+            while (length < max_length &&
+                   bytes[candidate + length] == bytes[position + length])
+              length++;
+            if (length > best_length) {
+              best_length = length;
+              matches_.push_back(Match{static_cast<std::uint16_t>(length),
+                                       static_cast<std::uint16_t>(distance)});
+              if (length == max_length) break;
+            }
+          }
+          candidate = previous[candidate & kWindowMask];
+        }
+      }
+      insert(position);
+    }
+    offsets_.push_back(static_cast<std::uint32_t>(matches_.size()));
+  }
+
+  [[nodiscard]] const Match* begin(std::size_t index) const noexcept {
+    return matches_.data() + offsets_[index];
+  }
+  [[nodiscard]] const Match* end(std::size_t index) const noexcept {
+    return matches_.data() + offsets_[index + 1];
+  }
+
+ private:
+  std::vector<std::uint32_t> offsets_;
+  std::vector<Match> matches_;
+};
+
+// The bit cost of each symbol, used to find the shortest path.
+struct CostModel {
+  std::array<float, DeflateFormat::kNumLitLenSymbols> litlen;
+  std::array<float, DeflateFormat::kNumDistanceSymbols> distance;
+  std::array<float, DeflateFormat::kMaxMatch + 1> length;  // with extra bits
+
+  void UpdateLengthCosts() {
+    for (unsigned l = DeflateFormat::kMinMatch; l <= DeflateFormat::kMaxMatch;
+         l++) {
+      const unsigned code = DeflateFormat::LengthCode(l);
+      length[l] = litlen[257 + code] + DeflateFormat::kLengthExtraBits[code];
+    }
+  }
+
+  [[nodiscard]] float DistanceCost(unsigned d) const noexcept {
+    const unsigned code = DeflateFormat::DistanceCode(d);
+    return distance[code] + DeflateFormat::kDistanceExtraBits[code];
+  }
+
+  static CostModel Fixed() {
+    CostModel model;
+    for (unsigned s = 0; s < model.litlen.size(); s++)
+      model.litlen[s] =
+          static_cast<float>(DeflateFormat::FixedLitLenLength(s));
+    model.distance.fill(5.0f);
+    model.UpdateLengthCosts();
+    return model;
+  }
+
+  // Costs by the entropy of the symbol statistics.
+  static CostModel Of(const LitLenCounts& litlen_counts,
+                      const DistanceCounts& distance_counts) {
+    CostModel model;
+    const auto fill = [](const auto& counts, auto& costs) {
+      std::uint64_t total = 0;
+      for (const std::uint32_t count : counts) total += count;
+      const double log_total =
+          std::log2(static_cast<double>(std::max<std::uint64_t>(total, 1)));
+      for (std::size_t s = 0; s < counts.size(); s++) {
+        costs[s] = static_cast<float>(
+            counts[s] != 0
+                ? log_total - std::log2(static_cast<double>(counts[s]))
+                : log_total + 1);
+      }
+    };
+    fill(litlen_counts, model.litlen);
+    fill(distance_counts, model.distance);
+    model.UpdateLengthCosts();
+    return model;
+  }
+};
+
+// Finds the sequence of symbols with the lowest cost by dynamic programming.
+std::vector<Symbol> ParseOptimal(std::string_view data, std::size_t begin,
+                                 std::size_t end, const MatchTable& matches,
+                                 const CostModel& model) {
+  const std::size_t size = end - begin;
+  std::vector<float> costs(size + 1, std::numeric_limits<float>::infinity());
+  std::vector<Symbol> from(size + 1);
+  costs[0] = 0;
+  for (std::size_t i = 0; i < size; i++) {
+    const float cost = costs[i];
+    const auto literal = static_cast<std::uint8_t>(data[begin + i]);
+    if (const float c = cost + model.litlen[literal]; c < costs[i + 1]) {
+      costs[i + 1] = c;
+      from[i + 1] = Symbol{0, literal};
+    }
+
+    unsigned length = DeflateFormat::kMinMatch;
+    for (const Match* match = matches.begin(i); match != matches.end(i);
+         match++) {
+      const float base = cost + model.DistanceCost(match->distance);
+      for (; length <= match->length; length++) {
+        if (const float c = base + model.length[length];
+            c < costs[i + length]) {
+          costs[i + length] = c;
+          from[i + length] =
+              Symbol{static_cast<std::uint16_t>(length), match->distance};
+        }
+      }
+    }
+  }
+
+  std::vector<Symbol> symbols;
+  for (std::size_t i = size; i > 0;) {
+    const Symbol symbol = from[i];
+    symbols.push_back(symbol);
+    i -= symbol.length != 0 ? symbol.length : 1;
+  }
+  std::reverse(symbols.begin(), symbols.end());
+  return symbols;
+}
+
+// Builds the Huffman code lengths, limited to max_bits, for the counts.
+template <std::size_t N>
+std::array<std::uint8_t, N> BuildLengths(
+    const std::array<std::uint32_t, N>& counts, unsigned max_bits) {
+  std::array<std::uint8_t, N> lengths{};
+  std::array<std::uint32_t, N> weights = counts;
+  for (;;) {
+    // Nodes [0, N) are the leaves; the parents are appended after them.
+    using Node = std::pair<std::uint64_t, std::size_t>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+    for (std::size_t s = 0; s < N; s++) {
+      if (weights[s] != 0) queue.emplace(weights[s], s);
+    }
+    if (queue.empty()) return lengths;
+    if (queue.size() == 1) {
+      lengths[queue.top().second] = 1;
+      return lengths;
+    }
+
+    std::vector<std::size_t> parents(N, 0);
+    while (queue.size() > 1) {
+      const Node a = queue.top();
+      queue.pop();
+      const Node b = queue.top();
+      queue.pop();
+      const std::size_t parent = parents.size();
+      parents.push_back(parent);  // the root points to itself
+      parents[a.second] = parent;
+      parents[b.second] = parent;
+      queue.emplace(a.first + b.first, parent);
+    }
+
+    unsigned longest = 0;
+    for (std::size_t s = 0; s < N; s++) {
+      if (weights[s] == 0) continue;
+      unsigned depth = 0;
+      for (std::size_t node = s; parents[node] != node; node = parents[node])
+        depth++;
+      lengths[s] = static_cast<std::uint8_t>(depth);
+      longest = std::max(longest, depth);
+    }
+    if (longest <= max_bits) return lengths;
+
+    // Flatten the statistics and try again.
+    for (std::uint32_t& weight : weights) {
+      if (weight != 0) weight = (weight + 1) / 2;
+    }
+  }
+}
+
+template <std::size_t N>
+std::array<std::uint16_t, N> MakeCodes(
+    const std::array<std::uint8_t, N>& lengths) {
+  std::array<std::uint16_t, 16> counts{};
+  for (const std::uint8_t length : lengths) counts[length]++;
+  counts[0] = 0;
+  std::array<std::uint16_t, 16> next{};
+  std::uint16_t code = 0;
+  for (unsigned bits = 1; bits < 16; bits++) {
+    code = static_cast<std::uint16_t>((code + counts[bits - 1]) << 1);
+    next[bits] = code;
+  }
+  std::array<std::uint16_t, N> codes{};
+  for (std::size_t s = 0; s < N; s++) {
+    if (lengths[s] != 0) codes[s] = next[lengths[s]]++;
+  }
+  return codes;
+}
+
+// An item of the run-length encoded code lengths of a dynamic block.
+struct CodeLengthItem {
+  std::uint8_t symbol;  // 0-15, or 16-18 for the repeats
+  std::uint8_t extra;
+};
+
+constexpr std::uint8_t kCodeLengthExtraBits[19]{0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                0, 0, 0, 0, 0, 0, 2, 3, 7};
+
+// The trees and the header of a dynamic Huffman block.
+struct DynamicTrees {
+  std::array<std::uint8_t, DeflateFormat::kNumLitLenSymbols> litlen_lengths;
+  std::array<std::uint8_t, DeflateFormat::kNumDistanceSymbols> distance_lengths;
+  std::array<std::uint8_t, 19> code_length_lengths;
+  std::vector<CodeLengthItem> items;
+  unsigned hlit = 0;
+  unsigned hdist = 0;
+  unsigned hclen = 0;
+
+  DynamicTrees(const LitLenCounts& litlen_counts,
+               const DistanceCounts& distance_counts) {
+    litlen_lengths = BuildLengths(litlen_counts, 15);
+    distance_lengths = BuildLengths(distance_counts, 15);
+
+    // Some inflaters reject a distance tree with less than two codes.
+    unsigned used = 0;
+    for (const std::uint8_t length : distance_lengths) used += length != 0;
+    if (used == 0) {
+      distance_lengths[0] = distance_lengths[1] = 1;
+    } else if (used == 1) {
+      // The only code has the length 1; add a dummy code beside it.
+      distance_lengths[distance_lengths[0] == 0 ? 0 : 1] = 1;
+    }
+
+    hlit = 257;
+    for (unsigned s = 257; s < litlen_lengths.size(); s++) {
+      if (litlen_lengths[s] != 0) hlit = s + 1;
+    }
+    hdist = 1;
+    for (unsigned s = 1; s < distance_lengths.size(); s++) {
+      if (distance_lengths[s] != 0) hdist = s + 1;
+    }
+
+    std::vector<std::uint8_t> all(litlen_lengths.begin(),
+                                  litlen_lengths.begin() + hlit);
+    all.insert(all.end(), distance_lengths.begin(),
+               distance_lengths.begin() + hdist);
+    for (std::size_t i = 0; i < all.size();) {
+      const std::uint8_t value = all[i];
+      std::size_t run = 1;
+      while (i + run < all.size() && all[i + run] == value) run++;
+      i += run;
+
+      if (value == 0) {
+        while (run >= 11) {
+          const std::size_t count = std::min<std::size_t>(run, 138);
+          items.push_back({18, static_cast<std::uint8_t>(count - 11)});
+          run -= count;
+        }
+        if (run >= 3) {
+          items.push_back({17, static_cast<std::uint8_t>(run - 3)});
+          run = 0;
+        }
+      } else {
+        items.push_back({value, 0});
+        run--;
+        while (run >= 3) {
+          const std::size_t count = std::min<std::size_t>(run, 6);
+          items.push_back({16, static_cast<std::uint8_t>(count - 3)});
+          run -= count;
+        }
+      }
+      for (; run > 0; run--) items.push_back({value, 0});
+    }
+
+    std::array<std::uint32_t, 19> code_length_counts{};
+    for (const CodeLengthItem& item : items) code_length_counts[item.symbol]++;
+    code_length_lengths = BuildLengths(code_length_counts, 7);
+    hclen = 4;
+    for (unsigned i = 4; i < 19; i++) {
+      if (code_length_lengths[DeflateFormat::kCodeLengthOrder[i]] != 0)
+        hclen = i + 1;
+    }
+  }
+
+  [[nodiscard]] std::uint64_t HeaderBits() const noexcept {
+    std::uint64_t bits = 5 + 5 + 4 + 3 * hclen;
+    for (const CodeLengthItem& item : items)
+      bits += code_length_lengths[item.symbol] +
+              kCodeLengthExtraBits[item.symbol];
+    return bits;
+  }
+};
+
+struct BlockStats {
+  LitLenCounts litlen{};
+  DistanceCounts distance{};
+  std::uint64_t extra_bits = 0;
+  std::size_t bytes = 0;
+
+  BlockStats(const Symbol* begin, const Symbol* end) {
+    for (const Symbol* s = begin; s != end; s++) {
+      if (s->length == 0) {
+        litlen[s->value]++;
+        bytes++;
+      } else {
+        const unsigned length_code = DeflateFormat::LengthCode(s->length);
+        const unsigned distance_code = DeflateFormat::DistanceCode(s->value);
+        litlen[257 + length_code]++;
+        distance[distance_code]++;
+        extra_bits += DeflateFormat::kLengthExtraBits[length_code] +
+                      DeflateFormat::kDistanceExtraBits[distance_code];
+        bytes += s->length;
+      }
+    }
+    litlen[DeflateFormat::kEndOfBlock]++;
+  }
+};
+
+template <std::size_t N1, std::size_t N2>
+std::uint64_t DataBits(const BlockStats& stats,
+                       const std::array<std::uint8_t, N1>& litlen_lengths,
+                       const std::array<std::uint8_t, N2>& distance_lengths) {
+  std::uint64_t bits = stats.extra_bits;
+  for (std::size_t s = 0; s < stats.litlen.size(); s++)
+    bits += static_cast<std::uint64_t>(stats.litlen[s]) * litlen_lengths[s];
+  for (std::size_t s = 0; s < stats.distance.size(); s++)
+    bits += static_cast<std::uint64_t>(stats.distance[s]) * distance_lengths[s];
+  return bits;
+}
+
+std::array<std::uint8_t, DeflateFormat::kNumFixedLitLenSymbols>
+FixedLitLenLengths() {
+  std::array<std::uint8_t, DeflateFormat::kNumFixedLitLenSymbols> lengths{};
+  for (unsigned s = 0; s < lengths.size(); s++)
+    lengths[s] =
+        static_cast<std::uint8_t>(DeflateFormat::FixedLitLenLength(s));
+  return lengths;
+}
+
+std::array<std::uint8_t, DeflateFormat::kNumDistanceSymbols>
+FixedDistanceLengths() {
+  std::array<std::uint8_t, DeflateFormat::kNumDistanceSymbols> lengths{};
+  lengths.fill(5);
+  return lengths;
+}
+
+enum class BlockType { kStored, kFixed, kDynamic };
+
+// Chooses the smallest block type for the symbols, and returns its size in
+// bits (an upper bound for the stored blocks, which depend on the alignment).
+std::pair<BlockType, std::uint64_t> ChooseBlockType(const Symbol* begin,
+                                                    const Symbol* end) {
+  const BlockStats stats{begin, end};
+  const DynamicTrees trees{stats.litlen, stats.distance};
+  const std::uint64_t dynamic_bits =
+      3 + trees.HeaderBits() +
+      DataBits(stats, trees.litlen_lengths, trees.distance_lengths);
+  const std::uint64_t fixed_bits =
+      3 + DataBits(stats, FixedLitLenLengths(), FixedDistanceLengths());
+  const std::size_t chunks = std::max<std::size_t>(
+      1, (stats.bytes + DeflateFormat::kMaxStoredSize - 1) /
+             DeflateFormat::kMaxStoredSize);
+  const std::uint64_t stored_bits = chunks * (3 + 7 + 32) + stats.bytes * 8ull;
+
+  if (stored_bits < dynamic_bits && stored_bits < fixed_bits)
+    return {BlockType::kStored, stored_bits};
+  if (fixed_bits <= dynamic_bits) return {BlockType::kFixed, fixed_bits};
+  return {BlockType::kDynamic, dynamic_bits};
+}
+
+// Splits the symbols into blocks in halves while the halves are smaller.
+// Appends the end of each block to ends.
+std::uint64_t SplitBlocks(const Symbol* begin, const Symbol* end, int depth,
+                          std::vector<const Symbol*>& ends) {
+  const std::uint64_t whole = ChooseBlockType(begin, end).second;
+  if (depth < kMaxSplitDepth && end - begin >= 1024) {
+    const Symbol* const middle = begin + (end - begin) / 2;
+    std::vector<const Symbol*> split_ends;
+    const std::uint64_t split =
+        SplitBlocks(begin, middle, depth + 1, split_ends) +
+        SplitBlocks(middle, end, depth + 1, split_ends);
+    if (split < whole) {
+      ends.insert(ends.end(), split_ends.begin(), split_ends.end());
+      return split;
+    }
+  }
+  ends.push_back(end);
+  return whole;
+}
+
+// Estimates the size of the symbols when encoded as a single dynamic block.
+std::uint64_t EstimateBits(const std::vector<Symbol>& symbols) {
+  return ChooseBlockType(symbols.data(), symbols.data() + symbols.size())
+      .second;
+}
+
+}  // namespace
+
+// Writes the blocks of a parsed region to the deflater output.
+class OptimalBlockWriter {
+ public:
+  explicit OptimalBlockWriter(OptimalDeflater& deflater) : d_(deflater) {}
+
+  void WriteBlock(std::string_view data, std::size_t position,
+                  const Symbol* begin, const Symbol* end, bool final) {
+    const BlockType type = ChooseBlockType(begin, end).first;
+    if (type == BlockType::kStored) {
+      const BlockStats stats{begin, end};
+      WriteStored(data.substr(position, stats.bytes), final);
+      return;
+    }
+
+    d_.WriteBits(final ? 1 : 0, 1);
+    if (type == BlockType::kFixed) {
+      d_.WriteBits(1, 2);
+      WriteSymbols(begin, end, FixedLitLenLengths(), FixedDistanceLengths());
+      return;
+    }
+
+    const BlockStats stats{begin, end};
+    const DynamicTrees trees{stats.litlen, stats.distance};
+    d_.WriteBits(2, 2);
+    d_.WriteBits(trees.hlit - 257, 5);
+    d_.WriteBits(trees.hdist - 1, 5);
+    d_.WriteBits(trees.hclen - 4, 4);
+    for (unsigned i = 0; i < trees.hclen; i++) {
+      d_.WriteBits(
+          trees.code_length_lengths[DeflateFormat::kCodeLengthOrder[i]], 3);
+    }
+    const auto codes = MakeCodes(trees.code_length_lengths);
+    for (const CodeLengthItem& item : trees.items) {
+      d_.WriteCode(codes[item.symbol], trees.code_length_lengths[item.symbol]);
+      d_.WriteBits(item.extra, kCodeLengthExtraBits[item.symbol]);
+    }
+    WriteSymbols(begin, end, trees.litlen_lengths, trees.distance_lengths);
+  }
+
+  void WriteStored(std::string_view bytes, bool final) {
+    do {
+      const std::size_t size =
+          std::min<std::size_t>(bytes.size(), DeflateFormat::kMaxStoredSize);
+      const bool last = size == bytes.size();
+      d_.WriteBits(final && last ? 1 : 0, 1);
+      d_.WriteBits(0, 2);
+      d_.AlignToByte();
+      d_.WriteBits(static_cast<std::uint32_t>(size), 16);
+      d_.WriteBits(static_cast<std::uint32_t>(~size & 0xffff), 16);
+      d_.output_.append(bytes.data(), size);
+      bytes.remove_prefix(size);
+    } while (!bytes.empty());
+  }
+
+ private:
+  OptimalDeflater& d_;
+
+  template <std::size_t N1, std::size_t N2>
+  void WriteSymbols(const Symbol* begin, const Symbol* end,
+                    const std::array<std::uint8_t, N1>& litlen_lengths,
+                    const std::array<std::uint8_t, N2>& distance_lengths) {
+    const auto litlen_codes = MakeCodes(litlen_lengths);
+    const auto distance_codes = MakeCodes(distance_lengths);
+    for (const Symbol* s = begin; s != end; s++) {
+      if (s->length == 0) {
+        d_.WriteCode(litlen_codes[s->value], litlen_lengths[s->value]);
+        continue;
+      }
+      const unsigned length_code = DeflateFormat::LengthCode(s->length);
+      const unsigned symbol = 257 + length_code;
+      d_.WriteCode(litlen_codes[symbol], litlen_lengths[symbol]);
+      d_.WriteBits(s->length - DeflateFormat::kLengthBase[length_code],
+                   DeflateFormat::kLengthExtraBits[length_code]);
+      const unsigned distance_code = DeflateFormat::DistanceCode(s->value);
+      d_.WriteCode(distance_codes[distance_code],
+                   distance_lengths[distance_code]);
+      d_.WriteBits(s->value - DeflateFormat::kDistanceBase[distance_code],
+                   DeflateFormat::kDistanceExtraBits[distance_code]);
+    }
+    const unsigned eob = DeflateFormat::kEndOfBlock;
+    d_.WriteCode(litlen_codes[eob], litlen_lengths[eob]);
+  }
+};
+
+void OptimalDeflater::Deflate(std::string_view data, std::size_t begin,
+                              std::size_t end, bool final) {
+  OptimalBlockWriter writer{*this};
+  if (begin == end) {
+    if (final) {
+      writer.WriteStored({}, true);
+      AlignToByte();
+    }
+    return;
+  }
+
+  const MatchTable matches{data, begin, end};
+  std::vector<Symbol> best =
+      ParseOptimal(data, begin, end, matches, CostModel::Fixed());
+  std::uint64_t best_bits = EstimateBits(best);
+  std::vector<Symbol> symbols = best;
+  for (int iteration = 0; iteration < iterations_; iteration++) {
+    const BlockStats stats{symbols.data(), symbols.data() + symbols.size()};
+    symbols = ParseOptimal(data, begin, end, matches,
+                           CostModel::Of(stats.litlen, stats.distance));
+    const std::uint64_t bits = EstimateBits(symbols);
+    if (bits >= best_bits) break;  // converged
+    best_bits = bits;
+    best = symbols;
+  }
+
+  std::vector<const Symbol*> ends;
+  SplitBlocks(best.data(), best.data() + best.size(), 0, ends);
+  const Symbol* block = best.data();
+  std::size_t position = begin;
+  for (const Symbol* block_end : ends) {
+    const bool last = block_end == best.data() + best.size();
+    writer.WriteBlock(data, position, block, block_end, final && last);
+    for (const Symbol* s = block; s != block_end; s++)
+      position += s->length != 0 ? s->length : 1;
+    block = block_end;
+  }
+  if (final) AlignToByte();
+}
+
+void OptimalDeflater::SyncFlush() {
+  OptimalBlockWriter{*this}.WriteStored({}, false);
+}
+
+void OptimalDeflater::WriteBits(std::uint32_t bits, int count) {
+  for (int i = 0; i < count; i++) {
+    bit_buffer_ |= ((bits >> i) & 1) << bit_count_;
+    if (++bit_count_ == 8) {
+      output_.push_back(static_cast<char>(bit_buffer_));
+      bit_buffer_ = 0;
+      bit_count_ = 0;
+    }
+  }
+}
+
+void OptimalDeflater::WriteCode(std::uint32_t code, int length) {
+  for (int i = length - 1; i >= 0; i--) WriteBits((code >> i) & 1, 1);
+}
+
+void OptimalDeflater::AlignToByte() {
+  if (bit_count_ > 0) WriteBits(0, 8 - bit_count_);
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,56 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_OPTIMAL_DEFLATER_HPP_
+#define GAXTAPPER_OPTIMAL_DEFLATER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace gaxtapper {
+
+// A raw deflate encoder that spends much more time than zlib for a smaller
+// output, in the same way as zopfli. It finds every match length at every
+// position, chooses the matches by the shortest path under a bit cost model
+// that is refined over several iterations, splits the result into blocks,
+// and writes each block as dynamic Huffman, fixed Huffman or stored,
+// whichever is the smallest.
+class OptimalDeflater {
+ public:
+  static constexpr int kDefaultIterations = 8;
+
+  explicit OptimalDeflater(int iterations = kDefaultIterations)
+      : iterations_(iterations) {}
+
+  // Encodes data[begin, end) as deflate blocks. data[0, begin) is the history
+  // that matches can refer to. The last block of the final call is marked as
+  // the final block, and the output is padded to a byte boundary.
+  void Deflate(std::string_view data, std::size_t begin, std::size_t end,
+               bool final);
+
+  // Appends an empty stored block, which aligns the output to a byte
+  // boundary like Z_SYNC_FLUSH.
+  void SyncFlush();
+
+  [[nodiscard]] const std::string& output() const noexcept { return output_; }
+  [[nodiscard]] std::uint64_t bit_count() const noexcept {
+    return output_.size() * 8ull + bit_count_;
+  }
+
+ private:
+  int iterations_;
+  std::string output_;
+  std::uint32_t bit_buffer_ = 0;
+  int bit_count_ = 0;
+
+  void WriteBits(std::uint32_t bits, int count);
+  void WriteCode(std::uint32_t code, int length);
+  void AlignToByte();
+
+  friend class OptimalBlockWriter;
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,93 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "output_hashes.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+namespace gaxtapper {
+
+OutputHashes::OutputHashes(std::filesystem::path path) : path_(std::move(path)) {
+  std::ifstream stream(path_);
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::istringstream fields{line};
+    Entry entry{};
+    std::string filename;
+    if (!(fields >> std::hex >> entry.hash >> std::dec >> entry.size >>
+          std::hex >> entry.file_hash))
+      continue;
+    // A line of the older format without the file hash has the filename in
+    // the place of the file hash.
+    if (fields.get() != ' ') continue;
+    if (!std::getline(fields, filename) || filename.empty()) continue;
+    entries_[filename] = entry;
+  }
+}
+
+std::uint64_t OutputHashes::HashGsf(
+    const GsfHeader& header, std::string_view rom,
+    const std::map<std::string, std::string>& tags, ZlibProfile profile) {
+  std::uint64_t hash = HashBytes({header.data(), header.size()},
+                                 static_cast<std::uint64_t>(profile));
+  hash = HashBytes(rom, hash);
+  for (const auto& [key, value] : tags) {
+    hash = HashBytes(key, hash);
+    hash = HashBytes(value, hash);
+  }
+  return hash;
+}
+
+bool OutputHashes::IsUnchanged(const std::filesystem::path& path,
+                               std::uint64_t hash) const {
+  Entry entry;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    const auto it = entries_.find(path.filename().string());
+    if (it == entries_.end() || it->second.hash != hash) return false;
+    entry = it->second;
+  }
+
+  std::error_code error;
+  const std::uintmax_t size = std::filesystem::file_size(path, error);
+  if (error || size != entry.size) return false;
+  try {
+    return HashBytes(MappedFile{path}.data()) == entry.file_hash;
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+}
+
+void OutputHashes::Update(const std::filesystem::path& path,
+                          std::uint64_t hash, std::string_view data) {
+  const std::uint64_t file_hash = HashBytes(data);
+  std::lock_guard<std::mutex> lock{mutex_};
+  entries_[path.filename().string()] = Entry{hash, data.size(), file_hash};
+}
+
+void OutputHashes::Save() const {
+  std::filesystem::path temporary_path{path_};
+  temporary_path += ".tmp";
+  {
+    std::ofstream stream(temporary_path, std::ios::out | std::ios::trunc);
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& [filename, entry] : entries_) {
+      stream << std::hex << std::setfill('0') << std::setw(16) << entry.hash
+             << std::dec << ' ' << entry.size << ' ' << std::hex
+             << std::setw(16) << entry.file_hash << std::dec << ' '
+             << filename << '\n';
+    }
+  }
+  std::filesystem::rename(temporary_path, path_);
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,67 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_OUTPUT_HASHES_HPP_
+#define GAXTAPPER_OUTPUT_HASHES_HPP_
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "gsf_header.hpp"
+#include "zlib_compressor.hpp"
+
+namespace gaxtapper {
+
+// Remembers the content hash of each output file in a sidecar file, so that
+// a file whose exe, tags and compression profile have not changed since the
+// last run can be left as it is, without compressing it again. The hash of
+// the written file is kept as well, so a file that has been removed or
+// changed since (such as retagged by hand) is written again.
+//
+// The sidecar is a text file with a line "<hash> <size> <file hash>
+// <filename>" for each file. IsUnchanged and Update can be called from
+// several threads.
+class OutputHashes {
+ public:
+  static constexpr std::string_view kExtension = ".gsfhash";
+
+  // Loads the sidecar, if it exists. A broken line is ignored, which only
+  // makes the file be written again.
+  explicit OutputHashes(std::filesystem::path path);
+
+  OutputHashes(const OutputHashes&) = delete;
+  OutputHashes& operator=(const OutputHashes&) = delete;
+
+  [[nodiscard]] static std::uint64_t HashGsf(
+      const GsfHeader& header, std::string_view rom,
+      const std::map<std::string, std::string>& tags, ZlibProfile profile);
+
+  // Returns true if the file on disk is the one that was written for the
+  // hash, which reads the whole file.
+  [[nodiscard]] bool IsUnchanged(const std::filesystem::path& path,
+                                 std::uint64_t hash) const;
+
+  // Records the hash of a file that is written in this run, with its data.
+  void Update(const std::filesystem::path& path, std::uint64_t hash,
+              std::string_view data);
+
+  // Saves the sidecar by replacing the old one with a new file.
+  void Save() const;
+
+ private:
+  struct Entry {
+    std::uint64_t hash;
+    std::uintmax_t size;
+    std::uint64_t file_hash;
+  };
+
+  std::filesystem::path path_;
+  std::map<std::string, Entry> entries_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace gaxtapper
+
+#endif
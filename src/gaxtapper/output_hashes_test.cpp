@@ -0,0 +1,75 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "output_hashes.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "gsf_header.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+void WriteFile(const std::filesystem::path& path, const std::string& data) {
+  std::ofstream stream(path, std::ios::out | std::ios::binary);
+  stream << data;
+}
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  const std::filesystem::path sidecar =
+      directory.path() / ("set" + std::string{OutputHashes::kExtension});
+  const std::filesystem::path gsflib = directory.path() / "set.gsflib";
+  const std::filesystem::path minigsf = directory.path() / "song.minigsf";
+
+  const GsfHeader header{0x8000000, 0x8000000, 4};
+  const std::uint64_t hash =
+      OutputHashes::HashGsf(header, "ROM!", {}, ZlibProfile::kDefault);
+  EXPECT(OutputHashes::HashGsf(header, "ROM?", {}, ZlibProfile::kDefault) !=
+         hash);
+  EXPECT(OutputHashes::HashGsf(header, "ROM!", {{"_lib", "set.gsflib"}},
+                               ZlibProfile::kDefault) != hash);
+  EXPECT(OutputHashes::HashGsf(header, "ROM!", {}, ZlibProfile::kMax) !=
+         hash);
+
+  // The hashes survive a save and a load.
+  const std::string gsflib_data = "PSF\x22 gsflib data";
+  const std::string minigsf_data = "PSF\x22 minigsf data";
+  WriteFile(gsflib, gsflib_data);
+  WriteFile(minigsf, minigsf_data);
+  {
+    OutputHashes hashes{sidecar};
+    EXPECT(!hashes.IsUnchanged(gsflib, hash));
+    hashes.Update(gsflib, hash, gsflib_data);
+    hashes.Update(minigsf, hash + 1, minigsf_data);
+    EXPECT(hashes.IsUnchanged(gsflib, hash));
+    hashes.Save();
+  }
+  {
+    std::ofstream stream(sidecar, std::ios::out | std::ios::app);
+    stream << "a broken line\n";
+  }
+  {
+    const OutputHashes hashes{sidecar};
+    EXPECT(hashes.IsUnchanged(gsflib, hash));
+    EXPECT(hashes.IsUnchanged(minigsf, hash + 1));
+    EXPECT(!hashes.IsUnchanged(gsflib, hash + 1));
+  }
+
+  // A file changed since, even with the same size, is written again, and
+  // so is a removed file.
+  std::string retagged = minigsf_data;
+  retagged.back() = 'A';
+  WriteFile(minigsf, retagged);
+  std::filesystem::remove(gsflib);
+  {
+    const OutputHashes hashes{sidecar};
+    EXPECT(!hashes.IsUnchanged(minigsf, hash + 1));
+    EXPECT(!hashes.IsUnchanged(gsflib, hash));
+  }
+  return testing::num_failures != 0;
+}
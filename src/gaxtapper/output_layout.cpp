@@ -0,0 +1,165 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "output_layout.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#include "hash.hpp"
+#include "path.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+// Calls field(name) for each "{name}" of the pattern and literal(text) for
+// the text between them.
+template <typename Field, typename Literal>
+void ForEachToken(std::string_view pattern, Field&& field, Literal&& literal) {
+  while (!pattern.empty()) {
+    const std::size_t open = pattern.find('{');
+    literal(pattern.substr(0, open));
+    if (open == std::string_view::npos) break;
+
+    const std::size_t close = pattern.find('}', open);
+    if (close == std::string_view::npos) {
+      throw std::invalid_argument("Unterminated field in the layout \"" +
+                                  std::string{pattern} + "\".");
+    }
+    field(pattern.substr(open + 1, close - open - 1));
+    pattern.remove_prefix(close + 1);
+  }
+}
+
+std::string FieldValue(std::string_view name, const Cartridge& cartridge) {
+  // A blank game code is filled with NUL, which has no place in a path.
+  std::string code = cartridge.game_code();
+  code.erase(std::min(code.find('\0'), code.size()));
+  if (name == "game_code") return cartridge.full_game_code();
+  if (name == "code") return code;
+  if (name == "prefix") return code.substr(0, 1);
+  if (name == "region")
+    return Cartridge::decode_country_code(code.size() == 4 ? code[3] : '\0');
+  if (name == "shard") {
+    char shard[3];
+    std::snprintf(shard, sizeof(shard), "%02x",
+                  static_cast<unsigned>(HashBytes(code) & 0xff));
+    return shard;
+  }
+  if (name == "title") return cartridge.game_title();
+  throw std::invalid_argument("Unknown field {" + std::string{name} +
+                              "} in the layout.");
+}
+
+// The manifest is shared by the ROMs extracted into the same directory.
+std::mutex manifest_mutex;
+
+unsigned long ProcessId() {
+#ifdef _WIN32
+  return static_cast<unsigned long>(_getpid());
+#else
+  return static_cast<unsigned long>(getpid());
+#endif
+}
+
+}  // namespace
+
+OutputLayout::OutputLayout(std::string pattern) : pattern_(std::move(pattern)) {
+  const std::filesystem::path path{pattern_};
+  if (path.is_absolute() || path.has_root_name())
+    throw std::invalid_argument("The layout must be a relative path.");
+  for (const auto& segment : path) {
+    if (segment == "..")
+      throw std::invalid_argument("The layout must not contain \"..\".");
+  }
+
+  // Check the fields with an empty cartridge header.
+  Cartridge cartridge;
+  cartridge.rom().assign(Cartridge::kHeaderSize, '\0');
+  ForEachToken(
+      pattern_, [&](std::string_view name) { FieldValue(name, cartridge); },
+      [](std::string_view) {});
+}
+
+std::filesystem::path OutputLayout::Directory(
+    const Cartridge& cartridge) const {
+  std::filesystem::path directory;
+  std::string segment;
+  const auto flush = [&] {
+    if (!segment.empty()) directory /= segment;
+    segment.clear();
+  };
+  ForEachToken(
+      pattern_,
+      [&](std::string_view name) {
+        std::string value =
+            ToSafeFilenameSegment(FieldValue(name, cartridge), '_').string();
+        if (value.empty() || value == "." || value == "..") value = "_";
+        segment += value;
+      },
+      [&](std::string_view text) {
+        for (const char c : text) {
+          if (c == '/' || c == '\\') {
+            flush();
+          } else {
+            segment += c;
+          }
+        }
+      });
+  flush();
+  return directory;
+}
+
+void OutputLayout::RecordInManifest(const std::filesystem::path& outdir,
+                                    const std::vector<ManifestEntry>& entries) {
+  if (entries.empty()) return;
+
+  std::lock_guard<std::mutex> lock{manifest_mutex};
+  const std::filesystem::path manifest_path =
+      outdir / std::filesystem::path{kManifestFilename};
+
+  std::map<std::string, std::string> lines;
+  {
+    std::ifstream stream(manifest_path);
+    std::string line;
+    while (std::getline(stream, line)) {
+      if (line.empty()) continue;
+      lines[line.substr(0, line.find('\t'))] = line;
+    }
+  }
+
+  for (const ManifestEntry& entry : entries) {
+    const std::string key = entry.gsflib_path.generic_u8string();
+    lines[key] = key + '\t' + entry.game_code + '\t' + entry.rom_name;
+  }
+
+  // The temporary file is unique to the process, so that another process
+  // writing the manifest does not write into it.
+  std::random_device random;
+  std::ostringstream suffix;
+  suffix << '.' << ProcessId() << '.' << std::hex << std::setfill('0')
+         << std::setw(8) << random() << ".tmp";
+  std::filesystem::path temporary_path{manifest_path};
+  temporary_path += suffix.str();
+  {
+    std::ofstream stream(temporary_path, std::ios::out | std::ios::trunc);
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+    for (const auto& [_, line] : lines) stream << line << '\n';
+  }
+  std::filesystem::rename(temporary_path, manifest_path);
+}
+
+}  // namespace gaxtapper
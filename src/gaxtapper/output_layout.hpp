@@ -0,0 +1,68 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_OUTPUT_LAYOUT_HPP_
+#define GAXTAPPER_OUTPUT_LAYOUT_HPP_
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "cartridge.hpp"
+
+namespace gaxtapper {
+
+// Places the GSF set of each ROM in a subdirectory of the output directory,
+// to keep the directories small when a large number of ROMs are extracted
+// into one tree. The subdirectory is given by a pattern such as
+// "{prefix}/{region}/{code}" with these fields:
+//
+//   {game_code}  the full game code (AGB-XXXX-XXX)
+//   {code}       the 4-character game code
+//   {prefix}     the first character of the game code
+//   {region}     the region of the game code (USA, EUR, JPN...)
+//   {shard}      2 hex digits of the hash of the game code (00-ff)
+//   {title}      the game title in the ROM header
+//
+// The path of each gsflib is recorded in a manifest in the output directory.
+class OutputLayout {
+ public:
+  static constexpr std::string_view kManifestFilename = "layout.tsv";
+
+  OutputLayout() = default;
+
+  // Throws std::invalid_argument for an unknown field or a path that would
+  // leave the output directory.
+  explicit OutputLayout(std::string pattern);
+
+  [[nodiscard]] bool empty() const noexcept { return pattern_.empty(); }
+  [[nodiscard]] const std::string& pattern() const noexcept {
+    return pattern_;
+  }
+
+  // Returns the subdirectory for the ROM, relative to the output directory.
+  [[nodiscard]] std::filesystem::path Directory(
+      const Cartridge& cartridge) const;
+
+  // A line of the manifest: the path of a gsflib (relative to the output
+  // directory) with the game code and the ROM filename.
+  struct ManifestEntry {
+    std::filesystem::path gsflib_path;
+    std::string game_code;
+    std::string rom_name;
+  };
+
+  // Records the entries in one rewrite of the manifest, replacing the old
+  // lines of the same gsflibs. The manifest is a tab-separated file sorted
+  // by the path. The processes that write into the same output directory
+  // at the same time may lose each other's lines, so that many ROMs are
+  // better extracted by one batch.
+  static void RecordInManifest(const std::filesystem::path& outdir,
+                               const std::vector<ManifestEntry>& entries);
+
+ private:
+  std::string pattern_;
+};
+
+}  // namespace gaxtapper
+
+#endif
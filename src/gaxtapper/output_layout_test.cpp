@@ -0,0 +1,100 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "output_layout.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include "cartridge.hpp"
+#include "hash.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+Cartridge MakeCartridge(std::string_view title, std::string_view code) {
+  Cartridge cartridge;
+  cartridge.rom().assign(Cartridge::kHeaderSize, '\0');
+  cartridge.rom().replace(0xa0, title.size(), title);
+  cartridge.rom().replace(0xac, code.size(), code);
+  return cartridge;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  return {std::istreambuf_iterator<char>(stream),
+          std::istreambuf_iterator<char>()};
+}
+
+void TestPattern() {
+  EXPECT_THROW(OutputLayout{"/gsf/{code}"}, std::invalid_argument);
+  EXPECT_THROW(OutputLayout{"{prefix}/../{code}"}, std::invalid_argument);
+  EXPECT_THROW(OutputLayout{"{publisher}"}, std::invalid_argument);
+  EXPECT_THROW(OutputLayout{"{code"}, std::invalid_argument);
+  EXPECT(OutputLayout{}.empty());
+
+  const Cartridge cartridge = MakeCartridge("MY GAME", "AXYE");
+  const auto directory = [&](const std::string& pattern) {
+    return OutputLayout{pattern}.Directory(cartridge).generic_string();
+  };
+  EXPECT(directory("{prefix}/{region}/{code}") == "A/USA/AXYE");
+  EXPECT(directory("{game_code}") == "AGB-AXYE-USA");
+  EXPECT(directory("gsf-{code}//{title}/") == "gsf-AXYE/MY GAME");
+
+  char shard[3];
+  std::snprintf(shard, sizeof(shard), "%02x",
+                static_cast<unsigned>(HashBytes("AXYE") & 0xff));
+  EXPECT(directory("{shard}/{code}") == std::string{shard} + "/AXYE");
+
+  // A field never adds a directory level or leaves the directory, and an
+  // empty field keeps its level.
+  const Cartridge unsafe = MakeCartridge("A/B:..", "BQ?J");
+  EXPECT(OutputLayout{"{title}/{code}"}.Directory(unsafe).generic_string() ==
+         "A_B_../BQ_J");
+  const Cartridge blank = MakeCartridge("..", "");
+  EXPECT(OutputLayout{"{title}/{code}/{region}"}
+             .Directory(blank)
+             .generic_string() == "_/_/XXX");
+}
+
+void TestManifest() {
+  const testing::TemporaryDirectory outdir;
+  const std::filesystem::path manifest_path =
+      outdir.path() / std::filesystem::path{OutputLayout::kManifestFilename};
+
+  OutputLayout::RecordInManifest(outdir.path(), {});
+  EXPECT(!std::filesystem::exists(manifest_path));
+
+  OutputLayout::RecordInManifest(
+      outdir.path(), {{"B/BBBE/bbb.gsflib", "AGB-BBBE-USA", "bbb.gba"},
+                      {"A/AAAJ/aaa.gsflib", "AGB-AAAJ-JPN", "aaa.gba"}});
+  EXPECT(ReadFile(manifest_path) ==
+         "A/AAAJ/aaa.gsflib\tAGB-AAAJ-JPN\taaa.gba\n"
+         "B/BBBE/bbb.gsflib\tAGB-BBBE-USA\tbbb.gba\n");
+
+  // The lines of the same gsflibs are replaced, and the others are kept in
+  // the order of the paths.
+  OutputLayout::RecordInManifest(
+      outdir.path(), {{"B/BBBE/bbb.gsflib", "AGB-BBBE-USA", "bbb (v1.1).gba"},
+                      {"A/AAAP/aaa.gsflib", "AGB-AAAP-EUR", "aaa (E).gba"}});
+  EXPECT(ReadFile(manifest_path) ==
+         "A/AAAJ/aaa.gsflib\tAGB-AAAJ-JPN\taaa.gba\n"
+         "A/AAAP/aaa.gsflib\tAGB-AAAP-EUR\taaa (E).gba\n"
+         "B/BBBE/bbb.gsflib\tAGB-BBBE-USA\tbbb (v1.1).gba\n");
+
+  // No temporary file is left behind.
+  EXPECT(std::distance(std::filesystem::directory_iterator{outdir.path()},
+                       std::filesystem::directory_iterator{}) == 1);
+}
+
+}  // namespace
+
+int main() {
+  TestPattern();
+  TestManifest();
+  return testing::num_failures != 0;
+}
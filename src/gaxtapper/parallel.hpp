@@ -0,0 +1,78 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_PARALLEL_HPP_
+#define GAXTAPPER_PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "task_pool.hpp"
+
+namespace gaxtapper {
+
+[[nodiscard]] inline unsigned DefaultThreadCount() noexcept {
+  const unsigned count = std::thread::hardware_concurrency();
+  return count != 0 ? count : 1;
+}
+
+/// Calls function(index, worker) for each index in [0, count) on a set of
+/// worker threads. Worker numbers are in [0, num_threads), so the caller can
+/// keep per-worker state without locking. The first exception is rethrown.
+///
+/// Inside a task of a TaskPool, the workers are tasks of the same pool
+/// (num_threads = 0 means the size of the pool), and the calling thread runs
+/// the other tasks of the pool while it waits for them.
+template <typename Function>
+void ParallelFor(std::size_t count, Function&& function,
+                 unsigned num_threads = 0) {
+  TaskPool* const pool = TaskPool::Current();
+  if (num_threads == 0)
+    num_threads = pool != nullptr ? pool->size() : DefaultThreadCount();
+  num_threads = static_cast<unsigned>(
+      std::min<std::size_t>(num_threads, std::max<std::size_t>(count, 1)));
+
+  std::atomic<std::size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&](unsigned worker_index) {
+    for (;;) {
+      const std::size_t index = next.fetch_add(1);
+      if (index >= count) break;
+      try {
+        function(index, worker_index);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{error_mutex};
+        if (!error) error = std::current_exception();
+        next = count;
+      }
+    }
+  };
+
+  if (pool != nullptr) {
+    std::atomic<unsigned> num_finished{0};
+    for (unsigned i = 1; i < num_threads; i++) {
+      pool->Submit([&, i] {
+        worker(i);
+        num_finished++;
+      });
+    }
+    worker(0);
+    pool->RunUntil([&] { return num_finished == num_threads - 1; });
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (unsigned i = 1; i < num_threads; i++) threads.emplace_back(worker, i);
+    worker(0);
+    for (std::thread& thread : threads) thread.join();
+  }
+
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace gaxtapper
+
+#endif
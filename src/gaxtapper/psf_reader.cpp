@@ -0,0 +1,164 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "psf_reader.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <zlib.h>
+#include "bytes.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+constexpr std::string_view kTagMarker = "[TAG]";
+
+// Removes the whitespace (control codes and spaces) around the string.
+std::string_view TrimTag(std::string_view s) {
+  while (!s.empty() && static_cast<unsigned char>(s.front()) <= 0x20)
+    s.remove_prefix(1);
+  while (!s.empty() && static_cast<unsigned char>(s.back()) <= 0x20)
+    s.remove_suffix(1);
+  return s;
+}
+
+}  // namespace
+
+PsfReader PsfReader::LoadFromFile(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file) {
+    std::ostringstream message;
+    message << path.string() << ": Unable to open the file";
+    throw std::runtime_error(message.str());
+  }
+  try {
+    return LoadFromStream(file);
+  } catch (const std::runtime_error& e) {
+    throw std::runtime_error(path.string() + ": " + e.what());
+  }
+}
+
+PsfReader PsfReader::LoadFromStream(std::istream& in) {
+  char header[kHeaderSize];
+  if (!in.read(header, kHeaderSize))
+    throw std::runtime_error("Not a PSF file");
+  PsfReader psf = ParseHeader(header);
+
+  in.seekg(0, std::ios::end);
+  const auto size = static_cast<std::uint64_t>(in.tellg());
+  if (!in || size < psf.tag_offset())
+    throw std::runtime_error("The file is truncated");
+  in.seekg(static_cast<std::streamoff>(psf.tag_offset()));
+  const std::string rest{std::istreambuf_iterator<char>(in),
+                         std::istreambuf_iterator<char>()};
+  if (in.bad()) throw std::runtime_error("Unable to read the tags");
+  psf.tags_ = ParseTags(rest);
+  return psf;
+}
+
+PsfReader PsfReader::MapFile(const std::filesystem::path& path) {
+  auto file = std::make_shared<const MappedFile>(path);
+  const std::string_view data = file->data();
+  try {
+    if (data.size() < kHeaderSize) throw std::runtime_error("Not a PSF file");
+    PsfReader psf = ParseHeader(data.data());
+    if (data.size() < psf.tag_offset())
+      throw std::runtime_error("The file is truncated");
+    psf.compressed_exe_ = data.substr(kHeaderSize + psf.reserved_size_,
+                                      psf.compressed_exe_size_);
+    psf.tags_ = ParseTags(data.substr(psf.tag_offset()));
+    psf.file_ = std::move(file);
+    return psf;
+  } catch (const std::runtime_error& e) {
+    throw std::runtime_error(path.string() + ": " + e.what());
+  }
+}
+
+bool PsfReader::VerifyCrc32() const {
+  // zlib takes the length as 32-bit, which the exe size always fits.
+  return crc32(0L, reinterpret_cast<const Bytef*>(compressed_exe_.data()),
+               static_cast<uInt>(compressed_exe_.size())) ==
+         compressed_exe_crc32_;
+}
+
+const std::string& PsfReader::Exe(std::size_t size) {
+  if (exe_complete_ || exe_.size() >= size) return exe_;
+
+  // The exe is inflated again from the start, which only costs the prefix
+  // that has been inflated before.
+  z_stream stream{};
+  if (inflateInit(&stream) != Z_OK)
+    throw std::runtime_error("Unable to initialize the decompressor.");
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed_exe_.data()));
+  stream.avail_in = static_cast<uInt>(compressed_exe_.size());
+
+  constexpr std::size_t kChunkSize = 0x10000;
+  std::string exe;
+  int status = Z_OK;
+  while (exe.size() < size && status != Z_STREAM_END) {
+    const std::size_t offset = exe.size();
+    exe.resize(offset + std::min(kChunkSize, size - offset));
+    stream.next_out = reinterpret_cast<Bytef*>(&exe[offset]);
+    stream.avail_out = static_cast<uInt>(exe.size() - offset);
+    status = inflate(&stream, Z_NO_FLUSH);
+    exe.resize(exe.size() - stream.avail_out);
+    if (status == Z_STREAM_END) break;
+    const bool truncated =
+        status == Z_BUF_ERROR || (status == Z_OK && stream.avail_in == 0 &&
+                                  stream.avail_out != 0);
+    if (status != Z_OK || truncated) {
+      inflateEnd(&stream);
+      throw std::runtime_error(truncated ? "The compressed exe is truncated"
+                                         : "The compressed exe is broken");
+    }
+  }
+  inflateEnd(&stream);
+
+  exe_ = std::move(exe);
+  exe_complete_ = status == Z_STREAM_END;
+  return exe_;
+}
+
+PsfReader PsfReader::ParseHeader(const char* header) {
+  if (std::string_view{header, 3} != "PSF")
+    throw std::runtime_error("Not a PSF file");
+
+  PsfReader psf;
+  psf.version_ = ReadInt8(&header[3]);
+  psf.reserved_size_ = ReadInt32L(&header[4]);
+  psf.compressed_exe_size_ = ReadInt32L(&header[8]);
+  psf.compressed_exe_crc32_ = ReadInt32L(&header[12]);
+  return psf;
+}
+
+std::map<std::string, std::string> PsfReader::ParseTags(std::string_view text) {
+  std::map<std::string, std::string> tags;
+  if (text.substr(0, kTagMarker.size()) != kTagMarker) return tags;
+  text.remove_prefix(kTagMarker.size());
+
+  while (!text.empty()) {
+    const std::size_t end = text.find('\n');
+    const std::string_view line = text.substr(0, end);
+    text.remove_prefix(end != std::string_view::npos ? end + 1 : text.size());
+
+    const std::size_t separator = line.find('=');
+    if (separator == std::string_view::npos) continue;
+    const std::string_view name = TrimTag(line.substr(0, separator));
+    if (name.empty()) continue;
+    const std::string_view value = TrimTag(line.substr(separator + 1));
+
+    const auto [it, inserted] =
+        tags.emplace(std::string{name}, std::string{value});
+    if (!inserted) (it->second += '\n') += value;
+  }
+  return tags;
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,94 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_PSF_READER_HPP_
+#define GAXTAPPER_PSF_READER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "mapped_file.hpp"
+
+namespace gaxtapper {
+
+// Reads the header and the tags of a PSF file. The tag section is found
+// from the sizes in the header, so the exe is neither read nor inflated.
+//
+// A file opened by MapFile also gives the exe. The file is mapped into
+// memory, and the exe is inflated only as far as it is asked for, so that
+// reading the GSF header of a large gsflib does not inflate all of it.
+class PsfReader {
+ public:
+  static constexpr std::size_t kHeaderSize = 16;
+  static constexpr std::size_t kWholeExe = static_cast<std::size_t>(-1);
+
+  static PsfReader LoadFromFile(const std::filesystem::path& path);
+  static PsfReader LoadFromStream(std::istream& in);
+  static PsfReader MapFile(const std::filesystem::path& path);
+
+  [[nodiscard]] std::uint8_t version() const noexcept { return version_; }
+  [[nodiscard]] std::uint32_t reserved_size() const noexcept {
+    return reserved_size_;
+  }
+  [[nodiscard]] std::uint32_t compressed_exe_size() const noexcept {
+    return compressed_exe_size_;
+  }
+  [[nodiscard]] std::uint32_t compressed_exe_crc32() const noexcept {
+    return compressed_exe_crc32_;
+  }
+
+  // The offset of the tag section, which is also the size of the file
+  // without the tags.
+  [[nodiscard]] std::uint64_t tag_offset() const noexcept {
+    return kHeaderSize + static_cast<std::uint64_t>(reserved_size_) +
+           compressed_exe_size_;
+  }
+
+  [[nodiscard]] const std::map<std::string, std::string>& tags()
+      const noexcept {
+    return tags_;
+  }
+  [[nodiscard]] std::map<std::string, std::string>& tags() noexcept {
+    return tags_;
+  }
+
+  // The compressed exe of a mapped file, which is empty for a file read
+  // from a stream.
+  [[nodiscard]] std::string_view compressed_exe() const noexcept {
+    return compressed_exe_;
+  }
+
+  // Returns whether the crc32 of the compressed exe matches the header.
+  [[nodiscard]] bool VerifyCrc32() const;
+
+  // Returns the exe inflated up to size bytes at least (less only if the
+  // exe is shorter). The whole exe is inflated by default, which also
+  // checks the adler32 of the zlib stream. Throws std::runtime_error if the
+  // compressed exe is broken.
+  const std::string& Exe(std::size_t size = kWholeExe);
+
+  // Parses the tag section (from "[TAG]"). The lines of a multi-line value
+  // are joined by newlines.
+  static std::map<std::string, std::string> ParseTags(std::string_view text);
+
+ private:
+  std::uint8_t version_ = 0;
+  std::uint32_t reserved_size_ = 0;
+  std::uint32_t compressed_exe_size_ = 0;
+  std::uint32_t compressed_exe_crc32_ = 0;
+  std::map<std::string, std::string> tags_;
+  std::shared_ptr<const MappedFile> file_;
+  std::string_view compressed_exe_;
+  std::string exe_;
+  bool exe_complete_ = false;
+
+  static PsfReader ParseHeader(const char* header);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -2,17 +2,42 @@
 
 #include "psf_writer.hpp"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 #include "bytes.hpp"
 
 namespace gaxtapper {
 
 PsfWriter::PsfWriter(uint8_t version, std::map<std::string, std::string> tags)
-    : version_{version},
-      exe_{compressed_exe_, zstr::default_buff_size, Z_BEST_COMPRESSION, 15},
-      tags_(std::move(tags)) {}
+    : version_{version}, tags_(std::move(tags)) {}
+
+void PsfWriter::SetExe(std::initializer_list<std::string_view> parts,
+                       const ZlibOptions& options) {
+  std::size_t exe_size = 0;
+  for (const std::string_view part : parts) exe_size += part.size();
+
+  const std::string reserved = reserved_.str();
+  const std::size_t exe_offset = kHeaderSize + reserved.size();
+  image_.clear();
+  image_.resize(exe_offset + ZlibCompressor::Bound(exe_size));
+  std::memcpy(&image_[kHeaderSize], reserved.data(), reserved.size());
+
+  std::uint32_t crc = 0;
+  const std::size_t compressed_size =
+      ZlibCompressor::Compress(parts, &image_[exe_offset], crc, options);
+
+  image_size_ = exe_offset + compressed_size;
+  WriteHeader(static_cast<std::uint32_t>(reserved.size()),
+              static_cast<std::uint32_t>(compressed_size), crc);
+}
 
 void PsfWriter::SaveToFile(const std::filesystem::path& path) {
   std::ofstream file(path, std::ios::out | std::ios::binary);
@@ -22,45 +47,107 @@ void PsfWriter::SaveToFile(const std::filesystem::path& path) {
 }
 
 void PsfWriter::SaveToStream(std::ostream& out) {
-  exe_.flush();
-  reserved_.flush();
+  if (image_.empty()) SetExe({});
+  out.write(image_.data(), static_cast<std::streamsize>(image_size_));
+  WriteTags(out, tags_);
+}
 
-  const std::string compressed_exe = compressed_exe_.str();
-  const std::string reserved = reserved_.str();
-  const std::uint32_t compressed_exe_crc32 =
-      crc32(0L, reinterpret_cast<const Bytef*>(compressed_exe.data()),
-            static_cast<uInt>(compressed_exe.size()));
-
-  const std::string header{NewHeader(compressed_exe, reserved, compressed_exe_crc32)};
-  out.write(header.data(), header.size());
-  out.write(reserved.data(), reserved.size());
-  out.write(compressed_exe.data(), compressed_exe.size());
-
-  if (!tags_.empty()) {
-    out.write("[TAG]", 5);
-
-    for (const auto& tag : tags_) {
-      const auto& key = tag.first;
-      const auto& value = tag.second;
-
-      std::istringstream value_reader{value};
-      std::string line;
-      while (std::getline(value_reader, line))
-        out << key << '=' << value << '\n';
+std::string PsfWriter::SaveToString() {
+  if (image_.empty()) SetExe({});
+  std::ostringstream tag_stream;
+  WriteTags(tag_stream, tags_);
+  const std::string tag_section = tag_stream.str();
+
+  // The tags go into the room left by the compressor, and the rest of the
+  // room is given back, so that the string does not keep the bound of the
+  // exe.
+  image_.resize(image_size_);
+  image_ += tag_section;
+  image_.shrink_to_fit();
+  image_size_ = 0;
+  return std::move(image_);
+}
+
+void PsfWriter::WriteTags(std::ostream& out,
+                          const std::map<std::string, std::string>& tags) {
+  if (tags.empty()) return;
+  out.write("[TAG]", 5);
+
+  for (const auto& tag : tags) {
+    const auto& key = tag.first;
+    const auto& value = tag.second;
+
+    std::istringstream value_reader{value};
+    std::string line;
+    while (std::getline(value_reader, line))
+      out << key << '=' << line << '\n';
+  }
+}
+
+void PsfWriter::ReplaceTags(const std::filesystem::path& path,
+                            std::uint64_t tag_offset,
+                            const std::map<std::string, std::string>& tags,
+                            bool atomic) {
+  std::ostringstream tag_stream;
+  WriteTags(tag_stream, tags);
+  const std::string tag_section = tag_stream.str();
+
+  if (!atomic) {
+    {
+      std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+      file.exceptions(std::ios::badbit | std::ios::failbit);
+      file.seekp(static_cast<std::streamoff>(tag_offset));
+      file.write(tag_section.data(), tag_section.size());
+    }
+    std::filesystem::resize_file(path, tag_offset + tag_section.size());
+    return;
+  }
+
+  // The name is unique, since a retag may run on the same file from several
+  // processes at once.
+  std::random_device random;
+  std::ostringstream suffix;
+  suffix << '.' << std::hex << std::setfill('0') << std::setw(8) << random()
+         << ".tmp";
+  std::filesystem::path temporary_path{path};
+  temporary_path += suffix.str();
+  try {
+    {
+      std::ifstream in(path, std::ios::in | std::ios::binary);
+      in.exceptions(std::ios::badbit | std::ios::failbit);
+      std::ofstream out(temporary_path, std::ios::out | std::ios::binary);
+      out.exceptions(std::ios::badbit | std::ios::failbit);
+      std::string buffer(0x10000, '\0');
+      for (std::uint64_t remaining = tag_offset; remaining > 0;) {
+        const auto size = static_cast<std::streamsize>(
+            std::min<std::uint64_t>(remaining, buffer.size()));
+        in.read(buffer.data(), size);
+        out.write(buffer.data(), size);
+        remaining -= static_cast<std::uint64_t>(size);
+      }
+      out.write(tag_section.data(), tag_section.size());
+      out.close();
     }
+    // The new file keeps the permissions of the one it replaces.
+    std::filesystem::permissions(temporary_path,
+                                 std::filesystem::status(path).permissions());
+    std::filesystem::rename(temporary_path, path);
+  } catch (...) {
+    std::error_code error;
+    std::filesystem::remove(temporary_path, error);
+    throw;
   }
 }
 
-std::string PsfWriter::NewHeader(std::string_view compressed_exe,
-                                 std::string_view reserved,
-                                 std::uint32_t compressed_exe_crc32) const {
-  std::string header(16, 0);
-  std::memcpy(header.data(), "PSF", 3);
+void PsfWriter::WriteHeader(std::uint32_t reserved_size,
+                            std::uint32_t compressed_exe_size,
+                            std::uint32_t compressed_exe_crc32) {
+  char* const header = image_.data();
+  std::memcpy(header, "PSF", 3);
   WriteInt8(&header[3], version_);
-  WriteInt32L(&header[4], static_cast<std::uint32_t>(reserved.size()));
-  WriteInt32L(&header[8], static_cast<std::uint32_t>(compressed_exe.size()));
+  WriteInt32L(&header[4], reserved_size);
+  WriteInt32L(&header[8], compressed_exe_size);
   WriteInt32L(&header[12], compressed_exe_crc32);
-  return header;
 }
 
 }  // namespace gaxtapper
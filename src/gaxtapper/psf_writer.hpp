@@ -5,36 +5,68 @@
 
 #include <cstdint>
 #include <filesystem>
+#include <initializer_list>
 #include <map>
 #include <sstream>
 #include <string>
 #include <string_view>
-#include "zstr.hpp"
+#include "zlib_compressor.hpp"
 
 namespace gaxtapper {
 
+// Writes a PSF file. The exe is deflated straight into a single buffer that
+// holds the whole PSF image (header, reserved area and compressed exe), and
+// the CRC is computed while the compressed data is produced. Large exes are
+// compressed in parallel (see ZlibCompressor).
 class PsfWriter {
  public:
+  static constexpr std::size_t kHeaderSize = 16;
+
   PsfWriter(uint8_t version, std::map<std::string, std::string> tags = {});
 
   uint8_t version() const noexcept { return version_; }
-  std::ostream& exe() noexcept { return exe_; }
   std::ostream& reserved() noexcept { return reserved_; }
   std::map<std::string, std::string>& tags() noexcept { return tags_; }
 
+  // Compresses the exe, given as consecutive parts. The reserved area must
+  // be written before.
+  void SetExe(std::initializer_list<std::string_view> parts,
+              const ZlibOptions& options = {});
+
   void SaveToFile(const std::filesystem::path& path);
   void SaveToStream(std::ostream& out);
+  // Returns the whole PSF file with the tags, moving out the buffer of the
+  // image (trimmed to its size) instead of copying it. The writer is left
+  // without an exe.
+  [[nodiscard]] std::string SaveToString();
+
+  // Writes the tag section. A value of several lines is written as a tag
+  // for each line.
+  static void WriteTags(std::ostream& out,
+                        const std::map<std::string, std::string>& tags);
+
+  // Replaces the tags of an existing PSF file, whose tag section begins at
+  // tag_offset (see PsfReader). The file is rewritten in place from the
+  // offset and truncated, or, if atomic, copied to a temporary file that
+  // replaces the original one with its permissions. A failed atomic rewrite
+  // leaves the original file as it was.
+  static void ReplaceTags(const std::filesystem::path& path,
+                          std::uint64_t tag_offset,
+                          const std::map<std::string, std::string>& tags,
+                          bool atomic = false);
 
  private:
   uint8_t version_;
   std::ostringstream reserved_;
-  std::ostringstream compressed_exe_;
-  zstr::ostream exe_;
+  // The image, and the size of its content (without the room left for the
+  // compressor).
+  std::string image_;
+  std::size_t image_size_ = 0;
   std::map<std::string, std::string> tags_;
 
-  std::string NewHeader(std::string_view compressed_exe,
-                        std::string_view reserved,
-                        std::uint32_t compressed_exe_crc32) const;
+  void WriteHeader(std::uint32_t reserved_size,
+                   std::uint32_t compressed_exe_size,
+                   std::uint32_t compressed_exe_crc32);
 };
 
 }  // namespace gaxtapper
@@ -0,0 +1,97 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "psf_writer.hpp"
+
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <sstream>
+#include <string>
+#include "psf_reader.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+using Tags = std::map<std::string, std::string>;
+
+const Tags kLongTags{{"title", "A title long enough to be cut"},
+                     {"artist", "Artist"},
+                     {"comment", "First line\nSecond line"}};
+
+PsfWriter MakeWriter() {
+  PsfWriter writer{0x22, kLongTags};
+  writer.reserved() << "RESERVED";
+  writer.SetExe({"EXE:", std::string(0x3000, '\x5a')});
+  return writer;
+}
+
+void TestSave() {
+  const std::string psf = MakeWriter().SaveToString();
+  std::ostringstream stream;
+  MakeWriter().SaveToStream(stream);
+  EXPECT(stream.str() == psf);
+
+  std::istringstream in{psf};
+  const PsfReader reader = PsfReader::LoadFromStream(in);
+  EXPECT(reader.version() == 0x22);
+  EXPECT(reader.reserved_size() == 8);
+  EXPECT(reader.tags() == kLongTags);
+}
+
+// Retags a copy of the PSF, and checks that only the tags have changed.
+void TestReplaceTags(const std::filesystem::path& directory, bool atomic) {
+  const std::filesystem::path path =
+      directory / (atomic ? "atomic.psf" : "in_place.psf");
+  MakeWriter().SaveToFile(path);
+  const std::uintmax_t size = std::filesystem::file_size(path);
+  const std::uint64_t tag_offset = PsfReader::LoadFromFile(path).tag_offset();
+  const auto permissions = std::filesystem::perms::owner_read |
+                           std::filesystem::perms::owner_write |
+                           std::filesystem::perms::group_read;
+  std::filesystem::permissions(path, permissions);
+
+  // A shorter tag section, which leaves the end of the old one to be cut.
+  const Tags short_tags{{"title", "T"}};
+  PsfWriter::ReplaceTags(path, tag_offset, short_tags, atomic);
+  const PsfReader reader = PsfReader::MapFile(path);
+  EXPECT(reader.tags() == short_tags);
+  EXPECT(reader.VerifyCrc32());
+  std::ostringstream tag_section;
+  PsfWriter::WriteTags(tag_section, short_tags);
+  EXPECT(std::filesystem::file_size(path) ==
+         tag_offset + tag_section.str().size());
+  EXPECT(std::filesystem::status(path).permissions() == permissions);
+
+  // A longer one again.
+  PsfWriter::ReplaceTags(path, tag_offset, kLongTags, atomic);
+  EXPECT(std::filesystem::file_size(path) == size);
+  EXPECT(PsfReader::LoadFromFile(path).tags() == kLongTags);
+}
+
+// A failed atomic retag leaves neither a changed file nor a temporary file.
+void TestFailedReplaceTags(const std::filesystem::path& directory) {
+  const std::filesystem::path path = directory / "failed.psf";
+  MakeWriter().SaveToFile(path);
+  const std::uintmax_t size = std::filesystem::file_size(path);
+  // The tag offset is past the end of the file, so the copy fails.
+  EXPECT_THROW(
+      PsfWriter::ReplaceTags(path, size + 0x100, {{"title", "T"}}, true),
+      std::exception);
+  EXPECT(std::filesystem::file_size(path) == size);
+  EXPECT(PsfReader::LoadFromFile(path).tags() == kLongTags);
+  for (const auto& entry : std::filesystem::directory_iterator(directory))
+    EXPECT(entry.path().extension() != ".tmp");
+}
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  TestSave();
+  TestReplaceTags(directory.path(), false);
+  TestReplaceTags(directory.path(), true);
+  TestFailedReplaceTags(directory.path());
+  return testing::num_failures != 0;
+}
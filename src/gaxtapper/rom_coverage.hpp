@@ -0,0 +1,72 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ROM_COVERAGE_HPP_
+#define GAXTAPPER_ROM_COVERAGE_HPP_
+
+#include <cstdint>
+#include <vector>
+#include "types.hpp"
+
+namespace gaxtapper {
+
+// Bitmap of the ROM bytes that have been fetched or read by the CPU or DMA.
+class RomCoverage {
+ public:
+  RomCoverage() = default;
+
+  explicit RomCoverage(agbsize_t size)
+      : size_(size), bits_((static_cast<std::size_t>(size) + 63) / 64) {}
+
+  [[nodiscard]] agbsize_t size() const noexcept { return size_; }
+
+  [[nodiscard]] const std::vector<std::uint64_t>& words() const noexcept {
+    return bits_;
+  }
+
+  [[nodiscard]] std::vector<std::uint64_t>& words() noexcept { return bits_; }
+
+  [[nodiscard]] bool test(agbsize_t offset) const noexcept {
+    return offset < size_ && (bits_[offset / 64] >> (offset % 64) & 1) != 0;
+  }
+
+  // Marks a naturally aligned access of 1, 2 or 4 bytes.
+  void Mark(agbsize_t offset, agbsize_t size) noexcept {
+    bits_[offset / 64] |= ((std::uint64_t{1} << size) - 1) << (offset % 64);
+  }
+
+  void MarkRange(agbsize_t offset, agbsize_t size) noexcept {
+    for (agbsize_t i = 0; i < size && offset + i < size_; i++)
+      bits_[(offset + i) / 64] |= std::uint64_t{1} << ((offset + i) % 64);
+  }
+
+  [[nodiscard]] agbsize_t count() const noexcept {
+    agbsize_t total = 0;
+    for (std::uint64_t word : bits_) {
+      while (word != 0) {
+        word &= word - 1;
+        total++;
+      }
+    }
+    return total;
+  }
+
+  // Returns the offset just past the last covered byte.
+  [[nodiscard]] agbsize_t end() const noexcept {
+    for (std::size_t i = bits_.size(); i > 0; i--) {
+      if (std::uint64_t word = bits_[i - 1]; word != 0) {
+        agbsize_t bit = 63;
+        while ((word >> bit & 1) == 0) bit--;
+        return static_cast<agbsize_t>((i - 1) * 64 + bit + 1);
+      }
+    }
+    return 0;
+  }
+
+ private:
+  agbsize_t size_ = 0;
+  std::vector<std::uint64_t> bits_;
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,517 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "server.hpp"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "gax_driver.hpp"
+#include "gax_driver_param.hpp"
+#include "inspection_cache.hpp"
+#include "types.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+// The longest request line, which is far longer than any valid one.
+constexpr std::size_t kMaxLineSize = 0x10000;
+
+[[noreturn]] void ThrowSocketError(const std::filesystem::path& path,
+                                   std::string_view what) {
+  throw std::runtime_error(path.string() + ": " + std::string{what} + " (" +
+                           std::strerror(errno) + ")");
+}
+
+// Reads the lines and the data of the requests from a socket.
+class SocketReader {
+ public:
+  explicit SocketReader(int fd) : fd_(fd) {}
+
+  // Returns false at the end of the input, or if the line is too long.
+  bool ReadLine(std::string& line) {
+    line.clear();
+    for (;;) {
+      const std::size_t end = buffer_.find('\n', offset_);
+      if (end != std::string::npos) {
+        line.append(buffer_, offset_, end - offset_);
+        offset_ = end + 1;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+      }
+      line.append(buffer_, offset_);
+      offset_ = buffer_.size();
+      if (line.size() > kMaxLineSize || !Fill()) return false;
+    }
+  }
+
+  // Returns false if the input ends before size bytes.
+  bool Read(std::string& data, std::size_t size) {
+    data.clear();
+    data.reserve(size);
+    while (data.size() < size) {
+      if (offset_ == buffer_.size() && !Fill()) return false;
+      const std::size_t length =
+          std::min(size - data.size(), buffer_.size() - offset_);
+      data.append(buffer_, offset_, length);
+      offset_ += length;
+    }
+    return true;
+  }
+
+ private:
+  int fd_;
+  std::string buffer_;
+  std::size_t offset_ = 0;
+
+  bool Fill() {
+    buffer_.resize(0x10000);
+    offset_ = 0;
+    for (;;) {
+      const ssize_t length = recv(fd_, buffer_.data(), buffer_.size(), 0);
+      if (length < 0 && errno == EINTR) continue;
+      buffer_.resize(length > 0 ? static_cast<std::size_t>(length) : 0);
+      return length > 0;
+    }
+  }
+};
+
+bool SendAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t length = send(fd, data.data(), data.size(), 0);
+    if (length < 0 && errno == EINTR) continue;
+    if (length <= 0) return false;
+    data.remove_prefix(static_cast<std::size_t>(length));
+  }
+  return true;
+}
+
+// The number of bytes of the UTF-8 sequence at the start of text, or 0 if
+// it is not a valid sequence.
+std::size_t Utf8SequenceSize(std::string_view text) {
+  const auto lead = static_cast<unsigned char>(text[0]);
+  const std::size_t size = lead >= 0xf0 && lead <= 0xf4   ? 4
+                           : lead >= 0xe0                ? 3
+                           : lead >= 0xc2 && lead < 0xe0 ? 2
+                                                         : 0;
+  if (size == 0 || size > text.size()) return 0;
+  for (std::size_t i = 1; i < size; i++) {
+    if ((static_cast<unsigned char>(text[i]) & 0xc0) != 0x80) return 0;
+  }
+  return size;
+}
+
+// Writes the text as a JSON string. The bytes that are not UTF-8 (such as
+// the copyright sign of the song info) are read as Latin-1.
+void WriteJsonString(std::ostream& stream, std::string_view text) {
+  stream << '"';
+  while (!text.empty()) {
+    const auto c = static_cast<unsigned char>(text[0]);
+    std::size_t size = 1;
+    if (c == '"' || c == '\\') {
+      stream << '\\' << text[0];
+    } else if (c >= 0x20 && c < 0x80) {
+      stream << text[0];
+    } else if (c >= 0x80 && (size = Utf8SequenceSize(text)) != 0) {
+      stream << text.substr(0, size);
+    } else {
+      size = 1;
+      stream << "\\u" << std::hex << std::setfill('0') << std::setw(4)
+             << static_cast<unsigned>(c) << std::dec;
+    }
+    text.remove_prefix(size);
+  }
+  stream << '"';
+}
+
+void WriteJsonMember(std::ostream& stream, std::string_view name) {
+  stream << ',';
+  WriteJsonString(stream, name);
+  stream << ':';
+}
+
+void WriteJsonMember(std::ostream& stream, std::string_view name,
+                     std::string_view value) {
+  WriteJsonMember(stream, name);
+  WriteJsonString(stream, value);
+}
+
+std::string ErrorAnswer(std::string_view message) {
+  std::ostringstream answer;
+  answer << "{\"ok\":false";
+  WriteJsonMember(answer, "error", message);
+  answer << "}\n";
+  return answer.str();
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+Server::Server(std::filesystem::path socket_path,
+               const ServerOptions& options)
+    : socket_path_(std::move(socket_path)),
+      options_(options),
+      pool_(options.num_threads) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const std::string path = socket_path_.string();
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    throw std::runtime_error(path +
+                             ": The path of the socket is too long");
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) ThrowSocketError(socket_path_, "Unable to create");
+  fcntl(listen_fd_, F_SETFD, FD_CLOEXEC);
+
+  std::error_code error;
+  if (std::filesystem::is_socket(socket_path_, error)) {
+    // The socket of a server that has not exited cleanly is replaced.
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    const bool in_use =
+        fd >= 0 && connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                           sizeof(address)) == 0;
+    if (fd >= 0) close(fd);
+    if (in_use) {
+      close(listen_fd_);
+      throw std::runtime_error(path + ": Another server is listening");
+    }
+    std::filesystem::remove(socket_path_, error);
+  }
+
+  if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd_, SOMAXCONN) != 0) {
+    close(listen_fd_);
+    ThrowSocketError(socket_path_, "Unable to listen");
+  }
+  if (pipe(stop_pipe_) != 0) {
+    close(listen_fd_);
+    std::filesystem::remove(socket_path_, error);
+    ThrowSocketError(socket_path_, "Unable to create a pipe");
+  }
+}
+
+Server::~Server() {
+  JoinConnections(true);
+  close(listen_fd_);
+  close(stop_pipe_[0]);
+  close(stop_pipe_[1]);
+  std::error_code error;
+  std::filesystem::remove(socket_path_, error);
+}
+
+void Server::Run() {
+  // A client that goes away must not kill the server.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  for (;;) {
+    pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      ThrowSocketError(socket_path_, "Unable to wait for a connection");
+    }
+    if (fds[1].revents != 0) break;
+    if ((fds[0].revents & POLLIN) == 0) continue;
+
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0) continue;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    JoinConnections(false);
+    std::lock_guard<std::mutex> lock{mutex_};
+    // Each connection has a thread and may hold a ROM, so that their
+    // number is limited.
+    if (options_.max_connections != 0 &&
+        connections_.size() >= options_.max_connections) {
+      num_rejected_++;
+      (void)SendAll(fd, ErrorAnswer("Too many connections."));
+      close(fd);
+      continue;
+    }
+    Connection& connection = connections_.emplace_back();
+    connection.fd = fd;
+    connection.thread = std::thread(&Server::Serve, this, std::ref(connection));
+  }
+
+  JoinConnections(true);
+}
+
+void Server::Stop() noexcept {
+  const char c = 0;
+  (void)!write(stop_pipe_[1], &c, 1);
+}
+
+void Server::Serve(Connection& connection) {
+  SocketReader reader{connection.fd};
+  std::string line;
+  while (reader.ReadLine(line)) {
+    if (line.empty()) continue;
+
+    Request request;
+    std::string error;
+    std::size_t size = 0;
+    bool has_size = false;
+    bool bad_size = false;
+    std::string_view fields{line};
+    std::size_t end = fields.find('\t');
+    request.command = std::string{fields.substr(0, end)};
+    while (end != std::string_view::npos) {
+      fields.remove_prefix(end + 1);
+      end = fields.find('\t');
+      const std::string_view field = fields.substr(0, end);
+      const std::size_t separator = field.find('=');
+      const std::string_view key = field.substr(0, separator);
+      const std::string_view value = separator != std::string_view::npos
+                                         ? field.substr(separator + 1)
+                                         : std::string_view{};
+      if (key == "path") {
+        request.path = std::filesystem::u8path(value);
+      } else if (key == "name") {
+        request.name = std::string{value};
+      } else if (key == "size") {
+        const auto [ptr, ec] =
+            std::from_chars(value.data(), value.data() + value.size(), size);
+        has_size = ec == std::errc{} && ptr == value.data() + value.size();
+        bad_size = !has_size;
+      } else if (!field.empty()) {
+        error = "Unknown option \"" + std::string{key} + "\".";
+      }
+    }
+
+    // The connection is closed after a request whose ROM cannot be read,
+    // since the start of the next request is not known.
+    if (bad_size || (has_size && size > Cartridge::kMaximumSize)) {
+      num_requests_++;
+      num_failed_++;
+      (void)SendAll(connection.fd,
+                    ErrorAnswer(bad_size ? "The size is not a number."
+                                         : "The ROM is too large."));
+      break;
+    }
+    if (has_size && !reader.Read(request.rom, size)) break;
+
+    if (error.empty() && (request.command == "inspect" ||
+                          request.command == "extract")) {
+      if (has_size == !request.path.empty())
+        error = "Either the size or the path of the ROM must be given.";
+    }
+
+    std::string answer;
+    if (!error.empty()) {
+      num_requests_++;
+      num_failed_++;
+      answer = ErrorAnswer(error);
+    } else if (request.command == "stats") {
+      answer = Stats();
+    } else {
+      answer = Answer(request);
+    }
+    if (!SendAll(connection.fd, answer)) break;
+  }
+
+  // The socket is closed when the thread is joined, so that its number is
+  // not reused while JoinConnections may shut it down.
+  shutdown(connection.fd, SHUT_RDWR);
+  connection.finished = true;
+}
+
+std::string Server::Answer(const Request& request) {
+  num_requests_++;
+  std::promise<std::string> answer;
+  pool_.Submit([&] {
+    try {
+      if (request.command != "inspect" && request.command != "extract") {
+        throw std::invalid_argument("Unknown command \"" + request.command +
+                                    "\".");
+      }
+      const Cartridge cartridge =
+          request.path.empty() ? Cartridge::LoadFromMemory(request.rom)
+                               : Cartridge::LoadFromFile(request.path);
+      if (request.command == "inspect") {
+        answer.set_value(Inspect(cartridge));
+        return;
+      }
+
+      std::string name = request.name;
+      if (name.empty())
+        name = request.path.empty() ? "rom" : request.path.stem().u8string();
+      answer.set_value(Extract(cartridge, name));
+    } catch (const std::exception& e) {
+      num_failed_++;
+      answer.set_value(ErrorAnswer(e.what()));
+    }
+  });
+  return answer.get_future().get();
+}
+
+std::string Server::Inspect(const Cartridge& cartridge) const {
+  const auto start = std::chrono::steady_clock::now();
+  bool hit = false;
+  const GaxDriverParam param =
+      options_.extract.inspect_cache.empty()
+          ? GaxDriver::Inspect(cartridge.rom())
+          : InspectionCache{options_.extract.inspect_cache}.Inspect(
+                cartridge.rom(), &hit);
+
+  std::ostringstream answer;
+  answer << "{\"ok\":true";
+  WriteJsonMember(answer, "game_title", cartridge.game_title());
+  WriteJsonMember(answer, "game_code", cartridge.full_game_code());
+  WriteJsonMember(answer, "gax");
+  answer << (param.ok() ? "true" : "false");
+  WriteJsonMember(answer, "major_version");
+  answer << param.version().major_version();
+  WriteJsonMember(answer, "minor_version");
+  answer << param.version().minor_version();
+  WriteJsonMember(answer, "version_text", param.version_text());
+  WriteJsonMember(answer, "gax2_estimate", to_string(param.gax2_estimate()));
+  WriteJsonMember(answer, "gax2_new", to_string(param.gax2_new()));
+  WriteJsonMember(answer, "gax2_init", to_string(param.gax2_init()));
+  WriteJsonMember(answer, "gax_irq", to_string(param.gax_irq()));
+  WriteJsonMember(answer, "gax_play", to_string(param.gax_play()));
+  WriteJsonMember(answer, "wram_pointer",
+                  to_string(param.gax_wram_pointer()));
+  WriteJsonMember(answer, "fx",
+                  to_string(param.fx() ? param.fx().address() : agbnullptr));
+  WriteJsonMember(answer, "songs");
+  answer << '[';
+  for (std::size_t i = 0; i < param.songs().size(); i++) {
+    const GaxMusicEntry& song = param.songs()[i];
+    if (i != 0) answer << ',';
+    answer << "{\"address\":";
+    WriteJsonString(answer, to_string(song.address()));
+    WriteJsonMember(answer, "name", song.info().parsed_name());
+    WriteJsonMember(answer, "artist", song.info().parsed_artist());
+    WriteJsonMember(answer, "channels");
+    answer << song.num_channels();
+    WriteJsonMember(answer, "mixing_rate");
+    answer << song.mixing_rate();
+    answer << '}';
+  }
+  answer << ']';
+  WriteJsonMember(answer, "cached");
+  answer << (hit ? "true" : "false");
+  WriteJsonMember(answer, "seconds");
+  answer << SecondsSince(start) << "}\n";
+  return answer.str();
+}
+
+std::string Server::Extract(const Cartridge& cartridge,
+                            const std::string& name) const {
+  const auto start = std::chrono::steady_clock::now();
+  const GsfSet set =
+      Gaxtapper::BuildGsfSet(cartridge.rom(), name, options_.extract);
+
+  std::vector<const GsfSetFile*> files{&set.gsflib};
+  for (const GsfSetFile& minigsf : set.minigsfs) files.push_back(&minigsf);
+
+  std::ostringstream answer;
+  answer << "{\"ok\":true";
+  WriteJsonMember(answer, "game_title", set.game_title);
+  WriteJsonMember(answer, "game_code", set.game_code);
+  WriteJsonMember(answer, "version_text", set.gax_version);
+  WriteJsonMember(answer, "driver_address", to_string(set.driver_address));
+  WriteJsonMember(answer, "work_address", to_string(set.work_address));
+  WriteJsonMember(answer, "minigsf_address", to_string(set.minigsf_address));
+  WriteJsonMember(answer, "gsflib_size");
+  answer << set.gsflib_size;
+  WriteJsonMember(answer, "warnings");
+  answer << '[';
+  for (std::size_t i = 0; i < set.warnings.size(); i++) {
+    if (i != 0) answer << ',';
+    WriteJsonString(answer, set.warnings[i]);
+  }
+  answer << ']';
+  WriteJsonMember(answer, "files");
+  answer << '[';
+  for (std::size_t i = 0; i < files.size(); i++) {
+    if (i != 0) answer << ',';
+    answer << "{\"filename\":";
+    WriteJsonString(answer, files[i]->filename);
+    WriteJsonMember(answer, "size");
+    answer << files[i]->data.size();
+    if (files[i]->song_address != agbnullptr)
+      WriteJsonMember(answer, "song", to_string(files[i]->song_address));
+    answer << '}';
+  }
+  answer << ']';
+  WriteJsonMember(answer, "seconds");
+  answer << SecondsSince(start) << "}\n";
+  for (const GsfSetFile* file : files) answer << file->data;
+  return answer.str();
+}
+
+std::string Server::Stats() {
+  std::size_t num_connections = 0;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const Connection& connection : connections_) {
+      if (!connection.finished) num_connections++;
+    }
+  }
+
+  std::ostringstream answer;
+  answer << "{\"ok\":true";
+  WriteJsonMember(answer, "requests");
+  answer << num_requests_.load();
+  WriteJsonMember(answer, "failed");
+  answer << num_failed_.load();
+  WriteJsonMember(answer, "connections");
+  answer << num_connections;
+  WriteJsonMember(answer, "rejected");
+  answer << num_rejected_.load();
+  WriteJsonMember(answer, "threads");
+  answer << pool_.size();
+  WriteJsonMember(answer, "busy_seconds");
+  answer << pool_.busy_seconds();
+  answer << "}\n";
+  return answer.str();
+}
+
+void Server::JoinConnections(bool all) {
+  std::list<Connection> finished;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (auto it = connections_.begin(); it != connections_.end();) {
+      const auto next = std::next(it);
+      if (all || it->finished) {
+        // The requests in progress are answered, but no more are read.
+        if (!it->finished) shutdown(it->fd, SHUT_RD);
+        finished.splice(finished.end(), connections_, it);
+      }
+      it = next;
+    }
+  }
+  for (Connection& connection : finished) {
+    connection.thread.join();
+    close(connection.fd);
+  }
+}
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,113 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_SERVER_HPP_
+#define GAXTAPPER_SERVER_HPP_
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "cartridge.hpp"
+#include "gaxtapper.hpp"
+#include "task_pool.hpp"
+
+namespace gaxtapper {
+
+// Options of Server.
+struct ServerOptions {
+  // The extraction of the extract requests. The options of the output are
+  // ignored (see Gaxtapper::BuildGsfSet), and inspect_cache is used by the
+  // inspect requests as well.
+  GsfSetOptions extract;
+  // The number of threads shared by all the requests (0 = all cores).
+  unsigned num_threads = 0;
+  // The connections served at the same time. A connection over the limit
+  // gets an error answer and is closed (0 = no limit).
+  std::size_t max_connections = 64;
+};
+
+// Answers the inspect and extract requests of the clients of a Unix domain
+// socket, so that a tool that processes many ROMs does not start a process
+// for each ROM. The requests of all the connections run as tasks of one
+// TaskPool, and the requests of a connection are answered in order.
+//
+// A request is a line of tab-separated fields, the command and then
+// key=value options, followed by the ROM if the size option is given:
+//   inspect <TAB> path=<file> <LF>
+//   inspect <TAB> size=<bytes> <LF> <ROM>
+//   extract <TAB> size=<bytes> [<TAB> name=<basename>] <LF> <ROM>
+//   stats <LF>
+// where path= can take the place of size= in an extract request too. The
+// path is a file on the side of the server.
+// The answer is a line with a JSON object, whose "ok" member tells whether
+// the request succeeded ("error" is the message if it did not). The answer
+// to extract lists the files with their size, and is followed by the
+// contents of the files in that order. A request whose ROM cannot be read
+// gets an error answer, and the connection is closed, since the start of the
+// next request is not known.
+class Server {
+ public:
+  // Throws std::runtime_error if the socket cannot be created. A socket
+  // file that no server is listening on is replaced.
+  Server(std::filesystem::path socket_path, const ServerOptions& options);
+  ~Server();
+
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  [[nodiscard]] const std::filesystem::path& socket_path() const noexcept {
+    return socket_path_;
+  }
+
+  // Accepts connections until Stop is called, and then waits for the
+  // requests in progress.
+  void Run();
+  // Makes Run return. Can be called from a signal handler.
+  void Stop() noexcept;
+
+ private:
+  struct Connection {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> finished{false};
+  };
+  struct Request {
+    std::string command;
+    std::filesystem::path path;
+    std::string name;
+    std::string rom;
+  };
+
+  std::filesystem::path socket_path_;
+  ServerOptions options_;
+  int listen_fd_ = -1;
+  // Stop writes to the pipe to wake up Run.
+  int stop_pipe_[2] = {-1, -1};
+  TaskPool pool_;
+  std::mutex mutex_;
+  std::list<Connection> connections_;
+  std::atomic<std::size_t> num_requests_{0};
+  std::atomic<std::size_t> num_failed_{0};
+  std::atomic<std::size_t> num_rejected_{0};
+
+  void Serve(Connection& connection);
+  // Runs the request as a task of the pool, and returns the answer.
+  std::string Answer(const Request& request);
+  [[nodiscard]] std::string Inspect(const Cartridge& cartridge) const;
+  [[nodiscard]] std::string Extract(const Cartridge& cartridge,
+                                    const std::string& name) const;
+  [[nodiscard]] std::string Stats();
+  void JoinConnections(bool all);
+};
+
+}  // namespace gaxtapper
+
+#endif
+
+#endif
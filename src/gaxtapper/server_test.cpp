@@ -0,0 +1,127 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "server.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+// A client of the server, which reads the answers line by line.
+class Client {
+ public:
+  explicit Client(const std::filesystem::path& path)
+      : fd_(socket(AF_UNIX, SOCK_STREAM, 0)) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    EXPECT(connect(fd_, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)) == 0);
+  }
+  ~Client() { close(fd_); }
+
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  void Send(std::string_view data) {
+    while (!data.empty()) {
+      const ssize_t length = send(fd_, data.data(), data.size(), 0);
+      if (length <= 0) return;
+      data.remove_prefix(static_cast<std::size_t>(length));
+    }
+  }
+
+  // Returns the next line, or an empty string when the server has closed
+  // the connection.
+  std::string ReadLine() {
+    std::string line;
+    char c;
+    while (recv(fd_, &c, 1, 0) == 1) {
+      if (c == '\n') return line;
+      line += c;
+    }
+    return {};
+  }
+
+ private:
+  int fd_;
+};
+
+bool StartsWith(std::string_view text, std::string_view prefix) {
+  return text.substr(0, prefix.size()) == prefix;
+}
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  ServerOptions options;
+  options.num_threads = 2;
+  options.max_connections = 2;
+  Server server{directory.path() / "gaxtapper.sock", options};
+  std::thread thread{[&] { server.Run(); }};
+
+  {
+    Client client{server.socket_path()};
+    client.Send("stats\n");
+    EXPECT(StartsWith(client.ReadLine(), "{\"ok\":true,\"requests\":0,"));
+
+    client.Send("play\tsize=4\nROM!");
+    EXPECT(client.ReadLine() ==
+           "{\"ok\":false,\"error\":\"Unknown command \\\"play\\\".\"}");
+    client.Send("inspect\tcolor=red\n");
+    EXPECT(client.ReadLine() ==
+           "{\"ok\":false,\"error\":\"Unknown option \\\"color\\\".\"}");
+    client.Send("inspect\n");
+    EXPECT(StartsWith(client.ReadLine(), "{\"ok\":false,"));
+
+    // A ROM without GAX is inspected, and the answer says so.
+    const std::string rom(0x1000, '\x01');
+    client.Send("inspect\tsize=" + std::to_string(rom.size()) + "\n" + rom);
+    const std::string answer = client.ReadLine();
+    EXPECT(StartsWith(answer, "{\"ok\":true,"));
+    EXPECT(answer.find("\"gax\":false") != std::string::npos);
+
+    // The connection is closed after a size that is not a number, whose ROM
+    // would be read as the next request otherwise.
+    client.Send("inspect\tsize=12x\nstats\n");
+    EXPECT(client.ReadLine() ==
+           "{\"ok\":false,\"error\":\"The size is not a number.\"}");
+    EXPECT(client.ReadLine().empty());
+  }
+
+  // The connections over the limit get an error and are closed.
+  {
+    // The closed connection counts until its thread has finished.
+    Client first{server.socket_path()};
+    for (int i = 0; i < 100; i++) {
+      first.Send("stats\n");
+      if (first.ReadLine().find("\"connections\":1,") != std::string::npos)
+        break;
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    Client second{server.socket_path()};
+    second.Send("stats\n");
+    EXPECT(StartsWith(second.ReadLine(), "{\"ok\":true,"));
+
+    Client third{server.socket_path()};
+    EXPECT(third.ReadLine() ==
+           "{\"ok\":false,\"error\":\"Too many connections.\"}");
+    EXPECT(third.ReadLine().empty());
+    first.Send("stats\n");
+    EXPECT(first.ReadLine().find("\"rejected\":1,") != std::string::npos);
+  }
+
+  server.Stop();
+  thread.join();
+  return testing::num_failures != 0;
+}
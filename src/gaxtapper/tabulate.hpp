@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <tuple>
 #include <vector>
 
 namespace gaxtapper {
@@ -0,0 +1,114 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "task_pool.hpp"
+
+#include <chrono>
+#include <utility>
+#include "parallel.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+thread_local TaskPool* current_pool = nullptr;
+thread_local unsigned current_queue = 0;
+
+}  // namespace
+
+TaskPool::TaskPool(unsigned num_threads) {
+  if (num_threads == 0) num_threads = DefaultThreadCount();
+  for (unsigned i = 0; i <= num_threads; i++)
+    queues_.push_back(std::make_unique<Queue>());
+  threads_.reserve(num_threads);
+  for (unsigned i = 0; i < num_threads; i++)
+    threads_.emplace_back(&TaskPool::Work, this, i);
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  changed_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+void TaskPool::Submit(Task task) {
+  const unsigned index = current_pool == this ? current_queue : size();
+  {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+    num_queued_++;
+  }
+  { std::lock_guard<std::mutex> lock{mutex_}; }
+  changed_.notify_one();
+}
+
+void TaskPool::RunUntil(const std::function<bool()>& done) {
+  TaskPool* const saved_pool = current_pool;
+  const unsigned saved_queue = current_queue;
+  if (current_pool != this) {
+    current_pool = this;
+    current_queue = size();
+  }
+
+  while (!done()) {
+    if (RunOne(current_queue)) continue;
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&] { return num_queued_ != 0 || done(); });
+  }
+
+  current_pool = saved_pool;
+  current_queue = saved_queue;
+}
+
+TaskPool* TaskPool::Current() noexcept { return current_pool; }
+
+void TaskPool::Work(unsigned index) {
+  current_pool = this;
+  current_queue = index;
+  for (;;) {
+    const auto start = std::chrono::steady_clock::now();
+    if (RunOne(index)) {
+      const auto elapsed = std::chrono::steady_clock::now() - start;
+      busy_nanoseconds_ +=
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+              .count();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock{mutex_};
+    changed_.wait(lock, [&] { return num_queued_ != 0 || stopping_; });
+    if (num_queued_ == 0 && stopping_) return;
+  }
+}
+
+bool TaskPool::RunOne(unsigned index) {
+  Task task;
+  const std::size_t num_queues = queues_.size();
+  for (std::size_t i = 0; i < num_queues && !task; i++) {
+    Queue& queue = *queues_[(index + i) % num_queues];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (queue.tasks.empty()) continue;
+    if (i == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    num_queued_--;
+  }
+  if (!task) return false;
+
+  task();
+  Finished();
+  return true;
+}
+
+void TaskPool::Finished() {
+  { std::lock_guard<std::mutex> lock{mutex_}; }
+  changed_.notify_all();
+}
+
+}  // namespace gaxtapper
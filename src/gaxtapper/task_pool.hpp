@@ -0,0 +1,80 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_TASK_POOL_HPP_
+#define GAXTAPPER_TASK_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gaxtapper {
+
+// A thread pool with a task queue for each worker. A worker runs the newest
+// task of its own queue first, and takes the oldest task of another queue
+// when its own queue is empty, so that the tasks spawned by a large job
+// spread to the idle workers while each worker keeps to the job it is on.
+//
+// While a task runs, ParallelFor submits its indices to the pool instead of
+// starting threads, so the nested loops (such as the blocks of a gsflib)
+// share the workers with the other jobs.
+class TaskPool {
+ public:
+  using Task = std::function<void()>;
+
+  explicit TaskPool(unsigned num_threads = 0);
+  ~TaskPool();
+
+  TaskPool(const TaskPool&) = delete;
+  TaskPool& operator=(const TaskPool&) = delete;
+
+  [[nodiscard]] unsigned size() const noexcept {
+    return static_cast<unsigned>(threads_.size());
+  }
+
+  // Queues a task, in the queue of the calling worker if it is one. The
+  // task must not throw.
+  void Submit(Task task);
+
+  // Runs the queued tasks on the calling thread until done() returns true.
+  // done() is checked again each time a task finishes.
+  void RunUntil(const std::function<bool()>& done);
+
+  // The time that the workers spent running tasks, summed over the workers.
+  // The tasks run by RunUntil on other threads are not counted.
+  [[nodiscard]] double busy_seconds() const noexcept {
+    return busy_nanoseconds_ / 1e9;
+  }
+
+  // The pool of the task that the calling thread is running, or nullptr.
+  [[nodiscard]] static TaskPool* Current() noexcept;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // The queues of the workers, and the last one for the other threads.
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::atomic<std::size_t> num_queued_{0};
+  std::atomic<std::int64_t> busy_nanoseconds_{0};
+  bool stopping_ = false;
+
+  void Work(unsigned index);
+  bool RunOne(unsigned index);
+  void Finished();
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,73 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_TESTING_HPP_
+#define GAXTAPPER_TESTING_HPP_
+
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <system_error>
+
+namespace gaxtapper {
+namespace testing {
+
+// The number of failed checks, which is the exit status of a test.
+inline int num_failures = 0;
+
+inline void Fail(const char* file, int line, const char* condition) {
+  std::cerr << file << ":" << line << ": Failed: " << condition << std::endl;
+  num_failures++;
+}
+
+// A new directory under the temporary directory, which is removed with its
+// contents at the end of the test.
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    std::random_device random;
+    path_ = std::filesystem::temp_directory_path() /
+            ("gaxtapper-test-" + std::to_string(random()));
+    std::filesystem::create_directories(path_);
+  }
+  ~TemporaryDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path_, error);
+  }
+
+  TemporaryDirectory(const TemporaryDirectory&) = delete;
+  TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+  [[nodiscard]] const std::filesystem::path& path() const noexcept {
+    return path_;
+  }
+
+ private:
+  std::filesystem::path path_;
+};
+
+}  // namespace testing
+}  // namespace gaxtapper
+
+// Reports a failure and goes on, unlike assert, which is gone with NDEBUG.
+#define EXPECT(condition)                                            \
+  do {                                                               \
+    if (!(condition))                                                \
+      ::gaxtapper::testing::Fail(__FILE__, __LINE__, #condition);    \
+  } while (false)
+
+// Checks that the statement throws the exception.
+#define EXPECT_THROW(statement, exception)                            \
+  do {                                                                \
+    bool thrown = false;                                              \
+    try {                                                             \
+      statement;                                                      \
+    } catch (const exception&) {                                      \
+      thrown = true;                                                  \
+    }                                                                 \
+    if (!thrown)                                                      \
+      ::gaxtapper::testing::Fail(__FILE__, __LINE__,                  \
+                                 #statement " throws " #exception);   \
+  } while (false)
+
+#endif
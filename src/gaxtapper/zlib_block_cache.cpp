@@ -0,0 +1,136 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "zlib_block_cache.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <zlib.h>
+#include "bytes.hpp"
+
+namespace gaxtapper {
+
+namespace {
+
+// The sizes of the fixed part of a block and a region in the file.
+constexpr std::size_t kBlockHeaderSize = 20;
+constexpr std::size_t kRegionSize = 17;
+
+// The entropy is kept as a fixed point number.
+constexpr double kEntropyScale = 65536.0;
+
+}  // namespace
+
+ZlibBlockCache::ZlibBlockCache(std::filesystem::path path)
+    : path_(std::move(path)) {
+  std::ifstream stream(path_, std::ios::in | std::ios::binary);
+  if (!stream) return;
+  const std::string file{std::istreambuf_iterator<char>(stream),
+                         std::istreambuf_iterator<char>()};
+  if (file.compare(0, kMagic.size(), kMagic) != 0) return;
+
+  std::map<std::uint64_t, Block> blocks;
+  std::size_t offset = kMagic.size();
+  while (offset != file.size()) {
+    if (file.size() - offset < kBlockHeaderSize) return;
+    const char* in = &file[offset];
+    const std::uint64_t key =
+        ReadInt32L(in) | (std::uint64_t{ReadInt32L(in + 4)} << 32);
+    Block block;
+    block.crc32 = ReadInt32L(in + 8);
+    const std::size_t size = ReadInt32L(in + 12);
+    const std::size_t num_regions = ReadInt32L(in + 16);
+    offset += kBlockHeaderSize;
+    if ((file.size() - offset) / kRegionSize < num_regions) return;
+
+    for (std::size_t i = 0; i < num_regions; i++) {
+      in = &file[offset];
+      ZlibRegionStats region;
+      region.offset = ReadInt32L(in);
+      region.size = ReadInt32L(in + 4);
+      region.compressed_size = ReadInt32L(in + 8);
+      region.entropy = ReadInt32L(in + 12) / kEntropyScale;
+      region.level = static_cast<std::int8_t>(ReadInt8(in + 16));
+      block.regions.push_back(region);
+      offset += kRegionSize;
+    }
+
+    if (file.size() - offset < size) return;
+    block.data = file.substr(offset, size);
+    offset += size;
+    // A damaged block is compressed again.
+    if (crc32(0L, reinterpret_cast<const Bytef*>(block.data.data()),
+              static_cast<uInt>(block.data.size())) != block.crc32)
+      continue;
+    blocks[key] = std::move(block);
+  }
+  loaded_ = std::move(blocks);
+}
+
+bool ZlibBlockCache::Find(std::uint64_t key, Block& block) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  const auto it = loaded_.find(key);
+  if (it == loaded_.end()) {
+    misses_++;
+    return false;
+  }
+  block = it->second;
+  used_[key] = it->second;
+  hits_++;
+  return true;
+}
+
+void ZlibBlockCache::Insert(std::uint64_t key, Block block) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  used_[key] = std::move(block);
+}
+
+void ZlibBlockCache::Save() const {
+  // The name is unique, since a batch may save the cache of the same ROM
+  // from several jobs at once.
+  std::random_device random;
+  std::ostringstream suffix;
+  suffix << '.' << std::hex << std::setfill('0') << std::setw(8) << random()
+         << ".tmp";
+  std::filesystem::path temporary_path{path_};
+  temporary_path += suffix.str();
+  {
+    std::ofstream stream(temporary_path,
+                         std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.exceptions(std::ios::badbit | std::ios::failbit);
+    stream << kMagic;
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& [key, block] : used_) {
+      char header[kBlockHeaderSize];
+      WriteInt32L(&header[0], static_cast<std::uint32_t>(key));
+      WriteInt32L(&header[4], static_cast<std::uint32_t>(key >> 32));
+      WriteInt32L(&header[8], block.crc32);
+      WriteInt32L(&header[12], static_cast<std::uint32_t>(block.data.size()));
+      WriteInt32L(&header[16],
+                  static_cast<std::uint32_t>(block.regions.size()));
+      stream.write(header, sizeof(header));
+
+      for (const ZlibRegionStats& region : block.regions) {
+        char fields[kRegionSize];
+        WriteInt32L(&fields[0], static_cast<std::uint32_t>(region.offset));
+        WriteInt32L(&fields[4], static_cast<std::uint32_t>(region.size));
+        WriteInt32L(&fields[8],
+                    static_cast<std::uint32_t>(region.compressed_size));
+        WriteInt32L(&fields[12], static_cast<std::uint32_t>(std::lround(
+                                     region.entropy * kEntropyScale)));
+        WriteInt8(&fields[16], static_cast<std::uint8_t>(region.level));
+        stream.write(fields, sizeof(fields));
+      }
+      stream.write(block.data.data(),
+                   static_cast<std::streamsize>(block.data.size()));
+    }
+    stream.close();
+  }
+  std::filesystem::rename(temporary_path, path_);
+}
+
+}  // namespace gaxtapper
@@ -0,0 +1,74 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ZLIB_BLOCK_CACHE_HPP_
+#define GAXTAPPER_ZLIB_BLOCK_CACHE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "zlib_compressor.hpp"
+
+namespace gaxtapper {
+
+// Keeps the compressed blocks of a ZlibCompressor stream between runs. A
+// block of the parallel compression depends only on its input and the
+// dictionary before it, so a block whose input has not changed can be
+// copied from the last run instead of being deflated again. Installing the
+// driver at another address only changes a few blocks of the gsflib, and
+// the other blocks are spliced from the cache.
+//
+// The blocks are looked up by a hash of the zlib version, the dictionary,
+// the input and the compression settings, so that a zlib upgrade never
+// splices blocks of another deflate. The cache file keeps the blocks used
+// by the last run, which replace the old ones when it is saved. Find and
+// Insert can be called from several threads.
+class ZlibBlockCache {
+ public:
+  static constexpr std::string_view kExtension = ".zblocks";
+
+  struct Block {
+    std::string data;
+    std::uint32_t crc32 = 0;
+    std::vector<ZlibRegionStats> regions;
+  };
+
+  ZlibBlockCache() = default;
+
+  // Loads the cache file, if it exists. A broken file is ignored, which only
+  // makes every block be compressed again.
+  explicit ZlibBlockCache(std::filesystem::path path);
+
+  ZlibBlockCache(const ZlibBlockCache&) = delete;
+  ZlibBlockCache& operator=(const ZlibBlockCache&) = delete;
+
+  [[nodiscard]] std::size_t hits() const noexcept { return hits_; }
+  [[nodiscard]] std::size_t misses() const noexcept { return misses_; }
+
+  // Copies the block of the key to block, and returns whether it is found.
+  bool Find(std::uint64_t key, Block& block);
+  void Insert(std::uint64_t key, Block block);
+
+  // Saves the blocks that have been found or inserted, by replacing the old
+  // file with a new one.
+  void Save() const;
+
+ private:
+  static constexpr std::string_view kMagic{"GAXZBLK\x01", 8};
+
+  std::filesystem::path path_;
+  std::map<std::uint64_t, Block> loaded_;
+  std::map<std::uint64_t, Block> used_;
+  std::atomic<std::size_t> hits_{0};
+  std::atomic<std::size_t> misses_{0};
+  mutable std::mutex mutex_;
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,135 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "zlib_block_cache.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include "zlib_compressor.hpp"
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+constexpr std::size_t kNumBlocks = 4;
+
+std::string MakeInput() {
+  std::mt19937 random{1};
+  std::string data;
+  while (data.size() < ZlibCompressor::kBlockSize * (kNumBlocks - 1) + 5) {
+    data += "GAX Sound Engine (c) Shin'en Multimedia. ";
+    data += static_cast<char>(random());
+  }
+  return data;
+}
+
+std::string Compress(std::string_view data, ZlibBlockCache* cache,
+                     ZlibProfile profile = ZlibProfile::kFast) {
+  std::string out(ZlibCompressor::Bound(data.size()), '\0');
+  std::uint32_t crc = 0;
+  ZlibOptions options;
+  options.profile = profile;
+  options.num_threads = 2;
+  options.block_cache = cache;
+  out.resize(ZlibCompressor::Compress({data}, out.data(), crc, options));
+  return out;
+}
+
+// Returns whether the cached compression has the given hits and misses, and
+// the same output as the compression without the cache.
+bool CompressesWith(std::string_view data, ZlibBlockCache& cache,
+                    std::size_t hits, std::size_t misses,
+                    ZlibProfile profile = ZlibProfile::kFast) {
+  const std::string cached = Compress(data, &cache, profile);
+  return cached == Compress(data, nullptr, profile) && cache.hits() == hits &&
+         cache.misses() == misses;
+}
+
+void TestHits(const std::filesystem::path& path) {
+  const std::string data = MakeInput();
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data, cache, 0, kNumBlocks));
+    cache.Save();
+  }
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data, cache, kNumBlocks, 0));
+  }
+
+  // A change invalidates its block, and the next block only if it is in the
+  // dictionary of that block.
+  std::string changed = data;
+  changed[ZlibCompressor::kBlockSize * 2 + 10] ^= 1;
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(changed, cache, kNumBlocks - 1, 1));
+  }
+  changed[ZlibCompressor::kBlockSize * 2 - 10] ^= 1;
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(changed, cache, kNumBlocks - 2, 2));
+    cache.Save();
+  }
+
+  // The file keeps only the blocks of the last run.
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data, cache, kNumBlocks - 2, 2));
+  }
+
+  // Another profile deflates every block again.
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(changed, cache, 0, kNumBlocks,
+                          ZlibProfile::kDefault));
+  }
+
+  // Tiny inputs are not cached.
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data.substr(0, ZlibCompressor::kTinySize / 2), cache,
+                          0, 0));
+  }
+}
+
+void TestBrokenFile(const std::filesystem::path& path) {
+  const std::string data = MakeInput();
+  {
+    ZlibBlockCache cache{path};
+    (void)Compress(data, &cache);
+    cache.Save();
+  }
+
+  // A damaged block is compressed again, and the others are still used.
+  const auto size = std::filesystem::file_size(path);
+  {
+    std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(static_cast<std::streamoff>(size - 1));
+    stream.put('\0');
+  }
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data, cache, kNumBlocks - 1, 1));
+  }
+
+  // A truncated file is ignored as a whole.
+  std::filesystem::resize_file(path, size - 1);
+  {
+    ZlibBlockCache cache{path};
+    EXPECT(CompressesWith(data, cache, 0, kNumBlocks));
+  }
+}
+
+}  // namespace
+
+int main() {
+  const testing::TemporaryDirectory directory;
+  TestHits(directory.path() / "hits.zblocks");
+  TestBrokenFile(directory.path() / "broken.zblocks");
+  return testing::num_failures != 0;
+}
@@ -0,0 +1,581 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "zlib_compressor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+#include "deflate_format.hpp"
+#include "hash.hpp"
+#include "optimal_deflater.hpp"
+#include "parallel.hpp"
+#include "zlib_block_cache.hpp"
+
+namespace gaxtapper {
+
+// The output is handed to deflate in slices of this size, so that the CRC
+// reads the compressed data while it is still in the cache.
+static constexpr uInt kCrcSliceSize = 0x40000;
+
+// The zlib header and the adler32 trailer.
+static constexpr std::size_t kWrapperSize = 2 + 4;
+
+// The zlib header of the tiny encoder (deflate, 32K window, best level).
+static constexpr unsigned char kTinyHeader[2]{0x78, 0xda};
+
+// A sync flush appends an empty stored block (and the pending bits), and
+// a change of the level at a region closes the current deflate block.
+static constexpr std::size_t kSyncFlushSize = 10;
+static constexpr std::size_t kRegionFlushSize = 8;
+
+// Changes the keys of the cached blocks when the encoding changes.
+static constexpr std::uint64_t kBlockCacheVersion = 2;
+
+namespace {
+
+// Calls function(slice) for the slices of the parts in [begin, end) of their
+// concatenation.
+template <typename Function>
+void ForEachSlice(std::initializer_list<std::string_view> parts,
+                  std::size_t begin, std::size_t end, Function&& function) {
+  std::size_t offset = 0;
+  for (const std::string_view part : parts) {
+    const std::size_t part_end = offset + part.size();
+    if (part_end > begin && offset < end) {
+      const std::size_t first = std::max(begin, offset) - offset;
+      const std::size_t last = std::min(end, part_end) - offset;
+      function(part.substr(first, last - first));
+    }
+    offset = part_end;
+    if (offset >= end) break;
+  }
+}
+
+// Deflates the input slices into out and keeps the crc32 of the output.
+class Deflater {
+ public:
+  Deflater(int level, int window_bits, int mem_level, Bytef* out,
+           std::size_t out_size)
+      : out_(out), out_size_(out_size), level_(level) {
+    if (deflateInit2(&stream_, level, Z_DEFLATED, window_bits, mem_level,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+      throw std::runtime_error("Unable to initialize the compressor.");
+    stream_.next_out = out;
+  }
+
+  ~Deflater() { deflateEnd(&stream_); }
+
+  Deflater(const Deflater&) = delete;
+  Deflater& operator=(const Deflater&) = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return static_cast<std::size_t>(stream_.next_out - out_);
+  }
+  [[nodiscard]] std::uint32_t crc32() const noexcept {
+    return static_cast<std::uint32_t>(crc_);
+  }
+
+  void SetDictionary(std::string_view dictionary) {
+    deflateSetDictionary(
+        &stream_, reinterpret_cast<const Bytef*>(dictionary.data()),
+        static_cast<uInt>(dictionary.size()));
+  }
+
+  // Changes the level for the following input. zlib ends the current block
+  // first, and returns Z_BUF_ERROR when the output space runs out before the
+  // block is written, in which case it is called again with more space.
+  void SetLevel(int level) {
+    if (level == level_) return;
+    int status;
+    do {
+      Bytef* const slice = NextSlice();
+      status = deflateParams(&stream_, level, Z_DEFAULT_STRATEGY);
+      crc_ = ::crc32(crc_, slice, static_cast<uInt>(stream_.next_out - slice));
+    } while (status == Z_BUF_ERROR);
+    if (status != Z_OK)
+      throw std::runtime_error("Unable to change the compression level.");
+    level_ = level;
+  }
+
+  void Deflate(std::string_view input, int flush) {
+    stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream_.avail_in = static_cast<uInt>(input.size());
+    int status;
+    do {
+      Bytef* const slice = NextSlice();
+      status = deflate(&stream_, flush);
+      if (status == Z_STREAM_ERROR)
+        throw std::runtime_error("Unable to compress the data.");
+      crc_ = ::crc32(crc_, slice, static_cast<uInt>(stream_.next_out - slice));
+    } while (stream_.avail_in != 0 ||
+             (flush == Z_FINISH && status != Z_STREAM_END) ||
+             (flush != Z_NO_FLUSH && stream_.avail_out == 0));
+  }
+
+ private:
+  z_stream stream_{};
+  Bytef* out_;
+  std::size_t out_size_;
+  int level_;
+  uLong crc_ = ::crc32(0L, Z_NULL, 0);
+
+  Bytef* NextSlice() {
+    stream_.avail_out = static_cast<uInt>(
+        std::min<std::size_t>(kCrcSliceSize, out_size_ - size()));
+    if (stream_.avail_out == 0)
+      throw std::runtime_error("The compressed data exceeds the bound.");
+    return stream_.next_out;
+  }
+};
+
+// Returns the order-0 entropy of the bytes in bits per byte.
+double Entropy(std::initializer_list<std::string_view> parts, std::size_t begin,
+               std::size_t end) {
+  std::uint32_t counts[256]{};
+  ForEachSlice(parts, begin, end, [&](std::string_view slice) {
+    for (const char c : slice) counts[static_cast<unsigned char>(c)]++;
+  });
+
+  const double size = static_cast<double>(end - begin);
+  double entropy = 0.0;
+  for (const std::uint32_t count : counts) {
+    if (count == 0) continue;
+    const double p = count / size;
+    entropy -= p * std::log2(p);
+  }
+  return entropy;
+}
+
+// The zlib level and memLevel of the profile.
+int ProfileLevel(ZlibProfile profile) noexcept {
+  return profile == ZlibProfile::kFast ? 1 : 9;
+}
+
+int ProfileMemLevel(ZlibProfile profile) noexcept {
+  return profile == ZlibProfile::kMax ? 9 : 8;
+}
+
+// Deflates [begin, end) of the input region by region, with the level that
+// suits each region, and appends the result of the regions.
+void DeflateRegions(Deflater& deflater,
+                    std::initializer_list<std::string_view> parts,
+                    std::size_t begin, std::size_t end, ZlibProfile profile,
+                    std::vector<ZlibRegionStats>& regions) {
+  const int level = ProfileLevel(profile);
+  for (std::size_t offset = begin; offset < end;
+       offset += ZlibCompressor::kRegionSize) {
+    ZlibRegionStats region;
+    region.offset = offset;
+    region.size = std::min(ZlibCompressor::kRegionSize, end - offset);
+    region.entropy = Entropy(parts, offset, offset + region.size);
+    region.level = profile == ZlibProfile::kMax
+                       ? level
+                       : ZlibCompressor::RegionLevel(region.entropy, level);
+
+    // The block is ended only when the level changes, so that the matches
+    // go on across the regions of the same level.
+    deflater.SetLevel(region.level);
+    const std::size_t start = deflater.size();
+    ForEachSlice(parts, offset, offset + region.size,
+                 [&](std::string_view slice) {
+                   deflater.Deflate(slice, Z_NO_FLUSH);
+                 });
+    region.compressed_size = deflater.size() - start;
+    regions.push_back(region);
+  }
+}
+
+std::size_t RegionCount(std::size_t size) noexcept {
+  return (size + ZlibCompressor::kRegionSize - 1) / ZlibCompressor::kRegionSize;
+}
+
+// Writes the bits of a deflate stream (LSB first) to a fixed buffer.
+class BitWriter {
+ public:
+  explicit BitWriter(unsigned char* out) noexcept : out_(out) {}
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  void Write(std::uint32_t bits, int count) noexcept {
+    buffer_ |= bits << count_;
+    count_ += count;
+    while (count_ >= 8) {
+      out_[size_++] = static_cast<unsigned char>(buffer_);
+      buffer_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  // Writes a Huffman code, which is stored from its most significant bit.
+  void WriteCode(std::uint32_t code, int length) noexcept {
+    std::uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+    Write(reversed, length);
+  }
+
+  void Flush() noexcept {
+    if (count_ > 0) Write(0, 8 - count_);
+  }
+
+ private:
+  unsigned char* out_;
+  std::size_t size_ = 0;
+  std::uint32_t buffer_ = 0;
+  int count_ = 0;
+};
+
+// Writes a symbol of the fixed literal/length code (RFC 1951 3.2.6).
+void WriteFixedLiteral(BitWriter& writer, unsigned symbol) noexcept {
+  if (symbol < 144)
+    writer.WriteCode(0x30 + symbol, 8);
+  else if (symbol < 256)
+    writer.WriteCode(0x190 + symbol - 144, 9);
+  else if (symbol < 280)
+    writer.WriteCode(symbol - 256, 7);
+  else
+    writer.WriteCode(0xc0 + symbol - 280, 8);
+}
+
+void WriteFixedMatch(BitWriter& writer, unsigned length,
+                     unsigned distance) noexcept {
+  const unsigned length_code = DeflateFormat::LengthCode(length);
+  WriteFixedLiteral(writer, 257 + length_code);
+  writer.Write(length - DeflateFormat::kLengthBase[length_code],
+               DeflateFormat::kLengthExtraBits[length_code]);
+
+  const unsigned distance_code = DeflateFormat::DistanceCode(distance);
+  writer.WriteCode(distance_code, 5);
+  writer.Write(distance - DeflateFormat::kDistanceBase[distance_code],
+               DeflateFormat::kDistanceExtraBits[distance_code]);
+}
+
+std::size_t BlockBound(std::size_t size) noexcept {
+  return compressBound(static_cast<uLong>(size)) + kSyncFlushSize +
+         RegionCount(size) * kRegionFlushSize;
+}
+
+// Deflates the block [begin, end) with OptimalDeflater into out, as zlib
+// would do with a sync flush (or the final block). Returns false if the
+// result does not fit BlockBound, which leaves the block to zlib.
+bool CompressOptimalBlock(std::initializer_list<std::string_view> parts,
+                          std::size_t begin, std::size_t end, bool final,
+                          Bytef* out, std::size_t& out_size,
+                          std::uint32_t& out_crc32,
+                          std::vector<ZlibRegionStats>& regions) {
+  const std::size_t window_begin =
+      begin - std::min(begin, ZlibCompressor::kDictionarySize);
+  std::string window;
+  window.reserve(end - window_begin);
+  ForEachSlice(parts, window_begin, end,
+               [&](std::string_view slice) { window += slice; });
+
+  OptimalDeflater deflater;
+  for (std::size_t offset = begin; offset < end;
+       offset += ZlibCompressor::kRegionSize) {
+    ZlibRegionStats region;
+    region.offset = offset;
+    region.size = std::min(ZlibCompressor::kRegionSize, end - offset);
+    region.entropy = Entropy(parts, offset, offset + region.size);
+    region.level = ZlibCompressor::kOptimalLevel;
+
+    const std::uint64_t start = deflater.bit_count();
+    const std::size_t region_end = offset + region.size;
+    deflater.Deflate(window, offset - window_begin, region_end - window_begin,
+                     final && region_end == end);
+    region.compressed_size =
+        static_cast<std::size_t>((deflater.bit_count() - start + 7) / 8);
+    regions.push_back(region);
+  }
+  if (!final) deflater.SyncFlush();
+
+  const std::string& output = deflater.output();
+  if (output.size() > BlockBound(end - begin)) {
+    regions.clear();
+    return false;
+  }
+  std::memcpy(out, output.data(), output.size());
+  out_size = output.size();
+  out_crc32 = static_cast<std::uint32_t>(
+      crc32(0L, out, static_cast<uInt>(output.size())));
+  return true;
+}
+
+// Deflates the block [begin, end) into out, with the input before it as the
+// dictionary, and ends it with a sync flush (or the final block).
+void CompressBlock(std::initializer_list<std::string_view> parts,
+                   std::size_t begin, std::size_t end, bool final,
+                   bool primed, Bytef* out, std::size_t& out_size,
+                   std::uint32_t& out_crc32,
+                   std::vector<ZlibRegionStats>& regions,
+                   ZlibProfile profile) {
+  if (profile == ZlibProfile::kUltra &&
+      CompressOptimalBlock(parts, begin, end, final, out, out_size, out_crc32,
+                           regions))
+    return;
+
+  Deflater deflater{ProfileLevel(profile), -15, ProfileMemLevel(profile), out,
+                    BlockBound(end - begin)};
+  if (primed) {
+    std::string dictionary;
+    dictionary.reserve(ZlibCompressor::kDictionarySize);
+    ForEachSlice(parts, begin - ZlibCompressor::kDictionarySize, begin,
+                 [&](std::string_view slice) { dictionary += slice; });
+    deflater.SetDictionary(dictionary);
+  }
+  DeflateRegions(deflater, parts, begin, end, profile, regions);
+  deflater.Deflate({}, final ? Z_FINISH : Z_SYNC_FLUSH);
+  out_size = deflater.size();
+  out_crc32 = deflater.crc32();
+}
+
+}  // namespace
+
+std::size_t ZlibCompressor::Bound(std::size_t size) noexcept {
+  if (size <= kTinySize) return compressBound(static_cast<uLong>(size));
+  if (size <= kBlockSize)
+    return compressBound(static_cast<uLong>(size)) +
+           RegionCount(size) * kRegionFlushSize;
+
+  const std::size_t num_blocks = (size + kBlockSize - 1) / kBlockSize;
+  return kWrapperSize + (num_blocks - 1) * BlockBound(kBlockSize) +
+         BlockBound(size - (num_blocks - 1) * kBlockSize);
+}
+
+std::size_t ZlibCompressor::Compress(std::initializer_list<std::string_view> parts,
+                                     char* out, std::uint32_t& out_crc32,
+                                     const ZlibOptions& options) {
+  std::size_t size = 0;
+  for (const std::string_view part : parts) size += part.size();
+
+  if (size <= kTinySize) return CompressTiny(parts, size, out, out_crc32);
+  if (size <= kBlockSize && options.profile != ZlibProfile::kUltra)
+    return CompressStream(parts, size, out, out_crc32, options);
+  return CompressBlocks(parts, size, out, out_crc32, options);
+}
+
+int ZlibCompressor::RegionLevel(double entropy, int level) noexcept {
+  if (entropy >= kStoredEntropy) return Z_NO_COMPRESSION;
+  if (entropy >= kFastEntropy) return std::min(level, kFastLevel);
+  return level;
+}
+
+ZlibProfile ZlibCompressor::ParseProfile(std::string_view name) {
+  for (const ZlibProfile profile :
+       {ZlibProfile::kFast, ZlibProfile::kDefault, ZlibProfile::kMax,
+        ZlibProfile::kUltra}) {
+    if (name == ProfileName(profile)) return profile;
+  }
+  throw std::invalid_argument("Unknown compression profile \"" +
+                              std::string(name) +
+                              "\" (expected fast, default, max or ultra).");
+}
+
+const char* ZlibCompressor::ProfileName(ZlibProfile profile) noexcept {
+  switch (profile) {
+    case ZlibProfile::kFast:
+      return "fast";
+    case ZlibProfile::kMax:
+      return "max";
+    case ZlibProfile::kUltra:
+      return "ultra";
+    default:
+      return "default";
+  }
+}
+
+std::size_t ZlibCompressor::CompressTiny(
+    std::initializer_list<std::string_view> parts, std::size_t size, char* out,
+    std::uint32_t& out_crc32) {
+  unsigned char input[kTinySize];
+  std::size_t offset = 0;
+  for (const std::string_view part : parts) {
+    std::memcpy(&input[offset], part.data(), part.size());
+    offset += part.size();
+  }
+
+  // A fixed Huffman block with greedy matching. Literals take 9 bits at most
+  // and matches take less than their length, so it fits the buffer below.
+  unsigned char fixed[kTinySize * 9 / 8 + 8];
+  BitWriter writer{fixed};
+  writer.Write(1, 1);  // BFINAL
+  writer.Write(1, 2);  // BTYPE = fixed Huffman
+  for (std::size_t i = 0; i < size;) {
+    std::size_t best_length = 0;
+    std::size_t best_distance = 0;
+    for (std::size_t j = i; j-- > 0;) {
+      std::size_t length = 0;
+      while (length < 258 && i + length < size &&
+             input[j + length] == input[i + length])
+        length++;
+      if (length > best_length) {
+        best_length = length;
+        best_distance = i - j;
+      }
+    }
+
+    if (best_length >= 3) {
+      WriteFixedMatch(writer, static_cast<unsigned>(best_length),
+                      static_cast<unsigned>(best_distance));
+      i += best_length;
+    } else {
+      WriteFixedLiteral(writer, input[i++]);
+    }
+  }
+  WriteFixedLiteral(writer, 256);  // end of block
+  writer.Flush();
+
+  std::size_t out_size = 0;
+  const auto put = [&](const void* data, std::size_t length) {
+    std::memcpy(out + out_size, data, length);
+    out_size += length;
+  };
+  put(kTinyHeader, sizeof(kTinyHeader));
+  if (writer.size() <= size + 5) {
+    put(fixed, writer.size());
+  } else {
+    // A stored block: BFINAL and BTYPE, LEN and NLEN.
+    const unsigned char stored[5]{
+        1, static_cast<unsigned char>(size & 0xff),
+        static_cast<unsigned char>(size >> 8),
+        static_cast<unsigned char>(~size & 0xff),
+        static_cast<unsigned char>((~size >> 8) & 0xff)};
+    put(stored, sizeof(stored));
+    put(input, size);
+  }
+
+  const uLong adler = adler32(1L, input, static_cast<uInt>(size));
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out[out_size++] = static_cast<char>((adler >> shift) & 0xff);
+
+  out_crc32 = static_cast<std::uint32_t>(
+      crc32(0L, reinterpret_cast<const Bytef*>(out),
+            static_cast<uInt>(out_size)));
+  return out_size;
+}
+
+std::size_t ZlibCompressor::CompressStream(
+    std::initializer_list<std::string_view> parts, std::size_t size, char* out,
+    std::uint32_t& out_crc32, const ZlibOptions& options) {
+  Deflater deflater{ProfileLevel(options.profile), 15,
+                    ProfileMemLevel(options.profile),
+                    reinterpret_cast<Bytef*>(out), Bound(size)};
+  std::vector<ZlibRegionStats> regions;
+  DeflateRegions(deflater, parts, 0, size, options.profile, regions);
+  deflater.Deflate({}, Z_FINISH);
+  if (options.regions != nullptr)
+    options.regions->insert(options.regions->end(), regions.begin(),
+                            regions.end());
+  out_crc32 = deflater.crc32();
+  return deflater.size();
+}
+
+std::size_t ZlibCompressor::CompressBlocks(
+    std::initializer_list<std::string_view> parts, std::size_t size, char* out,
+    std::uint32_t& out_crc32, const ZlibOptions& options) {
+  const int level = ProfileLevel(options.profile);
+  const std::size_t num_blocks = (size + kBlockSize - 1) / kBlockSize;
+  const std::size_t block_bound = BlockBound(kBlockSize);
+
+  struct Block {
+    std::size_t size = 0;  // compressed size
+    std::uint32_t crc32 = 0;
+    uLong adler32 = 0;
+    std::vector<ZlibRegionStats> regions;
+  };
+  std::vector<Block> blocks(num_blocks);
+
+  // Each block is deflated in its own slot of the output buffer, and the
+  // slots are packed together afterwards.
+  ParallelFor(
+      num_blocks,
+      [&](std::size_t index, unsigned) {
+        const std::size_t begin = index * kBlockSize;
+        const std::size_t end = std::min(size, begin + kBlockSize);
+        Block& block = blocks[index];
+
+        const bool final = index + 1 == num_blocks;
+        auto* const slot =
+            reinterpret_cast<Bytef*>(out + 2 + index * block_bound);
+
+        block.adler32 = adler32(0L, Z_NULL, 0);
+        ForEachSlice(parts, begin, end, [&](std::string_view slice) {
+          block.adler32 = adler32(block.adler32,
+                                  reinterpret_cast<const Bytef*>(slice.data()),
+                                  static_cast<uInt>(slice.size()));
+        });
+
+        // The block is given by the zlib version, the settings, its
+        // position, the dictionary and the input.
+        std::uint64_t key = 0;
+        if (options.block_cache != nullptr) {
+          key = HashBytes(zlibVersion(),
+                          kBlockCacheVersion << 8 |
+                              static_cast<std::uint64_t>(options.profile)
+                                  << 1 |
+                              (final ? 1 : 0));
+          key = Mix64(key ^ begin);
+          ForEachSlice(parts, begin - std::min(begin, kDictionarySize), end,
+                       [&](std::string_view slice) {
+                         key = HashBytes(slice, key);
+                       });
+
+          ZlibBlockCache::Block cached;
+          if (options.block_cache->Find(key, cached) &&
+              cached.data.size() <= BlockBound(end - begin)) {
+            std::memcpy(slot, cached.data.data(), cached.data.size());
+            block.size = cached.data.size();
+            block.crc32 = cached.crc32;
+            block.regions = std::move(cached.regions);
+            return;
+          }
+        }
+
+        CompressBlock(parts, begin, end, final, index != 0, slot, block.size,
+                      block.crc32, block.regions, options.profile);
+        if (options.block_cache != nullptr) {
+          options.block_cache->Insert(
+              key, ZlibBlockCache::Block{
+                       std::string(reinterpret_cast<const char*>(slot),
+                                   block.size),
+                       block.crc32, block.regions});
+        }
+      },
+      options.num_threads);
+
+  // The zlib header, with the compression level hint of the level.
+  const unsigned level_flags = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+  unsigned header = (0x78 << 8) | (level_flags << 6);
+  header += 31 - header % 31;
+  out[0] = static_cast<char>(header >> 8);
+  out[1] = static_cast<char>(header & 0xff);
+  uLong crc = crc32(0L, reinterpret_cast<const Bytef*>(out), 2);
+
+  std::size_t out_size = 2;
+  uLong adler = adler32(0L, Z_NULL, 0);
+  for (std::size_t index = 0; index < num_blocks; index++) {
+    const Block& block = blocks[index];
+    std::memmove(out + out_size, out + 2 + index * block_bound, block.size);
+    out_size += block.size;
+    crc = crc32_combine(crc, block.crc32, static_cast<z_off_t>(block.size));
+
+    const std::size_t length =
+        std::min(kBlockSize, size - index * kBlockSize);
+    adler = adler32_combine(adler, block.adler32, static_cast<z_off_t>(length));
+
+    if (options.regions != nullptr)
+      options.regions->insert(options.regions->end(), block.regions.begin(),
+                              block.regions.end());
+  }
+
+  for (int shift = 24; shift >= 0; shift -= 8)
+    out[out_size++] = static_cast<char>((adler >> shift) & 0xff);
+  crc = crc32(crc, reinterpret_cast<const Bytef*>(out + out_size - 4), 4);
+
+  out_crc32 = static_cast<std::uint32_t>(crc);
+  return out_size;
+}
+
+}  // namespace gaxtapper
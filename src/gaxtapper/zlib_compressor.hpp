@@ -0,0 +1,111 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#ifndef GAXTAPPER_ZLIB_COMPRESSOR_HPP_
+#define GAXTAPPER_ZLIB_COMPRESSOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+#include <vector>
+
+namespace gaxtapper {
+
+class ZlibBlockCache;
+
+// The compression result of a region of the input.
+struct ZlibRegionStats {
+  std::size_t offset = 0;
+  std::size_t size = 0;
+  // The output of zlib while the region was deflated. zlib holds back some
+  // output until the end of a block, which falls on a change of the level.
+  std::size_t compressed_size = 0;
+  double entropy = 0.0;  // bits per byte
+  int level = 0;
+};
+
+// The trade-off between the compression time and the size.
+//   fast:    zlib level 1, with the entropy rules of the regions.
+//   default: zlib level 9, with the entropy rules of the regions.
+//   max:     zlib level 9 and the largest hash table, for every region.
+//   ultra:   the optimal parsing of OptimalDeflater, which is many times
+//            slower than zlib.
+enum class ZlibProfile { kFast, kDefault, kMax, kUltra };
+
+struct ZlibOptions {
+  ZlibProfile profile = ZlibProfile::kDefault;
+  unsigned num_threads = 0;
+  // Receives the result of each region (in order) when not null.
+  std::vector<ZlibRegionStats>* regions = nullptr;
+  // Reuses the unchanged blocks of a previous run when not null. Inputs
+  // that are not split into blocks are not cached.
+  ZlibBlockCache* block_cache = nullptr;
+};
+
+// Compresses data into a single zlib stream. Large inputs are split into
+// blocks that are deflated in parallel (in the same way as pigz): each block
+// is primed with the tail of the previous block as the dictionary, ends with
+// a sync flush, and the adler32 of the blocks are combined for the trailer.
+// The output depends only on the input, not on the number of threads.
+// Tiny inputs (such as the minigsf programs) are encoded without zlib, as a
+// single fixed Huffman or stored block, which avoids setting up a deflate
+// context for a few bytes.
+//
+// The input is deflated by regions of kRegionSize bytes. The byte entropy
+// of each region decides how hard it is compressed: regions that are
+// already compressed (LZ77/Huffman graphics and audio) are stored, and
+// nearly incompressible ones only get a fast match search.
+//
+// The ultra profile replaces zlib with OptimalDeflater for each block, and
+// still produces a plain zlib stream.
+class ZlibCompressor {
+ public:
+  static constexpr std::size_t kTinySize = 0x200;
+  static constexpr std::size_t kBlockSize = 0x20000;
+  static constexpr std::size_t kDictionarySize = 0x8000;
+  static constexpr std::size_t kRegionSize = 0x10000;
+
+  // Regions at or above these entropies are stored, or compressed with the
+  // fast level.
+  static constexpr double kStoredEntropy = 7.9;
+  static constexpr double kFastEntropy = 7.5;
+  static constexpr int kFastLevel = 3;
+
+  // The level that the region stats show for the optimal parsing.
+  static constexpr int kOptimalLevel = 10;
+
+  // Returns the buffer size that Compress needs for an input of the size.
+  [[nodiscard]] static std::size_t Bound(std::size_t size) noexcept;
+
+  // Compresses the concatenation of the parts into out, which must have
+  // Bound(size) bytes, and returns the compressed size. The crc32 of the
+  // compressed data is stored to out_crc32.
+  static std::size_t Compress(std::initializer_list<std::string_view> parts,
+                              char* out, std::uint32_t& out_crc32,
+                              const ZlibOptions& options = {});
+
+  // Returns the level for a region of the entropy (in bits per byte).
+  [[nodiscard]] static int RegionLevel(double entropy, int level) noexcept;
+
+  // Converts between a profile and its name ("fast", "default", "max" or
+  // "ultra"). ParseProfile throws std::invalid_argument for an unknown name.
+  [[nodiscard]] static ZlibProfile ParseProfile(std::string_view name);
+  [[nodiscard]] static const char* ProfileName(ZlibProfile profile) noexcept;
+
+ private:
+  static std::size_t CompressTiny(std::initializer_list<std::string_view> parts,
+                                  std::size_t size, char* out,
+                                  std::uint32_t& out_crc32);
+  static std::size_t CompressStream(std::initializer_list<std::string_view> parts,
+                                    std::size_t size, char* out,
+                                    std::uint32_t& out_crc32,
+                                    const ZlibOptions& options);
+  static std::size_t CompressBlocks(std::initializer_list<std::string_view> parts,
+                                    std::size_t size, char* out,
+                                    std::uint32_t& out_crc32,
+                                    const ZlibOptions& options);
+};
+
+}  // namespace gaxtapper
+
+#endif
@@ -0,0 +1,101 @@
+// Gaxtapper: Automated GSF ripper for GAX Sound Engine.
+
+#include "zlib_compressor.hpp"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+#include "testing.hpp"
+
+using namespace gaxtapper;
+
+namespace {
+
+// A ROM-like input: text, repeated tables, and random (compressed) data, so
+// that the regions get different levels.
+std::string MakeInput(std::size_t size) {
+  std::mt19937 random{1};
+  std::string data;
+  data.reserve(size);
+  while (data.size() < size) {
+    switch (data.size() / ZlibCompressor::kRegionSize % 3) {
+      case 0:
+        data += "GAX Sound Engine v3.05 (c) Shin'en Multimedia. ";
+        break;
+      case 1:
+        for (int i = 0; i < 64; i++) data += static_cast<char>(i * 3);
+        break;
+      default:
+        for (int i = 0; i < 64; i++) data += static_cast<char>(random());
+        break;
+    }
+  }
+  data.resize(size);
+  return data;
+}
+
+std::string Compress(std::string_view header, std::string_view data,
+                     ZlibProfile profile, unsigned num_threads) {
+  std::string out(ZlibCompressor::Bound(header.size() + data.size()), '\0');
+  std::uint32_t crc = 0;
+  ZlibOptions options;
+  options.profile = profile;
+  options.num_threads = num_threads;
+  out.resize(
+      ZlibCompressor::Compress({header, data}, out.data(), crc, options));
+  EXPECT(crc == crc32(0, reinterpret_cast<const Bytef*>(out.data()),
+                      static_cast<uInt>(out.size())));
+  return out;
+}
+
+std::string Uncompress(const std::string& compressed, std::size_t size) {
+  std::string out(size + 1, '\0');
+  uLongf out_size = static_cast<uLongf>(out.size());
+  if (uncompress(reinterpret_cast<Bytef*>(out.data()), &out_size,
+                 reinterpret_cast<const Bytef*>(compressed.data()),
+                 static_cast<uLong>(compressed.size())) != Z_OK) {
+    return {};
+  }
+  out.resize(out_size);
+  return out;
+}
+
+void TestRoundTrip(std::size_t size, ZlibProfile profile) {
+  const std::string header = "HEADER123456";
+  const std::string data = MakeInput(size);
+  const std::string one = Compress(header, data, profile, 1);
+  EXPECT(Uncompress(one, header.size() + data.size()) == header + data);
+  // The output does not depend on the number of threads.
+  EXPECT(Compress(header, data, profile, 4) == one);
+}
+
+}  // namespace
+
+int main() {
+  for (const ZlibProfile profile :
+       {ZlibProfile::kFast, ZlibProfile::kDefault, ZlibProfile::kMax}) {
+    TestRoundTrip(0, profile);
+    TestRoundTrip(ZlibCompressor::kTinySize / 2, profile);
+    TestRoundTrip(ZlibCompressor::kBlockSize / 2, profile);
+    TestRoundTrip(ZlibCompressor::kBlockSize * 3 + 5, profile);
+  }
+  // The optimal parsing is slow, and a block and a half is enough.
+  TestRoundTrip(ZlibCompressor::kBlockSize * 3 / 2, ZlibProfile::kUltra);
+
+  for (const ZlibProfile profile : {ZlibProfile::kFast, ZlibProfile::kDefault,
+                                    ZlibProfile::kMax, ZlibProfile::kUltra}) {
+    EXPECT(ZlibCompressor::ParseProfile(ZlibCompressor::ProfileName(
+               profile)) == profile);
+  }
+  EXPECT_THROW((void)ZlibCompressor::ParseProfile("best"),
+               std::invalid_argument);
+
+  // Random data is stored, and text is compressed.
+  EXPECT(ZlibCompressor::RegionLevel(8.0, 9) == 0);
+  EXPECT(ZlibCompressor::RegionLevel(4.0, 9) == 9);
+  return testing::num_failures != 0;
+}
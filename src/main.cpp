@@ -1,12 +1,21 @@
 // Gaxtapper: Automated GSF ripper for GAX Sound Engine.
 
 #include <charconv>
+#include <csignal>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
 #include "args.hxx"
+#include "gaxtapper/async_file_writer.hpp"
 #include "gaxtapper/cartridge.hpp"
+#include "gaxtapper/gax_benchmark.hpp"
+#include "gaxtapper/gax_rom_optimizer.hpp"
+#include "gaxtapper/gax_song_timer.hpp"
 #include "gaxtapper/gaxtapper.hpp"
+#include "gaxtapper/inspection_cache.hpp"
+#include "gaxtapper/memory_budget.hpp"
+#include "gaxtapper/server.hpp"
+#include "gaxtapper/zlib_compressor.hpp"
 
 using namespace gaxtapper;
 using namespace std::literals::string_view_literals;
@@ -20,28 +29,135 @@ args::Group arguments("arguments");
 args::HelpFlag help(arguments, "help", "Show this help message and exit",
                     {'h', "help"});
 
-void ExtractCommand(args::Subparser& parser) {
-  args::ValueFlag<std::filesystem::path> outdir_arg(
+std::uint16_t ParseUInt16(std::string_view s, std::string_view name) {
+  int base = 10;
+  if (s.substr(0, 2) == "0X" || s.substr(0, 2) == "0x") {
+    s.remove_prefix(2);
+    base = 16;
+  }
+  std::uint16_t value = 0;
+  if (auto [ptr, ec] =
+          std::from_chars(s.data(), s.data() + s.size(), value, base);
+      ec != std::errc{} || ptr != s.data() + s.size()) {
+    std::ostringstream message;
+    message << "The " << name << " must be a number from 0 to 65535.";
+    throw std::invalid_argument(message.str());
+  }
+  return value;
+}
+
+// The options of the extraction, which are shared by the extract and batch
+// commands.
+struct ExtractFlags {
+  explicit ExtractFlags(args::Subparser& parser) : parser(parser) {}
+
+  [[nodiscard]] GsfSetOptions Get();
+
+  args::Subparser& parser;
+  args::ValueFlag<std::filesystem::path> outdir_arg{
       parser, "directory",
-      "The output directory (the default is the working directory)", {'d'});
-  args::ValueFlag<std::filesystem::path> basename_arg(
-      parser, "basename", "The output filename (without extension)", {'o'});
-  args::ValueFlag<std::string> entrypoint_arg(
+      "The output directory (the default is the working directory)", {'d'}};
+  args::ValueFlag<std::string> entrypoint_arg{
       parser, "entrypoint",
       "Entrypoint address where the driver is inserted (advanced)",
-      {"entrypoint"});
-  args::ValueFlag<std::string> work_arg(
+      {"entrypoint"}};
+  args::ValueFlag<std::string> work_arg{
       parser, "work",
-      "RAM address that the driver uses as a work space (advanced)", {"work"});
-  args::ValueFlag<std::string> work_size_arg(
+      "RAM address that the driver uses as a work space, or \"auto\" to "
+      "find a free IWRAM block by tracing the RAM used by GAX (advanced)",
+      {"work"}};
+  args::ValueFlag<std::string> work_size_arg{
       parser, "work-size",
-      "RAM block size that the driver uses as a work space (GAX 1 or GAX 2) (advanced)", {"work-size"});
-  args::Positional<std::filesystem::path> input_arg(
-      parser, "romfile", "The ROM file to be processed",
-      args::Options::Required);
-
-  parser.Parse();
+      "RAM block size that the driver uses as a work space (GAX 1 or GAX 2) (advanced)", {"work-size"}};
+  args::Flag verbose_arg{
+      parser, "verbose",
+      "Show the details of the processing, such as the compression ratio of "
+      "each ROM region",
+      {'v', "verbose"}};
+  args::ValueFlag<std::string> compression_arg{
+      parser, "profile",
+      "Compression of the gsflib: fast, default, max or ultra (the smallest "
+      "output, many times slower); the tiny minigsfs do not depend on it",
+      {"compression"}};
+  args::Flag lean_driver_arg{
+      parser, "lean-driver",
+      "Use the driver with a minimal interrupt handler, which serves VBlank "
+      "only and costs less CPU time in players",
+      {"lean-driver"}};
+  args::ValueFlag<std::string> mixing_rate_arg{
+      parser, "hz",
+      "Mixing rate of every song in hertz (5735, 9079, 10513, 11469, 13380, "
+      "15769, 18158, 21025, 26760, 31537, 36316, 40138 or 42049)",
+      {"mixing-rate"}};
+  args::ValueFlag<std::string> volume_arg{
+      parser, "volume",
+      "Volume of every song (the standard volume is 0x100)", {"volume"}};
+  args::Flag low_cpu_arg{
+      parser, "low-cpu",
+      "Lower the mixing rate of songs with many channels, to make the set "
+      "cheaper to play",
+      {"low-cpu"}};
+  args::ValueFlag<std::filesystem::path> manifest_arg{
+      parser, "manifest",
+      "A file that sets the mixing rate and the volume of each song",
+      {"manifest"}};
+  args::ImplicitValueFlag<double> optimize_arg{
+      parser, "seconds",
+      "Remove the ROM data unused by the songs, by playing each song for the "
+      "given time (the default is 180 seconds)",
+      {"optimize"}, GaxRomOptimizer::kDefaultSeconds, 0.0};
+  args::ImplicitValueFlag<double> timing_arg{
+      parser, "seconds",
+      "Detect the loop or the end of each song by emulation and set the "
+      "length/fade tags (the value is the maximum time to play, the default "
+      "is 900 seconds)",
+      {"timing"}, GaxSongTimer::kDefaultSeconds, 0.0};
+  args::ValueFlag<int> loops_arg{
+      parser, "count",
+      "The number of loops for the length tag of looping songs (default: 2)",
+      {"loops"}, GaxSongTimer::kDefaultLoopCount};
+  args::ValueFlag<double> fade_arg{
+      parser, "seconds",
+      "The fade tag of looping songs in seconds (default: 10)", {"fade"},
+      GaxSongTimer::kDefaultFadeSeconds};
+  args::ValueFlag<std::filesystem::path> lib_store_arg{
+      parser, "dir",
+      "Share the gsflib through a store in the directory: the minigsfs refer "
+      "to the gsflib of the same content, which is compressed only once",
+      {"lib-store"}};
+  args::ValueFlag<std::filesystem::path> block_cache_arg{
+      parser, "dir",
+      "Cache the compressed blocks of the gsflib in the directory, so that "
+      "extracting the ROM again with other --entrypoint or --work options "
+      "only compresses the changed blocks",
+      {"block-cache"}};
+  args::ValueFlag<std::filesystem::path> inspect_cache_arg{
+      parser, "dir",
+      "Cache the driver information found in each ROM in the directory, so "
+      "that the ROM is searched only once",
+      {"inspect-cache"}};
+  args::Flag force_arg{
+      parser, "force",
+      "Write every file, even the ones that have not changed since the last "
+      "run",
+      {"force"}};
+  args::ValueFlag<unsigned> threads_arg{
+      parser, "count",
+      "The number of threads that compress the output files (default: all "
+      "cores)",
+      {'j', "threads"}, 0};
+  args::ValueFlag<unsigned> io_threads_arg{
+      parser, "count",
+      "The number of threads that write the compressed files (default: 1)",
+      {"io-threads"}, 1};
+  args::ValueFlag<std::string> fsync_arg{
+      parser, "policy",
+      "Flush the output files to the disk: none (default), file (each file "
+      "when it is closed) or batch (all the files at the end)",
+      {"fsync"}};
+};
 
+GsfSetOptions ExtractFlags::Get() {
   agbptr_t entrypoint = agbnullptr;
   if (entrypoint_arg) {
     std::string_view s{entrypoint_arg.Get()};
@@ -55,7 +171,8 @@ void ExtractCommand(args::Subparser& parser) {
   }
 
   agbptr_t work_address = agbnullptr;
-  if (work_arg) {
+  const bool auto_work_address = work_arg && work_arg.Get() == "auto";
+  if (work_arg && !auto_work_address) {
     std::string_view s{work_arg.Get()};
     if (s.substr(0, 2) == "0X" || s.substr(0, 2) == "0x") s.remove_prefix(2);
     if (auto [ptr, ec] =
@@ -78,6 +195,105 @@ void ExtractCommand(args::Subparser& parser) {
     }
   }
 
+  GsfSetOptions options;
+  options.driver_address = entrypoint;
+  options.work_address = work_address;
+  options.work_size = work_size;
+  options.auto_work_address = auto_work_address;
+  options.lean_driver = lean_driver_arg.Get();
+  options.verbose = verbose_arg.Get();
+  options.outdir = args::get(outdir_arg);
+  options.num_threads = args::get(threads_arg);
+  options.num_io_threads = args::get(io_threads_arg);
+  if (fsync_arg)
+    options.sync = AsyncFileWriter::ParseSyncPolicy(fsync_arg.Get());
+  options.force = force_arg.Get();
+  if (lib_store_arg) options.lib_store = args::get(lib_store_arg);
+  if (block_cache_arg) options.block_cache = args::get(block_cache_arg);
+  if (inspect_cache_arg)
+    options.inspect_cache = args::get(inspect_cache_arg);
+  if (compression_arg)
+    options.compression = ZlibCompressor::ParseProfile(compression_arg.Get());
+
+  if (manifest_arg)
+    options.playback = GaxPlaybackSettings::LoadFromFile(args::get(manifest_arg));
+  if (mixing_rate_arg) {
+    options.playback.set_mixing_rate(
+        ParseUInt16(mixing_rate_arg.Get(), "mixing rate"));
+  }
+  if (volume_arg)
+    options.playback.set_volume(ParseUInt16(volume_arg.Get(), "volume"));
+  options.playback.set_low_cpu(low_cpu_arg.Get());
+
+  if (optimize_arg) {
+    options.optimize_seconds = args::get(optimize_arg);
+    if (options.optimize_seconds <= 0) {
+      throw std::invalid_argument(
+          "The optimization time must be a positive number of seconds.");
+    }
+  }
+
+  if (timing_arg) {
+    options.timing_seconds = args::get(timing_arg);
+    if (options.timing_seconds <= 0) {
+      throw std::invalid_argument(
+          "The timing limit must be a positive number of seconds.");
+    }
+  }
+
+  options.loop_count = args::get(loops_arg);
+  options.fade_seconds = args::get(fade_arg);
+  if (options.loop_count < 1)
+    throw std::invalid_argument("The loop count must be 1 or more.");
+  if (options.fade_seconds < 0)
+    throw std::invalid_argument("The fade time must not be negative.");
+
+  options.gsfby = "Gaxtapper";
+  return options;
+}
+
+constexpr char kLayoutHelp[] =
+    "Put the files in a subdirectory of the output directory, such as "
+    "{prefix}/{region}/{code} (fields: game_code, code, prefix, region, "
+    "shard, title)";
+
+void ExtractCommand(args::Subparser& parser) {
+  ExtractFlags flags{parser};
+  args::ValueFlag<std::filesystem::path> basename_arg(
+      parser, "basename", "The output filename (without extension)", {'o'});
+  args::ValueFlag<std::string> layout_arg(parser, "pattern", kLayoutHelp,
+                                          {"layout"});
+  args::ValueFlag<std::filesystem::path> archive_arg(
+      parser, "archive",
+      "Write the files into a .zip or .tar archive instead of the output "
+      "directory (- writes a tar to the standard output)",
+      {"archive"});
+  args::Positional<std::filesystem::path> input_arg(
+      parser, "romfile", "The ROM file to be processed",
+      args::Options::Required);
+
+  parser.Parse();
+
+  GsfSetOptions options = flags.Get();
+  if (archive_arg) {
+    if (flags.outdir_arg) {
+      throw std::invalid_argument(
+          "The output directory cannot be used with an archive.");
+    }
+    if (flags.lib_store_arg) {
+      throw std::invalid_argument(
+          "The gsflib store cannot be used with an archive.");
+    }
+    options.archive = args::get(archive_arg);
+  }
+  if (layout_arg) {
+    if (archive_arg) {
+      throw std::invalid_argument(
+          "The output layout cannot be used with an archive.");
+    }
+    options.layout = OutputLayout{args::get(layout_arg)};
+  }
+
   const auto in_path = args::get(input_arg);
   if (!exists(in_path)) {
     std::ostringstream message;
@@ -90,20 +306,172 @@ void ExtractCommand(args::Subparser& parser) {
   const std::filesystem::path basename{
       basename_arg ? args::get(basename_arg)
                    : std::filesystem::path{cartridge.full_game_code()}};
-  const std::filesystem::path outdir{args::get(outdir_arg)};
-  const std::string gsfby{"Gaxtapper"};
+  options.rom_name = in_path.filename().u8string();
 
-  Gaxtapper::ConvertToGsfSet(cartridge, basename, entrypoint, work_address,
-                             work_size, outdir, gsfby);
+  Gaxtapper::ConvertToGsfSet(cartridge, basename, options);
+}
+
+void BatchCommand(args::Subparser& parser) {
+  ExtractFlags flags{parser};
+  args::ValueFlag<std::string> layout_arg(parser, "pattern", kLayoutHelp,
+                                          {"layout"});
+  args::ValueFlag<unsigned> read_threads_arg(
+      parser, "count", "The number of threads that read the ROMs (default: 1)",
+      {"read-threads"}, 1);
+  args::ValueFlag<std::size_t> read_ahead_arg(
+      parser, "count",
+      "The number of ROMs that are read ahead of the extraction (default: "
+      "the number of threads)",
+      {"read-ahead"}, 0);
+  args::ValueFlag<std::filesystem::path> report_arg(
+      parser, "file",
+      "Write a report with a line for each ROM (tab-separated, in the order "
+      "of the input) to the file",
+      {"report"});
+  args::ValueFlag<std::string> max_memory_arg(
+      parser, "size",
+      "Start a ROM only while the estimated memory of the ROMs in progress "
+      "stays within the size, such as 2G (default: no limit)",
+      {"max-memory"});
+  args::PositionalList<std::filesystem::path> paths_arg(
+      parser, "romfiles",
+      "The ROM files to be processed, or the directories to be searched for "
+      "them (.gba, .agb and .bin)",
+      args::Options::Required);
+
+  parser.Parse();
+
+  BatchOptions options;
+  options.extract = flags.Get();
+  if (layout_arg) options.extract.layout = OutputLayout{args::get(layout_arg)};
+  options.num_threads = options.extract.num_threads;
+  if (max_memory_arg)
+    options.max_memory = MemoryBudget::ParseSize(max_memory_arg.Get());
+  options.num_read_threads = args::get(read_threads_arg);
+  options.read_ahead = args::get(read_ahead_arg);
+  if (report_arg) options.report = args::get(report_arg);
+  Gaxtapper::Batch(args::get(paths_arg), options);
+}
+
+void BenchmarkCommand(args::Subparser& parser) {
+  args::ValueFlag<double> seconds_arg(
+      parser, "seconds",
+      "The time to play each song (default: 30, 0 skips the playback)",
+      {"seconds"}, GaxBenchmark::kDefaultSeconds);
+  args::ValueFlagList<std::string> compression_arg(
+      parser, "profile",
+      "Measure the compression of the ROM with the profile (fast, default, "
+      "max or ultra); can be given more than once",
+      {"compression"});
+  args::Positional<std::filesystem::path> input_arg(
+      parser, "romfile", "The ROM file to be processed",
+      args::Options::Required);
+
+  parser.Parse();
+
+  const double seconds = args::get(seconds_arg);
+  if (seconds < 0) {
+    throw std::invalid_argument(
+        "The benchmark time must not be a negative number of seconds.");
+  }
+
+  std::vector<ZlibProfile> profiles;
+  for (const std::string& name : args::get(compression_arg))
+    profiles.push_back(ZlibCompressor::ParseProfile(name));
+
+  const auto in_path = args::get(input_arg);
+  if (!exists(in_path)) {
+    std::ostringstream message;
+    message << in_path.string() << ": File does not exist" << std::endl;
+    throw std::runtime_error{message.str()};
+  }
+
+  const Cartridge cartridge = Cartridge::LoadFromFile(in_path);
+  Gaxtapper::Benchmark(cartridge, seconds, profiles);
+}
+
+void TagCommand(args::Subparser& parser) {
+  args::ValueFlagList<std::string> set_arg(
+      parser, "name=value",
+      "Set a tag (an empty value removes the tag); can be given more than "
+      "once",
+      {"set"});
+  args::ValueFlagList<std::string> remove_arg(
+      parser, "name", "Remove a tag; can be given more than once",
+      {"remove"});
+  args::Flag atomic_arg(
+      parser, "atomic",
+      "Write each file to a temporary file and rename it, instead of "
+      "rewriting the tags in place",
+      {"atomic"});
+  args::ValueFlag<unsigned> threads_arg(
+      parser, "count",
+      "The number of threads that process the files (default: all cores)",
+      {'j', "threads"}, 0);
+  args::PositionalList<std::filesystem::path> paths_arg(
+      parser, "files",
+      "The PSF files (gsflib and minigsf) to be processed; their tags are "
+      "listed if no tag is set or removed",
+      args::Options::Required);
+
+  parser.Parse();
+
+  TagOptions options;
+  for (const std::string& tag : args::get(set_arg)) {
+    const std::size_t separator = tag.find('=');
+    if (separator == 0 || separator == std::string::npos) {
+      throw std::invalid_argument("Invalid tag \"" + tag +
+                                  "\" (expected name=value).");
+    }
+    options.set[tag.substr(0, separator)] = tag.substr(separator + 1);
+  }
+  for (const std::string& name : args::get(remove_arg))
+    options.set[name].clear();
+  options.atomic = atomic_arg.Get();
+  options.num_threads = args::get(threads_arg);
+
+  Gaxtapper::Retag(args::get(paths_arg), options);
+}
+
+void VerifyCommand(args::Subparser& parser) {
+  args::Flag deep_arg(
+      parser, "deep",
+      "Inflate the whole exe of each file, which also checks its adler32 and "
+      "size",
+      {"deep"});
+  args::ValueFlag<unsigned> threads_arg(
+      parser, "count",
+      "The number of threads that process the files (default: all cores)",
+      {'j', "threads"}, 0);
+  args::PositionalList<std::filesystem::path> paths_arg(
+      parser, "files",
+      "The GSF files (gsf, gsflib and minigsf) to be verified, or the "
+      "directories to be searched for them",
+      args::Options::Required);
+
+  parser.Parse();
+
+  VerifyOptions options;
+  options.deep = deep_arg.Get();
+  options.num_threads = args::get(threads_arg);
+  Gaxtapper::Verify(args::get(paths_arg), options);
 }
 
 void InspectCommand(args::Subparser& parser) {
   args::PositionalList<std::filesystem::path> paths(
       parser, "romfiles", "The ROM files to be processed");
   args::Flag single_line_arg(parser, "foo", "The foo flag", {'S', "single-line"});
+  args::ValueFlag<std::filesystem::path> inspect_cache_arg(
+      parser, "dir",
+      "Cache the driver information found in each ROM in the directory",
+      {"inspect-cache"});
 
   parser.Parse();
 
+  const std::filesystem::path inspect_cache =
+      inspect_cache_arg ? args::get(inspect_cache_arg)
+                        : std::filesystem::path{};
+
   for (auto&& path : paths) {
     if (!exists(path)) {
       std::cerr << path.string() << ": File does not exist" << std::endl;
@@ -115,20 +483,98 @@ void InspectCommand(args::Subparser& parser) {
       std::cout << "# " << path.stem().string() << " ("
                 << cartridge.full_game_code() << ")" << std::endl
                 << std::endl;
-      Gaxtapper::Inspect(cartridge);
+      Gaxtapper::Inspect(cartridge, inspect_cache);
       std::cout << std::endl;
     }
     else
-      Gaxtapper::InspectSimple(cartridge, path.stem().string());
+      Gaxtapper::InspectSimple(cartridge, path.stem().string(),
+                               inspect_cache);
   }
 }
 
+#ifndef _WIN32
+Server* running_server = nullptr;
+
+void ServeCommand(args::Subparser& parser) {
+  ExtractFlags flags{parser};
+  args::ValueFlag<std::size_t> max_connections_arg(
+      parser, "count",
+      "The number of clients served at the same time; the others get an "
+      "error (default: 64, 0 = no limit)",
+      {"max-connections"}, 64);
+  args::Positional<std::filesystem::path> socket_arg(
+      parser, "socket", "The path of the Unix domain socket to listen on",
+      args::Options::Required);
+
+  parser.Parse();
+
+  ServerOptions options;
+  options.extract = flags.Get();
+  options.num_threads = options.extract.num_threads;
+  options.max_connections = args::get(max_connections_arg);
+  Server server{args::get(socket_arg), options};
+  running_server = &server;
+  const auto stop = [](int) {
+    if (running_server != nullptr) running_server->Stop();
+  };
+  std::signal(SIGINT, stop);
+  std::signal(SIGTERM, stop);
+  std::cerr << "Listening on " << server.socket_path().string() << std::endl;
+  server.Run();
+  std::signal(SIGINT, SIG_DFL);
+  std::signal(SIGTERM, SIG_DFL);
+  running_server = nullptr;
+}
+#endif
+
+void CacheCommand(args::Subparser& parser) {
+  args::Flag prune_arg(
+      parser, "prune",
+      "Remove the entries of another version of the driver search and the "
+      "broken entries",
+      {"prune"});
+  args::ValueFlag<std::string> max_size_arg(
+      parser, "size",
+      "Also remove the least recently used entries until the cache takes "
+      "the size at most, such as 64M",
+      {"max-size"});
+  args::Flag clear_arg(parser, "clear", "Remove every entry", {"clear"});
+  args::Positional<std::filesystem::path> directory_arg(
+      parser, "dir", "The directory of the inspection cache",
+      args::Options::Required);
+
+  parser.Parse();
+
+  const InspectionCache cache{args::get(directory_arg)};
+  if (clear_arg) {
+    std::cout << "Removed " << cache.Clear() << " entries." << std::endl;
+  } else if (prune_arg || max_size_arg) {
+    const std::uintmax_t max_size =
+        max_size_arg ? MemoryBudget::ParseSize(max_size_arg.Get()) : 0;
+    std::cout << "Removed " << cache.Prune(max_size) << " entries."
+              << std::endl;
+  }
+
+  const InspectionCache::Stats stats = cache.Scan();
+  std::cout << "Entries: " << stats.num_entries << " (" << stats.num_stale
+            << " stale, " << stats.num_broken << " broken)" << std::endl
+            << "Size: " << stats.size << " bytes" << std::endl;
+}
+
 int main(int argc, const char** argv) {
   args::ArgumentParser parser(
       "An automated GSF ripper for GAX Sound Engine by Shin'en Multimedia.");
   args::Group commands(parser, "commands");
   args::Command extract(commands, "extract", "Extract songs as gsflib and minigsfs", &ExtractCommand);
+  args::Command batch(commands, "batch", "Extract the songs of many ROMs at once, sharing the threads", &BatchCommand);
   args::Command inspect(commands, "inspect", "Display the driver code/data information in ROM", &InspectCommand);
+#ifndef _WIN32
+  args::Command serve(commands, "serve", "Answer inspect/extract requests on a Unix domain socket", &ServeCommand);
+#endif
+  args::Command cache(commands, "cache", "Show, prune or clear an inspection cache (--inspect-cache)", &CacheCommand);
+  args::Command tag(commands, "tag", "Change the tags of gsflib/minigsf files without recompressing them", &TagCommand);
+  args::Command verify(commands, "verify", "Check gsflib/minigsf files for truncation and corruption", &VerifyCommand);
+  args::Command benchmark(commands, "benchmark", "Measure the CPU cost of the playback per second of audio", &BenchmarkCommand);
   args::GlobalOptions globals(parser, arguments);
 
   try {